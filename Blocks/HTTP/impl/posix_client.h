@@ -36,6 +36,8 @@ SOFTWARE.
 
 #include "../../URL/url.h"
 
+#include "posix_client_pool.h"
+
 #include "../../../Bricks/net/http/http.h"
 #include "../../../Bricks/file/file.h"
 
@@ -94,54 +96,43 @@ class GenericHTTPClientPOSIX final {
           port = 80;
         }
       }
-      current::net::Connection connection(
-          current::net::Connection(current::net::ClientSocket(parsed_url.host, port)));
-      connection.BlockingWrite(
-          request_method_ + ' ' + parsed_url.path + parsed_url.ComposeParameters() + " HTTP/1.1\r\n", true);
-      connection.BlockingWrite("Host: " + parsed_url.host + "\r\n", true);
-      if (!request_user_agent_.empty()) {
-        connection.BlockingWrite("User-Agent: " + request_user_agent_ + "\r\n", true);
-      }
-      for (const auto& h : request_headers_) {
-        connection.BlockingWrite(h.header + ": " + h.value + "\r\n", true);
-      }
-      if (!request_headers_.cookies.empty()) {
-        connection.BlockingWrite("Cookie: " + request_headers_.CookiesAsString() + "\r\n", true);
-      }
-      if (!request_body_content_type_.empty()) {
-        connection.BlockingWrite("Content-Type: " + request_body_content_type_ + "\r\n", true);
-      }
-      if (!request_body_contents_.empty()) {
-        // NOTE(dkorolev): The `try/catch/throw` combo here is a hack for the unit test for HTTP 413 to pass.
-        // It swallows the `SocketWriteException` exception for huge payloads, as Current's HTTP server logic
-        // does intentionally close the HTTP connection prematurely if `Content-Length` exceeds a reasonable limit.
+      // A connection from the pool may have been closed by the server right as it was being reused, with the client
+      // not yet aware of it. Thus, if the request over a reused connection fails before any byte of the response has
+      // been read, it is retried once, over a new connection. The request that could not be sent in full is always
+      // retried, as the server could not have acted upon it. The request with no response is only retried if it is
+      // idempotent, as the server may have served it already.
+      for (bool reuse_idle = true;; reuse_idle = false) {
+        auto pooled_connection = pool_connection_
+                                     ? HTTPClientConnections().Acquire(parsed_url.host, port, reuse_idle)
+                                     : HTTPClientConnections().AcquireUnpooled(parsed_url.host, port);
         try {
-#ifndef CURRENT_WINDOWS
-          connection.BlockingWrite("Content-Length: " + std::to_string(request_body_contents_.length()) + "\r\n", true);
-          connection.BlockingWrite("\r\n", true);
-          connection.BlockingWrite(request_body_contents_, false);
-#else
-          // TODO(grixa): this fix for the PayloadTooLarge test on Windows is temporary, need to revisit it.
-          connection.BlockingWrite("Content-Length: " + std::to_string(request_body_contents_.length()) + "\r\n\r\n" +
-                                       request_body_contents_,
-                                   false);
-#endif
-        } catch (const net::SocketWriteException&) {
-          if (request_body_contents_.length() <= net::constants::kMaxHTTPPayloadSizeInBytes) {
+          SendRequest(pooled_connection.Connection(), parsed_url);
+          http_request_.reset(
+              new CustomHTTPRequestData(pooled_connection.Connection(), request_data_construction_params_));
+        } catch (const current::net::SocketWriteException&) {
+          if (!pooled_connection.IsReused()) {
+            throw;
+          }
+          continue;
+        } catch (const current::net::EmptySocketException&) {
+          if (!pooled_connection.IsReused() || !IsIdempotentMethod(request_method_)) {
             throw;
           }
+          continue;
         }
-      } else {
-        connection.BlockingWrite("\r\n", false);
+        if (request_method_ != "HEAD" && http_request_->KeepAliveRequested() && http_request_->BodyLengthKnown() &&
+            !http_request_->HasPipelinedData()) {
+          pooled_connection.SetReusable();
+        }
+        break;
       }
-      http_request_.reset(new CustomHTTPRequestData(connection, request_data_construction_params_));
       // TODO(dkorolev): Rename `Path()`, it's only called so now because of HTTP request/response format.
       // Elaboration:
       // HTTP request  message is: `GET /path HTTP/1.1`, "/path" is the second component of it.
       // HTTP response message is: `HTTP/1.1 200 OK`, "200" is the second component of it.
       // Thus, since the same code is used for request and response parsing as of now,
       // the numerical response code "200" can be accessed with the same method as the "/path".
-      const int response_code_as_int = atoi(http_request_->RawPath().c_str());
+      const int response_code_as_int = atoi(http_request_->RawPathView().c_str());
       response_code_ = HTTPResponseCode(response_code_as_int);
       // Follow the redirects automatically.
       // Note: This is by no means a complete redirect implementation.
@@ -159,6 +150,52 @@ class GenericHTTPClientPOSIX final {
 
   const CustomHTTPRequestData& HTTPRequest() const { return *http_request_.get(); }
 
+ private:
+  static bool IsIdempotentMethod(const std::string& method) {
+    return method == "GET" || method == "HEAD" || method == "PUT" || method == "DELETE" || method == "OPTIONS";
+  }
+
+  void SendRequest(current::net::Connection& connection, const URL& parsed_url) {
+    connection.BlockingWrite(
+        request_method_ + ' ' + parsed_url.path + parsed_url.ComposeParameters() + " HTTP/1.1\r\n", true);
+    connection.BlockingWrite("Host: " + parsed_url.host + "\r\n", true);
+    if (!request_user_agent_.empty()) {
+      connection.BlockingWrite("User-Agent: " + request_user_agent_ + "\r\n", true);
+    }
+    for (const auto& h : request_headers_) {
+      connection.BlockingWrite(h.header + ": " + h.value + "\r\n", true);
+    }
+    if (!request_headers_.cookies.empty()) {
+      connection.BlockingWrite("Cookie: " + request_headers_.CookiesAsString() + "\r\n", true);
+    }
+    if (!request_body_content_type_.empty()) {
+      connection.BlockingWrite("Content-Type: " + request_body_content_type_ + "\r\n", true);
+    }
+    if (!request_body_contents_.empty()) {
+      // NOTE(dkorolev): The `try/catch/throw` combo here is a hack for the unit test for HTTP 413 to pass.
+      // It swallows the `SocketWriteException` exception for huge payloads, as Current's HTTP server logic
+      // does intentionally close the HTTP connection prematurely if `Content-Length` exceeds a reasonable limit.
+      try {
+#ifndef CURRENT_WINDOWS
+        connection.BlockingWrite("Content-Length: " + std::to_string(request_body_contents_.length()) + "\r\n", true);
+        connection.BlockingWrite("\r\n", true);
+        connection.BlockingWrite(request_body_contents_, false);
+#else
+        // TODO(grixa): this fix for the PayloadTooLarge test on Windows is temporary, need to revisit it.
+        connection.BlockingWrite("Content-Length: " + std::to_string(request_body_contents_.length()) + "\r\n\r\n" +
+                                     request_body_contents_,
+                                 false);
+#endif
+      } catch (const net::SocketWriteException&) {
+        if (request_body_contents_.length() <= net::constants::kMaxHTTPPayloadSizeInBytes) {
+          throw;
+        }
+      }
+    } else {
+      connection.BlockingWrite("\r\n", false);
+    }
+  }
+
  public:
   // Request parameters.
   std::string request_method_ = "";
@@ -169,6 +206,8 @@ class GenericHTTPClientPOSIX final {
   current::net::http::Headers request_headers_;
   const typename HTTP_HELPER::ConstructionParams request_data_construction_params_;
   bool allow_redirects_ = false;
+  // Set to false for the long-living streaming responses, so that they do not hold up the slots of the pool.
+  bool pool_connection_ = true;
 
   // Output parameters.
   current::net::HTTPResponseCodeValue response_code_ = HTTPResponseCode.InvalidCode;
@@ -0,0 +1,230 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Dmitry "Dima" Korolev, <dmitry.korolev@gmail.com>.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The process-wide pool of persistent connections used by the POSIX HTTP client.
+//
+// A connection is returned to the pool once a response has been read from it in full, and the server has not asked
+// to close it. The next request to the same host and port reuses the most recently returned connection, unless it has
+// been idle for longer than `idle_timeout`, or has been closed by the server meanwhile.
+//
+// The total number of connections to a single host, idle ones included, is capped by `max_connections_per_host`.
+// Once the cap is reached, further requests to this host wait until one of its connections is returned or closed,
+// but for no longer than `max_wait_for_connection`, and then go over a new connection outside the pool.
+// The long-living streaming responses, such as the ones of `ChunkedGET`, do not count towards this cap, as they use
+// the connections opened outside the pool via `AcquireUnpooled()`.
+
+#ifndef BLOCKS_HTTP_IMPL_POSIX_CLIENT_POOL_H
+#define BLOCKS_HTTP_IMPL_POSIX_CLIENT_POOL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "../../../Bricks/net/tcp/tcp.h"
+#include "../../../Bricks/util/singleton.h"
+
+namespace current {
+namespace http {
+
+struct HTTPClientConnectionPoolParams {
+  // The maximum number of idle connections to keep per host. Zero disables the reuse of connections.
+  size_t max_idle_connections_per_host;
+  // The maximum number of connections to a single host at any moment, idle ones included. Zero for no limit.
+  size_t max_connections_per_host;
+  // Idle connections are closed after this long. Should be shorter than the idle timeout of the server.
+  std::chrono::milliseconds idle_timeout;
+  // Once `max_connections_per_host` is reached, how long to wait for a connection before opening an unpooled one.
+  std::chrono::milliseconds max_wait_for_connection;
+
+  explicit HTTPClientConnectionPoolParams(
+      size_t max_idle_connections_per_host = 32u,
+      size_t max_connections_per_host = 256u,
+      std::chrono::milliseconds idle_timeout = std::chrono::milliseconds(4000),
+      std::chrono::milliseconds max_wait_for_connection = std::chrono::milliseconds(1000))
+      : max_idle_connections_per_host(max_idle_connections_per_host),
+        max_connections_per_host(max_connections_per_host),
+        idle_timeout(idle_timeout),
+        max_wait_for_connection(max_wait_for_connection) {}
+};
+
+class HTTPClientConnectionPool final {
+ private:
+  using clock_t = std::chrono::steady_clock;
+
+  struct IdleConnection {
+    std::unique_ptr<current::net::Connection> connection;
+    clock_t::time_point since;
+  };
+
+  struct PerHost {
+    size_t connections = 0u;  // Both idle and in use.
+    std::deque<IdleConnection> idle;
+  };
+
+ public:
+  // A connection checked out of the pool. Once destructed, it goes back to the pool if `SetReusable()` was called,
+  // and is closed otherwise. The connections opened outside the pool, with an empty `key`, are always closed.
+  class PooledConnection final {
+   public:
+    PooledConnection(HTTPClientConnectionPool& pool,
+                     std::string key,
+                     std::unique_ptr<current::net::Connection> connection,
+                     bool reused)
+        : pool_(pool), key_(std::move(key)), connection_(std::move(connection)), reused_(reused) {}
+    PooledConnection(PooledConnection&& rhs)
+        : pool_(rhs.pool_),
+          key_(std::move(rhs.key_)),
+          connection_(std::move(rhs.connection_)),
+          reused_(rhs.reused_),
+          reusable_(rhs.reusable_) {
+      rhs.key_.clear();
+    }
+    ~PooledConnection() {
+      if (!key_.empty()) {
+        pool_.Return(key_, std::move(connection_), reusable_);
+      }
+    }
+
+    current::net::Connection& Connection() { return *connection_; }
+
+    // Whether this connection has served requests before, so that a failure to use it may just mean
+    // the server has closed it while it was idle.
+    bool IsReused() const { return reused_; }
+
+    void SetReusable() { reusable_ = true; }
+
+   private:
+    HTTPClientConnectionPool& pool_;
+    std::string key_;
+    std::unique_ptr<current::net::Connection> connection_;
+    const bool reused_;
+    bool reusable_ = false;
+  };
+
+  void SetParams(const HTTPClientConnectionPoolParams& params) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    params_ = params;
+  }
+
+  HTTPClientConnectionPoolParams Params() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return params_;
+  }
+
+  size_t IdleConnectionsCount(const std::string& host, int port) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto cit = hosts_.find(Key(host, port));
+    return cit != hosts_.end() ? cit->second.idle.size() : 0u;
+  }
+
+  // Closes all the idle connections.
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& host : hosts_) {
+      host.second.connections -= host.second.idle.size();
+      host.second.idle.clear();
+    }
+    cv_.notify_all();
+  }
+
+  // Returns an idle connection to this host, unless `reuse_idle` is false, or opens a new one.
+  PooledConnection Acquire(const std::string& host, int port, bool reuse_idle = true) {
+    std::string key = Key(host, port);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      PerHost& per_host = hosts_[key];
+      const clock_t::time_point wait_deadline = clock_t::now() + params_.max_wait_for_connection;
+      while (true) {
+        while (reuse_idle && !per_host.idle.empty()) {
+          IdleConnection idle = std::move(per_host.idle.back());
+          per_host.idle.pop_back();
+          // Do not reuse the connection the server has closed meanwhile, or has sent something unexpected over.
+          current::net::Connection& connection = *idle.connection;
+          if (clock_t::now() - idle.since < params_.idle_timeout && !connection.ClosedByPeer() &&
+              !connection.WaitUntilReadable(std::chrono::milliseconds(0))) {
+            return PooledConnection(*this, key, std::move(idle.connection), true);
+          }
+          --per_host.connections;
+        }
+        if (!params_.max_connections_per_host || per_host.connections < params_.max_connections_per_host) {
+          ++per_host.connections;
+          break;
+        }
+        if (cv_.wait_until(lock, wait_deadline) == std::cv_status::timeout) {
+          key.clear();
+          break;
+        }
+      }
+    }
+    std::unique_ptr<current::net::Connection> connection;
+    try {
+      connection.reset(new current::net::Connection(current::net::ClientSocket(host, port)));
+    } catch (const current::Exception&) {
+      if (!key.empty()) {
+        Return(key, nullptr, false);
+      }
+      throw;
+    }
+    return PooledConnection(*this, key, std::move(connection), false);
+  }
+
+  // Opens a new connection outside the pool, which is closed once done with.
+  PooledConnection AcquireUnpooled(const std::string& host, int port) {
+    std::unique_ptr<current::net::Connection> connection(
+        new current::net::Connection(current::net::ClientSocket(host, port)));
+    return PooledConnection(*this, std::string(), std::move(connection), false);
+  }
+
+ private:
+  static std::string Key(const std::string& host, int port) { return host + ':' + std::to_string(port); }
+
+  void Return(const std::string& key, std::unique_ptr<current::net::Connection> connection, bool reusable) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      PerHost& per_host = hosts_[key];
+      if (connection && reusable && per_host.idle.size() < params_.max_idle_connections_per_host) {
+        per_host.idle.push_back(IdleConnection{std::move(connection), clock_t::now()});
+      } else {
+        --per_host.connections;
+      }
+    }
+    cv_.notify_one();
+  }
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  HTTPClientConnectionPoolParams params_;
+  std::map<std::string, PerHost> hosts_;
+};
+
+inline HTTPClientConnectionPool& HTTPClientConnections() { return current::Singleton<HTTPClientConnectionPool>(); }
+
+}  // namespace http
+}  // namespace current
+
+#endif  // BLOCKS_HTTP_IMPL_POSIX_CLIENT_POOL_H
@@ -29,21 +29,28 @@ SOFTWARE.
 #define BLOCKS_HTTP_IMPL_POSIX_SERVER_H
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 #include <iostream>  // TODO(dkorolev): More robust logging here.
 
 #include "../types.h"
 #include "../request.h"
 
+#include "posix_server_event_loop.h"
+
 #include "../../URL/url.h"
 
 #include "../../../Bricks/net/exceptions.h"
 #include "../../../Bricks/net/http/http.h"
 #include "../../../Bricks/time/chrono.h"
 #include "../../../Bricks/strings/printf.h"
+#include "../../../Bricks/sync/locks.h"
 #include "../../../Bricks/util/accumulative_scoped_deleter.h"
 
 namespace current {
@@ -154,6 +161,20 @@ struct StaticFileServer {
   }
 };
 
+// The opt-in pool of worker threads for `HTTPServerPOSIX`, set per port via `HTTP(port).UseWorkerPool(...)`.
+struct HTTPServerWorkerPoolParams {
+  // The number of threads to read requests and run handlers on. Zero serves requests from the listening thread.
+  size_t workers;
+  // The maximum number of accepted connections waiting for a worker. Once it is reached, the listening thread
+  // stops accepting until a worker frees up a slot, and further connections wait in the listen backlog.
+  size_t max_queue_depth;
+
+  explicit HTTPServerWorkerPoolParams(size_t workers = 0u, size_t max_queue_depth = 1024u)
+      : workers(workers), max_queue_depth(max_queue_depth) {
+    CURRENT_ASSERT(max_queue_depth > 0u);
+  }
+};
+
 // HTTP server bound to a specific port.
 class HTTPServerPOSIX final {
  public:
@@ -186,6 +207,20 @@ class HTTPServerPOSIX final {
     if (thread_.joinable()) {
       thread_.join();
     }
+    // Serve the already accepted connections, if any, and stop the workers.
+    UseWorkerPool(HTTPServerWorkerPoolParams());
+#ifdef CURRENT_POSIX
+    UseEventLoop(HTTPServerEventLoopParams());
+#endif
+    // Wait for the worker pools and the event loops replaced from their own threads to be torn down.
+    std::vector<std::thread> teardown_threads;
+    {
+      std::lock_guard<std::mutex> lock(worker_pool_mutex_);
+      teardown_threads.swap(teardown_threads_);
+    }
+    for (auto& thread : teardown_threads) {
+      thread.join();
+    }
   }
 
   // The bare `Join()` method is only used by small scripts to run the server indefinitely,
@@ -196,6 +231,68 @@ class HTTPServerPOSIX final {
   }
   // LCOV_EXCL_STOP
 
+  // By default, the listening thread reads each request and runs its handler before accepting the next connection.
+  // With `params.workers > 0`, accepted connections are handed over to a fixed-size pool of threads instead,
+  // so that a slow client or a slow handler does not stall other requests to this port.
+  // May be called at any time, including from the handlers. Once the worker pool is replaced, its already accepted
+  // connections are still served.
+  void UseWorkerPool(const HTTPServerWorkerPoolParams& params) {
+    std::shared_ptr<WorkerPool> previous_pool;
+    {
+      std::lock_guard<std::mutex> lock(worker_pool_mutex_);
+      previous_pool = std::move(worker_pool_);
+      if (params.workers) {
+        worker_pool_ = std::make_shared<WorkerPool>(*this, params);
+      }
+      if (previous_pool && previous_pool->RunsOnThisThread()) {
+        // Called by a handler run by the previous pool, which can not join the very thread it runs on.
+        teardown_threads_.emplace_back([](std::shared_ptr<WorkerPool> pool) { pool.reset(); },
+                                       std::move(previous_pool));
+      }
+    }
+    // The previous pool, if any, completes its queue and joins its threads as the last reference to it is gone.
+  }
+
+#ifdef CURRENT_POSIX
+  // With `params.threads > 0`, accepted connections are served by event loops instead, see `posix_server_event_loop.h`,
+  // so that many concurrent connections, such as long-lived chunked subscriptions, hold no threads while idle.
+  // Takes precedence over the worker pool. The handlers registered with `Register()` are run as they are.
+  // May be called at any time, including from the handlers. Once the event loops are replaced, the connections they
+  // were serving are closed.
+  void UseEventLoop(const HTTPServerEventLoopParams& params) {
+    std::shared_ptr<HTTPServerEventLoop> previous_event_loop;
+    {
+      std::lock_guard<std::mutex> lock(worker_pool_mutex_);
+      previous_event_loop = std::move(event_loop_);
+      if (params.threads) {
+        event_loop_ = std::make_shared<HTTPServerEventLoop>(
+            params,
+            [this](current::net::Connection&& connection, std::shared_ptr<current::net::HTTPKeepAliveState> state) {
+              ServeRequest(std::move(connection), std::move(state));
+            });
+      }
+      if (previous_event_loop && previous_event_loop->RunsOnThisThread()) {
+        // Called by a handler run by the previous event loops, which can not join the very thread they run on.
+        teardown_threads_.emplace_back([](std::shared_ptr<HTTPServerEventLoop> event_loop) { event_loop.reset(); },
+                                       std::move(previous_event_loop));
+      }
+    }
+  }
+#endif
+
+  // By default, the connection is closed once the response is sent. With `params.Enabled()`, up to
+  // `params.max_requests_per_connection` requests are served over each HTTP/1.1 connection, including pipelined ones,
+  // as long as their responses are sent from the handlers, and not from other threads after the handlers return.
+  // Such responses say `Connection: close`, and so do the chunked responses served by the worker pool, as these may
+  // well be sent from other threads for as long as they last, as with the subscriptions to the streams.
+  // Only applies to the connections served by the worker pool or by the event loops, see `UseWorkerPool()` and
+  // `UseEventLoop()`. The requests served from the listening thread are always closed after the response, as an idle
+  // kept alive connection would otherwise stop the listening thread from accepting other connections.
+  void UseKeepAlive(const current::net::HTTPKeepAliveParams& params) {
+    std::lock_guard<std::mutex> lock(worker_pool_mutex_);
+    keep_alive_params_ = params;
+  }
+
   // Scoped de-registerer of routes, of its own type.
   struct ScopedRegistererDifferentiator {};
   using HTTPRoutesScope = current::AccumulativeScopedDeleter<ScopedRegistererDifferentiator>;
@@ -214,7 +311,7 @@ class HTTPServerPOSIX final {
   HTTPRoutesScopeEntry Register(const std::string& path,
                                 const URLPathArgs::CountMask path_args_count_mask,
                                 F& handler) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<current::locks::SharedMutex> lock(mutex_);
     return DoRegisterHandler(path, [&handler](Request r) { handler(std::move(r)); }, path_args_count_mask, POLICY);
   }
 
@@ -222,26 +319,26 @@ class HTTPServerPOSIX final {
   HTTPRoutesScopeEntry Register(const std::string& path,
                                 const URLPathArgs::CountMask path_args_count_mask,
                                 std::function<void(Request)> handler) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<current::locks::SharedMutex> lock(mutex_);
     return DoRegisterHandler(path, handler, path_args_count_mask, POLICY);
   }
 
   // Two argument version registers handler with no URL path arguments.
   template <ReRegisterRoute POLICY = ReRegisterRoute::ThrowOnAttempt, typename F>
   HTTPRoutesScopeEntry Register(const std::string& path, F& handler) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<current::locks::SharedMutex> lock(mutex_);
     return DoRegisterHandler(
         path, [&handler](Request r) { handler(std::move(r)); }, URLPathArgs::CountMask::None, POLICY);
   }
   template <ReRegisterRoute POLICY = ReRegisterRoute::ThrowOnAttempt>
   HTTPRoutesScopeEntry Register(const std::string& path, std::function<void(Request)> handler) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<current::locks::SharedMutex> lock(mutex_);
     return DoRegisterHandler(path, handler, URLPathArgs::CountMask::None, POLICY);
   }
 
   void UnRegister(const std::string& path,
                   const URLPathArgs::CountMask path_args_count_mask = URLPathArgs::CountMask::None) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<current::locks::SharedMutex> lock(mutex_);
     URLPathArgs::CountMask mask = URLPathArgs::CountMask::None;  // `None` == 1 == (1 << 0).
     for (size_t i = 0; i <= URLPathArgs::MaxArgsCount; ++i, mask <<= 1) {
       if ((path_args_count_mask & mask) == mask) {
@@ -341,7 +438,7 @@ class HTTPServerPOSIX final {
   size_t PathHandlersCount() const {
     // NOTE: The total number of handlers is no longer an interesting measure.
     //       Just return the number of distinct paths, which may be path prefixes.
-    std::lock_guard<std::mutex> lock(mutex_);
+    current::locks::SharedLockGuard<> lock(mutex_);
     return handlers_.size();
   }
 
@@ -392,63 +489,108 @@ class HTTPServerPOSIX final {
     }
   }
 
+  // The pool of threads serving the accepted connections, see `UseWorkerPool()`.
+  class WorkerPool final {
+   public:
+    WorkerPool(HTTPServerPOSIX& server, const HTTPServerWorkerPoolParams& params)
+        : server_(server), max_queue_depth_(params.max_queue_depth) {
+      for (size_t i = 0u; i < params.workers; ++i) {
+        threads_.emplace_back(&WorkerPool::Thread, this);
+      }
+    }
+
+    // Whether called from one of the threads of this pool, i.e., by a handler it runs.
+    bool RunsOnThisThread() const {
+      const auto id = std::this_thread::get_id();
+      for (const auto& thread : threads_) {
+        if (thread.get_id() == id) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    ~WorkerPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+      }
+      queue_not_empty_.notify_all();
+      for (auto& thread : threads_) {
+        thread.join();
+      }
+    }
+
+    // Blocks while the queue is full.
+    void Push(current::net::Connection&& connection) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        queue_not_full_.wait(lock, [this]() { return queue_.size() < max_queue_depth_; });
+        queue_.push_back(std::move(connection));
+      }
+      queue_not_empty_.notify_one();
+    }
+
+   private:
+    void Thread() {
+      while (true) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        queue_not_empty_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;  // Stopping, and everything accepted has been served.
+        }
+        current::net::Connection connection(std::move(queue_.front()));
+        queue_.pop_front();
+        lock.unlock();
+        queue_not_full_.notify_one();
+        server_.ServeConnection(std::move(connection), true);
+      }
+    }
+
+    HTTPServerPOSIX& server_;
+    const size_t max_queue_depth_;
+    std::mutex mutex_;
+    std::condition_variable queue_not_empty_;
+    std::condition_variable queue_not_full_;
+    std::deque<current::net::Connection> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+  };
+
   void Thread(current::net::Socket socket) {
-    // TODO(dkorolev): Benchmark QPS.
     while (!terminating_) {
       try {
-        std::unique_ptr<current::net::HTTPServerConnection> connection(
-            new current::net::HTTPServerConnection(socket.Accept()));
+        current::net::Connection connection(socket.Accept());
         if (terminating_) {
           // Already terminating. Will not send the response, and this
           // lack of response should not result in an exception.
-          connection->DoNotSendAnyResponse();
+          current::net::HTTPServerConnection(std::move(connection)).DoNotSendAnyResponse();
           break;
         }
-        std::function<void(Request)> handler;
-        URLPathArgs url_path_args;
+        std::shared_ptr<WorkerPool> worker_pool;
+#ifdef CURRENT_POSIX
+        std::shared_ptr<HTTPServerEventLoop> event_loop;
+        current::net::HTTPKeepAliveParams keep_alive_params;
+#endif
         {
-          // TODO(dkorolev): Read-write lock for performance?
-          std::lock_guard<std::mutex> lock(mutex_);
-          FindHandler(connection->HTTPRequest().URL().path, handler, url_path_args);
+          std::lock_guard<std::mutex> lock(worker_pool_mutex_);
+          worker_pool = worker_pool_;
+#ifdef CURRENT_POSIX
+          event_loop = event_loop_;
+          keep_alive_params = keep_alive_params_;
+#endif
         }
-        if (handler) {
-          // OK, here's the tricky part with error handling and exceptions in this multithreaded world.
-          // * On the one hand, the connection should be std::move-d into the request,
-          //   since it might end up being served in another thread, via a message queue, etc.
-          //   Thus, the user code is responsible for closing the connection.
-          //   Not to mention that the std::move-d away connection can easily outlive this scope.
-          // * On the other hand, if an exception occurs in user code, we need to return a 500,
-          //   which should obviously happen before the connection object is destructed.
-          //   This seems like a good reason to not std::move it away, or move it away with some flag,
-          //   but I thought hard of it, and don't think it's a good choice -- D.K.
-          //
-          // Solution: Do nothing here. No matter how tempting it is, it won't work across threads. Period.
-          //
-          // The implementation of HTTP connection will return an "INTERNAL SERVER ERROR"
-          // if no response was sent. That's what the user gets. In debugger, they can put a breakpoint there
-          // and see what caused the error.
-          //
-          // It is the job of the user of this library to ensure no exceptions leave their code.
-          // In practice, a top-level try-catch for `const current::Exception& e` is good enough.
-          try {
-            handler(Request(std::move(connection), url_path_args));
-          } catch (const current::Exception& e) {  // LCOV_EXCL_LINE
-            // WARNING: This `catch` is really not sufficient, it just logs a message
-            // if a user exception occurred in the same thread that ran the handler.
-            // DO NOT COUNT ON IT.
-            std::cerr << "HTTP route failed in user code: " << e.what() << '\n';  // LCOV_EXCL_LINE
-          }
+#ifdef CURRENT_POSIX
+        if (event_loop) {
+          event_loop->Add(std::move(connection), keep_alive_params);
+          continue;
+        }
+#endif
+        if (worker_pool) {
+          worker_pool->Push(std::move(connection));
         } else {
-          connection->SendHTTPResponse(current::net::DefaultNotFoundMessage(),
-                                       HTTPResponseCode.NotFound,
-                                       current::net::constants::kDefaultHTMLContentType);
+          ServeConnection(std::move(connection), false);
         }
-      } catch (const current::net::ChunkSizeNotAValidHEXValue&) {
-        // The `ChunkSizeNotAValidHEXValue` situation, if emerged, is already handled with a "400 BAD REQUEST" response.
-      } catch (const current::net::HTTPPayloadTooLarge&) {
-        // The `HTTPPayloadTooLarge` situation, if emerged, is already handled with a "413 ENTITY TOO LARGE" response.
-      } catch (const current::net::EmptySocketException&) {  // LCOV_EXCL_LINE
-        // Silently discard errors if no data was sent in.
       } catch (const current::Exception& e) {  // LCOV_EXCL_LINE
         // TODO(dkorolev): More reliable logging.
         std::cerr << "HTTP route failed: " << e.what() << '\n';  // LCOV_EXCL_LINE
@@ -456,6 +598,89 @@ class HTTPServerPOSIX final {
     }
   }
 
+  // Serves the request(s) from the accepted connection. Runs either in the listening thread, with `can_keep_alive`
+  // unset, or in one of the threads of the worker pool.
+  void ServeConnection(current::net::Connection&& accepted_connection, bool can_keep_alive) {
+    std::shared_ptr<current::net::HTTPKeepAliveState> keep_alive;
+    if (can_keep_alive) {
+      std::lock_guard<std::mutex> lock(worker_pool_mutex_);
+      if (keep_alive_params_.Enabled()) {
+        keep_alive = std::make_shared<current::net::HTTPKeepAliveState>(keep_alive_params_);
+      }
+    }
+    if (!keep_alive) {
+      ServeRequest(std::move(accepted_connection), nullptr);
+    } else {
+      std::unique_ptr<current::net::Connection> connection(
+          new current::net::Connection(std::move(accepted_connection)));
+      while (connection) {
+        ServeRequest(std::move(*connection), keep_alive);
+        connection = keep_alive->TakeReleasedConnection();
+        if (connection && !keep_alive->HasPipelinedData() &&
+            !connection->WaitUntilReadable(keep_alive->Params().idle_timeout)) {
+          // The connection has been idle for too long.
+          break;
+        }
+      }
+    }
+  }
+
+  // Reads one request from the connection and runs its handler.
+  void ServeRequest(current::net::Connection&& accepted_connection,
+                    std::shared_ptr<current::net::HTTPKeepAliveState> keep_alive) {
+    try {
+      std::unique_ptr<current::net::HTTPServerConnection> connection(
+          new current::net::HTTPServerConnection(std::move(accepted_connection), std::move(keep_alive)));
+      std::function<void(Request)> handler;
+      URLPathArgs url_path_args;
+      {
+        current::locks::SharedLockGuard<> lock(mutex_);
+        FindHandler(connection->HTTPRequest().URL().path, handler, url_path_args);
+      }
+      if (handler) {
+        // OK, here's the tricky part with error handling and exceptions in this multithreaded world.
+        // * On the one hand, the connection should be std::move-d into the request,
+        //   since it might end up being served in another thread, via a message queue, etc.
+        //   Thus, the user code is responsible for closing the connection.
+        //   Not to mention that the std::move-d away connection can easily outlive this scope.
+        // * On the other hand, if an exception occurs in user code, we need to return a 500,
+        //   which should obviously happen before the connection object is destructed.
+        //   This seems like a good reason to not std::move it away, or move it away with some flag,
+        //   but I thought hard of it, and don't think it's a good choice -- D.K.
+        //
+        // Solution: Do nothing here. No matter how tempting it is, it won't work across threads. Period.
+        //
+        // The implementation of HTTP connection will return an "INTERNAL SERVER ERROR"
+        // if no response was sent. That's what the user gets. In debugger, they can put a breakpoint there
+        // and see what caused the error.
+        //
+        // It is the job of the user of this library to ensure no exceptions leave their code.
+        // In practice, a top-level try-catch for `const current::Exception& e` is good enough.
+        try {
+          handler(Request(std::move(connection), url_path_args));
+        } catch (const current::Exception& e) {  // LCOV_EXCL_LINE
+          // WARNING: This `catch` is really not sufficient, it just logs a message
+          // if a user exception occurred in the same thread that ran the handler.
+          // DO NOT COUNT ON IT.
+          std::cerr << "HTTP route failed in user code: " << e.what() << '\n';  // LCOV_EXCL_LINE
+        }
+      } else {
+        connection->SendHTTPResponse(current::net::DefaultNotFoundMessage(),
+                                     HTTPResponseCode.NotFound,
+                                     current::net::constants::kDefaultHTMLContentType);
+      }
+    } catch (const current::net::ChunkSizeNotAValidHEXValue&) {
+      // The `ChunkSizeNotAValidHEXValue` situation, if emerged, is already handled with a "400 BAD REQUEST" response.
+    } catch (const current::net::HTTPPayloadTooLarge&) {
+      // The `HTTPPayloadTooLarge` situation, if emerged, is already handled with a "413 ENTITY TOO LARGE" response.
+    } catch (const current::net::EmptySocketException&) {  // LCOV_EXCL_LINE
+      // Silently discard errors if no data was sent in.
+    } catch (const current::Exception& e) {  // LCOV_EXCL_LINE
+      // TODO(dkorolev): More reliable logging.
+      std::cerr << "HTTP route failed: " << e.what() << '\n';  // LCOV_EXCL_LINE
+    }
+  }
+
   void ValidateRoute(const std::string& path) {
     if (path.empty() || path[0] != '/') {
       CURRENT_THROW(PathDoesNotStartWithSlash("HTTP URL path does not start with a slash: `" + path + "`."));
@@ -526,8 +751,18 @@ class HTTPServerPOSIX final {
   const int port_;
   std::thread thread_;
 
-  // TODO(dkorolev): Look into read-write mutexes here.
-  mutable std::mutex mutex_;
+  // Route lookups take a shared lock, so that concurrent workers do not contend on it.
+  mutable current::locks::SharedMutex mutex_;
+
+  // Guards the worker pool, the event loops, and the keep-alive parameters.
+  std::mutex worker_pool_mutex_;
+  std::shared_ptr<WorkerPool> worker_pool_;
+  // Tearing down the worker pools and the event loops replaced from their own threads.
+  std::vector<std::thread> teardown_threads_;
+#ifdef CURRENT_POSIX
+  std::shared_ptr<HTTPServerEventLoop> event_loop_;
+#endif
+  current::net::HTTPKeepAliveParams keep_alive_params_;
 
   std::map<std::string, std::map<size_t, std::function<void(Request)>>> handlers_;
   std::vector<std::unique_ptr<StaticFileServer>> static_file_servers_;
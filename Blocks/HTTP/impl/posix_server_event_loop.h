@@ -0,0 +1,562 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev, <dmitry.korolev@gmail.com>.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The event-driven backend of `HTTPServerPOSIX`, set per port via `HTTP(port).UseEventLoop(...)`. Linux only.
+//
+// The accepted connections are made non-blocking, and are served by a few threads, each running its own `epoll`
+// loop. A thread reads the incoming data as it arrives, and, once a request has been received in full, parses it with
+// the regular `GenericHTTPRequestData` and runs its handler. No thread is blocked on a connection in between.
+//
+// The responses are not written into the sockets directly. They are queued per connection, and sent out as the sockets
+// become writable, so that a handler or a stream subscriber can keep sending chunks of a response from another thread
+// with no thread waiting on a slow client. Once more than `max_queued_bytes_per_connection` are queued though,
+// the writer blocks until the client catches up, as it would with a blocking socket.
+//
+// The handlers run in the event loop threads, and should not block. Long-running responses, such as chunked streams,
+// should be sent from other threads, with the `Request` moved there, as `Sherlock` does.
+
+#ifndef BLOCKS_HTTP_IMPL_POSIX_SERVER_EVENT_LOOP_H
+#define BLOCKS_HTTP_IMPL_POSIX_SERVER_EVENT_LOOP_H
+
+#include "../../../port.h"
+
+#ifdef CURRENT_POSIX
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <iostream>  // TODO(dkorolev): More robust logging here.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../../../Bricks/net/exceptions.h"
+#include "../../../Bricks/net/http/http.h"
+
+namespace current {
+namespace http {
+
+struct HTTPServerEventLoopParams {
+  // The number of threads running the event loops. Zero serves requests the regular, blocking, way.
+  size_t threads;
+  // Once more than this many bytes of the response are queued, the writer is blocked until some are sent out.
+  size_t max_queued_bytes_per_connection;
+
+  explicit HTTPServerEventLoopParams(size_t threads = 0u, size_t max_queued_bytes_per_connection = 1024u * 1024u)
+      : threads(threads), max_queued_bytes_per_connection(max_queued_bytes_per_connection) {}
+};
+
+class HTTPServerEventLoop final {
+ public:
+  // Parses the request out of the data set as pipelined, without reading from the connection, and runs its handler.
+  using serve_request_t =
+      std::function<void(current::net::Connection&&, std::shared_ptr<current::net::HTTPKeepAliveState>)>;
+
+  HTTPServerEventLoop(const HTTPServerEventLoopParams& params, serve_request_t serve_request)
+      : params_(params), serve_request_(std::move(serve_request)), next_loop_(0u) {
+    for (size_t i = 0u; i < params.threads; ++i) {
+      loops_.emplace_back(new Loop(*this));
+    }
+  }
+
+  // Serves the accepted connection in one of the event loops, alternating between them.
+  void Add(current::net::Connection&& connection, const current::net::HTTPKeepAliveParams& keep_alive_params) {
+    loops_[next_loop_++ % loops_.size()]->Add(std::move(connection), keep_alive_params);
+  }
+
+  // Whether called from one of the threads of these event loops, i.e., by a handler they run.
+  bool RunsOnThisThread() const {
+    for (const auto& loop : loops_) {
+      if (loop->RunsOnThisThread()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns the length of the first HTTP message in `data`, if it has been received in full, or zero otherwise.
+  // Follows `GenericHTTPRequestData`, so that, given this many bytes, it parses the message without reading more.
+  static size_t CompleteMessageLength(const std::vector<char>& data) {
+    const char* const begin = data.data();
+    const char* const end = begin + data.size();
+    const char* const crlf = current::net::constants::kCRLF;
+    const auto FindCRLF = [end, crlf](const char* from) -> const char* {
+      const char* const found = std::search(from, end, crlf, crlf + current::net::constants::kCRLFLength);
+      return found != end ? found : nullptr;
+    };
+    const char* p = begin;
+    // Blank lines before the first line of the message are ignored.
+    while (end - p >= 2 && p[0] == '\r' && p[1] == '\n') {
+      p += 2;
+    }
+    const char* line_end = FindCRLF(p);
+    if (!line_end) {
+      return 0u;
+    }
+    size_t content_length = static_cast<size_t>(-1);
+    bool chunked = false;
+    while (true) {
+      p = line_end + current::net::constants::kCRLFLength;
+      line_end = FindCRLF(p);
+      if (!line_end) {
+        return 0u;
+      }
+      if (line_end == p) {
+        p += current::net::constants::kCRLFLength;
+        break;  // The blank line after the headers.
+      }
+      const std::string line(p, line_end);
+      const size_t colon = line.find(current::net::constants::kHeaderKeyValueSeparator);
+      if (colon != std::string::npos) {
+        const std::string key = NormalizedHeaderToken(line.substr(0u, colon));
+        const std::string value = NormalizedHeaderToken(line.substr(colon + 1u));
+        if (key == NormalizedHeaderToken(current::net::constants::kContentLengthHeaderKey)) {
+          content_length = static_cast<size_t>(atoi(value.c_str()));
+        } else if (key == NormalizedHeaderToken(current::net::constants::kTransferEncodingHeaderKey) &&
+                   value == NormalizedHeaderToken(current::net::constants::kTransferEncodingChunkedValue)) {
+          chunked = true;
+        }
+      }
+    }
+    if (!chunked) {
+      if (content_length == static_cast<size_t>(-1) ||
+          content_length > current::net::constants::kMaxHTTPPayloadSizeInBytes) {
+        // No body, or the body is not to be read, as the request is responded to with "413 ENTITY TOO LARGE".
+        return p - begin;
+      }
+      return static_cast<size_t>(end - p) >= content_length ? (p - begin) + content_length : 0u;
+    }
+    while (true) {
+      while (end - p >= 2 && p[0] == '\r' && p[1] == '\n') {
+        p += 2;
+      }
+      line_end = FindCRLF(p);
+      if (!line_end) {
+        return 0u;
+      }
+      const std::string line(p, line_end);
+      p = line_end + current::net::constants::kCRLFLength;
+      char* hex_end;
+      const size_t chunk_length = static_cast<size_t>(strtoul(line.c_str(), &hex_end, 16));
+      if (hex_end == line.c_str() || !chunk_length) {
+        // The last chunk, or an invalid one, which is responded to with "400 BAD REQUEST".
+        if (end - p >= 2 && p[0] == '\r' && p[1] == '\n') {
+          p += 2;
+        }
+        return p - begin;
+      }
+      if (static_cast<size_t>(end - p) < chunk_length) {
+        return 0u;
+      }
+      p += chunk_length;
+    }
+  }
+
+ private:
+  // Lowercase, with no spaces around, and with underscores as dashes, see `GenericHTTPRequestData`.
+  static std::string NormalizedHeaderToken(const std::string& s) {
+    std::string result;
+    for (const char c : s) {
+      if (c != ' ' && c != '\t') {
+        result += (c != '_' ? static_cast<char>(std::tolower(c)) : '-');
+      }
+    }
+    return result;
+  }
+
+  class Loop;
+
+  // The state of a connection served by an event loop, as well as the queue of data to write into it.
+  class EventConnection final : public current::net::Connection::WriteQueue,
+                                public std::enable_shared_from_this<EventConnection> {
+   public:
+    EventConnection(Loop* loop, int fd, size_t max_queued_bytes)
+        : loop_(loop), fd_(fd), max_queued_bytes_(max_queued_bytes) {}
+
+    void Write(const void* buffer, size_t write_length, bool more) override {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (failed_) {
+        CURRENT_THROW(current::net::SocketWriteException());
+      }
+      while (outbound_.size() - outbound_offset_ > max_queued_bytes_) {
+        // Block the writer while too much data is queued, and make progress from the writer thread,
+        // as it may well be the very event loop thread this connection is served by.
+        lock.unlock();
+        pollfd pfd;
+        pfd.fd = fd_;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        ::poll(&pfd, 1, 100);
+        lock.lock();
+        if (!Flush() && failed_) {
+          CURRENT_THROW(current::net::SocketWriteException());
+        }
+      }
+      if (outbound_offset_ && outbound_offset_ * 2u >= outbound_.size()) {
+        outbound_.erase(0u, outbound_offset_);
+        outbound_offset_ = 0u;
+      }
+      outbound_.append(static_cast<const char*>(buffer), write_length);
+      // Similar to `MSG_MORE`, the data is held back until the rest of it is written.
+      if (!more && !Flush() && failed_) {
+        CURRENT_THROW(current::net::SocketWriteException());
+      }
+    }
+
+    // Called as the `Connection` is destructed, possibly, in another thread.
+    void Close() override {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closing_ = true;
+      Flush();
+      if (loop_) {
+        loop_->Notify(shared_from_this(), Loop::Event::Closed);
+      } else {
+        // The event loop is gone, so only the queued data that could be sent without blocking has been sent.
+        ::close(fd_);
+      }
+    }
+
+   private:
+    friend class Loop;
+
+    // Sends out as much of the queued data as possible without blocking. Returns whether everything was sent.
+    // Must be called with `mutex_` locked.
+    bool Flush() {
+      while (!failed_ && outbound_offset_ < outbound_.size()) {
+        const ssize_t sent = ::send(fd_,
+                                    outbound_.data() + outbound_offset_,
+                                    outbound_.size() - outbound_offset_,
+                                    MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent > 0) {
+          outbound_offset_ += static_cast<size_t>(sent);
+        } else if (sent < 0 && errno == EINTR) {
+          continue;  // LCOV_EXCL_LINE
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+          return false;
+        } else {
+          failed_ = true;
+        }
+      }
+      outbound_.clear();
+      outbound_offset_ = 0u;
+      return !failed_;
+    }
+
+    // Guarded by `mutex_`.
+    Loop* loop_;
+    const int fd_;
+    const size_t max_queued_bytes_;
+    std::mutex mutex_;
+    std::string outbound_;
+    size_t outbound_offset_ = 0u;
+    bool failed_ = false;
+    bool closing_ = false;
+
+    // Only accessed from the thread of the event loop.
+    std::unique_ptr<current::net::Connection> idle_connection_;  // Set unless a request is being served.
+    std::shared_ptr<current::net::HTTPKeepAliveState> keep_alive_;
+    std::vector<char> inbound_;
+    bool peer_closed_ = false;
+    std::chrono::steady_clock::time_point last_active_;
+    std::chrono::milliseconds idle_timeout_;
+  };
+
+  class Loop final {
+   public:
+    enum class Event { Added, Released, Closed };
+
+    explicit Loop(HTTPServerEventLoop& self)
+        : self_(self), epoll_fd_(::epoll_create1(0)), event_fd_(::eventfd(0, EFD_NONBLOCK)), stopping_(false) {
+      if (epoll_fd_ < 0 || event_fd_ < 0) {
+        CURRENT_THROW(current::net::SocketCreateException());  // LCOV_EXCL_LINE
+      }
+      epoll_event event;
+      event.events = EPOLLIN;
+      event.data.ptr = nullptr;
+      ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &event);
+      thread_ = std::thread(&Loop::Thread, this);
+    }
+
+    ~Loop() {
+      stopping_ = true;
+      Wake();
+      thread_.join();
+      // The connections not yet picked up by the event loop are only referred to by the pending notifications.
+      {
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        for (auto& e : events_) {
+          connections_[e.first.get()] = e.first;
+        }
+        events_.clear();
+      }
+      // The connections still being served are closed by their owners, once they are done with them.
+      // The ones the owners are done with, but which still had data to send, and the idle ones, are closed here.
+      for (auto& connection : connections_) {
+        EventConnection& c = *connection.second;
+        std::unique_ptr<current::net::Connection> idle_connection;
+        bool closing;
+        {
+          std::lock_guard<std::mutex> lock(c.mutex_);
+          c.loop_ = nullptr;
+          idle_connection = std::move(c.idle_connection_);
+          closing = c.closing_;
+        }
+        if (closing) {
+          ::close(c.fd_);
+        }
+      }
+      connections_.clear();
+      // The connections closed by their owners right before `loop_` was reset have been closed above.
+      {
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        events_.clear();
+      }
+      ::close(event_fd_);
+      ::close(epoll_fd_);
+    }
+
+    bool RunsOnThisThread() const { return thread_.get_id() == std::this_thread::get_id(); }
+
+    void Add(current::net::Connection&& connection, const current::net::HTTPKeepAliveParams& keep_alive_params) {
+      const int fd = static_cast<SOCKET>(connection.socket);
+      const int flags = ::fcntl(fd, F_GETFL, 0);
+      if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        CURRENT_THROW(current::net::SocketFcntlException());  // LCOV_EXCL_LINE
+      }
+      auto event_connection =
+          std::make_shared<EventConnection>(this, fd, self_.params_.max_queued_bytes_per_connection);
+      event_connection->idle_timeout_ = keep_alive_params.idle_timeout;
+      event_connection->keep_alive_ = std::make_shared<current::net::HTTPKeepAliveState>(keep_alive_params);
+      std::weak_ptr<EventConnection> weak_event_connection(event_connection);
+      event_connection->keep_alive_->SetReleaseCallback([weak_event_connection]() {
+        const auto event_connection = weak_event_connection.lock();
+        if (event_connection) {
+          std::unique_lock<std::mutex> lock(event_connection->mutex_);
+          if (event_connection->loop_) {
+            event_connection->loop_->Notify(event_connection, Event::Released);
+          } else {
+            lock.unlock();
+            // The event loop is gone, so the released connection is closed.
+            event_connection->keep_alive_->TakeReleasedConnection();
+          }
+        }
+      });
+      connection.SetWriteQueue(event_connection);
+      event_connection->idle_connection_.reset(new current::net::Connection(std::move(connection)));
+      Notify(std::move(event_connection), Event::Added);
+    }
+
+    void Notify(std::shared_ptr<EventConnection> connection, Event event) {
+      {
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        events_.emplace_back(std::move(connection), event);
+      }
+      Wake();
+    }
+
+   private:
+    void Wake() {
+      const uint64_t one = 1u;
+      if (::write(event_fd_, &one, sizeof(one)) < 0) {
+        // The counter of the `eventfd` is already nonzero, so the event loop will wake up anyway.
+      }
+    }
+
+    void Thread() {
+      std::vector<epoll_event> events(256u);
+      auto last_idle_check = std::chrono::steady_clock::now();
+      while (!stopping_) {
+        const int n = ::epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), 100);
+        for (int i = 0; i < n; ++i) {
+          EventConnection* connection = static_cast<EventConnection*>(events[i].data.ptr);
+          if (!connection) {
+            uint64_t counter;
+            if (::read(event_fd_, &counter, sizeof(counter)) < 0) {
+              // Another `epoll_wait` wakeup has already reset the counter.
+            }
+          } else {
+            if (events[i].events & EPOLLOUT) {
+              OnWritable(*connection);
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+              OnReadable(*connection);
+            }
+          }
+        }
+        // The connections are only erased here, after the events referring to them have been processed.
+        ProcessNotifications();
+        const auto now = std::chrono::steady_clock::now();
+        if (now - last_idle_check >= std::chrono::milliseconds(100)) {
+          last_idle_check = now;
+          std::vector<EventConnection*> stuck;
+          for (auto& connection : connections_) {
+            EventConnection& c = *connection.second;
+            if (now - c.last_active_ >= c.idle_timeout_) {
+              if (c.idle_connection_) {
+                c.idle_connection_ = nullptr;  // Closed via `EventConnection::Close()`.
+              } else {
+                // The response has been sent, but the client has not been reading it for too long.
+                std::lock_guard<std::mutex> lock(c.mutex_);
+                if (c.closing_) {
+                  stuck.push_back(&c);
+                }
+              }
+            }
+          }
+          for (EventConnection* c : stuck) {
+            Erase(*c);
+          }
+        }
+      }
+    }
+
+    void ProcessNotifications() {
+      while (true) {
+        std::vector<std::pair<std::shared_ptr<EventConnection>, Event>> events;
+        {
+          std::lock_guard<std::mutex> lock(events_mutex_);
+          events.swap(events_);
+        }
+        if (events.empty()) {
+          return;
+        }
+        for (auto& e : events) {
+          EventConnection& c = *e.first;
+          if (e.second == Event::Added) {
+            epoll_event event;
+            event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            event.data.ptr = &c;
+            connections_[&c] = e.first;
+            c.last_active_ = std::chrono::steady_clock::now();
+            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, c.fd_, &event) < 0) {
+              c.idle_connection_ = nullptr;  // LCOV_EXCL_LINE
+            }
+          } else if (e.second == Event::Released) {
+            c.idle_connection_ = c.keep_alive_->TakeReleasedConnection();
+            c.last_active_ = std::chrono::steady_clock::now();
+            // Serve the requests read while this one was being served, and read the ones not read yet.
+            OnReadable(c);
+          } else {
+            bool flushed;
+            {
+              std::lock_guard<std::mutex> lock(c.mutex_);
+              flushed = (c.outbound_offset_ == c.outbound_.size() || c.failed_);
+            }
+            if (flushed) {
+              Erase(c);
+            }
+          }
+        }
+      }
+    }
+
+    void Erase(EventConnection& c) {
+      if (connections_.count(&c)) {
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, c.fd_, nullptr);
+        ::close(c.fd_);
+        connections_.erase(&c);
+      }
+    }
+
+    void OnWritable(EventConnection& c) {
+      c.last_active_ = std::chrono::steady_clock::now();
+      bool closed;
+      {
+        std::lock_guard<std::mutex> lock(c.mutex_);
+        c.Flush();
+        closed = c.closing_ && (c.outbound_offset_ == c.outbound_.size() || c.failed_);
+      }
+      if (closed) {
+        Notify(c.shared_from_this(), Event::Closed);
+      }
+    }
+
+    void OnReadable(EventConnection& c) {
+      // Edge-triggered, so read everything there is, unless a request is too large to be served.
+      char buffer[64 * 1024];
+      while (!c.peer_closed_ && c.inbound_.size() <= kMaxInboundBytes) {
+        const ssize_t n = ::recv(c.fd_, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+          c.inbound_.insert(c.inbound_.end(), buffer, buffer + n);
+        } else if (n < 0 && errno == EINTR) {
+          continue;  // LCOV_EXCL_LINE
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+          break;
+        } else {
+          c.peer_closed_ = true;
+        }
+      }
+      if (!c.idle_connection_) {
+        return;  // Either a request is being served, or the connection is being closed.
+      }
+      c.last_active_ = std::chrono::steady_clock::now();
+      const size_t length = CompleteMessageLength(c.inbound_);
+      if (length) {
+        c.keep_alive_->SetPipelinedData(std::vector<char>(c.inbound_.begin(), c.inbound_.begin() + length));
+        c.inbound_.erase(c.inbound_.begin(), c.inbound_.begin() + length);
+        std::unique_ptr<current::net::Connection> connection(std::move(c.idle_connection_));
+        // Once the request is served, the connection is either released back, or closed, see `ProcessNotifications()`.
+        self_.serve_request_(std::move(*connection), c.keep_alive_);
+      } else if (c.peer_closed_ || c.inbound_.size() > kMaxInboundBytes) {
+        c.idle_connection_ = nullptr;  // Closed via `EventConnection::Close()`.
+      }
+    }
+
+    constexpr static size_t kMaxInboundBytes = current::net::constants::kMaxHTTPPayloadSizeInBytes + 64u * 1024u;
+
+    HTTPServerEventLoop& self_;
+    const int epoll_fd_;
+    const int event_fd_;
+    std::atomic_bool stopping_;
+    std::mutex events_mutex_;
+    std::vector<std::pair<std::shared_ptr<EventConnection>, Event>> events_;
+    std::unordered_map<EventConnection*, std::shared_ptr<EventConnection>> connections_;
+    std::thread thread_;
+  };
+
+  const HTTPServerEventLoopParams params_;
+  const serve_request_t serve_request_;
+  std::atomic_size_t next_loop_;
+  std::vector<std::unique_ptr<Loop>> loops_;
+};
+
+}  // namespace http
+}  // namespace current
+
+#endif  // CURRENT_POSIX
+
+#endif  // BLOCKS_HTTP_IMPL_POSIX_SERVER_EVENT_LOOP_H
@@ -33,7 +33,12 @@ SOFTWARE.
 #include "docu/server/docu_03httpserver_04_test.cc"
 #include "docu/server/docu_03httpserver_05_test.cc"
 
+#include <atomic>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "api.h"
 
@@ -82,6 +87,21 @@ DEFINE_int32(net_api_test_port_secondary,
              "different from "
              "ports in other network-based tests, since API-driven HTTP server will hold it open for the whole "
              "lifetime of the binary.");
+DEFINE_int32(net_api_test_port_worker_pool,
+             PickPortForUnitTest(),
+             "Local port to use for the test API-based HTTP server serving requests from a pool of worker threads.");
+DEFINE_int32(net_api_test_port_keep_alive,
+             PickPortForUnitTest(),
+             "Local port to use for the test API-based HTTP server with persistent connections.");
+DEFINE_int32(net_api_test_port_event_loop,
+             PickPortForUnitTest(),
+             "Local port to use for the test API-based HTTP server serving requests from event loops.");
+DEFINE_int32(net_api_test_port_client_pool,
+             PickPortForUnitTest(),
+             "Local port to use for the test API-based HTTP server the client keeps persistent connections to.");
+DEFINE_int32(net_api_test_port_bare_server,
+             PickPortForUnitTest(),
+             "Local port to use for the bare socket-based HTTP/1.1 server the client keeps persistent connections to.");
 DEFINE_string(net_api_test_tmpdir, ".current", "Local path for the test to create temporary files in.");
 
 CURRENT_STRUCT(HTTPAPITestObject) {
@@ -341,6 +361,388 @@ TEST(HTTPAPI, ConnectionIPAndPort) {
   EXPECT_EQ(1u, HTTP(FLAGS_net_api_test_port).PathHandlersCount());
 }
 
+TEST(HTTPAPI, WorkerPool) {
+  HTTP(FLAGS_net_api_test_port_worker_pool).UseWorkerPool(HTTPServerWorkerPoolParams(4u, 16u));
+  const string base_url = Printf("http://localhost:%d", FLAGS_net_api_test_port_worker_pool);
+
+  std::atomic_bool slow_handler_started(false);
+  std::atomic_bool slow_handler_released(false);
+  const auto scope = HTTP(FLAGS_net_api_test_port_worker_pool)
+                         .Register("/slow",
+                                   [&slow_handler_started, &slow_handler_released](Request r) {
+                                     slow_handler_started = true;
+                                     while (!slow_handler_released) {
+                                       std::this_thread::yield();
+                                     }
+                                     r("slow");
+                                   }) +
+                     HTTP(FLAGS_net_api_test_port_worker_pool).Register("/fast", [](Request r) { r("fast"); });
+
+  // A slow handler does not stall other requests to the same port.
+  std::string slow_response;
+  std::thread slow_client([&base_url, &slow_response]() { slow_response = HTTP(GET(base_url + "/slow")).body; });
+  while (!slow_handler_started) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ("fast", HTTP(GET(base_url + "/fast")).body);
+  slow_handler_released = true;
+  slow_client.join();
+  EXPECT_EQ("slow", slow_response);
+
+  // Routes are registered and unregistered consistently while being served concurrently.
+  std::atomic_bool done(false);
+  std::atomic_size_t served(0u);
+  std::atomic_size_t not_found(0u);
+  std::vector<std::thread> clients;
+  for (size_t i = 0u; i < 4u; ++i) {
+    clients.emplace_back([&base_url, &done, &served, &not_found]() {
+      while (!done) {
+        const auto response = HTTP(GET(base_url + "/flip"));
+        if (response.code == HTTPResponseCode.OK) {
+          EXPECT_EQ("flip", response.body);
+          ++served;
+        } else {
+          EXPECT_EQ(404, static_cast<int>(response.code));
+          ++not_found;
+        }
+      }
+    });
+  }
+  for (size_t i = 0u; i < 100u; ++i) {
+    const auto flip_scope = HTTP(FLAGS_net_api_test_port_worker_pool).Register("/flip", [](Request r) { r("flip"); });
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  done = true;
+  for (auto& client : clients) {
+    client.join();
+  }
+  EXPECT_LT(0u, served + not_found);
+  EXPECT_EQ(2u, HTTP(FLAGS_net_api_test_port_worker_pool).PathHandlersCount());
+
+  // The handler run by the worker pool can replace the very pool.
+  {
+    const auto reconfigure_scope =
+        HTTP(FLAGS_net_api_test_port_worker_pool).Register("/reconfigure", [](Request r) {
+          HTTP(FLAGS_net_api_test_port_worker_pool).UseWorkerPool(HTTPServerWorkerPoolParams(2u));
+          r("reconfigured");
+        });
+    EXPECT_EQ("reconfigured", HTTP(GET(base_url + "/reconfigure")).body);
+    EXPECT_EQ("fast", HTTP(GET(base_url + "/fast")).body);
+    EXPECT_EQ("reconfigured", HTTP(GET(base_url + "/reconfigure")).body);
+  }
+
+  // Back to serving requests from the listening thread.
+  HTTP(FLAGS_net_api_test_port_worker_pool).UseWorkerPool(HTTPServerWorkerPoolParams());
+  EXPECT_EQ("fast", HTTP(GET(base_url + "/fast")).body);
+}
+
+TEST(HTTPAPI, KeepAlive) {
+  HTTP(FLAGS_net_api_test_port_keep_alive).UseWorkerPool(HTTPServerWorkerPoolParams(2u));
+  HTTP(FLAGS_net_api_test_port_keep_alive)
+      .UseKeepAlive(current::net::HTTPKeepAliveParams(3u, std::chrono::milliseconds(100)));
+  const auto scope = HTTP(FLAGS_net_api_test_port_keep_alive).Register("/ka", [](Request r) { r(r.url.query["x"]); });
+
+  // The regular client closes the connection after the response.
+  EXPECT_EQ("1", HTTP(GET(Printf("http://localhost:%d/ka?x=1", FLAGS_net_api_test_port_keep_alive))).body);
+
+  // The responses may be read together, so the beginning of the next one is carried over.
+  std::vector<char> next_response_data;
+  const auto ReadResponse = [&next_response_data](Connection& connection) {
+    current::net::HTTPRequestData response(connection, {}, 16 * 1024 + 1, 1.95, next_response_data);
+    next_response_data = response.PipelinedData();
+    return response.RawPath() + ' ' + response.Body() + ' ' + (response.KeepAliveRequested() ? "keep-alive" : "close");
+  };
+  {
+    // Requests one by one, with the idle connection closed by the server.
+    Connection connection(current::net::ClientSocket("localhost", FLAGS_net_api_test_port_keep_alive));
+    connection.BlockingWrite("GET /ka?x=2 HTTP/1.1\r\n\r\n", false);
+    EXPECT_EQ("200 2 keep-alive", ReadResponse(connection));
+    connection.BlockingWrite("GET /ka?x=3 HTTP/1.1\r\n\r\n", false);
+    EXPECT_EQ("200 3 keep-alive", ReadResponse(connection));
+    EXPECT_TRUE(connection.WaitUntilReadable(std::chrono::milliseconds(5000)));
+    char c;
+    EXPECT_THROW(connection.BlockingRead(&c, 1u), current::net::EmptySocketException);
+  }
+  {
+    // Pipelined requests, up to the cap.
+    Connection connection(current::net::ClientSocket("localhost", FLAGS_net_api_test_port_keep_alive));
+    connection.BlockingWrite("GET /ka?x=4 HTTP/1.1\r\n\r\nGET /ka?x=5 HTTP/1.1\r\n\r\n", true);
+    connection.BlockingWrite("GET /nope HTTP/1.1\r\n\r\nGET /ka?x=6 HTTP/1.1\r\n\r\n", false);
+    EXPECT_EQ("200 4 keep-alive", ReadResponse(connection));
+    EXPECT_EQ("200 5 keep-alive", ReadResponse(connection));
+    EXPECT_EQ("404 " + DefaultNotFoundMessage() + " close", ReadResponse(connection));
+  }
+
+  {
+    // Without the worker pool, the listening thread serves the requests, and never keeps a connection alive.
+    HTTP(FLAGS_net_api_test_port_keep_alive).UseWorkerPool(HTTPServerWorkerPoolParams());
+    Connection connection(current::net::ClientSocket("localhost", FLAGS_net_api_test_port_keep_alive));
+    connection.BlockingWrite("GET /ka?x=7 HTTP/1.1\r\n\r\n", false);
+    EXPECT_EQ("200 7 close", ReadResponse(connection));
+  }
+
+  HTTP(FLAGS_net_api_test_port_keep_alive).UseKeepAlive(current::net::HTTPKeepAliveParams());
+  EXPECT_EQ("8", HTTP(GET(Printf("http://localhost:%d/ka?x=8", FLAGS_net_api_test_port_keep_alive))).body);
+}
+
+#ifdef CURRENT_POSIX
+TEST(HTTPAPI, EventLoop) {
+  const int port = FLAGS_net_api_test_port_event_loop;
+  HTTP(port).UseEventLoop(HTTPServerEventLoopParams(2u, 64u * 1024u));
+  const string base_url = Printf("http://localhost:%d", port);
+
+  std::mutex streams_mutex;
+  std::vector<Request> streams;
+  const auto scope =
+      HTTP(port).Register("/echo", [](Request r) { r(r.method + ' ' + r.url.query["x"] + ' ' + r.body); }) +
+      HTTP(port).Register("/large", [](Request r) { r(std::string(1000000u, 'x')); }) +
+      HTTP(port).Register("/stream",
+                          [&streams_mutex, &streams](Request r) {
+                            std::lock_guard<std::mutex> lock(streams_mutex);
+                            streams.push_back(std::move(r));
+                          });
+
+  // The very same handlers serve the requests.
+  EXPECT_EQ("GET 1 ", HTTP(GET(base_url + "/echo?x=1")).body);
+  EXPECT_EQ("POST 2 body", HTTP(POST(base_url + "/echo?x=2", "body")).body);
+  EXPECT_EQ(404, static_cast<int>(HTTP(GET(base_url + "/nope")).code));
+  EXPECT_EQ(1000000u, HTTP(GET(base_url + "/large")).body.length());
+
+  // Pipelined requests are served over persistent connections.
+  HTTP(port).UseKeepAlive(current::net::HTTPKeepAliveParams(3u, std::chrono::milliseconds(1000)));
+  {
+    std::vector<char> next_response_data;
+    const auto ReadResponse = [&next_response_data](Connection& connection) {
+      current::net::HTTPRequestData response(connection, {}, 16 * 1024 + 1, 1.95, next_response_data);
+      next_response_data = response.PipelinedData();
+      return response.Body() + ' ' + (response.KeepAliveRequested() ? "keep-alive" : "close");
+    };
+    Connection connection(current::net::ClientSocket("localhost", port));
+    connection.BlockingWrite("GET /echo?x=3 HTTP/1.1\r\n\r\n", true);
+    connection.BlockingWrite("POST /echo?x=4 HTTP/1.1\r\nContent-Length: 2\r\n\r\nOK", false);
+    EXPECT_EQ("GET 3  keep-alive", ReadResponse(connection));
+    EXPECT_EQ("POST 4 OK keep-alive", ReadResponse(connection));
+    connection.BlockingWrite("GET /echo?x=5 HTTP/1.1\r\n\r\n", false);
+    EXPECT_EQ("GET 5  close", ReadResponse(connection));
+  }
+  HTTP(port).UseKeepAlive(current::net::HTTPKeepAliveParams());
+
+  // Many chunked responses are sent concurrently from a single thread, with no thread per connection.
+  const size_t n = 100u;
+  std::vector<std::unique_ptr<Connection>> clients;
+  for (size_t i = 0u; i < n; ++i) {
+    clients.emplace_back(new Connection(current::net::ClientSocket("localhost", port)));
+    clients.back()->BlockingWrite("GET /stream HTTP/1.1\r\n\r\n", false);
+  }
+  while (true) {
+    std::lock_guard<std::mutex> lock(streams_mutex);
+    if (streams.size() == n) {
+      break;
+    }
+    std::this_thread::yield();
+  }
+  std::thread([&streams]() {
+    std::vector<current::net::HTTPServerConnection::ChunkedResponseSender> senders;
+    for (auto& r : streams) {
+      senders.push_back(r.connection.SendChunkedHTTPResponse());
+    }
+    for (size_t chunk = 0u; chunk < 10u; ++chunk) {
+      for (auto& sender : senders) {
+        sender.Send(current::ToString(chunk));
+      }
+    }
+  }).join();
+  streams.clear();
+  for (auto& client : clients) {
+    EXPECT_EQ("0123456789", current::net::HTTPRequestData(*client).Body());
+  }
+
+  // The connections the handlers are done with, but which still have data queued, are closed with the event loop.
+  {
+    const auto OpenFileDescriptors = []() {
+      size_t count = 0u;
+      FileSystem::ScanDir("/proc/self/fd",
+                          [&count](const FileSystem::ScanDirItemInfo&) { ++count; },
+                          FileSystem::ScanDirParameters::ListFilesAndDirs);
+      return count;
+    };
+    // Each event loop holds two file descriptors of its own, so the loop is replaced by one with as many threads.
+    const HTTPServerEventLoopParams params(1u, 256u * 1024u * 1024u);
+    HTTP(port).UseEventLoop(params);
+    std::atomic_bool responded(false);
+    const auto huge_scope = HTTP(port).Register("/huge", [&responded](Request r) {
+      r(std::string(64u * 1024u * 1024u, 'x'));
+      responded = true;
+    });
+    const size_t file_descriptors_before = OpenFileDescriptors();
+    {
+      Connection client(current::net::ClientSocket("localhost", port));
+      client.BlockingWrite("GET /huge HTTP/1.1\r\n\r\n", false);
+      while (!responded) {
+        std::this_thread::yield();
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      EXPECT_EQ(file_descriptors_before + 2u, OpenFileDescriptors());
+      HTTP(port).UseEventLoop(params);
+      EXPECT_EQ(file_descriptors_before + 1u, OpenFileDescriptors());
+    }
+    EXPECT_EQ(file_descriptors_before, OpenFileDescriptors());
+  }
+
+  // The handler run by the event loop can replace the very event loops.
+  {
+    const auto reconfigure_scope = HTTP(port).Register("/reconfigure", [port](Request r) {
+      HTTP(port).UseEventLoop(HTTPServerEventLoopParams(2u));
+      r("reconfigured");
+    });
+    EXPECT_EQ("reconfigured", HTTP(GET(base_url + "/reconfigure")).body);
+    EXPECT_EQ("GET 5 ", HTTP(GET(base_url + "/echo?x=5")).body);
+    EXPECT_EQ("reconfigured", HTTP(GET(base_url + "/reconfigure")).body);
+  }
+
+  HTTP(port).UseEventLoop(HTTPServerEventLoopParams());
+  EXPECT_EQ("GET 6 ", HTTP(GET(base_url + "/echo?x=6")).body);
+}
+#endif  // CURRENT_POSIX
+
+TEST(HTTPAPI, ClientConnectionPool) {
+  const int port = FLAGS_net_api_test_port_client_pool;
+  HTTP(port).UseWorkerPool(HTTPServerWorkerPoolParams(4u));
+  HTTP(port).UseKeepAlive(current::net::HTTPKeepAliveParams(1000u, std::chrono::milliseconds(200)));
+  const auto scope = HTTP(port).Register(
+      "/client_port", [](Request r) { r(current::ToString(r.connection.RemoteIPAndPort().port)); });
+  const string url = Printf("http://localhost:%d/client_port", port);
+  auto& pool = HTTPClientConnections();
+  pool.Clear();
+
+  // Consecutive requests are served over the same connection.
+  const string client_port = HTTP(GET(url)).body;
+  EXPECT_EQ(1u, pool.IdleConnectionsCount("localhost", port));
+  EXPECT_EQ(client_port, HTTP(GET(url)).body);
+  EXPECT_EQ(client_port, HTTP(POST(url, "body")).body);
+  EXPECT_EQ(1u, pool.IdleConnectionsCount("localhost", port));
+
+  // Once the server has closed the idle connection, a new one is established.
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  const string new_client_port = HTTP(GET(url)).body;
+  EXPECT_NE(client_port, new_client_port);
+  EXPECT_EQ(new_client_port, HTTP(GET(url)).body);
+
+  // The number of concurrent connections to the host is capped, and all of them are reused.
+  pool.SetParams(HTTPClientConnectionPoolParams(32u, 2u));
+  std::mutex ports_mutex;
+  std::set<string> ports;
+  std::vector<std::thread> clients;
+  for (size_t i = 0u; i < 4u; ++i) {
+    clients.emplace_back([&url, &ports_mutex, &ports]() {
+      for (size_t j = 0u; j < 25u; ++j) {
+        const string port = HTTP(GET(url)).body;
+        std::lock_guard<std::mutex> lock(ports_mutex);
+        ports.insert(port);
+      }
+    });
+  }
+  for (auto& client : clients) {
+    client.join();
+  }
+  EXPECT_LE(ports.size(), 2u);
+  EXPECT_LE(pool.IdleConnectionsCount("localhost", port), 2u);
+
+  // Once the cap is reached, and no connection is returned in time, the request is served over an unpooled one.
+  pool.SetParams(
+      HTTPClientConnectionPoolParams(32u, 1u, std::chrono::milliseconds(4000), std::chrono::milliseconds(50)));
+  pool.Clear();
+  {
+    auto held_connection = pool.Acquire("localhost", port);
+    EXPECT_FALSE(HTTP(GET(url)).body.empty());
+    EXPECT_EQ(0u, pool.IdleConnectionsCount("localhost", port));
+  }
+  EXPECT_EQ(0u, pool.IdleConnectionsCount("localhost", port));
+
+  // The streaming responses do not count towards the cap, so the regular requests do not wait for them to end.
+  pool.SetParams(HTTPClientConnectionPoolParams(32u, 1u, std::chrono::milliseconds(4000), std::chrono::seconds(60)));
+  pool.Clear();
+  {
+    std::atomic_bool streaming(false);
+    std::atomic_bool stop_streaming(false);
+    const auto stream_scope = HTTP(port).Register("/stream", [&stop_streaming](Request r) {
+      auto response = r.connection.SendChunkedHTTPResponse();
+      response.Send("chunk\n");
+      while (!stop_streaming) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+    std::thread streamer([port, &streaming]() {
+      HTTP(ChunkedGET(Printf("http://localhost:%d/stream", port),
+                      [](const std::string&, const std::string&) {},
+                      [&streaming](const std::string&) { streaming = true; },
+                      []() {}));
+    });
+    while (!streaming) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_FALSE(HTTP(GET(url)).body.empty());
+    EXPECT_EQ(1u, pool.IdleConnectionsCount("localhost", port));
+    stop_streaming = true;
+    streamer.join();
+  }
+
+  // With the pool disabled, every request is served over a new connection.
+  pool.SetParams(HTTPClientConnectionPoolParams(0u));
+  pool.Clear();
+  const string first_port = HTTP(GET(url)).body;
+  EXPECT_NE(first_port, HTTP(GET(url)).body);
+  EXPECT_EQ(0u, pool.IdleConnectionsCount("localhost", port));
+
+  pool.SetParams(HTTPClientConnectionPoolParams());
+  HTTP(port).UseKeepAlive(current::net::HTTPKeepAliveParams());
+  HTTP(port).UseWorkerPool(HTTPServerWorkerPoolParams());
+}
+
+#ifdef CURRENT_POSIX
+TEST(HTTPAPI, ClientConnectionPoolWithBareHTTP11Server) {
+  const int port = FLAGS_net_api_test_port_bare_server;
+  const string url = Printf("http://localhost:%d/bare", port);
+  auto& pool = HTTPClientConnections();
+  pool.Clear();
+
+  // The server responds with no `Connection` header, so the connection persists as per HTTP/1.1.
+  // It serves two requests over the first connection, and one over the second one, and closes each of them with
+  // no response to the next request. Over the third connection, it serves a single request.
+  std::atomic_size_t connections_accepted(0u);
+  current::net::Socket socket(port);
+  std::thread server([&socket, &connections_accepted]() {
+    for (size_t requests_to_serve : {2u, 1u, 1u}) {
+      Connection connection(socket.Accept());
+      ++connections_accepted;
+      for (size_t i = 0u; i < requests_to_serve; ++i) {
+        current::net::HTTPRequestData request(connection);
+        connection.BlockingWrite("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nOK", false);
+      }
+      if (connections_accepted < 3u) {
+        current::net::HTTPRequestData unanswered_request(connection);
+      }
+    }
+  });
+
+  EXPECT_EQ("OK", HTTP(GET(url)).body);
+  EXPECT_EQ(1u, pool.IdleConnectionsCount("localhost", port));
+  EXPECT_EQ("OK", HTTP(GET(url)).body);
+  EXPECT_EQ(1u, pool.IdleConnectionsCount("localhost", port));
+
+  // The `POST` which got no response over a reused connection may have been served, so it is not retried.
+  EXPECT_THROW(HTTP(POST(url, "not retried")), current::net::EmptySocketException);
+  EXPECT_EQ(0u, pool.IdleConnectionsCount("localhost", port));
+
+  // The `GET` which got no response over a reused connection is retried once, over a new connection.
+  EXPECT_EQ("OK", HTTP(GET(url)).body);
+  EXPECT_EQ("OK", HTTP(GET(url)).body);
+  EXPECT_EQ(3u, connections_accepted);
+
+  server.join();
+}
+#endif  // CURRENT_POSIX
+
 TEST(HTTPAPI, RespondsWithString) {
   const auto scope =
       HTTP(FLAGS_net_api_test_port)
@@ -756,7 +1158,7 @@ TEST(HTTPAPI, GetByChunksPrototype) {
     ASSERT_TRUE(client.Go());
     EXPECT_EQ("1\n|23\n|456\n|DONE", current::strings::Join(chunk_by_chunk_response, '|'));
     EXPECT_EQ(4u, headers.size());
-    EXPECT_EQ("Content-Type=text/plain Connection=keep-alive header=oh-well Transfer-Encoding=chunked",
+    EXPECT_EQ("Content-Type=text/plain Connection=close header=oh-well Transfer-Encoding=chunked",
               current::strings::Join(headers, ' '));
   }
   {
@@ -772,7 +1174,7 @@ TEST(HTTPAPI, GetByChunksPrototype) {
     EXPECT_EQ(200, static_cast<int>(response));
     EXPECT_EQ("1\n|23\n|456\n|DONE", current::strings::Join(chunk_by_chunk_response, '|'));
     EXPECT_EQ(4u, headers.size());
-    EXPECT_EQ("Content-Type=text/plain Connection=keep-alive header=oh-well Transfer-Encoding=chunked",
+    EXPECT_EQ("Content-Type=text/plain Connection=close header=oh-well Transfer-Encoding=chunked",
               current::strings::Join(headers, ' '));
   }
 }
@@ -275,6 +275,7 @@ struct HTTPImpl {
     chunked_client_impl_t impl(impl_params);
     impl.request_method_ = "GET";
     impl.request_url_ = request_params.url;
+    impl.pool_connection_ = false;
 
     if (impl.Go()) {
       return impl.response_code_;
@@ -59,6 +59,11 @@ struct InvalidSignatureLocation : PersistenceException {
   using PersistenceException::PersistenceException;
 };
 
+struct InvalidFileEntryFormat : PersistenceException {
+  explicit InvalidFileEntryFormat(const std::string& expected, const std::string& actual)
+      : PersistenceException("Invalid entry format, expected `" + expected + "`, actual `" + actual + "`.") {}
+};
+
 struct PersistenceMemoryBlockNoLongerAvailable : InGracefulShutdownException {
   using InGracefulShutdownException::InGracefulShutdownException;
 };
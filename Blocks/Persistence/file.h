@@ -25,17 +25,51 @@ SOFTWARE.
 
 // A simple, reference, implementation of an file-based persister.
 // The file is replayed at startup to check its integriry and to extract the most recent index/timestamp.
-// Each iterator opens the same file again, to read its first N lines.
+// The file is memory-mapped, and the iterators read it through the mapping, parsing the entries straight from the
+// mapped bytes. The mapping grows with the file. If the file can not be mapped, each iterator opens it again instead.
 // Iterators never outlive the persister.
+//
+// By default, each published entry is flushed into the file right away. Pass in `FilePersisterGroupCommit`
+// as the last constructor argument to enable group commit: entries from concurrent publishers are collected
+// into a shared batch, and one write, plus an optional `fdatasync()`, makes the whole batch durable.
+// `Publish()` still only returns once its entry is durable, and entries become visible to iterators and
+// subscribers batch by batch. The batch is formed under an internal mutex, while the batches are written, one
+// at a time, under the publish mutex, which is not held while waiting for the batch to fill up. The caller's
+// lock on the publish mutex is never released: a publisher that already holds it writes the pending batch
+// itself, and the ones that do not take it to write the batch.
+// Thus, the publishers that all hold the publish mutex, as the streams do, only batch via `PublishBatch()`, and
+// their entries are written right away, without waiting for `max_delay`, as nobody else could join the batch.
+//
+// `BinaryFile<ENTRY>` is the same persister with the entries stored in the compact binary format instead of JSON.
+// The file remains line-based: the directives and the index-and-timestamp prefixes are still JSON, and the binary
+// entry is escaped to not contain newlines. Such a file starts with the `#format binary` directive.
+//
+// The offset and the timestamp of each entry are indexed, in memory by default. Pass in `FilePersisterSidecarIndex`
+// as the last constructor argument to keep the index in a memory-mapped sidecar file, `<file>.idx`, appended to
+// as the entries are published. With the sidecar index in place, the startup only validates the first lines of
+// the file and its tail since the last indexed entry, so that the restart time does not depend on the length of
+// the stream. A missing sidecar index, or one that does not match the file, is rebuilt by replaying the whole file.
+// The sidecar file is left next to the stream file, to be reused by the next persister over it; whoever removes
+// the stream file removes `<file>.idx` as well.
 
 #ifndef BLOCKS_PERSISTENCE_FILE_H
 #define BLOCKS_PERSISTENCE_FILE_H
 
+#include "../../port.h"
+
 #include <atomic>
+#include <condition_variable>
 #include <fstream>
 #include <functional>
 
+#ifndef CURRENT_WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "exceptions.h"
+#include "file_index.h"
+#include "file_mapping.h"
 
 #include "../SS/persister.h"
 #include "../SS/signature.h"
@@ -45,11 +79,48 @@ SOFTWARE.
 #include "../../Bricks/time/chrono.h"
 #include "../../Bricks/util/atomic_that_works.h"
 #include "../../TypeSystem/Schema/schema.h"
+#include "../../TypeSystem/Serialization/binary.h"
 #include "../../TypeSystem/Serialization/json.h"
 
 namespace current {
 namespace persistence {
 
+// How durable a group-committed batch is by the time `Publish()` returns.
+enum class FilePersisterDurability : int {
+  Flush = 0,     // The batch is written into the file, i.e., handed over to the OS.
+  FDataSync = 1  // The batch is also `fdatasync()`-ed to the disk.
+};
+
+// The parameters of the group commit mode of the file persister.
+struct FilePersisterGroupCommit {
+  // The maximum number of entries in one batch. Once it is reached, the batch is written before appending more.
+  size_t max_batch_size;
+  // How long the first publisher of a batch waits for others to join it. Zero means "no extra latency":
+  // the batch is written right away, and the entries published while it is being written form the next batch.
+  std::chrono::microseconds max_delay;
+  FilePersisterDurability durability;
+
+  explicit FilePersisterGroupCommit(size_t max_batch_size = 1000,
+                                    std::chrono::microseconds max_delay = std::chrono::microseconds(0),
+                                    FilePersisterDurability durability = FilePersisterDurability::Flush)
+      : max_batch_size(max_batch_size), max_delay(max_delay), durability(durability) {}
+};
+
+// The tag to keep the index of the file persister in the `<file>.idx` sidecar file, instead of in memory.
+struct FilePersisterSidecarIndex {};
+
+// Where the file picks up the stream, for a file holding a segment of a longer stream, see `SegmentedFile`.
+struct FilePersisterStart {
+  uint64_t index;                           // The index of the first entry of the file.
+  std::chrono::microseconds last_entry_us;  // The timestamp of the entry right before it, or -1us.
+  std::chrono::microseconds head;           // The head of the stream as of the beginning of the file, or -1us.
+
+  explicit FilePersisterStart(uint64_t index = 0u,
+                              std::chrono::microseconds last_entry_us = std::chrono::microseconds(-1),
+                              std::chrono::microseconds head = std::chrono::microseconds(-1))
+      : index(index), last_entry_us(last_entry_us), head(head) {}
+};
+
 namespace impl {
 
 namespace constants {
@@ -57,34 +128,154 @@ constexpr char kDirectiveMarker = '#';
 constexpr char kSignatureDirective[] = "#signature";
 constexpr char kHeadDirective[] = "#head";
 constexpr char kHeadFormatString[] = "%020lld";
+constexpr char kFormatDirective[] = "#format";
 }  // namespace current::persistence::impl::constants
 
 typedef int64_t head_value_t;
 
-// An iterator to read a file line by line, extracting tab-separated `idxts_t index` and `const char* data`.
+// The default format of the entries in the file: one line of JSON per entry.
+struct JSONFileEntryFormat {
+  static const char* Name() { return "json"; }
+  static bool RequiresFormatDirective() { return false; }
+
+  template <typename E>
+  static std::string Serialize(E&& entry) {
+    return JSON(std::forward<E>(entry));
+  }
+
+  template <typename ENTRY>
+  static ENTRY Parse(const char* data, size_t length) {
+    return ParseJSON<ENTRY>(data, length);
+  }
+
+  // The raw line is already JSON, and is returned as is.
+  template <typename ENTRY>
+  static bool TranscodeLineIntoJSON(const char*, size_t, std::string&) {
+    return false;
+  }
+};
+
+// The binary format of the entries. The bytes which would break the line-based structure of the file,
+// as well as the escape character itself, are escaped: `\n` for '\n', `\0` for '\0', `\\` for '\\'.
+struct BinaryFileEntryFormat {
+  static const char* Name() { return "binary"; }
+  static bool RequiresFormatDirective() { return true; }
+
+  template <typename E>
+  static std::string Serialize(E&& entry) {
+    const std::string binary = current::serialization::binary::Binary(entry);
+    std::string result;
+    result.reserve(binary.length() + binary.length() / 16u);
+    for (const char c : binary) {
+      if (c == '\n') {
+        result.append("\\n", 2u);
+      } else if (c == '\0') {
+        result.append("\\0", 2u);
+      } else if (c == '\\') {
+        result.append("\\\\", 2u);
+      } else {
+        result.push_back(c);
+      }
+    }
+    return result;
+  }
+
+  template <typename ENTRY>
+  static ENTRY Parse(const char* data, size_t length) {
+    std::string binary;
+    binary.reserve(length);
+    const char* const end = data + length;
+    for (const char* p = data; p != end; ++p) {
+      if (*p != '\\') {
+        binary.push_back(*p);
+      } else {
+        ++p;
+        if (p == end) {
+          CURRENT_THROW(MalformedEntryException(std::string(data, length)));
+        } else if (*p == 'n') {
+          binary.push_back('\n');
+        } else if (*p == '0') {
+          binary.push_back('\0');
+        } else if (*p == '\\') {
+          binary.push_back('\\');
+        } else {
+          CURRENT_THROW(MalformedEntryException(std::string(data, length)));
+        }
+      }
+    }
+    return ParseBinary<ENTRY>(binary);
+  }
+
+  // The raw entries are exposed as JSON regardless of how they are stored, so the line is transcoded into `output`.
+  template <typename ENTRY>
+  static bool TranscodeLineIntoJSON(const char* line, size_t length, std::string& output) {
+    const char* tab = static_cast<const char*>(std::memchr(line, '\t', length));
+    if (!tab) {
+      CURRENT_THROW(MalformedEntryException(std::string(line, length)));
+    }
+    const size_t prefix_length = static_cast<size_t>(tab - line) + 1u;
+    output.assign(line, prefix_length);
+    output.append(JSON(Parse<ENTRY>(tab + 1, length - prefix_length)));
+    return true;
+  }
+};
+
+// The raw entry, as exposed by the `Unsafe` iterator: the bytes of the line, with no copy made when the file is mapped.
+// Valid until the iterator it came from is advanced or destroyed. Converts into `std::string` to keep the entry.
+class FileEntryView final {
+ public:
+  FileEntryView(const char* data, size_t length) : data_(data), length_(length) {}
+  FileEntryView(const std::string& s) : data_(s.data()), length_(s.length()) {}
+  FileEntryView(const char* s) : data_(s), length_(strlen(s)) {}
+
+  const char* data() const { return data_; }
+  size_t size() const { return length_; }
+  size_t length() const { return length_; }
+  bool empty() const { return !length_; }
+  char operator[](size_t i) const { return data_[i]; }
+
+  std::string ToString() const { return std::string(data_, length_); }
+  operator std::string() const { return ToString(); }
+
+  friend bool operator==(const FileEntryView& lhs, const FileEntryView& rhs) {
+    return lhs.length_ == rhs.length_ && !std::memcmp(lhs.data_, rhs.data_, lhs.length_);
+  }
+  friend bool operator!=(const FileEntryView& lhs, const FileEntryView& rhs) { return !(lhs == rhs); }
+  friend std::ostream& operator<<(std::ostream& os, const FileEntryView& view) {
+    return os.write(view.data_, static_cast<std::streamsize>(view.length_));
+  }
+
+ private:
+  const char* data_;
+  size_t length_;
+};
+
+// An iterator to read a file line by line, extracting tab-separated `idxts_t index` and the entry data.
 // Validates the entries come in the right order of 0-based indexes, and with strictly increasing timestamps.
-template <typename ENTRY>
+// The lines come from `LINE_READER`, either an `std::istream`, or the memory mapping of the file.
+template <typename ENTRY, class LINE_READER = IStreamLineReader>
 class IteratorOverFileOfPersistedEntries {
  public:
-  explicit IteratorOverFileOfPersistedEntries(std::istream& fi, std::streampos offset, uint64_t index_at_offset)
-      : fi_(fi), next_(index_at_offset, std::chrono::microseconds(0)) {
-    CURRENT_ASSERT(!fi_.bad());
-    if (offset) {
-      fi_.seekg(offset, std::ios_base::beg);
-    }
-  }
+  explicit IteratorOverFileOfPersistedEntries(LINE_READER&& reader, uint64_t index_at_offset)
+      : reader_(std::move(reader)), next_(index_at_offset, std::chrono::microseconds(0)) {}
 
   template <typename F1, typename F2>
   bool ProcessNextEntry(F1&& on_entry, F2&& on_directive) {
-    if (std::getline(fi_, line_)) {
+    const char* line;
+    size_t length;
+    if (reader_.NextLine(line, length)) {
+      if (!length) {
+        CURRENT_THROW(MalformedEntryException(""));
+      }
       // A directive always starts with kDirectiveMarker ('#'),
       // an entry - with JSON-serialized `idxts_t` object
-      if (line_[0] != constants::kDirectiveMarker) {
-        const size_t tab_pos = line_.find('\t');
-        if (tab_pos == std::string::npos) {
-          CURRENT_THROW(MalformedEntryException(line_));
+      if (line[0] != constants::kDirectiveMarker) {
+        const char* tab = static_cast<const char*>(std::memchr(line, '\t', length));
+        if (!tab) {
+          CURRENT_THROW(MalformedEntryException(std::string(line, length)));
         }
-        const auto current = ParseJSON<idxts_t>(line_.substr(0, tab_pos));
+        const size_t tab_pos = static_cast<size_t>(tab - line);
+        const auto current = ParseJSON<idxts_t>(line, tab_pos);
         if (current.index != next_.index) {
           // Indexes must be strictly continuous.
           CURRENT_THROW(ss::InconsistentIndexException(next_.index, current.index));
@@ -93,12 +284,12 @@ class IteratorOverFileOfPersistedEntries {
           // Timestamps must monotonically increase.
           CURRENT_THROW(ss::InconsistentTimestampException(next_.us, current.us));
         }
-        on_entry(current, line_.c_str() + tab_pos + 1);
+        on_entry(current, tab + 1, length - tab_pos - 1u);
         next_ = current;
         ++next_.index;
         ++next_.us;
       } else {
-        on_directive(line_);
+        on_directive(std::string(line, length));
       }
       return true;
     } else {
@@ -110,13 +301,12 @@ class IteratorOverFileOfPersistedEntries {
   idxts_t Next() const { return next_; }
 
  private:
-  std::istream& fi_;
-  std::string line_;
+  LINE_READER reader_;
   idxts_t next_;
 };
 
 // The implementation of a persister based exclusively on appending to and reading one text flie.
-template <typename ENTRY>
+template <typename ENTRY, class ENTRY_FORMAT = JSONFileEntryFormat>
 class FilePersister {
  protected:
   // { last_published_index + 1, last_published_us, current_head_us }, or { 0, -1us, -1us } for an empty persister.
@@ -133,17 +323,38 @@ class FilePersister {
     std::ofstream appender;
     std::fstream head_rewriter;
 
-    // `offset.size() == end.next_index`, and `offset[i]` is the offset in bytes where the line for index `i` begins.
-    std::mutex& mutex_ref;  // Guards `offset`, `head_offset` and `timestamp`.
-    std::vector<std::streampos> offset;
+    // The iterators read the file through its memory mapping, up to `file_size`, the number of bytes written so far.
+    // `file_size` is updated under `mutex_ref` after each write, before the written entries are reflected in `end`.
+    FilePersisterMapping mapping;
+    std::atomic<uint64_t> file_size;
+
+    // `start.index + index.Size() == end.next_index`, and `index.Offset(i)` is the offset in bytes where the line
+    // for index `start.index + i` begins, with `index.Timestamp(i)` being the timestamp of that entry.
+    const FilePersisterStart start;
+    std::mutex& mutex_ref;  // Guards `index` and `head_offset`.
+    FilePersisterIndex index;
     std::streamoff head_offset;
-    std::vector<std::chrono::microseconds> timestamp;
 
     // Just `std::atomic<end_t> end;` won't work in g++ until 5.1, ref.
     // http://stackoverflow.com/questions/29824570/segfault-in-stdatomic-load/29824840#29824840
     // std::atomic<end_t> end;
     current::atomic_that_works<end_t> end;
 
+    // Group commit state, guarded by `group_commit_mutex`, which is locked after `mutex_ref` when both are held.
+    // The entries of the batch are already assigned their indexes and offsets, but are added to `index`,
+    // and reflected in `end`, only once written, with `mutex_ref` held.
+    const bool group_commit_enabled;
+    const FilePersisterGroupCommit group_commit;
+    std::mutex group_commit_mutex;
+    std::condition_variable group_commit_cv;  // Notified once the batch is full or written, to cut `max_delay` short.
+    end_t batch_end;  // The `end` as seen by the publishers, including the entries of the pending batch.
+    std::string batch_data;
+    std::vector<std::streampos> batch_offset;
+    std::vector<std::chrono::microseconds> batch_timestamp;
+    std::streamoff batch_next_offset = 0;
+    bool batch_write_failed = false;
+    int sync_fd = -1;  // Used for `fdatasync()`, if requested.
+
     FilePersisterImpl() = delete;
     FilePersisterImpl(const FilePersisterImpl&) = delete;
     FilePersisterImpl(FilePersisterImpl&&) = delete;
@@ -152,87 +363,295 @@ class FilePersister {
 
     explicit FilePersisterImpl(std::mutex& mutex_ref,
                                const ss::StreamNamespaceName& namespace_name,
-                               const std::string& filename)
+                               const std::string& filename,
+                               bool group_commit_enabled = false,
+                               const FilePersisterGroupCommit& group_commit = FilePersisterGroupCommit(),
+                               const FilePersisterStart& start = FilePersisterStart(),
+                               bool sidecar_index = false)
         : filename(filename),
           appender(filename, std::ofstream::app | std::ofstream::ate),
           head_rewriter(filename, std::ofstream::in | std::ofstream::out),
+          mapping(filename),
+          file_size(0u),
+          start(start),
           mutex_ref(mutex_ref),
-          head_offset(0) {
+          index(sidecar_index ? filename + constants::kIndexFileSuffix : std::string()),
+          head_offset(0),
+          group_commit_enabled(group_commit_enabled),
+          group_commit(group_commit) {
       ValidateFileAndInitializeHead(namespace_name);
       if (appender.bad() || head_rewriter.bad()) {
         CURRENT_THROW(PersistenceFileNotWritable(filename));
       }
+      file_size.store(static_cast<uint64_t>(std::streamoff(appender.tellp())));
+      if (group_commit_enabled) {
+        batch_end = end.load();
+        batch_next_offset = static_cast<std::streamoff>(file_size.load());
+        if (group_commit.durability == FilePersisterDurability::FDataSync) {
+#ifndef CURRENT_WINDOWS
+          sync_fd = ::open(filename.c_str(), O_WRONLY);
+          if (sync_fd < 0) {
+            CURRENT_THROW(PersistenceFileNotWritable(filename));
+          }
+#endif
+        }
+      }
+    }
+
+    ~FilePersisterImpl() {
+#ifndef CURRENT_WINDOWS
+      if (sync_fd >= 0) {
+        ::close(sync_fd);
+      }
+#endif
+    }
+
+    // Syncs the file data to the disk. `fdatasync()` on any descriptor of the file covers all the writes into it.
+    bool SyncToDisk() {
+#if defined(CURRENT_POSIX)
+      return !::fdatasync(sync_fd);
+#elif defined(CURRENT_APPLE)
+      return !::fsync(sync_fd);
+#else
+      return true;
+#endif
+    }
+
+    // Waits, up to `max_delay`, for the batch to fill up, unless the first `next_index` entries are written meanwhile.
+    // Must be called with `mutex_ref` not locked, so that the publishers waiting for their entries, that are written
+    // already, are not held back, and so that the other publishers can lock it to write a full batch.
+    void WaitForBatchToFillUp(uint64_t next_index) {
+      if (group_commit.max_delay.count() > 0) {
+        std::unique_lock<std::mutex> lock(group_commit_mutex);
+        group_commit_cv.wait_for(lock, group_commit.max_delay, [this, next_index]() {
+          return batch_write_failed || batch_offset.size() >= group_commit.max_batch_size ||
+                 end.load().next_index >= next_index;
+        });
+      }
+    }
+
+    // Writes the pending batch, if any, into the file. Must be called with `mutex_ref` locked, which is held
+    // for the duration of the I/O, while other publishers form the next batch under `group_commit_mutex`.
+    void WriteBatchFromLockedSection() {
+      std::string data;
+      std::vector<std::streampos> batch_offset_to_write;
+      std::vector<std::chrono::microseconds> batch_timestamp_to_write;
+      end_t batch_end_to_write;
+      {
+        std::unique_lock<std::mutex> lock(group_commit_mutex);
+        if (batch_write_failed) {
+          CURRENT_THROW(PersistenceFileNotWritable(filename));
+        }
+        if (batch_offset.empty()) {
+          return;
+        }
+        data.swap(batch_data);
+        batch_offset_to_write.swap(batch_offset);
+        batch_timestamp_to_write.swap(batch_timestamp);
+        batch_end_to_write = batch_end;
+      }
+
+      appender.write(data.data(), data.size());
+      appender.flush();
+      bool ok = appender.good();
+      if (ok && group_commit.durability == FilePersisterDurability::FDataSync) {
+        ok = SyncToDisk();
+      }
+      if (!ok) {
+        std::lock_guard<std::mutex> lock(group_commit_mutex);
+        batch_write_failed = true;
+        group_commit_cv.notify_all();
+        CURRENT_THROW(PersistenceFileNotWritable(filename));
+      }
+
+      for (size_t i = 0; i < batch_offset_to_write.size(); ++i) {
+        index.PushBack(batch_offset_to_write[i], batch_timestamp_to_write[i]);
+      }
+      if (group_commit.durability == FilePersisterDurability::FDataSync) {
+        // A failure is not fatal: the entries are durable, and the index is validated, or rebuilt, on restart.
+        static_cast<void>(index.Sync());
+      }
+      file_size.store(file_size.load() + data.size());
+      head_offset = 0;
+      {
+        // Under `group_commit_mutex`, for the publishers waiting for the batch to not miss the update.
+        std::lock_guard<std::mutex> lock(group_commit_mutex);
+        end.store(batch_end_to_write);
+      }
+      group_commit_cv.notify_all();
+    }
+
+    // Makes the first `next_index` entries durable. Must be called with `mutex_ref` locked. The entries appended
+    // before are either written already, as no other write can be in progress, or are in the pending batch.
+    void MakeDurableFromLockedSection(uint64_t next_index) {
+      if (end.load().next_index < next_index) {
+        WriteBatchFromLockedSection();
+        CURRENT_ASSERT(end.load().next_index >= next_index);
+      }
+    }
+
+    // Whether the line at `index.Offset(i)` is the entry `start.index + i` with the timestamp `index.Timestamp(i)`.
+    bool IndexedEntryMatchesFile(std::istream& fi, uint64_t i, std::streamoff file_size) {
+      const std::streamoff entry_offset = index.Offset(i);
+      if (entry_offset < 0 || entry_offset >= file_size) {
+        return false;
+      }
+      if (entry_offset) {
+        // The entry must begin right after the end of the previous line.
+        fi.seekg(entry_offset - 1, std::ios_base::beg);
+        if (fi.get() != '\n') {
+          return false;
+        }
+      } else {
+        fi.seekg(0, std::ios_base::beg);
+      }
+      std::string line;
+      if (!std::getline(fi, line) || fi.eof() || line.empty() || line[0] == constants::kDirectiveMarker) {
+        return false;
+      }
+      const size_t tab_pos = line.find('\t');
+      if (tab_pos == std::string::npos) {
+        return false;
+      }
+      idxts_t current;
+      try {
+        ParseJSON(line.substr(0, tab_pos), current);
+      } catch (const TypeSystemParseJSONException&) {
+        return false;
+      }
+      return current.index == start.index + i && current.us == index.Timestamp(i);
+    }
+
+    // Checks the header and the tail of the index, and the first and the last indexed entries against the file.
+    // As the offsets and the timestamps are increasing, all the records then point within the file.
+    // Does not read through the file.
+    bool IndexMatchesFile(std::istream& fi) {
+      const uint64_t size = index.Size();
+      if (!size) {
+        return true;
+      }
+      fi.seekg(0, std::ios_base::end);
+      const std::streamoff file_size = fi.tellg();
+      const bool result = index.Consistent() && IndexedEntryMatchesFile(fi, 0u, file_size) &&
+                          IndexedEntryMatchesFile(fi, size - 1u, file_size);
+      fi.clear();
+      fi.seekg(0, std::ios_base::beg);
+      return result;
     }
 
     // Replay the file but ignore its contents. Used to initialize `end` at startup.
+    // If the sidecar index matches the file, only the lines before the first entry, i.e. the directives at the
+    // beginning of the file, and the tail of the file starting from the last indexed entry are read.
     void ValidateFileAndInitializeHead(const ss::StreamNamespaceName& namespace_name) {
       std::ifstream fi(filename);
       if (!fi.bad()) {
-        // Read through all the lines.
+        // Read through the lines.
         // Let `IteratorOverFileOfPersistedEntries` maintain its own `next_`, which later becomes `this->end`.
-        // While reading the file, record the offset of each record and store it in `offset`.
-        IteratorOverFileOfPersistedEntries<ENTRY> cit(fi, 0, 0);
+        // While reading the file, record the offset of each record not yet indexed and append it to `index`.
         const std::streampos offset_zero(0);
         auto current_offset = offset_zero;
-        auto head = std::chrono::microseconds(-1);
+        auto head = start.head;
+        bool format_directive_found = false;
+        bool indexed_entry_found = false;
         reflection::StructSchema struct_schema;
         struct_schema.AddType<ENTRY>();
         const auto signature = JSON(ss::StreamSignature(namespace_name, struct_schema.GetSchemaInfo()));
-        while (cit.ProcessNextEntry(
-            [&](const idxts_t& current, const char*) {
-              CURRENT_ASSERT(current.index == offset.size());
-              CURRENT_ASSERT(current.index == timestamp.size());
-              if (!(current.us > head)) {
-                CURRENT_THROW(ss::InconsistentTimestampException(head + std::chrono::microseconds(1), current.us));
-              }
-              offset.push_back(current_offset);
-              timestamp.push_back(current.us);
-              current_offset = fi.tellg();
-              head = current.us;
-              head_offset = 0;
-            },
-            [&](const std::string& value) {
-              static const auto head_key_length = strlen(constants::kHeadDirective);
-              static const auto signature_key_length = strlen(constants::kSignatureDirective);
-              head_offset = 0;
-              if (!value.compare(0, head_key_length, constants::kHeadDirective)) {
-                auto offset = head_key_length;
-                while (std::isspace(value[offset])) {
-                  ++offset;
-                }
-                const auto us = std::chrono::microseconds(current::FromString<head_value_t>(value.c_str() + offset));
-                if (!(us > head)) {
-                  CURRENT_THROW(ss::InconsistentTimestampException(head + std::chrono::microseconds(1), us));
-                }
-                head = us;
-                head_offset = std::streamoff(current_offset) + offset;
-              } else if (!value.compare(0, signature_key_length, constants::kSignatureDirective)) {
-                // The signature, if present, should be at the beginning of the file.
-                if (current_offset != offset_zero) {
-                  CURRENT_THROW(InvalidSignatureLocation());
-                }
-                auto offset = signature_key_length;
-                while (std::isspace(value[offset])) {
-                  ++offset;
-                }
-                if (value.compare(offset, signature.length(), signature)) {
-                  CURRENT_THROW(InvalidStreamSignature(signature, value.substr(offset)));
-                }
-              }
-              current_offset = fi.tellg();
-            })) {
+        const auto on_entry = [&](const idxts_t& current, const char*, size_t) {
+          if (!(current.us > head)) {
+            CURRENT_THROW(ss::InconsistentTimestampException(head + std::chrono::microseconds(1), current.us));
+          }
+          if (current.index - start.index < index.Size()) {
+            indexed_entry_found = true;
+          } else {
+            CURRENT_ASSERT(current.index - start.index == index.Size());
+            index.PushBack(current_offset, current.us);
+          }
+          current_offset = fi.tellg();
+          head = current.us;
+          head_offset = 0;
+        };
+        const auto on_directive = [&](const std::string& value) {
+          static const auto head_key_length = strlen(constants::kHeadDirective);
+          static const auto signature_key_length = strlen(constants::kSignatureDirective);
+          static const auto format_key_length = strlen(constants::kFormatDirective);
+          head_offset = 0;
+          if (!value.compare(0, head_key_length, constants::kHeadDirective)) {
+            auto offset = head_key_length;
+            while (std::isspace(value[offset])) {
+              ++offset;
+            }
+            const auto us = std::chrono::microseconds(current::FromString<head_value_t>(value.c_str() + offset));
+            if (!(us > head)) {
+              CURRENT_THROW(ss::InconsistentTimestampException(head + std::chrono::microseconds(1), us));
+            }
+            head = us;
+            head_offset = std::streamoff(current_offset) + offset;
+          } else if (!value.compare(0, signature_key_length, constants::kSignatureDirective)) {
+            // The signature, if present, should be at the beginning of the file.
+            if (current_offset != offset_zero) {
+              CURRENT_THROW(InvalidSignatureLocation());
+            }
+            auto offset = signature_key_length;
+            while (std::isspace(value[offset])) {
+              ++offset;
+            }
+            if (value.compare(offset, signature.length(), signature)) {
+              CURRENT_THROW(InvalidStreamSignature(signature, value.substr(offset)));
+            }
+          } else if (!value.compare(0, format_key_length, constants::kFormatDirective)) {
+            auto offset = format_key_length;
+            while (std::isspace(value[offset])) {
+              ++offset;
+            }
+            if (value.compare(offset, std::string::npos, ENTRY_FORMAT::Name())) {
+              CURRENT_THROW(InvalidFileEntryFormat(ENTRY_FORMAT::Name(), value.substr(offset)));
+            }
+            format_directive_found = true;
+          }
+          current_offset = fi.tellg();
+        };
+        if (!IndexMatchesFile(fi)) {
+          index.Clear();
+        }
+        IteratorOverFileOfPersistedEntries<ENTRY> cit(IStreamLineReader(fi, 0), start.index);
+        while (!indexed_entry_found && cit.ProcessNextEntry(on_entry, on_directive)) {
           ;
         }
-        const auto& next = cit.Next();
+        auto next = cit.Next();
+        if (indexed_entry_found) {
+          // Skip to the last indexed entry. The entries before it have been validated when they were indexed.
+          const uint64_t last_indexed_index = index.Size() - 1u;
+          current_offset = index.Offset(last_indexed_index);
+          head = index.Timestamp(last_indexed_index) - std::chrono::microseconds(1);
+          fi.clear();
+          fi.seekg(current_offset, std::ios_base::beg);
+          IteratorOverFileOfPersistedEntries<ENTRY> tail(IStreamLineReader(fi, current_offset),
+                                                         start.index + last_indexed_index);
+          while (tail.ProcessNextEntry(on_entry, on_directive)) {
+            ;
+          }
+          next = tail.Next();
+        }
         // The `next.us` stores the closest possible next entry timestamp,
         // so the last processed entry timestamp is always 1us less.
-        end.store({next.index, next.us - std::chrono::microseconds(1), head});
+        if (next.index != start.index) {
+          end.store({next.index, next.us - std::chrono::microseconds(1), head});
+        } else {
+          end.store({start.index, start.last_entry_us, head});
+        }
         // Append the signature if there is neither entries nor directives in the file.
         if (!current_offset) {
           appender << constants::kSignatureDirective << ' ' << signature << std::endl;
         }
+        // Mark the file as using the non-default entry format before the first entry is written into it.
+        if (ENTRY_FORMAT::RequiresFormatDirective() && !format_directive_found) {
+          if (next.index) {
+            CURRENT_THROW(InvalidFileEntryFormat(ENTRY_FORMAT::Name(), JSONFileEntryFormat::Name()));
+          }
+          appender << constants::kFormatDirective << ' ' << ENTRY_FORMAT::Name() << std::endl;
+        }
       } else {
-        end.store({0ull, std::chrono::microseconds(-1), std::chrono::microseconds(-1)});
+        end.store({start.index, start.last_entry_us, start.head});
       }
     }
   };
@@ -249,6 +668,74 @@ class FilePersister {
                          const std::string& filename)
       : file_persister_impl_(mutex_ref, namespace_name, filename) {}
 
+  explicit FilePersister(std::mutex& mutex_ref,
+                         const ss::StreamNamespaceName& namespace_name,
+                         const std::string& filename,
+                         const FilePersisterGroupCommit& group_commit)
+      : file_persister_impl_(mutex_ref, namespace_name, filename, true, group_commit) {}
+
+  explicit FilePersister(std::mutex& mutex_ref,
+                         const ss::StreamNamespaceName& namespace_name,
+                         const std::string& filename,
+                         FilePersisterSidecarIndex)
+      : file_persister_impl_(
+            mutex_ref, namespace_name, filename, false, FilePersisterGroupCommit(), FilePersisterStart(), true) {}
+
+  explicit FilePersister(std::mutex& mutex_ref,
+                         const ss::StreamNamespaceName& namespace_name,
+                         const std::string& filename,
+                         const FilePersisterGroupCommit& group_commit,
+                         FilePersisterSidecarIndex)
+      : file_persister_impl_(mutex_ref, namespace_name, filename, true, group_commit, FilePersisterStart(), true) {}
+
+  // Used by `SegmentedFile`, which keeps a sidecar index for each segment, and removes it along with the segment.
+  explicit FilePersister(std::mutex& mutex_ref,
+                         const ss::StreamNamespaceName& namespace_name,
+                         const std::string& filename,
+                         const FilePersisterStart& start,
+                         FilePersisterSidecarIndex)
+      : file_persister_impl_(mutex_ref, namespace_name, filename, false, FilePersisterGroupCommit(), start, true) {}
+
+  // The state shared by both iterators: the reader of the lines of the file, from its mapping if possible.
+  class FileReader final {
+   public:
+    FileReader(const FilePersisterImpl& impl, std::streampos offset) : filename_(impl.filename) {
+      std::shared_ptr<const FilePersisterMapping::Region> region = impl.mapping.Acquire(impl.file_size.load());
+      if (region) {
+        mapped_reader_ =
+            std::make_unique<MappedFileLineReader>(impl.mapping, std::move(region), impl.file_size, offset);
+      } else {
+        OpenFile(offset);
+      }
+    }
+
+    bool NextLine(const char*& line, size_t& length) {
+      if (mapped_reader_) {
+        if (mapped_reader_->NextLine(line, length)) {
+          return true;
+        }
+        if (!mapped_reader_->Failed()) {
+          return false;
+        }
+        // The file has outgrown the mapping, and no larger mapping is available: read the rest of it from the file.
+        OpenFile(mapped_reader_->Offset());
+        mapped_reader_ = nullptr;
+      }
+      return istream_reader_->NextLine(line, length);
+    }
+
+   private:
+    void OpenFile(std::streampos offset) {
+      fi_ = std::make_unique<std::ifstream>(filename_);
+      istream_reader_ = std::make_unique<IStreamLineReader>(*fi_, offset);
+    }
+
+    const std::string filename_;
+    std::unique_ptr<MappedFileLineReader> mapped_reader_;
+    std::unique_ptr<std::ifstream> fi_;
+    std::unique_ptr<IStreamLineReader> istream_reader_;
+  };
+
   class Iterator final {
    public:
     struct Entry {
@@ -269,8 +756,8 @@ class FilePersister {
              uint64_t index_at_offset)
         : file_persister_impl_(file_persister_impl, [this]() { valid_ = false; }), i_(i) {
       if (!filename.empty()) {
-        fi_ = std::make_unique<std::ifstream>(filename);
-        cit_ = std::make_unique<IteratorOverFileOfPersistedEntries<ENTRY>>(*fi_, offset, index_at_offset);
+        cit_ = std::make_unique<IteratorOverFileOfPersistedEntries<ENTRY, FileReader>>(
+            FileReader(*file_persister_impl_, offset), index_at_offset);
       }
     }
 
@@ -285,11 +772,11 @@ class FilePersister {
       bool found = false;
       while (!found) {
         if (!(cit_->ProcessNextEntry(
-                [this, &found, &result](const idxts_t& cursor, const char* json) {
+                [this, &found, &result](const idxts_t& cursor, const char* data, size_t length) {
                   if (cursor.index == i_) {
                     found = true;
                     result.idx_ts = cursor;
-                    result.entry = ParseJSON<ENTRY>(json);
+                    result.entry = ENTRY_FORMAT::template Parse<ENTRY>(data, length);
                   } else if (cursor.index > i_) {                                     // LCOV_EXCL_LINE
                     CURRENT_THROW(ss::InconsistentIndexException(i_, cursor.index));  // LCOV_EXCL_LINE
                   }
@@ -317,11 +804,12 @@ class FilePersister {
    private:
     ScopeOwnedBySomeoneElse<FilePersisterImpl> file_persister_impl_;
     bool valid_ = true;
-    std::unique_ptr<std::ifstream> fi_;
-    std::unique_ptr<IteratorOverFileOfPersistedEntries<ENTRY>> cit_;
+    std::unique_ptr<IteratorOverFileOfPersistedEntries<ENTRY, FileReader>> cit_;
     uint64_t i_;
   };
 
+  // Returns the raw lines of the file, reading through it sequentially, and skipping the directives.
+  // For the JSON format, the returned `FileEntryView` points straight into the mapped file.
   class IteratorUnsafe final {
    public:
     IteratorUnsafe() = delete;
@@ -334,38 +822,44 @@ class FilePersister {
                    const std::string& filename,
                    uint64_t i,
                    std::streampos offset,
-                   uint64_t)
-        : file_persister_impl_(file_persister_impl, [this]() { valid_ = false; }), i_(i), current_offset_(offset) {
+                   uint64_t index_at_offset)
+        : file_persister_impl_(file_persister_impl, [this]() { valid_ = false; }),
+          i_(i),
+          next_line_index_(index_at_offset) {
       if (!filename.empty()) {
-        fi_ = std::make_unique<std::ifstream>(filename);
-        CURRENT_ASSERT(!fi_->bad());
-        if (offset) {
-          fi_->seekg(offset, std::ios_base::beg);
-        }
+        reader_ = std::make_unique<FileReader>(*file_persister_impl_, offset);
       }
     }
 
     // `operator*` relies on the fact each entry will be requested at most once.
     // The range-based for-loop works fine. -- D.K.
-    std::string operator*() const {
+    FileEntryView operator*() const {
       if (!valid_) {
         CURRENT_THROW(
             PersistenceFileNoLongerAvailable(file_persister_impl_.ObjectAccessorDespitePossiblyDestructing().filename));
       }
-      if (current_entry_.empty()) {
-        const auto offset = file_persister_impl_->offset[i_];
-        if (offset != current_offset_) {
-          fi_->seekg(offset, std::ios_base::beg);
-          current_offset_ = offset;
-        }
-        if (std::getline(*fi_, current_entry_)) {
-          CURRENT_ASSERT(current_entry_[0] != constants::kDirectiveMarker);
-        } else {
-          // End of file. Should never happen as long as the user only iterates over valid ranges.
-          CURRENT_THROW(current::Exception());  // LCOV_EXCL_LINE
+      if (!current_line_) {
+        while (true) {
+          const char* line;
+          size_t length;
+          if (!reader_->NextLine(line, length)) {
+            // End of file. Should never happen as long as the user only iterates over valid ranges.
+            CURRENT_THROW(current::Exception());  // LCOV_EXCL_LINE
+          }
+          if (length && line[0] != constants::kDirectiveMarker && next_line_index_++ == i_) {
+            current_line_ = line;
+            current_length_ = length;
+            current_transcoded_ =
+                ENTRY_FORMAT::template TranscodeLineIntoJSON<ENTRY>(line, length, current_transcoded_entry_);
+            break;
+          }
         }
       }
-      return current_entry_;
+      if (current_transcoded_) {
+        return FileEntryView(current_transcoded_entry_);
+      } else {
+        return FileEntryView(current_line_, current_length_);
+      }
     }
 
     IteratorUnsafe& operator++() {
@@ -374,7 +868,7 @@ class FilePersister {
             PersistenceFileNoLongerAvailable(file_persister_impl_.ObjectAccessorDespitePossiblyDestructing().filename));
       }
       ++i_;
-      current_entry_.clear();
+      current_line_ = nullptr;
       return *this;
     }
     bool operator==(const IteratorUnsafe& rhs) const { return i_ == rhs.i_; }
@@ -384,10 +878,13 @@ class FilePersister {
    private:
     ScopeOwnedBySomeoneElse<FilePersisterImpl> file_persister_impl_;
     bool valid_ = true;
-    std::unique_ptr<std::ifstream> fi_;
+    std::unique_ptr<FileReader> reader_;
     uint64_t i_;
-    mutable std::string current_entry_;
-    mutable std::streampos current_offset_;
+    mutable uint64_t next_line_index_;  // The index of the entry the next non-directive line of the file holds.
+    mutable const char* current_line_ = nullptr;
+    mutable size_t current_length_ = 0u;
+    mutable bool current_transcoded_ = false;
+    mutable std::string current_transcoded_entry_;
   };
 
   template <typename ITERATOR>
@@ -438,6 +935,10 @@ class FilePersister {
 
   template <current::locks::MutexLockStatus MLS, typename E, typename US>
   idxts_t DoPublish(E&& entry, const US us) {
+    if (file_persister_impl_->group_commit_enabled) {
+      return DoPublishWithGroupCommit<MLS>(std::forward<E>(entry), us);
+    }
+
     current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->mutex_ref);
 
     end_t iterator = file_persister_impl_->end.load();
@@ -448,12 +949,13 @@ class FilePersister {
 
     iterator.last_entry_us = iterator.head = timestamp;
     const auto current = idxts_t(iterator.next_index, iterator.last_entry_us);
-    CURRENT_ASSERT(file_persister_impl_->offset.size() == iterator.next_index);
-    CURRENT_ASSERT(file_persister_impl_->timestamp.size() == iterator.next_index);
-    file_persister_impl_->offset.push_back(file_persister_impl_->appender.tellp());
-    file_persister_impl_->timestamp.push_back(timestamp);
+    CURRENT_ASSERT(file_persister_impl_->start.index + file_persister_impl_->index.Size() == iterator.next_index);
+    file_persister_impl_->index.PushBack(std::streamoff(file_persister_impl_->file_size.load()), timestamp);
 
-    file_persister_impl_->appender << JSON(current) << '\t' << JSON(std::forward<E>(entry)) << std::endl;
+    WriteJSON(file_persister_impl_->appender, current) << '\t' << ENTRY_FORMAT::Serialize(std::forward<E>(entry))
+                                                      << std::endl;
+    file_persister_impl_->file_size.store(
+        static_cast<uint64_t>(std::streamoff(file_persister_impl_->appender.tellp())));
     ++iterator.next_index;
     file_persister_impl_->head_offset = 0;
     file_persister_impl_->end.store(iterator);
@@ -461,10 +963,148 @@ class FilePersister {
     return current;
   }
 
+  template <current::locks::MutexLockStatus MLS, typename E, typename US>
+  idxts_t DoPublishWithGroupCommit(E&& entry, const US us) {
+    FilePersisterImpl& impl = *file_persister_impl_;
+    const auto current = AppendToBatch<MLS>([&impl, &entry, us]() {
+      end_t& iterator = impl.batch_end;
+      const auto timestamp = current::time::GetTimestampFromLockedSection(us);
+      if (!(timestamp > iterator.head)) {
+        CURRENT_THROW(ss::InconsistentTimestampException(iterator.head + std::chrono::microseconds(1), timestamp));
+      }
+      iterator.last_entry_us = iterator.head = timestamp;
+      const auto current = idxts_t(iterator.next_index, iterator.last_entry_us);
+      impl.batch_offset.push_back(impl.batch_next_offset);
+      impl.batch_timestamp.push_back(timestamp);
+      impl.batch_next_offset +=
+          static_cast<std::streamoff>(AppendEntryLine(impl.batch_data, current, std::forward<E>(entry)));
+      ++iterator.next_index;
+      return current;
+    });
+    MakeDurable<MLS>(current.index + 1);
+    return current;
+  }
+
+  // Calls `append` with `group_commit_mutex` locked, once the pending batch has room, and returns its result.
+  // A full batch is written first, by this publisher, unless another one gets to write it.
+  template <current::locks::MutexLockStatus MLS, typename F>
+  auto AppendToBatch(F&& append) -> decltype(append()) {
+    FilePersisterImpl& impl = *file_persister_impl_;
+    while (true) {
+      uint64_t full_batch_next_index;
+      {
+        std::lock_guard<std::mutex> lock(impl.group_commit_mutex);
+        if (impl.batch_write_failed) {
+          CURRENT_THROW(PersistenceFileNotWritable(impl.filename));
+        }
+        if (impl.batch_offset.size() < impl.group_commit.max_batch_size) {
+          auto result = append();
+          if (impl.batch_offset.size() >= impl.group_commit.max_batch_size) {
+            impl.group_commit_cv.notify_all();
+          }
+          return result;
+        }
+        full_batch_next_index = impl.batch_end.next_index;
+      }
+      MakeDurable<MLS>(full_batch_next_index);
+    }
+  }
+
+  // Makes the first `next_index` entries durable, locking the publish mutex for the write unless it is held already.
+  // Only the publishers that do not hold the publish mutex wait for the batch to fill up: while it is held, no other
+  // publisher that holds it to publish can join the batch, so the wait would only delay the caller's own entries.
+  template <current::locks::MutexLockStatus MLS>
+  void MakeDurable(uint64_t next_index) {
+    FilePersisterImpl& impl = *file_persister_impl_;
+    if (impl.end.load().next_index < next_index) {
+      if (MLS == current::locks::MutexLockStatus::NeedToLock) {
+        impl.WaitForBatchToFillUp(next_index);
+      }
+      current::locks::SmartMutexLockGuard<MLS> lock(impl.mutex_ref);
+      impl.MakeDurableFromLockedSection(next_index);
+    }
+  }
+
+  // Writes the whole batch at once, and, with group commit, waits for it to become durable once.
+  // With group commit, the batch joins the pending one as a whole, even if it exceeds `max_batch_size`.
+  template <current::locks::MutexLockStatus MLS>
+  void DoPublishBatch(std::vector<ss::IndexedEntry<ENTRY>>& entries) {
+    FilePersisterImpl& impl = *file_persister_impl_;
+    if (impl.group_commit_enabled) {
+      const uint64_t next_index = AppendToBatch<MLS>([&impl, &entries]() {
+        ss::ValidateBatchTimestamps(entries, impl.batch_end.head);
+        for (auto& e : entries) {
+          impl.batch_offset.push_back(impl.batch_next_offset);
+          impl.batch_timestamp.push_back(e.idx_ts.us);
+          impl.batch_next_offset += static_cast<std::streamoff>(AppendEntryLine(
+              impl.batch_data, idxts_t(impl.batch_end.next_index++, e.idx_ts.us), std::move(e.entry)));
+        }
+        if (!entries.empty()) {
+          impl.batch_end.last_entry_us = impl.batch_end.head = entries.back().idx_ts.us;
+        }
+        return impl.batch_end.next_index;
+      });
+      MakeDurable<MLS>(next_index);
+    } else {
+      current::locks::SmartMutexLockGuard<MLS> lock(impl.mutex_ref);
+      end_t iterator = impl.end.load();
+      ss::ValidateBatchTimestamps(entries, iterator.head);
+      if (entries.empty()) {
+        return;
+      }
+      std::string data;
+      const uint64_t file_size = impl.file_size.load();
+      for (auto& e : entries) {
+        CURRENT_ASSERT(impl.start.index + impl.index.Size() == iterator.next_index);
+        impl.index.PushBack(static_cast<std::streamoff>(file_size + data.size()), e.idx_ts.us);
+        AppendEntryLine(data, idxts_t(iterator.next_index++, e.idx_ts.us), std::move(e.entry));
+      }
+      impl.appender.write(data.data(), data.size());
+      impl.appender.flush();
+      impl.file_size.store(file_size + data.size());
+      iterator.last_entry_us = iterator.head = entries.back().idx_ts.us;
+      impl.head_offset = 0;
+      impl.end.store(iterator);
+    }
+  }
+
+  // Appends the line of the entry to `data`, returning the length of the line.
+  template <typename E>
+  static size_t AppendEntryLine(std::string& data, idxts_t current, E&& entry) {
+    const size_t size_before = data.size();
+    AppendJSON(data, current);
+    data.append(1, '\t');
+    data.append(ENTRY_FORMAT::Serialize(std::forward<E>(entry)));
+    data.append(1, '\n');
+    return data.size() - size_before;
+  }
+
   template <current::locks::MutexLockStatus MLS, typename US>
   void DoUpdateHead(const US us) {
-    current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->mutex_ref);
+    if (file_persister_impl_->group_commit_enabled) {
+      // The `#head` directive must follow all the entries published before it, so write them first,
+      // and keep `group_commit_mutex` locked while writing it, so that no entry joins the batch meanwhile.
+      FilePersisterImpl& impl = *file_persister_impl_;
+      current::locks::SmartMutexLockGuard<MLS> lock(impl.mutex_ref);
+      while (true) {
+        std::unique_lock<std::mutex> group_commit_lock(impl.group_commit_mutex);
+        if (impl.batch_offset.empty()) {
+          DoUpdateHeadImpl(us);
+          impl.batch_end.head = impl.end.load().head;
+          impl.batch_next_offset = static_cast<std::streamoff>(impl.file_size.load());
+          break;
+        }
+        group_commit_lock.unlock();
+        impl.WriteBatchFromLockedSection();
+      }
+    } else {
+      current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->mutex_ref);
+      DoUpdateHeadImpl(us);
+    }
+  }
 
+  template <typename US>
+  void DoUpdateHeadImpl(const US us) {
     end_t iterator = file_persister_impl_->end.load();
     const auto timestamp = current::time::GetTimestampFromLockedSection(us);
     if (!(timestamp > iterator.head)) {
@@ -481,6 +1121,8 @@ class FilePersister {
       appender << constants::kHeadDirective << ' ';
       file_persister_impl_->head_offset = appender.tellp();
       appender << head_str << std::endl;
+      file_persister_impl_->file_size.store(
+          static_cast<uint64_t>(file_persister_impl_->head_offset) + head_str.length() + 1u);
     }
     file_persister_impl_->end.store(iterator);
   }
@@ -517,26 +1159,24 @@ class FilePersister {
     return file_persister_impl_->end.load().head;
   }
 
+  // The number of bytes written into the file so far. Must be called with the publish mutex locked.
+  uint64_t FileSizeFromLockedSection() const {
+    return static_cast<uint64_t>(std::streamoff(file_persister_impl_->appender.tellp()));
+  }
+
   std::pair<uint64_t, uint64_t> IndexRangeByTimestampRange(std::chrono::microseconds from,
                                                            std::chrono::microseconds till) const {
     std::pair<uint64_t, uint64_t> result{static_cast<uint64_t>(-1), static_cast<uint64_t>(-1)};
     std::lock_guard<std::mutex> lock(file_persister_impl_->mutex_ref);
-    const auto begin_it =
-        std::lower_bound(file_persister_impl_->timestamp.begin(),
-                         file_persister_impl_->timestamp.end(),
-                         from,
-                         [](std::chrono::microseconds entry_t, std::chrono::microseconds t) { return entry_t < t; });
-    if (begin_it != file_persister_impl_->timestamp.end()) {
-      result.first = std::distance(file_persister_impl_->timestamp.begin(), begin_it);
+    const FilePersisterIndex& index = file_persister_impl_->index;
+    const uint64_t begin = index.LowerBound(from);
+    if (begin != index.Size()) {
+      result.first = file_persister_impl_->start.index + begin;
     }
     if (till.count() > 0) {
-      const auto end_it =
-          std::upper_bound(file_persister_impl_->timestamp.begin(),
-                           file_persister_impl_->timestamp.end(),
-                           till,
-                           [](std::chrono::microseconds t, std::chrono::microseconds entry_t) { return t < entry_t; });
-      if (end_it != file_persister_impl_->timestamp.end()) {
-        result.second = std::distance(file_persister_impl_->timestamp.begin(), end_it);
+      const uint64_t end = index.UpperBound(till);
+      if (end != index.Size()) {
+        result.second = file_persister_impl_->start.index + end;
       }
     }
     return result;
@@ -560,13 +1200,15 @@ class FilePersister {
       return IterableRange<IM>(
           file_persister_impl_, 0, 0, 0);  // OK, even for an empty persister, where 0 is an invalid index.
     }
-    if (end_index < begin_index) {
+    const uint64_t start_index = file_persister_impl_->start.index;
+    if (end_index < begin_index || begin_index < start_index) {
       CURRENT_THROW(InvalidIterableRangeException());
     }
     std::lock_guard<std::mutex> lock(file_persister_impl_->mutex_ref);
-    CURRENT_ASSERT(file_persister_impl_->offset.size() >=
+    CURRENT_ASSERT(start_index + file_persister_impl_->index.Size() >=
                    current_size);  // "Greater" is OK, `Iterate()` is multithreaded. -- D.K.
-    return IterableRange<IM>(file_persister_impl_, begin_index, end_index, file_persister_impl_->offset[begin_index]);
+    return IterableRange<IM>(
+        file_persister_impl_, begin_index, end_index, file_persister_impl_->index.Offset(begin_index - start_index));
   }
 
   template <ss::IterationMode IM>
@@ -591,6 +1233,9 @@ class FilePersister {
 template <typename ENTRY>
 using File = ss::EntryPersister<impl::FilePersister<ENTRY>, ENTRY>;
 
+template <typename ENTRY>
+using BinaryFile = ss::EntryPersister<impl::FilePersister<ENTRY, impl::BinaryFileEntryFormat>, ENTRY>;
+
 }  // namespace current::persistence
 }  // namespace current
 
@@ -0,0 +1,333 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+          (c) 2016 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The index of the file persister: the offset and the timestamp of each entry of the stream file.
+//
+// By default the index is kept in memory, and is built while the stream file is replayed at startup.
+// If the persister opts in, the index lives in a sidecar file, `<stream file>.idx`, which is a 32-byte header
+// followed by fixed-width 16-byte `{ offset, us }` records, one per entry. The file is memory-mapped and only ever
+// appended to, so that on restart the index is available right away, instead of being rebuilt by reading through
+// the whole stream. The mapping covers the sidecar file only, and is re-created as the file grows with the stream.
+// The sidecar file belongs to the persister that opted in, which is also responsible for removing it.
+// The index is a pure optimization: at startup its header and its last records are checked, and the index is
+// rebuilt if they do not match. If the sidecar file can not be created or mapped, the index is kept in memory only.
+
+#ifndef BLOCKS_PERSISTENCE_FILE_INDEX_H
+#define BLOCKS_PERSISTENCE_FILE_INDEX_H
+
+#include "../../port.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef CURRENT_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace current {
+namespace persistence {
+namespace impl {
+
+namespace constants {
+constexpr char kIndexFileSuffix[] = ".idx";
+constexpr char kIndexFileMagic[8] = {'C', '5', 'T', 'I', 'D', 'X', '0', '3'};
+// The number of the most recent records `Consistent()` checks to be increasing.
+constexpr uint64_t kIndexFileRecordsToValidate = 16u;
+// The sidecar file grows by at least this many records at a time, and by at least its current size.
+constexpr uint64_t kIndexFileGrowthInRecords = 1ull << 16;
+}  // namespace current::persistence::impl::constants
+
+class FilePersisterIndex final {
+ public:
+  struct Record {
+    int64_t offset;
+    int64_t us;
+  };
+  static_assert(sizeof(Record) == 16, "");
+
+  FilePersisterIndex() = delete;
+  FilePersisterIndex(const FilePersisterIndex&) = delete;
+  FilePersisterIndex& operator=(const FilePersisterIndex&) = delete;
+
+  // An empty `filename` keeps the index in memory only.
+  explicit FilePersisterIndex(const std::string& filename) : filename_(filename) {
+    if (!filename_.empty()) {
+      Map();
+    }
+  }
+  ~FilePersisterIndex() { Unmap(); }
+
+  // Whether the records are backed by the sidecar file, as opposed to being kept in memory only.
+  bool Persistent() const { return header_ != nullptr; }
+
+  uint64_t Size() const { return header_ ? header_->size : memory_.size(); }
+
+  // Whether the header matches the last record, and the offsets and the timestamps of the last few records
+  // are increasing. Reads neither the rest of the index nor the stream file, so that the cost does not depend
+  // on the length of the stream; the first and the last records are then checked against the stream file.
+  bool Consistent() const {
+    const uint64_t size = Size();
+    if (!header_ || !size) {
+      return true;
+    }
+    const uint64_t first = size > constants::kIndexFileRecordsToValidate
+                               ? size - constants::kIndexFileRecordsToValidate
+                               : 0u;
+    for (uint64_t i = first + 1u; i < size; ++i) {
+      if (!(At(i).offset > At(i - 1u).offset && At(i).us > At(i - 1u).us)) {
+        return false;
+      }
+    }
+    return header_->checksum == TailChecksum(size, &At(size - 1u));
+  }
+
+  std::streampos Offset(uint64_t i) const { return std::streampos(At(i).offset); }
+  std::chrono::microseconds Timestamp(uint64_t i) const { return std::chrono::microseconds(At(i).us); }
+
+  void PushBack(std::streampos offset, std::chrono::microseconds us) {
+    const Record record{static_cast<int64_t>(std::streamoff(offset)), static_cast<int64_t>(us.count())};
+    if (header_ && !Reserve(header_->size + 1u)) {
+      MoveToMemory();
+    }
+    if (header_) {
+      // The record is written before the size is, so that the sidecar file never refers to a missing record.
+      // A crash between the two leaves the checksum not matching the size, and the index is rebuilt on restart.
+      records_[header_->size] = record;
+      header_->checksum = TailChecksum(header_->size + 1u, &record);
+      ++header_->size;
+    } else {
+      memory_.push_back(record);
+    }
+  }
+
+  // Drops all the records, to rebuild the index from scratch.
+  void Clear() {
+    if (header_) {
+      header_->size = 0u;
+      header_->checksum = TailChecksum(0u, nullptr);
+      synced_size_ = 0u;
+    } else {
+      memory_.clear();
+    }
+  }
+
+  // The index of the first entry with the timestamp not less than `us`, or `Size()` if there is none.
+  uint64_t LowerBound(std::chrono::microseconds us) const {
+    return PartitionPoint([us](int64_t entry_us) { return entry_us < us.count(); });
+  }
+
+  // The index of the first entry with the timestamp greater than `us`, or `Size()` if there is none.
+  uint64_t UpperBound(std::chrono::microseconds us) const {
+    return PartitionPoint([us](int64_t entry_us) { return !(us.count() < entry_us); });
+  }
+
+  // Flushes the records added since the previous call, and then the header, from the mapping to the disk.
+  // Used along with `fdatasync()` of the stream file, so that the index is as durable as the entries it refers to.
+  bool Sync() {
+#ifndef CURRENT_WINDOWS
+    if (!header_ || synced_size_ == header_->size) {
+      return true;
+    }
+    static const uint64_t page_size = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    const uint64_t begin = (sizeof(Header) + synced_size_ * sizeof(Record)) / page_size * page_size;
+    const uint64_t end = sizeof(Header) + header_->size * sizeof(Record);
+    char* mapping = reinterpret_cast<char*>(mapping_);
+    if (::msync(mapping + begin, end - begin, MS_SYNC) || (begin && ::msync(mapping, sizeof(Header), MS_SYNC))) {
+      return false;
+    }
+    synced_size_ = header_->size;
+#endif
+    return true;
+  }
+
+ private:
+  struct Header {
+    char magic[8];
+    uint64_t size;
+    uint64_t checksum;  // Of `size` and the last record, see `TailChecksum()`.
+    uint64_t reserved;
+  };
+  static_assert(sizeof(Header) == 32, "");
+
+  // The FNV-1a hash of the number of records and of the last one, 64 bits at a time.
+  static uint64_t TailChecksum(uint64_t size, const Record* last) {
+    constexpr static uint64_t kPrime = 1099511628211ull;
+    uint64_t checksum = (14695981039346656037ull ^ size) * kPrime;
+    if (last) {
+      checksum = (checksum ^ static_cast<uint64_t>(last->offset)) * kPrime;
+      checksum = (checksum ^ static_cast<uint64_t>(last->us)) * kPrime;
+    }
+    return checksum;
+  }
+
+  const Record& At(uint64_t i) const { return header_ ? records_[i] : memory_[i]; }
+
+  template <typename F>
+  uint64_t PartitionPoint(F&& is_before) const {
+    uint64_t begin = 0u;
+    uint64_t end = Size();
+    while (begin < end) {
+      const uint64_t middle = begin + (end - begin) / 2u;
+      if (is_before(At(middle).us)) {
+        begin = middle + 1u;
+      } else {
+        end = middle;
+      }
+    }
+    return begin;
+  }
+
+  void Map() {
+#ifndef CURRENT_WINDOWS
+    fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+      return;
+    }
+    struct stat file_stat;
+    if (::fstat(fd_, &file_stat)) {
+      Unmap();
+      return;
+    }
+    file_size_ = static_cast<uint64_t>(file_stat.st_size);
+    if (file_size_ < sizeof(Header) && !Reserve(0u)) {
+      Unmap();
+      return;
+    }
+    if (!MapFile()) {
+      Unmap();
+      return;
+    }
+    Header* header = reinterpret_cast<Header*>(mapping_);
+    const bool valid = !std::memcmp(header->magic, constants::kIndexFileMagic, sizeof(header->magic)) &&
+                       header->size <= (file_size_ - sizeof(Header)) / sizeof(Record);
+    if (!valid) {
+      std::memcpy(header->magic, constants::kIndexFileMagic, sizeof(header->magic));
+      header->size = 0u;
+      header->checksum = TailChecksum(0u, nullptr);
+      header->reserved = 0u;
+    }
+    header_ = header;
+    synced_size_ = header_->size;
+#endif
+  }
+
+  // Maps the whole sidecar file, replacing the previous mapping, if any. Keeps the previous mapping on failure.
+  bool MapFile() {
+#ifndef CURRENT_WINDOWS
+    void* mapping = ::mmap(nullptr, file_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) {
+      return false;
+    }
+    if (mapping_) {
+      ::munmap(mapping_, mapped_bytes_);
+    }
+    const bool had_header = header_ != nullptr;
+    mapping_ = mapping;
+    mapped_bytes_ = file_size_;
+    records_ = reinterpret_cast<Record*>(reinterpret_cast<Header*>(mapping_) + 1);
+    if (had_header) {
+      header_ = reinterpret_cast<Header*>(mapping_);
+    }
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // Makes sure the sidecar file, and its mapping, have room for `size` records.
+  // The records move in memory as the file grows, thus they are only accessed under the lock of the persister.
+  bool Reserve(uint64_t size) {
+#ifndef CURRENT_WINDOWS
+    if (sizeof(Header) + size * sizeof(Record) <= file_size_) {
+      return true;
+    }
+    const uint64_t capacity_now = file_size_ >= sizeof(Header) ? (file_size_ - sizeof(Header)) / sizeof(Record) : 0u;
+    const uint64_t growth = std::max(capacity_now, constants::kIndexFileGrowthInRecords);
+    const uint64_t capacity = (size / growth + 1u) * growth;
+    const uint64_t new_file_size = sizeof(Header) + capacity * sizeof(Record);
+    if (static_cast<uint64_t>(static_cast<off_t>(new_file_size)) != new_file_size ||
+        static_cast<uint64_t>(static_cast<size_t>(new_file_size)) != new_file_size ||
+        ::ftruncate(fd_, static_cast<off_t>(new_file_size))) {
+      return false;
+    }
+    file_size_ = new_file_size;
+    return !mapping_ || MapFile();
+#else
+    static_cast<void>(size);
+    return false;
+#endif
+  }
+
+  // Keeps maintaining the index in memory once the sidecar file can not grow any further.
+  // The records already in the sidecar file remain valid, and the rest of the stream is re-read on restart.
+  void MoveToMemory() {
+    memory_.assign(records_, records_ + header_->size);
+    Unmap();
+  }
+
+  void Unmap() {
+#ifndef CURRENT_WINDOWS
+    if (header_) {
+      // Drop the preallocated tail, keeping only the records.
+      const uint64_t size = sizeof(Header) + header_->size * sizeof(Record);
+      header_ = nullptr;
+      // A failure is not fatal, as the sidecar file is still valid with the extra space after its records.
+      const int unused_ftruncate_result = ::ftruncate(fd_, static_cast<off_t>(size));
+      static_cast<void>(unused_ftruncate_result);
+    }
+    if (mapping_) {
+      ::munmap(mapping_, mapped_bytes_);
+      mapping_ = nullptr;
+    }
+    records_ = nullptr;
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+#endif
+  }
+
+  const std::string filename_;
+  int fd_ = -1;
+  void* mapping_ = nullptr;
+  uint64_t mapped_bytes_ = 0u;
+  uint64_t file_size_ = 0u;
+  Header* header_ = nullptr;
+  Record* records_ = nullptr;
+  uint64_t synced_size_ = 0u;  // The number of records known to be flushed to the disk by `Sync()`.
+  std::vector<Record> memory_;  // Used iff there is no sidecar file, or it is not available.
+};
+
+}  // namespace current::persistence::impl
+}  // namespace current::persistence
+}  // namespace current
+
+#endif  // BLOCKS_PERSISTENCE_FILE_INDEX_H
@@ -0,0 +1,217 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The read-only memory mapping of the stream file of the file persister, shared by all its iterators.
+//
+// The file is mapped in regions, each covering the file from its very beginning. A region is sized after the file,
+// with room for it to grow, and the mapping is shared with the file, so that the entries appended to the file become
+// readable through the very same region. Once the file outgrows the most recent region, a twice larger one is mapped.
+// The regions are reference-counted, so that the iterators keep reading through the region they have started with
+// until they need a larger one, and the regions no longer used by any iterator are unmapped.
+// Only the bytes known to be written into the file may be accessed, see `MappedFileLineReader`.
+// If the file can not be mapped, the iterators read it via `std::ifstream`.
+
+#ifndef BLOCKS_PERSISTENCE_FILE_MAPPING_H
+#define BLOCKS_PERSISTENCE_FILE_MAPPING_H
+
+#include "../../port.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#ifndef CURRENT_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace current {
+namespace persistence {
+namespace impl {
+
+namespace constants {
+// The smallest region to map, so that a small file is not remapped every time it grows a bit.
+constexpr uint64_t kStreamFileMinMappedBytes = 1ull << 24;
+}  // namespace current::persistence::impl::constants
+
+class FilePersisterMapping final {
+ public:
+  // The first `size` bytes of the file, mapped into memory for as long as the region is referenced.
+  class Region final {
+   public:
+    Region(const char* data, uint64_t size) : data_(data), size_(size) {}
+    ~Region() {
+#ifndef CURRENT_WINDOWS
+      ::munmap(const_cast<char*>(data_), static_cast<size_t>(size_));
+#endif
+    }
+
+    const char* Data() const { return data_; }
+    uint64_t Size() const { return size_; }
+
+   private:
+    const char* const data_;
+    const uint64_t size_;
+  };
+
+  FilePersisterMapping() = delete;
+  FilePersisterMapping(const FilePersisterMapping&) = delete;
+  FilePersisterMapping& operator=(const FilePersisterMapping&) = delete;
+
+  explicit FilePersisterMapping(const std::string& filename) {
+#ifndef CURRENT_WINDOWS
+    fd_ = ::open(filename.c_str(), O_RDONLY);
+#else
+    static_cast<void>(filename);
+#endif
+  }
+
+  ~FilePersisterMapping() {
+    region_ = nullptr;
+#ifndef CURRENT_WINDOWS
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+#endif
+  }
+
+  // A region covering at least the first `file_size` bytes of the file, or `nullptr` if it can not be mapped.
+  std::shared_ptr<const Region> Acquire(uint64_t file_size) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!(region_ && region_->Size() >= file_size)) {
+      region_ = Map(std::max(std::max(file_size, region_ ? region_->Size() : 0u) * 2u,
+                             constants::kStreamFileMinMappedBytes));
+    }
+    return region_;
+  }
+
+ private:
+  std::shared_ptr<const Region> Map(uint64_t size) const {
+#ifndef CURRENT_WINDOWS
+    if (fd_ >= 0 && static_cast<uint64_t>(static_cast<size_t>(size)) == size) {
+      void* mapping = ::mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_SHARED, fd_, 0);
+      if (mapping != MAP_FAILED) {
+        return std::make_shared<const Region>(reinterpret_cast<const char*>(mapping), size);
+      }
+    }
+#else
+    static_cast<void>(size);
+#endif
+    return nullptr;
+  }
+
+  int fd_ = -1;
+  mutable std::mutex mutex_;
+  mutable std::shared_ptr<const Region> region_;  // The most recent, and the largest, region.
+};
+
+// Reads the lines of the mapped file, starting from `offset`, and up to the number of bytes written so far.
+// The lines are returned as pointers into the mapping, and are only ever read once fully written. A line remains
+// valid until the reader moves on to a larger region twice, i.e. at least until the next line is read.
+// Once the file outgrows the mapping and no larger region can be mapped, `NextLine()` returns `false`, and
+// `Failed()` becomes `true`, for the caller to continue reading the file from `Offset()` by other means.
+class MappedFileLineReader final {
+ public:
+  MappedFileLineReader(const FilePersisterMapping& mapping,
+                       std::shared_ptr<const FilePersisterMapping::Region> region,
+                       const std::atomic<uint64_t>& file_size,
+                       std::streampos offset)
+      : mapping_(mapping),
+        region_(std::move(region)),
+        file_size_(file_size),
+        offset_(static_cast<uint64_t>(std::streamoff(offset))) {}
+
+  // Sets `line` and `length` to the next line, without the trailing '\n'. Returns `false` at the end of the file.
+  bool NextLine(const char*& line, size_t& length) {
+    const uint64_t file_size = file_size_.load();
+    if (offset_ >= file_size) {
+      return false;
+    }
+    if (file_size > region_->Size()) {
+      std::shared_ptr<const FilePersisterMapping::Region> region = mapping_.Acquire(file_size);
+      if (!region) {
+        failed_ = true;
+        return false;
+      }
+      previous_region_ = std::move(region_);
+      region_ = std::move(region);
+    }
+    const char* begin = region_->Data() + offset_;
+    const char* end = static_cast<const char*>(std::memchr(begin, '\n', static_cast<size_t>(file_size - offset_)));
+    if (!end) {
+      return false;
+    }
+    line = begin;
+    length = static_cast<size_t>(end - begin);
+    offset_ += length + 1u;
+    return true;
+  }
+
+  bool Failed() const { return failed_; }
+  std::streampos Offset() const { return std::streampos(static_cast<std::streamoff>(offset_)); }
+
+ private:
+  const FilePersisterMapping& mapping_;
+  std::shared_ptr<const FilePersisterMapping::Region> region_;
+  std::shared_ptr<const FilePersisterMapping::Region> previous_region_;
+  const std::atomic<uint64_t>& file_size_;
+  uint64_t offset_;
+  bool failed_ = false;
+};
+
+// Reads the lines of the file via `std::getline`, for when it is not mapped into memory.
+class IStreamLineReader final {
+ public:
+  IStreamLineReader(std::istream& fi, std::streampos offset) : fi_(fi) {
+    CURRENT_ASSERT(!fi_.bad());
+    if (offset) {
+      fi_.seekg(offset, std::ios_base::beg);
+    }
+  }
+
+  bool NextLine(const char*& line, size_t& length) {
+    if (std::getline(fi_, line_)) {
+      line = line_.data();
+      length = line_.length();
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+ private:
+  std::istream& fi_;
+  std::string line_;
+};
+
+}  // namespace current::persistence::impl
+}  // namespace current::persistence
+}  // namespace current
+
+#endif  // BLOCKS_PERSISTENCE_FILE_MAPPING_H
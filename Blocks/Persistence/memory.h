@@ -24,18 +24,18 @@ SOFTWARE.
 *******************************************************************************/
 
 // A simple, reference, implementation of an in-memory persister.
-// Store all entries in an `std::vector<std::pair<std::chrono::microseconds, ENTRY>>`,
-// and accesses this vector by indexes from under a mutex when iterating over the entries.
+// Stores all entries as `std::pair<std::chrono::microseconds, ENTRY>` in an append-only array, see `memory_array.h`,
+// which is only appended to from under the mutex, and is read by indexes with no lock taken.
 // Iterators never outlive the persister.
 
 #ifndef BLOCKS_PERSISTENCE_MEMORY_H
 #define BLOCKS_PERSISTENCE_MEMORY_H
 
-#include <deque>
 #include <functional>
 #include <mutex>
 
 #include "exceptions.h"
+#include "memory_array.h"
 
 #include "../SS/persister.h"
 #include "../SS/signature.h"
@@ -54,8 +54,8 @@ class MemoryPersister {
  private:
   struct Container {
     using entry_t = std::pair<std::chrono::microseconds, ENTRY>;
-    std::mutex& mutex_ref;  // Guards `entries` and `head`.
-    std::deque<entry_t> entries;
+    std::mutex& mutex_ref;  // Guards `head`, and appending to `entries`.
+    AppendOnlyChunkedArray<entry_t> entries;
     std::chrono::microseconds head = std::chrono::microseconds(-1);
 
     Container(std::mutex& mutex_ref) : mutex_ref(mutex_ref) {}
@@ -82,7 +82,6 @@ class MemoryPersister {
       if (!valid_) {
         CURRENT_THROW(PersistenceMemoryBlockNoLongerAvailable());
       }
-      std::lock_guard<std::mutex> lock(container_->mutex_ref);
       return Entry(i_, container_->entries[i_]);
     }
     Iterator& operator++() {
@@ -111,7 +110,6 @@ class MemoryPersister {
       if (!valid_) {
         CURRENT_THROW(PersistenceMemoryBlockNoLongerAvailable());
       }
-      std::lock_guard<std::mutex> lock(container_->mutex_ref);
       const auto& entry = container_->entries[i_];
       return JSON(idxts_t(i_, entry.first)) + '\t' + JSON(entry.second);
     }
@@ -167,12 +165,24 @@ class MemoryPersister {
     if (!(timestamp > head)) {
       CURRENT_THROW(ss::InconsistentTimestampException(head + std::chrono::microseconds(1), timestamp));
     }
-    const auto index = static_cast<uint64_t>(container_->entries.size());
-    container_->entries.emplace_back(timestamp, std::forward<E>(entry));
+    const auto index = container_->entries.Size();
+    container_->entries.EmplaceBack(timestamp, std::forward<E>(entry));
     container_->head = timestamp;
     return idxts_t(index, timestamp);
   }
 
+  template <current::locks::MutexLockStatus MLS>
+  void DoPublishBatch(std::vector<ss::IndexedEntry<ENTRY>>& entries) {
+    current::locks::SmartMutexLockGuard<MLS> lock(container_->mutex_ref);
+    ss::ValidateBatchTimestamps(entries, container_->head);
+    for (auto& e : entries) {
+      container_->entries.EmplaceBack(e.idx_ts.us, std::move(e.entry));
+    }
+    if (!entries.empty()) {
+      container_->head = entries.back().idx_ts.us;
+    }
+  }
+
   template <current::locks::MutexLockStatus MLS, typename US>
   void DoUpdateHead(const US us) {
     current::locks::SmartMutexLockGuard<MLS> lock(container_->mutex_ref);
@@ -184,31 +194,32 @@ class MemoryPersister {
     container_->head = timestamp;
   }
 
-  template <current::locks::MutexLockStatus MLS>
+  // No lock is needed to read the entries, regardless of `MLS`.
+  template <current::locks::MutexLockStatus>
   bool Empty() const noexcept {
-    current::locks::SmartMutexLockGuard<MLS> lock(container_->mutex_ref);
-    return container_->entries.empty();
+    return container_->entries.Empty();
   }
 
-  template <current::locks::MutexLockStatus MLS>
+  template <current::locks::MutexLockStatus>
   uint64_t Size() const noexcept {
-    current::locks::SmartMutexLockGuard<MLS> lock(container_->mutex_ref);
-    return static_cast<uint64_t>(container_->entries.size());
+    return container_->entries.Size();
   }
 
   idxts_t LastPublishedIndexAndTimestamp() const {
-    std::lock_guard<std::mutex> lock(container_->mutex_ref);
-    if (!container_->entries.empty()) {
-      return idxts_t(container_->entries.size() - 1, container_->entries.back().first);
+    const uint64_t size = container_->entries.Size();
+    if (size) {
+      return idxts_t(size - 1u, container_->entries[size - 1u].first);
     } else {
       CURRENT_THROW(NoEntriesPublishedYet());
     }
   }
 
+  // Locks the mutex, for the head to be consistent with the last entry.
   head_optidxts_t HeadAndLastPublishedIndexAndTimestamp() const noexcept {
     std::lock_guard<std::mutex> lock(container_->mutex_ref);
-    if (!container_->entries.empty()) {
-      return head_optidxts_t(container_->head, container_->entries.size() - 1, container_->entries.back().first);
+    const uint64_t size = container_->entries.Size();
+    if (size) {
+      return head_optidxts_t(container_->head, size - 1u, container_->entries[size - 1u].first);
     } else {
       return head_optidxts_t(container_->head);
     }
@@ -223,23 +234,15 @@ class MemoryPersister {
   std::pair<uint64_t, uint64_t> IndexRangeByTimestampRange(std::chrono::microseconds from,
                                                            std::chrono::microseconds till) const {
     std::pair<uint64_t, uint64_t> result{static_cast<uint64_t>(-1), static_cast<uint64_t>(-1)};
-    std::lock_guard<std::mutex> lock(container_->mutex_ref);
-    const auto begin_it =
-        std::lower_bound(container_->entries.begin(),
-                         container_->entries.end(),
-                         from,
-                         [](const typename Container::entry_t& e, std::chrono::microseconds t) { return e.first < t; });
-    if (begin_it != container_->entries.end()) {
-      result.first = std::distance(container_->entries.begin(), begin_it);
+    const uint64_t size = container_->entries.Size();
+    const uint64_t begin = PartitionPoint(size, [from](std::chrono::microseconds us) { return us < from; });
+    if (begin != size) {
+      result.first = begin;
     }
     if (till.count() > 0) {
-      const auto end_it = std::upper_bound(
-          container_->entries.begin(),
-          container_->entries.end(),
-          till,
-          [](std::chrono::microseconds t, const typename Container::entry_t& e) { return t < e.first; });
-      if (end_it != container_->entries.end()) {
-        result.second = std::distance(container_->entries.begin(), end_it);
+      const uint64_t end = PartitionPoint(size, [till](std::chrono::microseconds us) { return !(till < us); });
+      if (end != size) {
+        result.second = end;
       }
     }
     return result;
@@ -252,10 +255,7 @@ class MemoryPersister {
 
   template <ss::IterationMode IM>
   IterableRange<IM> Iterate(uint64_t begin, uint64_t end) const {
-    const uint64_t size = [this]() {
-      std::lock_guard<std::mutex> lock(container_->mutex_ref);
-      return static_cast<uint64_t>(container_->entries.size());
-    }();
+    const uint64_t size = container_->entries.Size();
 
     if (end == static_cast<uint64_t>(-1)) {
       end = size;
@@ -291,6 +291,22 @@ class MemoryPersister {
   }
 
  private:
+  // The index of the first of the first `size` entries for which `is_before(timestamp)` is `false`.
+  template <typename F>
+  uint64_t PartitionPoint(uint64_t size, F&& is_before) const {
+    uint64_t begin = 0u;
+    uint64_t end = size;
+    while (begin < end) {
+      const uint64_t middle = begin + (end - begin) / 2u;
+      if (is_before(container_->entries[middle].first)) {
+        begin = middle + 1u;
+      } else {
+        end = middle;
+      }
+    }
+    return begin;
+  }
+
   mutable ScopeOwnedByMe<Container> container_;
 };
 
@@ -0,0 +1,133 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+          (c) 2016 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The append-only array of the entries of the in-memory persister, readable without locking.
+//
+// The entries are stored in blocks which never move: the first block holds `kFirstBlockSize` entries, and each next
+// block is twice as large as the previous one, so that a fixed-size table of blocks is enough for any number of
+// entries. There is a single writer at a time, which is guaranteed by the caller. The writer constructs the entry in
+// place first, and only then publishes the new size, so that any entry below the size, as observed via `Size()`, is
+// safe to read from any thread, with no lock taken. The entries are never modified once appended.
+
+#ifndef BLOCKS_PERSISTENCE_MEMORY_ARRAY_H
+#define BLOCKS_PERSISTENCE_MEMORY_ARRAY_H
+
+#include "../../port.h"
+
+#include <atomic>
+#include <type_traits>
+
+namespace current {
+namespace persistence {
+namespace impl {
+
+template <typename T>
+class AppendOnlyChunkedArray final {
+ public:
+  AppendOnlyChunkedArray() : size_(0u) {
+    for (auto& block : blocks_) {
+      block.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  AppendOnlyChunkedArray(const AppendOnlyChunkedArray&) = delete;
+  AppendOnlyChunkedArray& operator=(const AppendOnlyChunkedArray&) = delete;
+
+  ~AppendOnlyChunkedArray() {
+    const uint64_t size = size_.load(std::memory_order_acquire);
+    for (uint64_t i = 0u; i < size; ++i) {
+      (*this)[i].~T();
+    }
+    for (auto& block : blocks_) {
+      delete[] block.load(std::memory_order_relaxed);
+    }
+  }
+
+  uint64_t Size() const { return size_.load(std::memory_order_acquire); }
+  bool Empty() const { return !Size(); }
+
+  // `i` must be less than the `Size()` observed by the caller.
+  const T& operator[](uint64_t i) const {
+    const Position position(i);
+    return *reinterpret_cast<const T*>(&blocks_[position.block].load(std::memory_order_acquire)[position.offset]);
+  }
+
+  const T& Back() const { return (*this)[Size() - 1u]; }
+
+  // Must only be called by one thread at a time.
+  template <typename... ARGS>
+  void EmplaceBack(ARGS&&... args) {
+    const uint64_t size = size_.load(std::memory_order_relaxed);
+    const Position position(size);
+    storage_t* block = blocks_[position.block].load(std::memory_order_relaxed);
+    if (!block) {
+      block = new storage_t[kFirstBlockSize << position.block];
+      blocks_[position.block].store(block, std::memory_order_release);
+    }
+    new (&block[position.offset]) T(std::forward<ARGS>(args)...);
+    size_.store(size + 1u, std::memory_order_release);
+  }
+
+ private:
+  using storage_t = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+  constexpr static size_t kFirstBlockSizeBits = 10u;
+  constexpr static uint64_t kFirstBlockSize = 1ull << kFirstBlockSizeBits;
+  constexpr static size_t kMaxBlocks = 64u - kFirstBlockSizeBits;
+
+  // Entry `i` is at `offset` in `block`, where `i + kFirstBlockSize == 2^(block + kFirstBlockSizeBits) + offset`.
+  struct Position {
+    size_t block;
+    uint64_t offset;
+
+    explicit Position(uint64_t i) {
+      const uint64_t x = i + kFirstBlockSize;
+      const size_t bit = HighestBit(x);
+      block = bit - kFirstBlockSizeBits;
+      offset = x - (1ull << bit);
+    }
+  };
+
+  static size_t HighestBit(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63u - static_cast<size_t>(__builtin_clzll(x));
+#else
+    size_t result = 0u;
+    while (x >>= 1) {
+      ++result;
+    }
+    return result;
+#endif
+  }
+
+  std::atomic<storage_t*> blocks_[kMaxBlocks];
+  std::atomic<uint64_t> size_;
+};
+
+}  // namespace current::persistence::impl
+}  // namespace current::persistence
+}  // namespace current
+
+#endif  // BLOCKS_PERSISTENCE_MEMORY_ARRAY_H
@@ -28,6 +28,7 @@ SOFTWARE.
 
 #include "memory.h"
 #include "file.h"
+#include "segmented_file.h"
 
 // Enable legacy names for now. Confirmed Current compiles with the next four lines commented out. -- D.K.
 
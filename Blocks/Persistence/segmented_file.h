@@ -0,0 +1,733 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+          (c) 2016 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// A file-based persister which keeps the stream in a sequence of files, the segments, instead of a single one.
+//
+// Each segment is a regular stream file, with its own signature and sidecar index, holding a contiguous range of
+// the entries, which keep their stream-wide indexes. The stream rolls over to a new segment once the current one
+// reaches `max_segment_bytes`, or once a new entry is `max_segment_duration` or more past the first entry of it.
+// The manifest, `<filename>.manifest`, lists the segments, along with their index and timestamp ranges.
+//
+// Once there are more than `max_live_segments` sealed segments, or once they are older than `max_live_age` compared
+// to the most recent entry, the oldest ones are either deleted or moved into `archive_directory`. The archived
+// segments remain part of the stream and are iterated over as usual. The deleted ones are gone for good, and
+// iterating over the stream starts from its first entry still available.
+//
+// The manifest is always updated before the files of the deleted or archived segments are removed, so that it never
+// refers to a missing file. The archived segments are linked, or copied, into `archive_directory` by a background
+// thread, so that publishing never waits for it.
+//
+// The sealed segments are only opened while being iterated over, so that the number of open files, and the page cache
+// pressure, do not grow with the length of the stream. The files of a segment which is deleted or archived while being
+// iterated over are only removed once the iteration is done.
+//
+// Iterators never outlive the persister.
+
+#ifndef BLOCKS_PERSISTENCE_SEGMENTED_FILE_H
+#define BLOCKS_PERSISTENCE_SEGMENTED_FILE_H
+
+#include "../../port.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+
+#include "file.h"
+
+#include "../../Bricks/file/file.h"
+#include "../../Bricks/strings/printf.h"
+
+namespace current {
+namespace persistence {
+
+// What happens to the sealed segments beyond the retention limits.
+enum class FilePersisterRetention : int {
+  Delete = 0,  // The segments are deleted, along with their entries.
+  Archive = 1  // The segments are moved into `archive_directory`, and remain part of the stream.
+};
+
+// The parameters of the segmented file persister. Zero stands for "no limit" in each of them.
+struct FilePersisterSegmentation {
+  uint64_t max_segment_bytes;
+  std::chrono::microseconds max_segment_duration;
+  size_t max_live_segments;  // The number of sealed segments to keep in place, not counting the archived ones.
+  std::chrono::microseconds max_live_age;
+  FilePersisterRetention retention;
+  std::string archive_directory;
+
+  explicit FilePersisterSegmentation(uint64_t max_segment_bytes = 1ull << 30,
+                                     std::chrono::microseconds max_segment_duration = std::chrono::microseconds(0),
+                                     size_t max_live_segments = 0u,
+                                     std::chrono::microseconds max_live_age = std::chrono::microseconds(0),
+                                     FilePersisterRetention retention = FilePersisterRetention::Delete,
+                                     const std::string& archive_directory = "")
+      : max_segment_bytes(max_segment_bytes),
+        max_segment_duration(max_segment_duration),
+        max_live_segments(max_live_segments),
+        max_live_age(max_live_age),
+        retention(retention),
+        archive_directory(archive_directory) {}
+};
+
+CURRENT_STRUCT(FilePersisterSegmentInfo) {
+  CURRENT_FIELD(file, std::string);
+  CURRENT_FIELD(begin_index, uint64_t, 0u);
+  CURRENT_FIELD(begin_last_entry_us, std::chrono::microseconds, std::chrono::microseconds(-1));
+  CURRENT_FIELD(begin_head, std::chrono::microseconds, std::chrono::microseconds(-1));
+  // The fields below are only set for the sealed segments.
+  CURRENT_FIELD(sealed, bool, false);
+  CURRENT_FIELD(end_index, uint64_t, 0u);
+  CURRENT_FIELD(last_entry_us, std::chrono::microseconds, std::chrono::microseconds(-1));
+  CURRENT_FIELD(end_head, std::chrono::microseconds, std::chrono::microseconds(-1));
+  CURRENT_FIELD(archived, bool, false);
+};
+
+CURRENT_STRUCT(FilePersisterManifest) { CURRENT_FIELD(segments, std::vector<FilePersisterSegmentInfo>); };
+
+namespace impl {
+
+namespace constants {
+constexpr char kManifestFileSuffix[] = ".manifest";
+constexpr char kSegmentFileSuffixFormatString[] = ".%020llu";
+}  // namespace current::persistence::impl::constants
+
+template <typename ENTRY, class ENTRY_FORMAT = JSONFileEntryFormat>
+class SegmentedFilePersister {
+ private:
+  using segment_persister_t = FilePersister<ENTRY, ENTRY_FORMAT>;
+
+  // { last_published_index + 1, last_published_us, current_head_us }, or { 0, -1us, -1us } for an empty persister.
+  struct end_t {
+    uint64_t next_index;
+    std::chrono::microseconds last_entry_us;
+    std::chrono::microseconds head;
+  };
+
+  struct Segment final {
+    FilePersisterSegmentInfo info;  // Guarded by `mutex_ref`, except for `file` and `begin_index`, which never change.
+    std::shared_ptr<segment_persister_t> persister;            // The active segment is always open.
+    std::weak_ptr<segment_persister_t> sealed_persister;       // The sealed ones are open while being iterated over.
+    std::atomic_bool remove_files_when_released{false};
+
+    explicit Segment(const FilePersisterSegmentInfo& info) : info(info) {}
+    ~Segment() {
+      persister = nullptr;
+      if (remove_files_when_released) {
+        current::FileSystem::RmFile(info.file, current::FileSystem::RmFileParameters::Silent);
+        current::FileSystem::RmFile(info.file + constants::kIndexFileSuffix,
+                                    current::FileSystem::RmFileParameters::Silent);
+      }
+    }
+
+    FilePersisterStart Start() const {
+      return FilePersisterStart(info.begin_index, info.begin_last_entry_us, info.begin_head);
+    }
+  };
+
+  struct SegmentedFilePersisterImpl final {
+    std::mutex& mutex_ref;  // Guards `segments` and `active_first_entry_us`.
+    const ss::StreamNamespaceName namespace_name;
+    const std::string filename;
+    const FilePersisterSegmentation segmentation;
+    std::vector<std::shared_ptr<Segment>> segments;  // The last one is the active one.
+    std::chrono::microseconds active_first_entry_us = std::chrono::microseconds(-1);
+    current::atomic_that_works<end_t> end;
+
+    // The archiving thread, used with `FilePersisterRetention::Archive` only. Its flags are guarded by `mutex_ref`.
+    std::condition_variable archive_cv;
+    bool archive_requested = true;  // Archive the segments left beyond the limits by the previous run, if any.
+    bool destructing = false;
+    std::thread archive_thread;
+
+    SegmentedFilePersisterImpl() = delete;
+    SegmentedFilePersisterImpl(const SegmentedFilePersisterImpl&) = delete;
+    SegmentedFilePersisterImpl(SegmentedFilePersisterImpl&&) = delete;
+    SegmentedFilePersisterImpl& operator=(const SegmentedFilePersisterImpl&) = delete;
+    SegmentedFilePersisterImpl& operator=(SegmentedFilePersisterImpl&&) = delete;
+
+    SegmentedFilePersisterImpl(std::mutex& mutex_ref,
+                               const ss::StreamNamespaceName& namespace_name,
+                               const std::string& filename,
+                               const FilePersisterSegmentation& segmentation)
+        : mutex_ref(mutex_ref), namespace_name(namespace_name), filename(filename), segmentation(segmentation) {
+      const std::string manifest_filename = filename + constants::kManifestFileSuffix;
+      bool manifest_found = false;
+      try {
+        const std::string manifest_contents = current::FileSystem::ReadFileAsString(manifest_filename);
+        manifest_found = true;
+        for (const auto& info : ParseJSON<FilePersisterManifest>(manifest_contents).segments) {
+          segments.push_back(std::make_shared<Segment>(info));
+        }
+      } catch (const current::FileException&) {
+      }
+      if (!manifest_found || segments.empty()) {
+        segments.clear();
+        FilePersisterSegmentInfo info;
+        info.file = SegmentFileName(0u);
+        segments.push_back(std::make_shared<Segment>(info));
+        RemoveSegmentFiles(info.file);
+        SaveManifest();
+      }
+      Segment& active = *segments.back();
+      active.persister = std::make_shared<segment_persister_t>(
+          mutex_ref, namespace_name, active.info.file, active.Start(), FilePersisterSidecarIndex());
+      const auto head_idxts = active.persister->HeadAndLastPublishedIndexAndTimestamp();
+      end.store({active.persister->template Size<current::locks::MutexLockStatus::AlreadyLocked>(),
+                 Exists(head_idxts.idxts) ? Value(head_idxts.idxts).us : std::chrono::microseconds(-1),
+                 head_idxts.head});
+      if (end.load().next_index != active.info.begin_index) {
+        active_first_entry_us =
+            (*active.persister->template Iterate<ss::IterationMode::Safe>(active.info.begin_index,
+                                                                          active.info.begin_index + 1u).begin())
+                .idx_ts.us;
+      }
+      if (segmentation.retention == FilePersisterRetention::Archive) {
+        archive_thread = std::thread([this]() { ArchiveThread(); });
+      }
+    }
+
+    ~SegmentedFilePersisterImpl() {
+      if (archive_thread.joinable()) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_ref);
+          destructing = true;
+          archive_cv.notify_one();
+        }
+        archive_thread.join();
+      }
+    }
+
+    std::string SegmentFileName(uint64_t begin_index) const {
+      return filename + Printf(constants::kSegmentFileSuffixFormatString, static_cast<unsigned long long>(begin_index));
+    }
+
+    static void RemoveSegmentFiles(const std::string& file) {
+      current::FileSystem::RmFile(file, current::FileSystem::RmFileParameters::Silent);
+      current::FileSystem::RmFile(file + constants::kIndexFileSuffix, current::FileSystem::RmFileParameters::Silent);
+    }
+
+    // Rewrites the manifest atomically. Must be called with `mutex_ref` locked.
+    void SaveManifest() {
+      FilePersisterManifest manifest;
+      for (const auto& segment : segments) {
+        manifest.segments.push_back(segment->info);
+      }
+      const std::string manifest_filename = filename + constants::kManifestFileSuffix;
+      const std::string tmp_filename = manifest_filename + ".tmp";
+      try {
+        current::FileSystem::WriteStringToFile(JSON(manifest), tmp_filename.c_str());
+        current::FileSystem::RenameFile(tmp_filename, manifest_filename);
+      } catch (const current::FileException&) {
+        CURRENT_THROW(PersistenceFileNotWritable(manifest_filename));
+      }
+    }
+
+    // Returns the persister of the segment, opening it if necessary. Must be called with `mutex_ref` locked.
+    std::shared_ptr<segment_persister_t> OpenSegment(Segment& segment) {
+      if (segment.persister) {
+        return segment.persister;
+      }
+      std::shared_ptr<segment_persister_t> result = segment.sealed_persister.lock();
+      if (!result) {
+        result = std::make_shared<segment_persister_t>(
+            mutex_ref, namespace_name, segment.info.file, segment.Start(), FilePersisterSidecarIndex());
+        segment.sealed_persister = result;
+      }
+      return result;
+    }
+
+    bool ShouldRollOver(std::chrono::microseconds timestamp) {
+      if (end.load().next_index == segments.back()->info.begin_index) {
+        return false;  // Never roll over an empty segment.
+      }
+      return (segmentation.max_segment_bytes &&
+              segments.back()->persister->FileSizeFromLockedSection() >= segmentation.max_segment_bytes) ||
+             (segmentation.max_segment_duration.count() &&
+              timestamp - active_first_entry_us >= segmentation.max_segment_duration);
+    }
+
+    // Seals the active segment and starts a new one. Must be called with `mutex_ref` locked.
+    void RollOver() {
+      const end_t current_end = end.load();
+      Segment& sealed = *segments.back();
+      sealed.info.sealed = true;
+      sealed.info.end_index = current_end.next_index;
+      sealed.info.last_entry_us = current_end.last_entry_us;
+      sealed.info.end_head = current_end.head;
+      sealed.sealed_persister = sealed.persister;
+      sealed.persister = nullptr;
+
+      FilePersisterSegmentInfo info;
+      info.file = SegmentFileName(current_end.next_index);
+      info.begin_index = current_end.next_index;
+      info.begin_last_entry_us = current_end.last_entry_us;
+      info.begin_head = current_end.head;
+      // A file by this name, if any, is not part of the stream, as it is not in the manifest.
+      RemoveSegmentFiles(info.file);
+      auto active = std::make_shared<Segment>(info);
+      active->persister = std::make_shared<segment_persister_t>(
+          mutex_ref, namespace_name, info.file, active->Start(), FilePersisterSidecarIndex());
+      segments.push_back(active);
+      active_first_entry_us = std::chrono::microseconds(-1);
+
+      if (segmentation.retention == FilePersisterRetention::Archive) {
+        SaveManifest();
+        archive_requested = true;
+        archive_cv.notify_one();
+      } else {
+        // The deleted segments are always the oldest ones, so that the remaining ones are contiguous.
+        const size_t deleted_count = SegmentsBeyondRetention().size();
+        std::vector<std::shared_ptr<Segment>> deleted(segments.begin(), segments.begin() + deleted_count);
+        segments.erase(segments.begin(), segments.begin() + deleted_count);
+        SaveManifest();
+        for (const auto& segment : deleted) {
+          segment->remove_files_when_released = true;
+        }
+      }
+    }
+
+    // The positions of the oldest sealed segments beyond the retention limits, not counting the archived ones.
+    // Must be called with `mutex_ref` locked.
+    std::vector<size_t> SegmentsBeyondRetention() const {
+      std::vector<size_t> result;
+      size_t live_sealed_segments = 0u;
+      for (size_t i = 0u; i + 1u < segments.size(); ++i) {
+        if (!segments[i]->info.archived) {
+          ++live_sealed_segments;
+        }
+      }
+      const auto newest_us = end.load().last_entry_us;
+      for (size_t i = 0u; i + 1u < segments.size(); ++i) {
+        const Segment& segment = *segments[i];
+        if (segment.info.archived) {
+          continue;
+        }
+        const bool expired =
+            (segmentation.max_live_segments && live_sealed_segments > segmentation.max_live_segments) ||
+            (segmentation.max_live_age.count() && segment.info.last_entry_us < newest_us - segmentation.max_live_age);
+        if (!expired) {
+          break;
+        }
+        --live_sealed_segments;
+        result.push_back(i);
+      }
+      return result;
+    }
+
+    // Moves the segments beyond the retention limits into `archive_directory`. The files are linked or copied with
+    // `mutex_ref` unlocked, as the sealed segments never change, then the manifest is updated to refer to the archived
+    // files, and only then are the original files removed, once no longer iterated over. A segment which fails to be
+    // archived is left in place, to be retried on the next roll over.
+    void ArchiveThread() {
+      std::unique_lock<std::mutex> lock(mutex_ref);
+      while (true) {
+        archive_cv.wait(lock, [this]() { return archive_requested || destructing; });
+        if (!archive_requested) {
+          return;
+        }
+        archive_requested = false;
+        std::vector<std::shared_ptr<Segment>> originals;
+        for (const size_t i : SegmentsBeyondRetention()) {
+          originals.push_back(segments[i]);
+        }
+        if (originals.empty()) {
+          continue;
+        }
+        lock.unlock();
+        std::vector<std::shared_ptr<Segment>> archived;
+        for (const auto& original : originals) {
+          FilePersisterSegmentInfo info = original->info;
+          info.file = current::FileSystem::JoinPath(segmentation.archive_directory, BaseName(info.file));
+          info.archived = true;
+          try {
+            LinkOrCopyFile(original->info.file, info.file);
+            LinkOrCopyFile(original->info.file + constants::kIndexFileSuffix, info.file + constants::kIndexFileSuffix);
+          } catch (const current::Exception&) {
+            break;  // Keep the archived segments contiguous.
+          }
+          archived.push_back(std::make_shared<Segment>(info));
+        }
+        originals.resize(archived.size());
+        lock.lock();
+        // Only this thread replaces the sealed segments, and the roll overs only append new ones.
+        for (size_t i = 0u; i < archived.size(); ++i) {
+          *std::find(segments.begin(), segments.end(), originals[i]) = archived[i];
+        }
+        try {
+          SaveManifest();
+        } catch (const current::Exception&) {
+          for (size_t i = 0u; i < archived.size(); ++i) {
+            *std::find(segments.begin(), segments.end(), archived[i]) = originals[i];
+          }
+          continue;
+        }
+        for (const auto& original : originals) {
+          original->remove_files_when_released = true;
+        }
+        lock.unlock();
+        originals.clear();  // Removes the original files, unless they are still being iterated over.
+        lock.lock();
+      }
+    }
+
+    static std::string BaseName(const std::string& file) {
+      const size_t separator_pos = file.find_last_of(current::FileSystem::GetPathSeparator());
+      return separator_pos == std::string::npos ? file : file.substr(separator_pos + 1u);
+    }
+
+    // Hard-links the file if the destination is on the same file system, and copies it otherwise.
+    static void LinkOrCopyFile(const std::string& from, const std::string& to) {
+      current::FileSystem::RmFile(to, current::FileSystem::RmFileParameters::Silent);
+#ifndef CURRENT_WINDOWS
+      if (!::link(from.c_str(), to.c_str())) {
+        return;
+      }
+#endif
+      std::ifstream fi(from, std::ifstream::binary);
+      if (!fi.good()) {
+        return;  // The sidecar index may be missing, in which case it will be rebuilt.
+      }
+      std::ofstream fo(to, std::ofstream::binary);
+      fo << fi.rdbuf();
+      if (!fo.good()) {
+        CURRENT_THROW(PersistenceFileNotWritable(to));
+      }
+    }
+  };
+
+ public:
+  SegmentedFilePersister() = delete;
+  SegmentedFilePersister(const SegmentedFilePersister&) = delete;
+  SegmentedFilePersister(SegmentedFilePersister&&) = delete;
+  SegmentedFilePersister& operator=(const SegmentedFilePersister&) = delete;
+  SegmentedFilePersister& operator=(SegmentedFilePersister&&) = delete;
+
+  explicit SegmentedFilePersister(std::mutex& mutex_ref,
+                                  const ss::StreamNamespaceName& namespace_name,
+                                  const std::string& filename,
+                                  const FilePersisterSegmentation& segmentation = FilePersisterSegmentation())
+      : impl_(mutex_ref, namespace_name, filename, segmentation) {}
+
+  // Iterates over the segments one by one, using the iterators of the persisters of the segments.
+  template <ss::IterationMode IM>
+  class IteratorImpl final {
+   private:
+    using segment_range_t = typename segment_persister_t::template IterableRange<IM>;
+    using segment_iterator_t = decltype(std::declval<const segment_range_t&>().begin());
+
+   public:
+    using value_t = decltype(*std::declval<const segment_iterator_t&>());
+
+    IteratorImpl() = delete;
+    IteratorImpl(const IteratorImpl&) = delete;
+    IteratorImpl(IteratorImpl&&) = default;
+    IteratorImpl& operator=(const IteratorImpl&) = delete;
+    IteratorImpl& operator=(IteratorImpl&&) = delete;
+
+    IteratorImpl(ScopeOwned<SegmentedFilePersisterImpl>& impl,
+                 const std::vector<std::shared_ptr<Segment>>& segments,
+                 uint64_t i,
+                 uint64_t end)
+        : impl_(impl, [this]() { valid_ = false; }), segments_(segments), i_(i), end_(end) {}
+
+    // `operator*` relies on the fact each entry will be requested at most once.
+    value_t operator*() const {
+      if (!valid_) {
+        CURRENT_THROW(PersistenceFileNoLongerAvailable(impl_.ObjectAccessorDespitePossiblyDestructing().filename));
+      }
+      if (!segment_iterator_ || i_ >= segment_end_) {
+        OpenSegmentContaining(i_);
+      }
+      return **segment_iterator_;
+    }
+
+    IteratorImpl& operator++() {
+      if (!valid_) {
+        CURRENT_THROW(PersistenceFileNoLongerAvailable(impl_.ObjectAccessorDespitePossiblyDestructing().filename));
+      }
+      ++i_;
+      if (segment_iterator_) {
+        ++(*segment_iterator_);
+      }
+      return *this;
+    }
+    bool operator==(const IteratorImpl& rhs) const { return i_ == rhs.i_; }
+    bool operator!=(const IteratorImpl& rhs) const { return !operator==(rhs); }
+    operator bool() const { return valid_; }
+
+   private:
+    void OpenSegmentContaining(uint64_t i) const {
+      size_t k = 0u;
+      while (k + 1u < segments_.size() && segments_[k + 1u]->info.begin_index <= i) {
+        ++k;
+      }
+      // Release the segment being iterated over, if any, in the reverse order of acquiring it.
+      segment_iterator_ = nullptr;
+      segment_range_ = nullptr;
+      persister_ = nullptr;
+      segment_ = segments_[k];
+      {
+        std::lock_guard<std::mutex> lock(impl_->mutex_ref);
+        persister_ = impl_->OpenSegment(*segment_);
+      }
+      segment_end_ = (k + 1u < segments_.size()) ? std::min(end_, segments_[k + 1u]->info.begin_index) : end_;
+      segment_range_ = std::make_unique<segment_range_t>(persister_->template Iterate<IM>(i, segment_end_));
+      segment_iterator_ = std::make_unique<segment_iterator_t>(segment_range_->begin());
+    }
+
+    mutable ScopeOwnedBySomeoneElse<SegmentedFilePersisterImpl> impl_;
+    bool valid_ = true;
+    std::vector<std::shared_ptr<Segment>> segments_;
+    uint64_t i_;
+    uint64_t end_;
+    // Declared in the order of acquiring, for the destruction to happen in the reverse one.
+    mutable std::shared_ptr<Segment> segment_;
+    mutable std::shared_ptr<segment_persister_t> persister_;
+    mutable std::unique_ptr<segment_range_t> segment_range_;
+    mutable std::unique_ptr<segment_iterator_t> segment_iterator_;
+    mutable uint64_t segment_end_ = 0u;
+  };
+
+  template <ss::IterationMode IM>
+  class IterableRangeImpl {
+   public:
+    explicit IterableRangeImpl(ScopeOwned<SegmentedFilePersisterImpl>& impl,
+                               std::vector<std::shared_ptr<Segment>>&& segments,
+                               uint64_t begin,
+                               uint64_t end)
+        : impl_(impl, [this]() { valid_ = false; }), segments_(std::move(segments)), begin_(begin), end_(end) {}
+
+    IteratorImpl<IM> begin() const {
+      if (!valid_) {
+        CURRENT_THROW(PersistenceFileNoLongerAvailable(impl_.ObjectAccessorDespitePossiblyDestructing().filename));
+      }
+      return IteratorImpl<IM>(impl_, segments_, begin_, end_);
+    }
+    IteratorImpl<IM> end() const {
+      if (!valid_) {
+        CURRENT_THROW(PersistenceFileNoLongerAvailable(impl_.ObjectAccessorDespitePossiblyDestructing().filename));
+      }
+      return IteratorImpl<IM>(impl_, std::vector<std::shared_ptr<Segment>>(), end_, end_);
+    }
+
+    operator bool() const { return valid_; }
+
+   private:
+    mutable ScopeOwnedBySomeoneElse<SegmentedFilePersisterImpl> impl_;
+    bool valid_ = true;
+    const std::vector<std::shared_ptr<Segment>> segments_;
+    const uint64_t begin_;
+    const uint64_t end_;
+  };
+
+  template <current::locks::MutexLockStatus MLS, typename E, typename US>
+  idxts_t DoPublish(E&& entry, const US us) {
+    current::locks::SmartMutexLockGuard<MLS> lock(impl_->mutex_ref);
+    const auto timestamp = current::time::GetTimestampFromLockedSection(us);
+    if (impl_->ShouldRollOver(timestamp)) {
+      impl_->RollOver();
+    }
+    segment_persister_t& active = *impl_->segments.back()->persister;
+    const auto result =
+        active.template DoPublish<current::locks::MutexLockStatus::AlreadyLocked>(std::forward<E>(entry), timestamp);
+    if (impl_->active_first_entry_us.count() < 0) {
+      impl_->active_first_entry_us = result.us;
+    }
+    impl_->end.store({result.index + 1u, result.us, result.us});
+    return result;
+  }
+
+  // The segment to roll over is checked once per batch, so a batch is never split across segments.
+  template <current::locks::MutexLockStatus MLS>
+  void DoPublishBatch(std::vector<ss::IndexedEntry<ENTRY>>& entries) {
+    current::locks::SmartMutexLockGuard<MLS> lock(impl_->mutex_ref);
+    if (entries.empty()) {
+      return;
+    }
+    ss::ValidateBatchTimestamps(entries, impl_->end.load().head);
+    if (impl_->ShouldRollOver(entries.front().idx_ts.us)) {
+      impl_->RollOver();
+    }
+    const std::chrono::microseconds first_entry_us = entries.front().idx_ts.us;
+    segment_persister_t& active = *impl_->segments.back()->persister;
+    active.template DoPublishBatch<current::locks::MutexLockStatus::AlreadyLocked>(entries);
+    if (impl_->active_first_entry_us.count() < 0) {
+      impl_->active_first_entry_us = first_entry_us;
+    }
+    const idxts_t last = active.LastPublishedIndexAndTimestamp();
+    impl_->end.store({last.index + 1u, last.us, last.us});
+  }
+
+  template <current::locks::MutexLockStatus MLS, typename US>
+  void DoUpdateHead(const US us) {
+    current::locks::SmartMutexLockGuard<MLS> lock(impl_->mutex_ref);
+    const auto& active = impl_->segments.back()->persister;
+    active->template DoUpdateHead<current::locks::MutexLockStatus::AlreadyLocked>(us);
+    end_t iterator = impl_->end.load();
+    iterator.head = active->template CurrentHead<current::locks::MutexLockStatus::AlreadyLocked>();
+    impl_->end.store(iterator);
+  }
+
+  template <current::locks::MutexLockStatus>
+  bool Empty() const noexcept {
+    return !impl_->end.load().next_index;
+  }
+  template <current::locks::MutexLockStatus>
+  uint64_t Size() const noexcept {
+    return impl_->end.load().next_index;
+  }
+
+  idxts_t LastPublishedIndexAndTimestamp() const {
+    const auto iterator = impl_->end.load();
+    if (iterator.next_index) {
+      return idxts_t(iterator.next_index - 1, iterator.last_entry_us);
+    } else {
+      CURRENT_THROW(NoEntriesPublishedYet());
+    }
+  }
+
+  head_optidxts_t HeadAndLastPublishedIndexAndTimestamp() const noexcept {
+    const auto iterator = impl_->end.load();
+    if (iterator.next_index) {
+      return head_optidxts_t(iterator.head, iterator.next_index - 1, iterator.last_entry_us);
+    } else {
+      return head_optidxts_t(iterator.head);
+    }
+  }
+
+  template <current::locks::MutexLockStatus>
+  std::chrono::microseconds CurrentHead() const noexcept {
+    return impl_->end.load().head;
+  }
+
+  // The index of the first entry still available, i.e. not deleted by the retention policy.
+  uint64_t FirstAvailableIndex() const {
+    std::lock_guard<std::mutex> lock(impl_->mutex_ref);
+    return impl_->segments.front()->info.begin_index;
+  }
+
+  // Only the segments which may contain the entries in the range are opened.
+  std::pair<uint64_t, uint64_t> IndexRangeByTimestampRange(std::chrono::microseconds from,
+                                                           std::chrono::microseconds till) const {
+    std::pair<uint64_t, uint64_t> result{static_cast<uint64_t>(-1), static_cast<uint64_t>(-1)};
+    std::vector<std::pair<std::shared_ptr<Segment>, FilePersisterSegmentInfo>> segments;
+    {
+      std::lock_guard<std::mutex> lock(impl_->mutex_ref);
+      for (const auto& segment : impl_->segments) {
+        segments.emplace_back(segment, segment->info);
+      }
+    }
+    const auto SegmentIndexRange = [this](
+        Segment& segment, std::chrono::microseconds from, std::chrono::microseconds till) {
+      std::shared_ptr<segment_persister_t> persister;
+      {
+        std::lock_guard<std::mutex> lock(impl_->mutex_ref);
+        persister = impl_->OpenSegment(segment);
+      }
+      return persister->IndexRangeByTimestampRange(from, till);
+    };
+    for (const auto& segment : segments) {
+      if (!segment.second.sealed || segment.second.last_entry_us >= from) {
+        result.first = SegmentIndexRange(*segment.first, from, std::chrono::microseconds(0)).first;
+        if (result.first != static_cast<uint64_t>(-1)) {
+          break;
+        }
+      }
+    }
+    if (till.count() > 0) {
+      for (const auto& segment : segments) {
+        if (!segment.second.sealed || segment.second.last_entry_us > till) {
+          result.second = SegmentIndexRange(*segment.first, from, till).second;
+          break;
+        }
+      }
+    }
+    return result;
+  }
+
+  template <ss::IterationMode IM>
+  using IterableRange = IterableRangeImpl<IM>;
+
+  // The entries deleted by the retention policy are skipped, so the range may begin later than requested.
+  template <ss::IterationMode IM>
+  IterableRange<IM> Iterate(uint64_t begin_index, uint64_t end_index) const {
+    const uint64_t current_size = impl_->end.load().next_index;
+    if (end_index == static_cast<uint64_t>(-1)) {
+      end_index = current_size;
+    }
+    if (end_index > current_size) {
+      CURRENT_THROW(InvalidIterableRangeException());
+    }
+    if (begin_index == end_index) {
+      return IterableRange<IM>(impl_, std::vector<std::shared_ptr<Segment>>(), 0, 0);
+    }
+    if (end_index < begin_index) {
+      CURRENT_THROW(InvalidIterableRangeException());
+    }
+    std::vector<std::shared_ptr<Segment>> segments;
+    {
+      std::lock_guard<std::mutex> lock(impl_->mutex_ref);
+      begin_index = std::max(begin_index, impl_->segments.front()->info.begin_index);
+      for (size_t k = 0u; k < impl_->segments.size(); ++k) {
+        const bool ends_before_range =
+            k + 1u < impl_->segments.size() && impl_->segments[k + 1u]->info.begin_index <= begin_index;
+        if (!ends_before_range && impl_->segments[k]->info.begin_index < end_index) {
+          segments.push_back(impl_->segments[k]);
+        }
+      }
+    }
+    if (begin_index >= end_index) {
+      return IterableRange<IM>(impl_, std::vector<std::shared_ptr<Segment>>(), 0, 0);
+    }
+    return IterableRange<IM>(impl_, std::move(segments), begin_index, end_index);
+  }
+
+  template <ss::IterationMode IM>
+  IterableRange<IM> Iterate(std::chrono::microseconds from, std::chrono::microseconds till) const {
+    if (till.count() > 0 && till < from) {
+      CURRENT_THROW(InvalidIterableRangeException());
+    }
+    const auto index_range = IndexRangeByTimestampRange(from, till);
+    if (index_range.first != static_cast<uint64_t>(-1)) {
+      return Iterate<IM>(index_range.first, index_range.second);
+    } else {  // No entries found in the given range.
+      return IterableRange<IM>(impl_, std::vector<std::shared_ptr<Segment>>(), 0, 0);
+    }
+  }
+
+ private:
+  mutable ScopeOwnedByMe<SegmentedFilePersisterImpl> impl_;
+};
+
+}  // namespace current::persistence::impl
+
+template <typename ENTRY>
+using SegmentedFile = ss::EntryPersister<impl::SegmentedFilePersister<ENTRY>, ENTRY>;
+
+}  // namespace current::persistence
+}  // namespace current
+
+#endif  // BLOCKS_PERSISTENCE_SEGMENTED_FILE_H
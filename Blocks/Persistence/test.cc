@@ -25,6 +25,7 @@ SOFTWARE.
 
 #include "../../port.h"
 
+#include <cstring>
 #include <string>
 
 #define CURRENT_MOCK_TIME  // `SetNow()`.
@@ -37,6 +38,7 @@ SOFTWARE.
 #include "../../Bricks/file/file.h"
 #include "../../Bricks/strings/join.h"
 #include "../../Bricks/strings/printf.h"
+#include "../../Bricks/strings/split.h"
 
 #include "../../3rdparty/gtest/gtest-main-with-dflags.h"
 
@@ -225,6 +227,56 @@ TEST(PersistenceLayer, MemoryExceptions) {
   }
 }
 
+TEST(PersistenceLayer, MemoryConcurrentReadersAndPublisher) {
+  using IMPL = current::persistence::Memory<uint64_t>;
+
+  std::mutex mutex;
+  IMPL impl(mutex, current::ss::StreamNamespaceName("namespace", "entry_name"));
+
+  // Enough entries to span several blocks of the underlying append-only array.
+  const uint64_t n = 20000u;
+  std::atomic_bool done(false);
+  std::vector<std::thread> readers;
+  for (size_t t = 0; t < 4u; ++t) {
+    readers.emplace_back([&impl, &done]() {
+      while (!done) {
+        const uint64_t size = impl.Size();
+        if (size) {
+          const auto last = impl.LastPublishedIndexAndTimestamp();
+          EXPECT_LE(size - 1u, last.index);
+          uint64_t i = size > 100u ? size - 100u : 0u;
+          for (const auto& e : impl.Iterate(i, size)) {
+            EXPECT_EQ(i, e.idx_ts.index);
+            EXPECT_EQ(i, e.entry);
+            EXPECT_EQ(static_cast<int64_t>(i + 1u), e.idx_ts.us.count());
+            ++i;
+          }
+          const auto range = impl.IndexRangeByTimestampRange(std::chrono::microseconds(size / 2u + 1u),
+                                                             std::chrono::microseconds(size / 2u + 1u));
+          EXPECT_EQ(size / 2u, range.first);
+        }
+      }
+    });
+  }
+  for (uint64_t i = 0u; i < n; ++i) {
+    impl.Publish(i, std::chrono::microseconds(i + 1u));
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(n, impl.Size());
+  uint64_t i = 0u;
+  for (const auto& e : impl.Iterate()) {
+    EXPECT_EQ(i, e.entry);
+    ++i;
+  }
+  EXPECT_EQ(n, i);
+  EXPECT_EQ(12345u,
+            impl.IndexRangeByTimestampRange(std::chrono::microseconds(12346), std::chrono::microseconds(0)).first);
+}
+
 TEST(PersistenceLayer, MemoryIteratorCanNotOutliveMemoryBlock) {
   using namespace persistence_test;
   using IMPL = current::persistence::Memory<std::string>;
@@ -684,6 +736,734 @@ TEST(PersistenceLayer, FileSignatureExceptions) {
   }
 }
 
+TEST(PersistenceLayer, BinaryFile) {
+  current::time::ResetToZero();
+
+  using namespace persistence_test;
+
+  using IMPL = current::persistence::BinaryFile<StorableString>;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+  const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+
+  // The bytes to escape in binary entries, with the length of the string, serialized as a varint, being '\n' too.
+  const std::string tricky(std::string("n\nl\\z\0b", 7) + "...");
+  ASSERT_EQ(10u, tricky.length());
+
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name);
+    current::time::SetNow(std::chrono::microseconds(100));
+    impl.Publish(StorableString("foo"));
+    current::time::SetNow(std::chrono::microseconds(200));
+    impl.Publish(StorableString(tricky));
+    current::time::SetNow(std::chrono::microseconds(300));
+    impl.UpdateHead();
+    EXPECT_EQ(2u, impl.Size());
+  }
+
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name);
+    EXPECT_EQ(2u, impl.Size());
+    EXPECT_EQ(300, impl.CurrentHead().count());
+
+    std::vector<std::string> entries;
+    for (const auto& e : impl.Iterate()) {
+      entries.push_back(e.entry.s);
+    }
+    ASSERT_EQ(2u, entries.size());
+    EXPECT_EQ("foo", entries[0]);
+    EXPECT_EQ(tricky, entries[1]);
+
+    // Unsafe iteration returns JSON regardless of the format of the file.
+    std::vector<std::string> entries_unsafe;
+    for (const auto& e : impl.Iterate<current::ss::IterationMode::Unsafe>()) {
+      entries_unsafe.push_back(e);
+    }
+    EXPECT_EQ("{\"index\":0,\"us\":100}\t{\"s\":\"foo\"},{\"index\":1,\"us\":200}\t" + JSON(StorableString(tricky)),
+              Join(entries_unsafe, ","));
+
+    current::time::SetNow(std::chrono::microseconds(400));
+    impl.Publish(StorableString("bar"));
+  }
+
+  const std::vector<std::string> lines =
+      current::strings::Split(current::FileSystem::ReadFileAsString(persistence_file_name), '\n');
+  ASSERT_EQ(6u, lines.size());
+  EXPECT_EQ("#signature ", lines[0].substr(0, 11));
+  EXPECT_EQ("#format binary", lines[1]);
+  EXPECT_EQ("{\"index\":0,\"us\":100}\t\x03" "foo", lines[2]);
+  EXPECT_EQ("#head 00000000000000000300", lines[4]);
+
+  // The JSON and the binary persisters refuse to open each other's files.
+  {
+    std::mutex mutex;
+    ASSERT_THROW(current::persistence::File<StorableString>(mutex, namespace_name, persistence_file_name),
+                 current::persistence::InvalidFileEntryFormat);
+  }
+  {
+    const std::string json_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data.json");
+    const auto json_file_remover = current::FileSystem::ScopedRmFile(json_file_name);
+    std::mutex mutex;
+    {
+      current::persistence::File<StorableString> impl(mutex, namespace_name, json_file_name);
+      impl.Publish(StorableString("foo"), std::chrono::microseconds(1000));
+    }
+    ASSERT_THROW(IMPL(mutex, namespace_name, json_file_name), current::persistence::InvalidFileEntryFormat);
+  }
+}
+
+TEST(PersistenceLayer, FileGroupCommit) {
+  current::time::ResetToZero();
+
+  using namespace persistence_test;
+
+  using IMPL = current::persistence::File<StorableString>;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+  const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+
+  const size_t threads_count = 8;
+  const size_t entries_per_thread = 250;
+
+  for (const auto durability : {current::persistence::FilePersisterDurability::Flush,
+                                current::persistence::FilePersisterDurability::FDataSync}) {
+    current::FileSystem::RmFile(persistence_file_name, current::FileSystem::RmFileParameters::Silent);
+    {
+      std::mutex mutex;
+      IMPL impl(mutex,
+                namespace_name,
+                persistence_file_name,
+                current::persistence::FilePersisterGroupCommit(10, std::chrono::microseconds(100), durability));
+      std::vector<std::thread> threads;
+      for (size_t t = 0; t < threads_count; ++t) {
+        threads.emplace_back([&impl, t, entries_per_thread]() {
+          for (size_t i = 0; i < entries_per_thread; ++i) {
+            const auto result = impl.Publish(StorableString(Printf("%d:%d", static_cast<int>(t), static_cast<int>(i))));
+            // By the time `Publish()` returns, the entry must be visible.
+            EXPECT_GT(impl.Size(), result.index);
+          }
+        });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      EXPECT_EQ(threads_count * entries_per_thread, impl.Size());
+
+      // The `#head` directive goes after all the entries.
+      const auto head = impl.CurrentHead();
+      impl.UpdateHead(head + std::chrono::microseconds(1));
+      EXPECT_EQ((head + std::chrono::microseconds(1)).count(), impl.CurrentHead().count());
+
+      impl.Publish(StorableString("last"), head + std::chrono::microseconds(2));
+      EXPECT_EQ(threads_count * entries_per_thread + 1, impl.Size());
+    }
+    {
+      // Re-open the file in the regular mode and confirm all entries are there, and in the right order.
+      std::mutex mutex;
+      IMPL impl(mutex, namespace_name, persistence_file_name);
+      EXPECT_EQ(threads_count * entries_per_thread + 1, impl.Size());
+      std::vector<size_t> next_per_thread(threads_count);
+      uint64_t expected_index = 0;
+      for (const auto& e : impl.Iterate(0, threads_count * entries_per_thread)) {
+        EXPECT_EQ(expected_index++, e.idx_ts.index);
+        int t;
+        int i;
+        ASSERT_EQ(2, sscanf(e.entry.s.c_str(), "%d:%d", &t, &i));
+        EXPECT_EQ(next_per_thread[t]++, static_cast<size_t>(i));
+      }
+      EXPECT_EQ("last", (*impl.Iterate(threads_count * entries_per_thread).begin()).entry.s);
+      size_t unsafe_count = 0;
+      for (const auto& e : impl.Iterate<current::ss::IterationMode::Unsafe>()) {
+        EXPECT_EQ('{', e[0]);
+        ++unsafe_count;
+      }
+      EXPECT_EQ(threads_count * entries_per_thread + 1, unsafe_count);
+    }
+  }
+}
+
+TEST(PersistenceLayer, FileGroupCommitKeepsCallersLock) {
+  current::time::ResetToZero();
+
+  using namespace persistence_test;
+
+  using IMPL = current::persistence::File<StorableString>;
+  using us_t = std::chrono::microseconds;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+  const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+
+  std::mutex mutex;
+  IMPL impl(mutex,
+            namespace_name,
+            persistence_file_name,
+            current::persistence::FilePersisterGroupCommit(10, std::chrono::milliseconds(500)));
+
+  // The publisher holding the mutex keeps it locked throughout the group commit, and, as no other such publisher
+  // can join the batch meanwhile, writes it without waiting for `max_delay`. A publisher not holding the mutex joins
+  // the batch, and locks it to write it.
+  std::atomic_bool done(false);
+  std::atomic_bool mutex_was_released(false);
+  std::unique_lock<std::mutex> lock(mutex);
+  std::thread watcher([&mutex, &done, &mutex_was_released]() {
+    while (!done) {
+      if (mutex.try_lock()) {
+        mutex_was_released = true;
+        mutex.unlock();
+      }
+      std::this_thread::yield();
+    }
+  });
+
+  using MLS = current::locks::MutexLockStatus;
+  const auto begin = std::chrono::steady_clock::now();
+  impl.Publish<MLS::AlreadyLocked>(StorableString("foo"), us_t(10));
+  EXPECT_LE(1u, impl.Size<MLS::AlreadyLocked>());
+  std::vector<current::ss::IndexedEntry<StorableString>> batch;
+  batch.emplace_back(idxts_t(0u, us_t(200)), StorableString("bar"));
+  impl.PublishBatch<MLS::AlreadyLocked>(batch);
+  impl.UpdateHead<MLS::AlreadyLocked>(us_t(300));
+  EXPECT_EQ(300, impl.CurrentHead<MLS::AlreadyLocked>().count());
+  EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(250));
+  std::thread other_publisher([&impl]() { impl.Publish(StorableString("other"), us_t(400)); });
+
+  done = true;
+  watcher.join();
+  EXPECT_FALSE(mutex_was_released);
+  lock.unlock();
+  other_publisher.join();
+
+  EXPECT_EQ(3u, impl.Size());
+  std::vector<std::string> entries;
+  for (const auto& e : impl.Iterate()) {
+    entries.push_back(e.entry.s);
+  }
+  EXPECT_EQ("foo,bar,other", Join(entries, ","));
+}
+
+namespace persistence_test {
+
+// The batch is published at once, keeping the timestamps, and is not published at all if a timestamp is off.
+template <typename IMPL>
+void RunPublishBatchTest(IMPL& impl) {
+  using us_t = std::chrono::microseconds;
+
+  std::vector<current::ss::IndexedEntry<StorableString>> batch;
+  batch.emplace_back(idxts_t(0u, us_t(10)), StorableString("foo"));
+  batch.emplace_back(idxts_t(0u, us_t(20)), StorableString("bar"));
+  impl.PublishBatch(batch);
+  EXPECT_EQ(2u, impl.Size());
+  EXPECT_EQ(20, impl.CurrentHead().count());
+
+  batch.clear();
+  batch.emplace_back(idxts_t(0u, us_t(30)), StorableString("baz"));
+  batch.emplace_back(idxts_t(0u, us_t(30)), StorableString("meh"));
+  ASSERT_THROW(impl.PublishBatch(batch), current::ss::InconsistentTimestampException);
+  EXPECT_EQ(2u, impl.Size());
+
+  batch.clear();
+  impl.PublishBatch(batch);
+  impl.Publish(StorableString("baz"), us_t(30));
+
+  std::vector<std::string> entries;
+  for (const auto& e : impl.Iterate()) {
+    entries.push_back(Printf("%s:%d:%d",
+                             e.entry.s.c_str(),
+                             static_cast<int>(e.idx_ts.index),
+                             static_cast<int>(e.idx_ts.us.count())));
+  }
+  EXPECT_EQ("foo:0:10,bar:1:20,baz:2:30", Join(entries, ","));
+}
+
+}  // namespace persistence_test
+
+TEST(PersistenceLayer, PublishBatch) {
+  current::time::ResetToZero();
+
+  using namespace persistence_test;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+  const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+
+  {
+    std::mutex mutex;
+    current::persistence::Memory<StorableString> impl(mutex, namespace_name);
+    RunPublishBatchTest(impl);
+  }
+  {
+    std::mutex mutex;
+    current::persistence::File<StorableString> impl(mutex, namespace_name, persistence_file_name);
+    RunPublishBatchTest(impl);
+  }
+  {
+    current::FileSystem::RmFile(persistence_file_name);
+    std::mutex mutex;
+    current::persistence::File<StorableString> impl(
+        mutex,
+        namespace_name,
+        persistence_file_name,
+        current::persistence::FilePersisterGroupCommit(
+            1, std::chrono::microseconds(0), current::persistence::FilePersisterDurability::FDataSync));
+    RunPublishBatchTest(impl);
+  }
+  {
+    // Re-open the file to confirm the batches are written correctly.
+    std::mutex mutex;
+    current::persistence::File<StorableString> impl(mutex, namespace_name, persistence_file_name);
+    EXPECT_EQ(3u, impl.Size());
+    EXPECT_EQ("bar", (*impl.Iterate(1).begin()).entry.s);
+  }
+  {
+    const std::string dir = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "segmented");
+    current::FileSystem::RmDir(
+        dir, current::FileSystem::RmDirParameters::Silent, current::FileSystem::RmDirRecursive::Yes);
+    current::FileSystem::MkDir(dir);
+    {
+      std::mutex mutex;
+      current::persistence::SegmentedFile<StorableString> impl(
+          mutex, namespace_name, current::FileSystem::JoinPath(dir, "data"));
+      RunPublishBatchTest(impl);
+    }
+    current::FileSystem::RmDir(
+        dir, current::FileSystem::RmDirParameters::Silent, current::FileSystem::RmDirRecursive::Yes);
+  }
+}
+
+TEST(PersistenceLayer, FileSidecarIndex) {
+  current::time::ResetToZero();
+
+  using namespace persistence_test;
+
+  using IMPL = current::persistence::File<StorableString>;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+  const std::string index_file_name = persistence_file_name + ".idx";
+  current::FileSystem::RmFile(index_file_name, current::FileSystem::RmFileParameters::Silent);
+  const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+  const auto index_file_remover = current::FileSystem::ScopedRmFile(index_file_name);
+
+  using current::persistence::FilePersisterSidecarIndex;
+
+  // The index is kept in memory unless the sidecar one is requested.
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name);
+    impl.Publish(StorableString("foo"), std::chrono::microseconds(100));
+  }
+  ASSERT_THROW(current::FileSystem::GetFileSize(index_file_name), current::FileException);
+  current::FileSystem::RmFile(persistence_file_name);
+
+  const auto Contents = [&](IMPL& impl) -> std::string {
+    std::vector<std::string> entries;
+    for (const auto& e : impl.Iterate()) {
+      entries.push_back(Printf(
+          "%s %d %d", e.entry.s.c_str(), static_cast<int>(e.idx_ts.index), static_cast<int>(e.idx_ts.us.count())));
+    }
+    return Join(entries, ",");
+  };
+
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, FilePersisterSidecarIndex());
+    impl.Publish(StorableString("foo"), std::chrono::microseconds(100));
+    impl.Publish(StorableString("bar"), std::chrono::microseconds(200));
+    impl.Publish(StorableString("baz"), std::chrono::microseconds(300));
+  }
+
+  // The index holds a 32-byte header and a 16-byte record per entry.
+  EXPECT_EQ(32u + 3u * 16u, current::FileSystem::GetFileSize(index_file_name));
+
+  // The entries appended to the file by other means are picked up from the tail of the file, and get indexed.
+  current::FileSystem::WriteStringToFile(
+      "{\"index\":3,\"us\":400}\t{\"s\":\"meh\"}\n#head 00000000000000000500\n", persistence_file_name.c_str(), true);
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, FilePersisterSidecarIndex());
+    EXPECT_EQ(4u, impl.Size());
+    EXPECT_EQ(500, impl.CurrentHead().count());
+    EXPECT_EQ("foo 0 100,bar 1 200,baz 2 300,meh 3 400", Contents(impl));
+    // The timestamps are looked up in the index too.
+    std::vector<std::string> by_timestamp;
+    for (const auto& e : impl.Iterate(std::chrono::microseconds(150), std::chrono::microseconds(300))) {
+      by_timestamp.push_back(e.entry.s);
+    }
+    EXPECT_EQ("bar,baz", Join(by_timestamp, ","));
+    impl.Publish(StorableString("new"), std::chrono::microseconds(600));
+  }
+  EXPECT_EQ(32u + 5u * 16u, current::FileSystem::GetFileSize(index_file_name));
+
+  // With the index in place, the entries between the first and the last one are not read at startup.
+  const std::string valid_contents = current::FileSystem::ReadFileAsString(persistence_file_name);
+  {
+    std::string contents = valid_contents;
+    const size_t bar_pos = contents.find("\"bar\"");
+    ASSERT_FALSE(std::string::npos == bar_pos);
+    contents.replace(bar_pos, 5u, "\"BAR\"");
+    current::FileSystem::WriteStringToFile(contents, persistence_file_name.c_str());
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, FilePersisterSidecarIndex());
+    EXPECT_EQ(5u, impl.Size());
+    EXPECT_EQ("foo 0 100,BAR 1 200,baz 2 300,meh 3 400,new 4 600", Contents(impl));
+  }
+
+  // A corrupted index is rebuilt.
+  current::FileSystem::WriteStringToFile(valid_contents, persistence_file_name.c_str());
+  const std::string valid_index = current::FileSystem::ReadFileAsString(index_file_name);
+  {
+    // Including when a record in the tail is off, with the first and the last ones matching the file.
+    std::string index = valid_index;
+    int64_t us;
+    std::memcpy(&us, &index[32u + 3u * 16u + 8u], sizeof(us));
+    EXPECT_EQ(400, us);
+    us = 700;
+    std::memcpy(&index[32u + 3u * 16u + 8u], &us, sizeof(us));
+    current::FileSystem::WriteStringToFile(index, index_file_name.c_str());
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, FilePersisterSidecarIndex());
+    std::vector<std::string> by_timestamp;
+    for (const auto& e : impl.Iterate(std::chrono::microseconds(301), std::chrono::microseconds(0))) {
+      by_timestamp.push_back(e.entry.s);
+    }
+    EXPECT_EQ("meh,new", Join(by_timestamp, ","));
+  }
+  EXPECT_EQ(valid_index, current::FileSystem::ReadFileAsString(index_file_name));
+  current::FileSystem::WriteStringToFile("Malformed index", index_file_name.c_str());
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, FilePersisterSidecarIndex());
+    EXPECT_EQ(5u, impl.Size());
+    EXPECT_EQ("foo 0 100,bar 1 200,baz 2 300,meh 3 400,new 4 600", Contents(impl));
+  }
+  EXPECT_EQ(32u + 5u * 16u, current::FileSystem::GetFileSize(index_file_name));
+
+  // An index which does not match the file is rebuilt, and so is a missing one.
+  for (const bool remove_index : {false, true}) {
+    if (remove_index) {
+      current::FileSystem::RmFile(index_file_name);
+    }
+    const std::string signature = valid_contents.substr(0u, valid_contents.find('\n') + 1u);
+    current::FileSystem::WriteStringToFile(signature +
+                                               "{\"index\":0,\"us\":100}\t{\"s\":\"one\"}\n"
+                                               "{\"index\":1,\"us\":150}\t{\"s\":\"two\"}\n",
+                                           persistence_file_name.c_str());
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, FilePersisterSidecarIndex());
+    EXPECT_EQ(2u, impl.Size());
+    EXPECT_EQ("one 0 100,two 1 150", Contents(impl));
+  }
+  EXPECT_EQ(32u + 2u * 16u, current::FileSystem::GetFileSize(index_file_name));
+
+  // The sidecar file, along with its mapping, grows as needed.
+  current::FileSystem::RmFile(persistence_file_name);
+  current::FileSystem::RmFile(index_file_name);
+  const uint64_t N = 100000u;
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, FilePersisterSidecarIndex());
+    for (uint64_t i = 0u; i < N; ++i) {
+      impl.Publish(StorableString(current::ToString(i)), std::chrono::microseconds(i + 1u));
+    }
+    EXPECT_EQ("12345", (*impl.Iterate(std::chrono::microseconds(12346), std::chrono::microseconds(0)).begin()).entry.s);
+  }
+  EXPECT_EQ(32u + N * 16u, current::FileSystem::GetFileSize(index_file_name));
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, FilePersisterSidecarIndex());
+    EXPECT_EQ(N, impl.Size());
+    EXPECT_EQ("99998", (*impl.Iterate(std::chrono::microseconds(99999), std::chrono::microseconds(0)).begin()).entry.s);
+  }
+
+  // The sidecar index is maintained by group commit as well.
+  current::FileSystem::RmFile(persistence_file_name);
+  current::FileSystem::RmFile(index_file_name);
+  {
+    std::mutex mutex;
+    IMPL impl(mutex,
+              namespace_name,
+              persistence_file_name,
+              current::persistence::FilePersisterGroupCommit(
+                  10, std::chrono::microseconds(0), current::persistence::FilePersisterDurability::FDataSync),
+              FilePersisterSidecarIndex());
+    impl.Publish(StorableString("foo"), std::chrono::microseconds(100));
+    impl.Publish(StorableString("bar"), std::chrono::microseconds(200));
+  }
+  EXPECT_EQ(32u + 2u * 16u, current::FileSystem::GetFileSize(index_file_name));
+}
+
+TEST(PersistenceLayer, FileIterationWhileAppending) {
+  current::time::ResetToZero();
+
+  using namespace persistence_test;
+
+  using IMPL = current::persistence::File<StorableString>;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+  const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+
+  const uint64_t N = 2000;
+
+  std::mutex mutex;
+  IMPL impl(mutex, namespace_name, persistence_file_name);
+
+  // The file grows, with the `#head` directives in between the entries, while it is being iterated over.
+  std::thread publisher([&impl, N]() {
+    for (uint64_t i = 0; i < N; ++i) {
+      impl.Publish(StorableString(current::ToString(i)), std::chrono::microseconds(i * 10 + 1));
+      if (i % 7 == 0) {
+        impl.UpdateHead(std::chrono::microseconds(i * 10 + 5));
+      }
+    }
+  });
+
+  uint64_t safe_count = 0;
+  uint64_t unsafe_count = 0;
+  while (safe_count < N || unsafe_count < N) {
+    for (const auto& e : impl.Iterate(safe_count)) {
+      ASSERT_EQ(safe_count, e.idx_ts.index);
+      ASSERT_EQ(current::ToString(safe_count), e.entry.s);
+      ++safe_count;
+    }
+    for (const auto& e : impl.Iterate<current::ss::IterationMode::Unsafe>(unsafe_count)) {
+      ASSERT_EQ(JSON(idxts_t(unsafe_count, std::chrono::microseconds(unsafe_count * 10 + 1))) + '\t' +
+                    JSON(StorableString(current::ToString(unsafe_count))),
+                e);
+      ++unsafe_count;
+    }
+  }
+  publisher.join();
+
+  // The entries skipped over by the `Unsafe` iterator are not returned.
+  {
+    auto iterable = impl.Iterate<current::ss::IterationMode::Unsafe>(5, 20);
+    auto iterator = iterable.begin();
+    EXPECT_EQ("{\"index\":5,\"us\":51}\t{\"s\":\"5\"}", *iterator);
+    EXPECT_EQ("{\"index\":5,\"us\":51}\t{\"s\":\"5\"}", *iterator);
+    ++iterator;
+    ++iterator;
+    ++iterator;
+    EXPECT_EQ("{\"index\":8,\"us\":81}\t{\"s\":\"8\"}", *iterator);
+    const std::string copy = *iterator;
+    ++iterator;
+    EXPECT_EQ("{\"index\":8,\"us\":81}\t{\"s\":\"8\"}", copy);
+    EXPECT_EQ('{', (*iterator)[0]);
+  }
+}
+
+TEST(PersistenceLayer, FileMappingGrowsWithTheFile) {
+  using current::persistence::impl::FilePersisterMapping;
+  using current::persistence::impl::MappedFileLineReader;
+
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+  const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+
+  std::ofstream appender(persistence_file_name);
+  appender << "first\n" << std::flush;
+  std::atomic<uint64_t> file_size(6u);
+
+  const FilePersisterMapping mapping(persistence_file_name);
+  std::shared_ptr<const FilePersisterMapping::Region> region = mapping.Acquire(file_size);
+  ASSERT_TRUE(static_cast<bool>(region));
+  const uint64_t initial_mapped_bytes = region->Size();
+  EXPECT_GE(initial_mapped_bytes, 6u);
+
+  {
+    MappedFileLineReader reader(mapping, region, file_size, 0);
+    const char* line;
+    size_t length;
+    ASSERT_TRUE(reader.NextLine(line, length));
+    EXPECT_EQ("first", std::string(line, length));
+    EXPECT_FALSE(reader.NextLine(line, length));
+
+    // Grow the file past the initial mapping while the reader is in use, and keep reading through the same reader.
+    const std::string long_line(1024 * 1024, 'x');
+    const uint64_t lines = initial_mapped_bytes / long_line.length() + 2u;
+    for (uint64_t i = 0; i < lines; ++i) {
+      appender << long_line << '\n';
+    }
+    appender << "last\n" << std::flush;
+    file_size = 6u + lines * (long_line.length() + 1u) + 5u;
+
+    for (uint64_t i = 0; i < lines; ++i) {
+      ASSERT_TRUE(reader.NextLine(line, length));
+      ASSERT_EQ(long_line.length(), length);
+      ASSERT_EQ('x', line[length - 1u]);
+    }
+    ASSERT_TRUE(reader.NextLine(line, length));
+    EXPECT_EQ("last", std::string(line, length));
+    EXPECT_FALSE(reader.NextLine(line, length));
+    EXPECT_FALSE(reader.Failed());
+  }
+
+  // The new readers get the larger mapping, while the smaller one is released once no longer in use.
+  EXPECT_GT(mapping.Acquire(file_size)->Size(), initial_mapped_bytes);
+  EXPECT_EQ(1, region.use_count());
+}
+
+TEST(PersistenceLayer, SegmentedFile) {
+  current::time::ResetToZero();
+
+  using namespace persistence_test;
+
+  using IMPL = current::persistence::SegmentedFile<StorableString>;
+  using current::persistence::FilePersisterSegmentation;
+  using current::persistence::FilePersisterRetention;
+  using us_t = std::chrono::microseconds;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string dir = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "segmented");
+  const std::string archive_dir = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "segmented_archive");
+  for (const auto& d : {dir, archive_dir}) {
+    current::FileSystem::RmDir(
+        d, current::FileSystem::RmDirParameters::Silent, current::FileSystem::RmDirRecursive::Yes);
+    current::FileSystem::MkDir(d);
+  }
+  const std::string base = current::FileSystem::JoinPath(dir, "data");
+  const auto SegmentFile = [](const std::string& path, int begin_index) {
+    return path + Printf(".%020d", begin_index);
+  };
+  const auto FileExists = [](const std::string& file_name) {
+    return std::ifstream(file_name).good();
+  };
+
+  const auto Contents = [](IMPL& impl, uint64_t begin, uint64_t end) -> std::string {
+    std::vector<std::string> entries;
+    for (const auto& e : impl.Iterate(begin, end)) {
+      entries.push_back(Printf("%s:%d", e.entry.s.c_str(), static_cast<int>(e.idx_ts.index)));
+    }
+    return Join(entries, ",");
+  };
+  const auto Count = [](IMPL& impl) -> size_t {
+    size_t count = 0u;
+    for (const auto& e : impl.Iterate()) {
+      static_cast<void>(e);
+      ++count;
+    }
+    return count;
+  };
+
+  // Roll over every 1000us worth of entries: the entries at 100us .. 1000us go into the first segment, and so on.
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, base, FilePersisterSegmentation(0u, us_t(1000)));
+    for (int i = 0; i < 25; ++i) {
+      impl.Publish(StorableString(Printf("e%d", i)), us_t(100 * (i + 1)));
+    }
+    impl.UpdateHead(us_t(2600));
+    EXPECT_EQ(25u, impl.Size());
+    EXPECT_EQ(2600, impl.CurrentHead().count());
+    EXPECT_EQ("e8:8,e9:9,e10:10,e11:11", Contents(impl, 8, 12));
+    EXPECT_EQ("e19:19,e20:20", Contents(impl, 19, 21));
+    EXPECT_EQ(25u, Count(impl));
+
+    const auto range = impl.IndexRangeByTimestampRange(us_t(950), us_t(1150));
+    EXPECT_EQ(9u, range.first);
+    EXPECT_EQ(11u, range.second);
+    std::vector<std::string> by_timestamp;
+    for (const auto& e : impl.Iterate(us_t(950), us_t(2050))) {
+      by_timestamp.push_back(e.entry.s);
+    }
+    EXPECT_EQ(11u, by_timestamp.size());
+    EXPECT_EQ("e9", by_timestamp.front());
+    EXPECT_EQ("e19", by_timestamp.back());
+
+    std::vector<std::string> unsafe;
+    for (const auto& e : impl.Iterate<current::ss::IterationMode::Unsafe>(9, 11)) {
+      unsafe.push_back(e);
+    }
+    EXPECT_EQ(
+        "{\"index\":9,\"us\":1000}\t{\"s\":\"e9\"},"
+        "{\"index\":10,\"us\":1100}\t{\"s\":\"e10\"}",
+        Join(unsafe, ","));
+  }
+  EXPECT_TRUE(FileExists(base + ".manifest"));
+  EXPECT_TRUE(FileExists(SegmentFile(base, 0)));
+  EXPECT_TRUE(FileExists(SegmentFile(base, 10)));
+  EXPECT_TRUE(FileExists(SegmentFile(base, 20)));
+  EXPECT_FALSE(FileExists(SegmentFile(base, 25)));
+
+  // Restart, and keep only one sealed segment in place.
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, base, FilePersisterSegmentation(0u, us_t(1000), 1u));
+    EXPECT_EQ(25u, impl.Size());
+    EXPECT_EQ(2600, impl.CurrentHead().count());
+    EXPECT_EQ(0u, impl.FirstAvailableIndex());
+    EXPECT_THROW(impl.Publish(StorableString("too early"), us_t(2600)), current::ss::InconsistentTimestampException);
+
+    // A range over the segments about to be deleted keeps them around until it is done with.
+    const auto full_range = impl.Iterate(0, 25);
+
+    // Rolling over to the fourth segment leaves only the third one in place, besides the active one.
+    impl.Publish(StorableString("e25"), us_t(3100));
+    EXPECT_EQ(26u, impl.Size());
+    EXPECT_EQ(20u, impl.FirstAvailableIndex());
+    EXPECT_EQ("e20:20,e21:21,e22:22,e23:23,e24:24,e25:25", Contents(impl, 0, 26));
+    EXPECT_EQ("e20:20,e21:21,e22:22,e23:23,e24:24,e25:25", Contents(impl, 20, static_cast<uint64_t>(-1)));
+
+    size_t count = 0u;
+    for (const auto& e : full_range) {
+      EXPECT_EQ(count, e.idx_ts.index);
+      ++count;
+    }
+    EXPECT_EQ(25u, count);
+    EXPECT_TRUE(FileExists(SegmentFile(base, 0)));
+    // The manifest no longer refers to the deleted segments, whose files are removed once no longer iterated over.
+    const std::string manifest = current::FileSystem::ReadFileAsString(base + ".manifest");
+    EXPECT_EQ(std::string::npos, manifest.find(SegmentFile(base, 0)));
+    EXPECT_NE(std::string::npos, manifest.find(SegmentFile(base, 20)));
+  }
+  EXPECT_FALSE(FileExists(SegmentFile(base, 0)));
+  EXPECT_FALSE(FileExists(SegmentFile(base, 10)));
+  EXPECT_TRUE(FileExists(SegmentFile(base, 20)));
+  EXPECT_TRUE(FileExists(SegmentFile(base, 25)));
+
+  // Archive the segments beyond the limit instead, rolling over by size.
+  const std::string archived_base = current::FileSystem::JoinPath(dir, "archived");
+  {
+    std::mutex mutex;
+    IMPL impl(mutex,
+              namespace_name,
+              archived_base,
+              FilePersisterSegmentation(200u, us_t(0), 2u, us_t(0), FilePersisterRetention::Archive, archive_dir));
+    for (int i = 0; i < 20; ++i) {
+      impl.Publish(StorableString(Printf("e%d", i)), us_t(100 * (i + 1)));
+    }
+    EXPECT_EQ(0u, impl.FirstAvailableIndex());
+    EXPECT_EQ("e0:0,e1:1,e2:2", Contents(impl, 0, 3));
+    EXPECT_EQ(20u, Count(impl));
+  }
+  EXPECT_FALSE(FileExists(SegmentFile(archived_base, 0)));
+  EXPECT_TRUE(FileExists(SegmentFile(current::FileSystem::JoinPath(archive_dir, "archived"), 0)));
+  {
+    std::mutex mutex;
+    IMPL impl(mutex,
+              namespace_name,
+              archived_base,
+              FilePersisterSegmentation(200u, us_t(0), 2u, us_t(0), FilePersisterRetention::Archive, archive_dir));
+    EXPECT_EQ(20u, impl.Size());
+    std::vector<std::string> all;
+    for (const auto& e : impl.Iterate()) {
+      all.push_back(e.entry.s);
+    }
+    ASSERT_EQ(20u, all.size());
+    EXPECT_EQ("e0", all.front());
+    EXPECT_EQ("e19", all.back());
+  }
+
+  for (const auto& d : {dir, archive_dir}) {
+    current::FileSystem::RmDir(
+        d, current::FileSystem::RmDirParameters::Silent, current::FileSystem::RmDirRecursive::Yes);
+  }
+}
+
 TEST(PersistenceLayer, FileSafeVsUnsafeIterators) {
   using namespace persistence_test;
 
@@ -718,7 +1498,7 @@ TEST(PersistenceLayer, FileSafeVsUnsafeIterators) {
   const auto GetUnsafeIterationResult = [&]() -> std::string {
     std::string combined_result;
     for (const auto& e : impl.Iterate<current::ss::IterationMode::Unsafe>()) {
-      combined_result += e + '\n';
+      combined_result += std::string(e) + '\n';
     }
     return combined_result;
   };
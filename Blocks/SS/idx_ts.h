@@ -29,6 +29,7 @@ SOFTWARE.
 #include "../../port.h"
 
 #include <chrono>
+#include <utility>
 
 #include "exceptions.h"
 
@@ -80,6 +81,18 @@ CURRENT_STRUCT(HeadAndOptionalIndexAndTimestamp) {
   }
 };
 
+// An entry along with its index and timestamp, as passed to the batched subscribers, and as published in batches.
+template <typename ENTRY>
+struct IndexedEntry {
+  IndexAndTimestamp idx_ts;
+  ENTRY entry;
+
+  IndexedEntry() = default;
+  template <typename E>
+  IndexedEntry(IndexAndTimestamp idx_ts, E&& entry)
+      : idx_ts(idx_ts), entry(std::forward<E>(entry)) {}
+};
+
 }  // namespace current::ss
 }  // namespace current
 
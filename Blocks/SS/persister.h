@@ -26,6 +26,8 @@ SOFTWARE.
 #ifndef BLOCKS_SS_PERSISTER_H
 #define BLOCKS_SS_PERSISTER_H
 
+#include <vector>
+
 #include "idx_ts.h"
 
 #include "../../Bricks/sync/locks.h"
@@ -41,6 +43,17 @@ struct GenericPersister {};
 template <typename ENTRY>
 struct GenericEntryPersister : GenericPersister {};
 
+// Throws unless the timestamps of the entries to publish as a batch are strictly increasing, starting after `head`.
+template <typename ENTRY>
+void ValidateBatchTimestamps(const std::vector<IndexedEntry<ENTRY>>& entries, std::chrono::microseconds head) {
+  for (const auto& e : entries) {
+    if (!(e.idx_ts.us > head)) {
+      CURRENT_THROW(InconsistentTimestampException(head + std::chrono::microseconds(1), e.idx_ts.us));
+    }
+    head = e.idx_ts.us;
+  }
+}
+
 template <typename IMPL, typename ENTRY>
 class EntryPersister : public GenericEntryPersister<ENTRY>, public IMPL {
  public:
@@ -65,6 +78,12 @@ class EntryPersister : public GenericEntryPersister<ENTRY>, public IMPL {
   IndexAndTimestamp Publish(ENTRY&& e, std::chrono::microseconds us) {
     return IMPL::template DoPublish<MLS>(std::move(e), us);
   }
+  // Publishes the entries, moving them out, with the timestamps from their `idx_ts.us`, under one lock, and waits for
+  // them to become durable once. The entries are either all published, or, if any timestamp is out of order, none are.
+  template <current::locks::MutexLockStatus MLS = current::locks::MutexLockStatus::NeedToLock>
+  void PublishBatch(std::vector<IndexedEntry<ENTRY>>& entries) {
+    IMPL::template DoPublishBatch<MLS>(entries);
+  }
   template <current::locks::MutexLockStatus MLS = current::locks::MutexLockStatus::NeedToLock>
   void UpdateHead() {
     return IMPL::template DoUpdateHead<MLS>(current::time::DefaultTimeArgument());
@@ -28,6 +28,8 @@ SOFTWARE.
 
 #include "../../port.h"
 
+#include <vector>
+
 #include "idx_ts.h"
 
 #include "../../TypeSystem/variant.h"
@@ -67,6 +69,11 @@ class EntryPublisher : public GenericEntryPublisher<ENTRY>, public IMPL {
   idxts_t Publish(ENTRY&& e, std::chrono::microseconds us) {
     return IMPL::template DoPublish<MLS>(std::move(e), us);
   }
+  // Publishes the entries, keeping their timestamps, as one batch. Only supported by some publishers.
+  template <MutexLockStatus MLS = MutexLockStatus::NeedToLock, typename E>
+  void PublishBatch(std::vector<E>& entries) {
+    IMPL::template DoPublishBatch<MLS>(entries);
+  }
   template <MutexLockStatus MLS = MutexLockStatus::NeedToLock>
   void UpdateHead() {
     IMPL::template DoUpdateHead<MLS>(current::time::DefaultTimeArgument());
@@ -163,6 +170,75 @@ struct IsStreamSubscriber {
   static constexpr bool value = std::is_base_of<GenericStreamSubscriber<current::decay<E>>, current::decay<T>>::value;
 };
 
+// How the entries are grouped for a batched subscriber. The batch is passed to the subscriber as soon as it has
+// `max_entries` entries, or once the subscriber has caught up with the stream and the first entry of the batch
+// has been waiting for at least `max_age`. With the default zero `max_age` no extra latency is introduced.
+struct SubscriberBatching {
+  size_t max_entries;
+  std::chrono::microseconds max_age;
+
+  explicit SubscriberBatching(size_t max_entries = 1000u,
+                              std::chrono::microseconds max_age = std::chrono::microseconds(0))
+      : max_entries(max_entries ? max_entries : 1u), max_age(max_age) {}
+};
+
+template <typename ENTRY>
+struct GenericBatchedStreamSubscriber {};
+
+// The opt-in batched flavor of `StreamSubscriber`. Instead of the per-entry `operator()`, `IMPL` implements
+// `EntryResponse operator()(std::vector<IndexedEntry<ENTRY>>& entries, idxts_t last)`, and is free to move
+// the entries out of the vector. The head updates, `EntryResponseIfNoMorePassTypeFilter()`, and `Terminate()`
+// are the same as for `StreamSubscriber`. All the entries of a batch are passed before the termination request.
+template <typename IMPL, typename ENTRY>
+class BatchedStreamSubscriber : public GenericBatchedStreamSubscriber<ENTRY>, public StreamSubscriber<IMPL, ENTRY> {
+ public:
+  using StreamSubscriber<IMPL, ENTRY>::StreamSubscriber;
+  using EntrySubscriber<IMPL, ENTRY>::operator();
+
+  EntryResponse operator()(std::vector<IndexedEntry<ENTRY>>& entries, idxts_t last) {
+    return IMPL::operator()(entries, last);
+  }
+
+  const SubscriberBatching& Batching() const { return batching_; }
+  void SetBatching(const SubscriberBatching& batching) { batching_ = batching; }
+
+ private:
+  SubscriberBatching batching_;
+};
+
+template <typename T, typename E>
+struct IsBatchedStreamSubscriber {
+  static constexpr bool value =
+      std::is_base_of<GenericBatchedStreamSubscriber<current::decay<E>>, current::decay<T>>::value;
+};
+
+template <typename ENTRY>
+struct GenericRawStreamSubscriber {};
+
+// The opt-in flavor of `StreamSubscriber` which can be passed the entries as they are persisted, without parsing
+// them: each line is `JSON(idx_ts) + '\t' + JSON(entry)`, in the default JSON format, with no trailing newline.
+// `IMPL` implements `bool AcceptsRawLines()`, which is asked once, as the subscription starts, and, if it returns
+// `true`, `EntryResponse operator()(const char* line, size_t length, idxts_t current, idxts_t last)`, which is then
+// called instead of the per-entry `operator()`. The line is only valid for the duration of the call.
+// Only the subscribers to the very type of the stream, not to one of the types of its `Variant<>`, get raw lines.
+template <typename IMPL, typename ENTRY>
+class RawStreamSubscriber : public GenericRawStreamSubscriber<ENTRY>, public StreamSubscriber<IMPL, ENTRY> {
+ public:
+  using StreamSubscriber<IMPL, ENTRY>::StreamSubscriber;
+  using EntrySubscriber<IMPL, ENTRY>::operator();
+
+  bool AcceptsRawLines() { return IMPL::AcceptsRawLines(); }
+  EntryResponse operator()(const char* line, size_t length, idxts_t current, idxts_t last) {
+    return IMPL::operator()(line, length, current, last);
+  }
+};
+
+template <typename T, typename E>
+struct IsRawStreamSubscriber {
+  static constexpr bool value =
+      std::is_base_of<GenericRawStreamSubscriber<current::decay<E>>, current::decay<T>>::value;
+};
+
 namespace impl {
 
 template <typename TYPE_SUBSCRIBED_TO, typename STREAM_UNDERLYING_VARIANT>
@@ -197,6 +273,29 @@ struct PassEntryToSubscriberIfTypeMatchesImpl<T, T> {
   }
 };
 
+template <typename TYPE_SUBSCRIBED_TO, typename STREAM_UNDERLYING_VARIANT>
+struct AppendEntryToBatchIfTypeMatchesImpl {
+  template <typename E>
+  static bool Append(std::vector<IndexedEntry<TYPE_SUBSCRIBED_TO>>& batch, E&& entry, idxts_t current) {
+    const E& entry_cref = entry;
+    if (Exists<TYPE_SUBSCRIBED_TO>(entry_cref)) {
+      batch.emplace_back(current, Value<TYPE_SUBSCRIBED_TO>(std::forward<E>(entry)));
+      return true;
+    } else {
+      return false;
+    }
+  }
+};
+
+template <typename T>
+struct AppendEntryToBatchIfTypeMatchesImpl<T, T> {
+  template <typename E>
+  static bool Append(std::vector<IndexedEntry<T>>& batch, E&& entry, idxts_t current) {
+    batch.emplace_back(current, std::forward<E>(entry));
+    return true;
+  }
+};
+
 }  // namespace current::ss::impl
 
 template <typename TYPE_SUBSCRIBED_TO, typename STREAM_UNDERLYING_VARIANT, typename F, typename G, typename E>
@@ -205,6 +304,15 @@ EntryResponse PassEntryToSubscriberIfTypeMatches(F&& f, G&& fallback, E&& entry,
       std::forward<F>(f), std::forward<G>(fallback), std::forward<E>(entry), current, last);
 }
 
+// The batched counterpart of `PassEntryToSubscriberIfTypeMatches()`. Returns whether the entry has been appended.
+template <typename TYPE_SUBSCRIBED_TO, typename STREAM_UNDERLYING_VARIANT, typename E>
+bool AppendEntryToBatchIfTypeMatches(std::vector<IndexedEntry<TYPE_SUBSCRIBED_TO>>& batch,
+                                     E&& entry,
+                                     idxts_t current) {
+  return impl::AppendEntryToBatchIfTypeMatchesImpl<TYPE_SUBSCRIBED_TO, STREAM_UNDERLYING_VARIANT>::Append(
+      batch, std::forward<E>(entry), current);
+}
+
 }  // namespace current::ss
 }  // namespace current
 
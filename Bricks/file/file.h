@@ -31,6 +31,7 @@ SOFTWARE.
 
 #include <cstdio>
 #include <fstream>
+#include <functional>
 #include <string>
 #include <cstring>
 #include <vector>
@@ -49,6 +49,10 @@ constexpr char kContentLengthHeaderKey[] = "Content-Length";
 constexpr char kTransferEncodingHeaderKey[] = "Transfer-Encoding";
 constexpr char kTransferEncodingChunkedValue[] = "chunked";
 constexpr char kHTTPMethodOverrideHeaderKey[] = "X-HTTP-Method-Override";
+constexpr char kConnectionHeaderKey[] = "Connection";
+constexpr char kConnectionKeepAliveValue[] = "keep-alive";
+constexpr char kConnectionCloseValue[] = "close";
+constexpr char kHTTP11[] = "HTTP/1.1";
 
 constexpr char kHTTPAccessControlAllowOriginHeaderName[] = "Access-Control-Allow-Origin";
 constexpr char kHTTPAccessControlAllowOriginHeaderValue[] = "*";
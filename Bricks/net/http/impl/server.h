@@ -25,9 +25,17 @@ SOFTWARE.
 #ifndef BRICKS_NET_HTTP_IMPL_SERVER_H
 #define BRICKS_NET_HTTP_IMPL_SERVER_H
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
 #include <map>
+#include <mutex>
+#include <queue>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 #include <memory>
 
@@ -43,10 +51,12 @@ SOFTWARE.
 #include "../../tcp/tcp.h"
 
 #include "../../../template/enable_if.h"
+#include "../../../util/singleton.h"
 
 #include "../../../../TypeSystem/struct.h"
 #include "../../../../TypeSystem/Serialization/json.h"
 
+#include "../../../strings/chunk.h"
 #include "../../../strings/util.h"
 #include "../../../strings/split.h"
 
@@ -95,6 +105,15 @@ inline EventsJournal& HTTPDataJournal() { return current::Singleton<EventsJourna
 // HTTP response helpers. Used from both `GenericHTTPRequestData` and `GenericHTTPServerConnection`.
 struct HTTPResponder {
   typedef enum { ConnectionClose, ConnectionKeepAlive } ConnectionType;
+
+  // The connection to send the response into, and whether it will be kept open for more requests afterwards.
+  struct ResponseConnection {
+    Connection& connection;
+    const ConnectionType type;
+    ResponseConnection(Connection& connection, ConnectionType type = ConnectionClose)
+        : connection(connection), type(type) {}
+  };
+
   static void PrepareHTTPResponseHeader(std::ostream& os,
                                         ConnectionType connection_type,
                                         HTTPResponseCodeValue code = HTTPResponseCode.OK,
@@ -121,23 +140,23 @@ struct HTTPResponder {
 
   // The actual implementation of sending the HTTP response.
   template <typename T>
-  static void SendHTTPResponseImpl(Connection& connection,
+  static void SendHTTPResponseImpl(ResponseConnection connection,
                                    const T& begin,
                                    const T& end,
                                    HTTPResponseCodeValue code,
                                    const std::string& content_type,
                                    const http::Headers& extra_headers) {
     std::ostringstream os;
-    PrepareHTTPResponseHeader(os, ConnectionClose, code, content_type, extra_headers);
+    PrepareHTTPResponseHeader(os, connection.type, code, content_type, extra_headers);
     os << "Content-Length: " << (end - begin) << constants::kCRLF << constants::kCRLF;
-    connection.BlockingWrite(os.str(), true);
-    connection.BlockingWrite(begin, end, false);
+    connection.connection.BlockingWrite(os.str(), true);
+    connection.connection.BlockingWrite(begin, end, false);
   }
 
   // Only support STL containers of chars and bytes, this does not yet cover std::string.
   template <typename T>
   static ENABLE_IF<sizeof(typename T::value_type) == 1> SendHTTPResponse(
-      Connection& connection,
+      ResponseConnection connection,
       const T& begin,
       const T& end,
       HTTPResponseCodeValue code = HTTPResponseCode.OK,
@@ -147,7 +166,7 @@ struct HTTPResponder {
   }
   template <typename T>
   static ENABLE_IF<sizeof(typename T::value_type) == 1> SendHTTPResponse(
-      Connection& connection,
+      ResponseConnection connection,
       T&& container,
       HTTPResponseCodeValue code = HTTPResponseCode.OK,
       const std::string& content_type = constants::kDefaultContentType,
@@ -156,7 +175,7 @@ struct HTTPResponder {
   }
 
   // Special case to handle std::string.
-  static void SendHTTPResponse(Connection& connection,
+  static void SendHTTPResponse(ResponseConnection connection,
                                const std::string& string,
                                HTTPResponseCodeValue code = HTTPResponseCode.OK,
                                const std::string& content_type = constants::kDefaultContentType,
@@ -167,7 +186,7 @@ struct HTTPResponder {
   // Support `CURRENT_STRUCT`-s.
   template <class T>
   static ENABLE_IF<IS_CURRENT_STRUCT(current::decay<T>)> SendHTTPResponse(
-      Connection& connection,
+      ResponseConnection connection,
       T&& object,
       HTTPResponseCodeValue code = HTTPResponseCode.OK,
       const std::string& content_type = constants::kDefaultJSONContentType,
@@ -181,7 +200,7 @@ struct HTTPResponder {
   // (For backwards compatibility only, really. -- D.K.)
   template <class T>
   static ENABLE_IF<IS_CURRENT_STRUCT(current::decay<T>)> SendHTTPResponse(
-      Connection& connection,
+      ResponseConnection connection,
       T&& object,
       const std::string& name,
       HTTPResponseCodeValue code = HTTPResponseCode.OK,
@@ -196,17 +215,33 @@ struct HTTPResponder {
 // HTTPDefaultHelper handles headers and chunked transfers.
 // One can inject a custom implementaion of it to avoid keeping all HTTP body in memory.
 // TODO(dkorolev): This is not yet the case, but will be soon once I fix HTTP parse code.
+//
+// The headers are kept as views into the buffer of `GenericHTTPRequestData`, and only parsed into `http::Headers`
+// once they are first accessed, or right before the buffer is moved or reused.
+// The first access after the parsing is done materializes the headers exactly once, so that `headers()` is safe
+// to call concurrently on a const object.
 class HTTPDefaultHelper {
  public:
   struct ConstructionParams {};
   HTTPDefaultHelper(const ConstructionParams&) {}
 
-  const http::Headers& headers() const { return headers_; }
+  const http::Headers& headers() const {
+    std::call_once(headers_materialized_, [this]() { MaterializeHeaders(); });
+    return headers_;
+  }
 
  protected:
   HTTPDefaultHelper() = default;
 
-  inline void OnHeader(const char* key, const char* value) { headers_.SetHeaderOrCookie(key, value); }
+  inline void OnHeader(const char* key, const char* value) {
+    if (header_views_.empty()) {
+      header_views_.reserve(kHeaderViewsInitialCapacity);
+    }
+    header_views_.emplace_back(key, value);
+  }
+
+  // Called while parsing only, before the object is available to the user, hence not under `headers_materialized_`.
+  inline void OnBufferRelocation() { MaterializeHeaders(); }
 
   inline void OnChunk(const char* chunk, size_t length) { body_.append(chunk, length); }
 
@@ -216,7 +251,18 @@ class HTTPDefaultHelper {
   }
 
  private:
-  http::Headers headers_;
+  enum { kHeaderViewsInitialCapacity = 32 };
+
+  void MaterializeHeaders() const {
+    for (const auto& header : header_views_) {
+      headers_.SetHeaderOrCookie(header.first, header.second);
+    }
+    header_views_.clear();
+  }
+
+  mutable http::Headers headers_;
+  mutable std::vector<std::pair<strings::Chunk, strings::Chunk>> header_views_;
+  mutable std::once_flag headers_materialized_;
   std::string body_;
 };
 
@@ -226,11 +272,22 @@ class HTTPDefaultHelper {
 // Getters:
 // * current::url::URL URL() (to access `.host`, `.path`, `.scheme` and `.port`).
 // * std::string RawPath() (the URL before parsing).
+// * strings::Chunk RawPathView(), strings::Chunk QueryView() (the above, and the part of it after the `?`, in place).
 // * std::string Method().
 // * std::string Body(), size_t BodyLength(), const char* Body{Begin,End}().
+// * bool KeepAliveRequested() (HTTP/1.1 without `Connection: close`, or an explicit `Connection: keep-alive`).
+// * bool BodyLengthKnown() (whether the message has `Content-Length` or is chunk-encoded).
+// * std::vector<char> PipelinedData() (the bytes read past the end of this message, i.e., the next request).
+//
+// The optional `pipelined_data` is the beginning of this message, if it was read along with the previous one.
+//
+// Nothing is copied out of the buffer while parsing: `URL()`, `RawPath()`, `Body()`, and the headers of the default
+// helper are only materialized once they are first accessed. Neither the views nor the `Body{Begin,End}()` pointers
+// outlive this object.
 //
 // Exceptions:
 // * ConnectionResetByPeer       : When the server is using chunked transfer and doesn't fully send one.
+// * EmptyConnectionResetByPeer  : When the connection is closed before the first line of the message.
 //
 // HTTP message: http://www.w3.org/Protocols/rfc2616/rfc2616.html
 template <class HELPER>
@@ -240,13 +297,19 @@ class GenericHTTPRequestData : public HELPER {
       Connection& c,
       const typename HELPER::ConstructionParams& params = typename HELPER::ConstructionParams(),
       const int initial_buffer_size = 16 * 1024 + 1,
-      const double buffer_growth_k = 1.95)
-      : HELPER(params), buffer_(initial_buffer_size) {
+      const double buffer_growth_k = 1.95,
+      const std::vector<char>& pipelined_data = std::vector<char>())
+      : HELPER(params), buffer_(std::max(static_cast<size_t>(initial_buffer_size), pipelined_data.size() + 2u)) {
     // `offset` is the number of bytes read into `buffer_` so far.
     // `length_cap` is infinity first (size_t is unsigned), and it changes/ to the absolute offset
     // of the end of HTTP body in the buffer_, once `Content-Length` and two consecutive CRLS have been seen.
-    size_t offset = 0;
+    size_t offset = pipelined_data.size();
     size_t length_cap = static_cast<size_t>(-1);
+    std::copy(pipelined_data.begin(), pipelined_data.end(), buffer_.begin());
+
+    // `parse_pipelined_data_first` is set when the message may already be complete, and should be parsed
+    // before reading more data from the connection, as there may be no more data coming in.
+    bool parse_pipelined_data_first = !pipelined_data.empty();
 
     // `current_line_offset` is the index of the first character after CRLF in `buffer_`.
     size_t current_line_offset = 0;
@@ -265,31 +328,40 @@ class GenericHTTPRequestData : public HELPER {
     bool receiving_body_in_chunks = false;
 
     while (offset < length_cap) {
-      size_t chunk;
-      size_t read_count;
-      // Use `offset + 1` instead of just `offset` to leave room for the '\0'.
-      CURRENT_ASSERT(buffer_.size() > offset + 1);
-      // NOTE: This `if` should not be made a `while`, as it may so happen that the boundary between two
-      // consecutively received packets lays right on the final size, but instead of parsing the received body,
-      // the server would wait forever for more data to arrive from the client.
-      chunk = buffer_.size() - offset - 1;
-      read_count = c.BlockingRead(&buffer_[offset], chunk);
-      CURRENT_BRICKS_LOG_HTTP_EVENT(
-          "read %lu bytes while requested %lu (buffer offset %lu)\n", read_count, chunk, offset);
-      offset += read_count;
-      if (read_count == chunk && offset < length_cap) {
-        // The `std::max()` condition is kept just in case we compile Current for a device
-        // that is extremely short on memory, for which `buffer_growth_k` could be some 1.0001. -- D.K.
-        const size_t new_buffer_size =
-            std::max(static_cast<size_t>(buffer_.size() * buffer_growth_k), buffer_.size() + 1);
-        CURRENT_BRICKS_LOG_HTTP_EVENT("resize the buffer %lu -> %lu\n", buffer_.size(), new_buffer_size);
-        buffer_.resize(new_buffer_size);
-      }
-      if (!read_count) {
-        // This is worth re-checking, but as for 2014/12/06 the concensus of reading through man
-        // and StackOverflow is that a return value of zero from read() from a socket indicates
-        // that the socket has been closed by the peer.
-        CURRENT_THROW(ConnectionResetByPeer());  // LCOV_EXCL_LINE
+      if (parse_pipelined_data_first) {
+        parse_pipelined_data_first = false;
+      } else {
+        size_t chunk;
+        size_t read_count;
+        // Use `offset + 1` instead of just `offset` to leave room for the '\0'.
+        CURRENT_ASSERT(buffer_.size() > offset + 1);
+        // NOTE: This `if` should not be made a `while`, as it may so happen that the boundary between two
+        // consecutively received packets lays right on the final size, but instead of parsing the received body,
+        // the server would wait forever for more data to arrive from the client.
+        chunk = buffer_.size() - offset - 1;
+        read_count = c.BlockingRead(&buffer_[offset], chunk);
+        CURRENT_BRICKS_LOG_HTTP_EVENT(
+            "read %lu bytes while requested %lu (buffer offset %lu)\n", read_count, chunk, offset);
+        offset += read_count;
+        if (read_count == chunk && offset < length_cap) {
+          // The `std::max()` condition is kept just in case we compile Current for a device
+          // that is extremely short on memory, for which `buffer_growth_k` could be some 1.0001. -- D.K.
+          const size_t new_buffer_size =
+              std::max(static_cast<size_t>(buffer_.size() * buffer_growth_k), buffer_.size() + 1);
+          CURRENT_BRICKS_LOG_HTTP_EVENT("resize the buffer %lu -> %lu\n", buffer_.size(), new_buffer_size);
+          ResizeBuffer(new_buffer_size);
+        }
+        if (!read_count) {
+          // This is worth re-checking, but as for 2014/12/06 the concensus of reading through man
+          // and StackOverflow is that a return value of zero from read() from a socket indicates
+          // that the socket has been closed by the peer.
+          if (!first_line_parsed) {
+            // Nothing but, perhaps, blank lines has been sent in. For instance, the client is done
+            // with a kept alive connection.
+            CURRENT_THROW(EmptyConnectionResetByPeer());
+          }
+          CURRENT_THROW(ConnectionResetByPeer());  // LCOV_EXCL_LINE
+        }
       }
       buffer_[offset] = '\0';
       char* next_crlf_ptr;
@@ -302,14 +374,20 @@ class GenericHTTPRequestData : public HELPER {
         if (!first_line_parsed) {
           if (!line_is_blank) {
             // It's recommended by W3 to wait for the first line ignoring prior CRLF-s.
-            const std::vector<std::string> pieces =
-                strings::Split<strings::ByWhitespace>(&buffer_[current_line_offset]);
-            if (pieces.size() >= 1) {
+            const char* pieces[3];
+            const size_t pieces_count = SplitFirstLineInPlace(&buffer_[current_line_offset], pieces);
+            if (pieces_count >= 1) {
               method_ = pieces[0];
             }
-            if (pieces.size() >= 2) {
-              raw_path_ = pieces[1];
-              url_ = current::url::URL(raw_path_);
+            if (pieces_count >= 2) {
+              raw_path_view_ = strings::Chunk(pieces[1]);
+            }
+            // HTTP/1.1 connections are persistent by default. The version is the last piece of the request line,
+            // and the first piece of the status line of the response, as in `HTTP/1.1 200 OK`.
+            if (pieces_count >= 1 && !std::strncmp(pieces[0], "HTTP/", 5)) {
+              keep_alive_requested_ = !std::strcmp(pieces[0], constants::kHTTP11);
+            } else {
+              keep_alive_requested_ = (pieces_count >= 3 && !std::strcmp(pieces[2], constants::kHTTP11));
             }
             first_line_parsed = true;
           }
@@ -331,6 +409,12 @@ class GenericHTTPRequestData : public HELPER {
             if (chunk_length == 0) {
               // Done with the body.
               HELPER::OnChunkedBodyDone(body_buffer_begin_, body_buffer_end_);
+              // Skip the CRLF that terminates the zero chunk, if it has already been read.
+              if (buffer_[next_line_offset] == '\r' && buffer_[next_line_offset + 1] == '\n') {
+                next_line_offset += constants::kCRLFLength;
+              }
+              pipelined_data_begin_ = next_line_offset;
+              pipelined_data_end_ = offset;
               return;
             } else {
               // A chunk of length `chunk_length` bytes starts right at next_line_offset.
@@ -345,6 +429,7 @@ class GenericHTTPRequestData : public HELPER {
                     CURRENT_BRICKS_LOG_HTTP_EVENT("memmove %lu bytes from offset %lu to fit the entire chunk\n",
                                                   offset - chunk_offset,
                                                   chunk_offset);
+                    BeforeBufferRelocation();
                     std::memmove(&buffer_[0], &buffer_[chunk_offset], offset - chunk_offset);
                     offset -= chunk_offset;
                     next_offset -= chunk_offset;
@@ -356,7 +441,7 @@ class GenericHTTPRequestData : public HELPER {
                         std::max(static_cast<size_t>(buffer_.size() * buffer_growth_k), next_offset + 1);
                     CURRENT_BRICKS_LOG_HTTP_EVENT(
                         "resize the buffer %lu -> %lu to fit the entire chunk\n", buffer_.size(), new_buffer_size);
-                    buffer_.resize(new_buffer_size);
+                    ResizeBuffer(new_buffer_size);
                     // LCOV_EXCL_STOP
                   }
                 }
@@ -395,6 +480,7 @@ class GenericHTTPRequestData : public HELPER {
             HELPER::OnHeader(key, value);
             if (HeaderNameEquals(key, constants::kContentLengthHeaderKey)) {
               body_length = static_cast<size_t>(atoi(value));
+              body_length_known_ = true;
               if (body_length > constants::kMaxHTTPPayloadSizeInBytes) {
                 HTTPResponder::SendHTTPResponse(c,
                                                 net::DefaultRequestEntityTooLargeMessage(),
@@ -407,6 +493,13 @@ class GenericHTTPRequestData : public HELPER {
             } else if (HeaderNameEquals(key, constants::kTransferEncodingHeaderKey)) {
               if (HeaderNameEquals(value, constants::kTransferEncodingChunkedValue)) {
                 chunked_transfer_encoding = true;
+                body_length_known_ = true;
+              }
+            } else if (HeaderNameEquals(key, constants::kConnectionHeaderKey)) {
+              if (HeaderNameEquals(value, constants::kConnectionCloseValue)) {
+                keep_alive_requested_ = false;
+              } else if (HeaderNameEquals(value, constants::kConnectionKeepAliveValue)) {
+                keep_alive_requested_ = true;
               }
             }
           }
@@ -423,19 +516,24 @@ class GenericHTTPRequestData : public HELPER {
               length_cap = body_offset + body_length;
               // Keep in mind that `buffer_` should have the size of `length_cap + 1`, to include the `\0'.
               if (length_cap + 1 > buffer_.size()) {
-                buffer_.resize(length_cap + 1);
+                ResizeBuffer(length_cap + 1);
               }
               if (length_cap > offset) {
                 const size_t bytes_to_read = length_cap - offset;
                 if (bytes_to_read != c.BlockingRead(&buffer_[offset], bytes_to_read, Connection::FillFullBuffer)) {
                   CURRENT_THROW(ConnectionResetByPeer());  // LCOV_EXCL_LINE
                 }
+                offset = length_cap;
               }
               body_buffer_begin_ = &buffer_[body_offset];
               body_buffer_end_ = body_buffer_begin_ + body_length;
+              pipelined_data_begin_ = length_cap;
+              pipelined_data_end_ = offset;
               return;
             } else {
               // HTTP body length has not been set, so we're done..
+              pipelined_data_begin_ = body_offset;
+              pipelined_data_end_ = offset;
               return;
             }
           } else {
@@ -445,6 +543,8 @@ class GenericHTTPRequestData : public HELPER {
         current_line_offset = next_line_offset;
       }
       if (receiving_body_in_chunks && current_line_offset) {
+        // Either way, the beginning of the buffer is about to be overwritten.
+        BeforeBufferRelocation();
         if (offset > current_line_offset) {
           CURRENT_BRICKS_LOG_HTTP_EVENT("memmove %lu bytes from offset %lu to the beginning\n",
                                         offset - current_line_offset,
@@ -461,20 +561,47 @@ class GenericHTTPRequestData : public HELPER {
   }
 
   inline const std::string& Method() const { return method_; }
-  inline const current::url::URL& URL() const { return url_; }
-  inline const std::string& RawPath() const { return raw_path_; }
+
+  inline const current::url::URL& URL() const {
+    if (!url_parsed_) {
+      url_ = current::url::URL(RawPath());
+      url_parsed_ = true;
+    }
+    return url_;
+  }
+
+  inline const std::string& RawPath() const {
+    if (!raw_path_materialized_) {
+      raw_path_.assign(raw_path_view_.c_str(), raw_path_view_.length());
+      raw_path_materialized_ = true;
+    }
+    return raw_path_;
+  }
+
+  inline strings::Chunk RawPathView() const { return raw_path_view_; }
+
+  // The query string, without the `?`, as sent, i.e. not URL-decoded.
+  inline strings::Chunk QueryView() const {
+    const char* query = std::strchr(raw_path_view_.c_str(), '?');
+    if (query) {
+      ++query;
+      return strings::Chunk(query, raw_path_view_.length() - (query - raw_path_view_.c_str()));
+    } else {
+      return strings::Chunk();
+    }
+  }
 
   // Note that `Body*()` methods assume that the body was fully read into memory.
   // If other means of reading the body, for example, event-based chunk parsing, is used,
   // then `Body()` will return empty string and all other `Body*()` methods will return nullptr.
 
   inline const std::string& Body() const {
+    if (!body_buffer_begin_) {
+      static const std::string empty_body;
+      return empty_body;
+    }
     if (!prepared_body_) {
-      if (body_buffer_begin_) {
-        prepared_body_.reset(new std::string(body_buffer_begin_, body_buffer_end_));
-      } else {
-        prepared_body_.reset(new std::string());
-      }
+      prepared_body_.reset(new std::string(body_buffer_begin_, body_buffer_end_));
     }
     return *prepared_body_.get();
   }
@@ -492,7 +619,57 @@ class GenericHTTPRequestData : public HELPER {
     }
   }
 
+  inline bool KeepAliveRequested() const { return keep_alive_requested_; }
+
+  inline bool BodyLengthKnown() const { return body_length_known_; }
+
+  inline bool HasPipelinedData() const { return pipelined_data_end_ > pipelined_data_begin_; }
+
+  inline std::vector<char> PipelinedData() const {
+    return std::vector<char>(buffer_.begin() + pipelined_data_begin_, buffer_.begin() + pipelined_data_end_);
+  }
+
  private:
+  // Splits the first line of the message by whitespace, in place, into up to three '\0'-terminated pieces:
+  // the method, the path, and the protocol version.
+  static size_t SplitFirstLineInPlace(char* line, const char* pieces[3]) {
+    const auto IsSpaceOrTab = [](const char c) { return c == ' ' || c == '\t'; };
+    size_t count = 0u;
+    while (*line && count < 3u) {
+      while (IsSpaceOrTab(*line)) {
+        ++line;
+      }
+      if (!*line) {
+        break;
+      }
+      pieces[count++] = line;
+      while (*line && !IsSpaceOrTab(*line)) {
+        ++line;
+      }
+      if (*line) {
+        *line++ = '\0';
+      }
+    }
+    return count;
+  }
+
+  // The views into `buffer_` must be materialized before its data is moved by a reallocation or by a `memmove()`.
+  void BeforeBufferRelocation() {
+    if (!raw_path_materialized_ && !raw_path_view_.empty()) {
+      raw_path_view_ = strings::Chunk(RawPath());
+    }
+    NotifyHelperOfBufferRelocation(std::is_base_of<HTTPDefaultHelper, HELPER>());
+  }
+  void NotifyHelperOfBufferRelocation(std::true_type) { HELPER::OnBufferRelocation(); }
+  void NotifyHelperOfBufferRelocation(std::false_type) {}
+
+  void ResizeBuffer(size_t new_size) {
+    if (new_size > buffer_.capacity()) {
+      BeforeBufferRelocation();
+    }
+    buffer_.resize(new_size);
+  }
+
   static char NormalizeHeaderChar(char c) { return c != '_' ? std::tolower(c) : '-'; }
   static bool HeaderNameEquals(const char* lhs, const char* rhs) {
     while (*lhs && *rhs) {
@@ -503,18 +680,24 @@ class GenericHTTPRequestData : public HELPER {
     return !*lhs && !*rhs;
   }
 
-  // Fields available to the user via getters.
+  // Fields available to the user via getters. The path is parsed into `url_` and copied into `raw_path_` on demand.
   std::string method_;
-  current::url::URL url_;
-  std::string raw_path_;
+  strings::Chunk raw_path_view_;
+  mutable current::url::URL url_;
+  mutable bool url_parsed_ = false;
+  mutable std::string raw_path_;
+  mutable bool raw_path_materialized_ = false;
 
   // HTTP parsing fields that have to be caried out of the parsing routine.
   std::vector<char> buffer_;                 // The buffer into which data has been read, except for chunked case.
   const char* body_buffer_begin_ = nullptr;  // If BODY has been provided, pointer pair to it.
   const char* body_buffer_end_ = nullptr;    // Will not be nullptr if body_buffer_begin_ is not nullptr.
+  size_t pipelined_data_begin_ = 0u;         // The bytes read past the end of this message, if any.
+  size_t pipelined_data_end_ = 0u;
+  bool keep_alive_requested_ = false;
+  bool body_length_known_ = false;
 
   // HTTP body gets converted to an std::string representation as it's first requested.
-  // TODO(dkorolev): This pattern is worth revisiting. StringPiece?
   mutable std::unique_ptr<std::string> prepared_body_;
 
   // Disable any copy/move support since this class uses pointers.
@@ -528,18 +711,245 @@ class GenericHTTPRequestData : public HELPER {
 // The default implementation is exposed as HTTPRequestData.
 using HTTPRequestData = GenericHTTPRequestData<HTTPDefaultHelper>;
 
+// Coalescing of the data sent via a chunked response into larger HTTP chunks. Disabled with `max_bytes == 0`,
+// in which case each piece of data is sent right away, as a chunk of its own.
+// Otherwise the data is buffered, and sent as one chunk once `max_bytes` bytes are buffered, or once the oldest
+// buffered piece of data has been waiting for `max_delay`, or upon an explicit `Flush()`. With a non-zero `max_delay`
+// the buffered data is also sent once it is due with no `Send()` needed, by `ChunkedResponseFlushTimer`.
+// A zero `max_delay` means no timer: the data is then only sent once `max_bytes` bytes are buffered, upon `Flush()`,
+// or at the end of the response.
+struct ChunkedResponseCoalescing {
+  size_t max_bytes;
+  std::chrono::microseconds max_delay;
+
+  explicit ChunkedResponseCoalescing(size_t max_bytes = 0u,
+                                     std::chrono::microseconds max_delay = std::chrono::microseconds(0))
+      : max_bytes(max_bytes), max_delay(max_delay) {}
+
+  bool Enabled() const { return max_bytes > 0u; }
+};
+
+// The single, process-wide, thread to send out the coalesced data of the chunked responses once it is due,
+// so that no chunked response needs a thread of its own. The deadlines are kept in a heap, the earliest first.
+// The timer only keeps weak pointers to the responses, and skips the ones that are gone by their deadlines.
+// The timer never blocks on a response: it skips the response that is being written to by its own sender, and writes
+// the due data without blocking. The part of it the socket does not take right away is kept, to be written either
+// by the next write of the sender itself, or by the timer again, after another `max_delay`. Thus, a receiver that
+// does not read holds up no other responses.
+class ChunkedResponseFlushTimer final {
+ public:
+  class Flushable {
+   public:
+    virtual ~Flushable() = default;
+    // Called from the timer thread, with no locks held, once the scheduled deadline has passed.
+    virtual void FlushIfDue() = 0;
+  };
+
+  ChunkedResponseFlushTimer() : thread_(&ChunkedResponseFlushTimer::Thread, this) {}
+
+  ~ChunkedResponseFlushTimer() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+  }
+
+  void Schedule(std::chrono::steady_clock::time_point deadline, std::weak_ptr<Flushable> flushable) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const bool earliest = deadlines_.empty() || deadline < deadlines_.top().deadline;
+    deadlines_.push(Scheduled{deadline, std::move(flushable)});
+    if (earliest) {
+      cv_.notify_one();
+    }
+  }
+
+ private:
+  struct Scheduled {
+    std::chrono::steady_clock::time_point deadline;
+    std::weak_ptr<Flushable> flushable;
+    // Reversed, as `std::priority_queue<>` puts the greatest element on top.
+    bool operator<(const Scheduled& rhs) const { return deadline > rhs.deadline; }
+  };
+
+  void Thread() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+      if (deadlines_.empty()) {
+        cv_.wait(lock);
+      } else if (std::chrono::steady_clock::now() < deadlines_.top().deadline) {
+        const std::chrono::steady_clock::time_point deadline = deadlines_.top().deadline;
+        cv_.wait_until(lock, deadline);
+      } else {
+        std::weak_ptr<Flushable> flushable = deadlines_.top().flushable;
+        deadlines_.pop();
+        lock.unlock();
+        if (std::shared_ptr<Flushable> locked = flushable.lock()) {
+          locked->FlushIfDue();
+        }
+        lock.lock();
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::priority_queue<Scheduled> deadlines_;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+// Persistent connections, aka HTTP keep-alive. Disabled with `max_requests_per_connection == 1`.
+struct HTTPKeepAliveParams {
+  // The maximum number of requests to serve over a single connection.
+  size_t max_requests_per_connection;
+  // The time to wait for the next request on an idle connection before closing it.
+  std::chrono::milliseconds idle_timeout;
+
+  explicit HTTPKeepAliveParams(size_t max_requests_per_connection = 1u,
+                               std::chrono::milliseconds idle_timeout = std::chrono::milliseconds(5000))
+      : max_requests_per_connection(max_requests_per_connection), idle_timeout(idle_timeout) {}
+
+  bool Enabled() const { return max_requests_per_connection > 1u; }
+};
+
+// The state of a persistent connection, shared by the `GenericHTTPServerConnection`-s of its requests,
+// which are served one at a time, and by the serving loop.
+//
+// Once a request is served, if the response has been sent in full and the connection can be kept alive, the destructor
+// of its `GenericHTTPServerConnection` releases the connection here, along with the next request(s) already read.
+// The serving loop then takes the released connection and serves the next request on it. If the request is still
+// being served by the time the serving loop is done with it, i.e., the response is sent from another thread,
+// the connection is not released, and is closed once the response is sent. Such a response says `Connection: close`,
+// as the response only says `Connection: keep-alive` once the connection is promised to be taken back, see
+// `PromiseRelease()`.
+class HTTPKeepAliveState final {
+ public:
+  explicit HTTPKeepAliveState(const HTTPKeepAliveParams& params) : params_(params) {}
+
+  const HTTPKeepAliveParams& Params() const { return params_; }
+
+  // Returns the connection released for the next request, or `nullptr` if it was not released.
+  // Once `nullptr` has been returned, the connection is no longer accepted back.
+  // Waits for the response that has been promised to release the connection to be sent, see `PromiseRelease()`.
+  std::unique_ptr<Connection> TakeReleasedConnection() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    release_promised_cv_.wait(lock, [this]() { return released_connection_ || !release_promised_; });
+    if (!released_connection_) {
+      accepting_released_connection_ = false;
+    }
+    return std::move(released_connection_);
+  }
+
+  // Whether the next request has already been read in full or in part, and is not to be waited for.
+  bool HasPipelinedData() const { return !pipelined_data_.empty(); }
+
+  // Event-driven servers read requests themselves, and hand over the next one before it is served.
+  void SetPipelinedData(std::vector<char>&& pipelined_data) { pipelined_data_ = std::move(pipelined_data); }
+
+  // Event-driven servers do not wait for the connection to be released, and are notified instead.
+  // The callback is run in the thread that has served the request, and should take the released connection.
+  void SetReleaseCallback(std::function<void()> on_release) { on_release_ = std::move(on_release); }
+
+ private:
+  template <class>
+  friend class GenericHTTPServerConnection;
+
+  // Called by the `GenericHTTPServerConnection` of the request being served, in the order below.
+  std::vector<char> TakePipelinedData() { return std::move(pipelined_data_); }
+  bool CanServeOneMoreRequest() { return ++requests_served_ < params_.max_requests_per_connection; }
+
+  // Called as the response is about to be sent. Returns whether the connection will be taken back once the response
+  // is sent, for the response to say `Connection: keep-alive`, and, if so, has the serving loop wait for it.
+  // Event-driven servers take the connection back whenever it is released. The serving loop takes it back as long as
+  // it has not yet given up on it, but does not wait for the chunked responses, which may well be sent from other
+  // threads for as long as they last.
+  bool PromiseRelease(bool chunked) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (on_release_) {
+      return true;
+    }
+    if (chunked || !accepting_released_connection_) {
+      return false;
+    }
+    release_promised_ = true;
+    return true;
+  }
+
+  // Called once the promised response is sent, or has failed to be, with the connection released if it was sent.
+  void Release(Connection& connection, std::vector<char>&& pipelined_data) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      release_promised_ = false;
+      if (!accepting_released_connection_) {
+        return;
+      }
+      pipelined_data_ = std::move(pipelined_data);
+      released_connection_.reset(new Connection(std::move(connection)));
+    }
+    release_promised_cv_.notify_all();
+    if (on_release_) {
+      on_release_();
+    }
+  }
+  void BreakPromise() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      release_promised_ = false;
+    }
+    release_promised_cv_.notify_all();
+  }
+
+  const HTTPKeepAliveParams params_;
+  size_t requests_served_ = 0u;
+  std::vector<char> pipelined_data_;
+  std::mutex mutex_;
+  bool accepting_released_connection_ = true;
+  bool release_promised_ = false;
+  std::condition_variable release_promised_cv_;
+  std::unique_ptr<Connection> released_connection_;
+  std::function<void()> on_release_;
+};
+
 template <class HTTP_REQUEST_DATA>
 class GenericHTTPServerConnection final : public HTTPResponder {
  public:
-  // The only constructor parses HTTP headers coming from the socket
+  // The constructor parses HTTP headers coming from the socket
   // in the constructor of `message_(connection_)`.
   GenericHTTPServerConnection(
       Connection&& c,
       const typename HTTP_REQUEST_DATA::ConstructionParams& params = typename HTTP_REQUEST_DATA::ConstructionParams(),
       const int initial_buffer_size = 16 * 1024 + 1,
       const double buffer_growth_k = 1.95)
-      : connection_(std::move(c)), message_(connection_, params, initial_buffer_size, buffer_growth_k) {}
+      : GenericHTTPServerConnection(std::move(c), nullptr, params, initial_buffer_size, buffer_growth_k) {}
+
+  // With `keep_alive` set, the connection may be released to serve more requests, see `HTTPKeepAliveState`.
+  GenericHTTPServerConnection(
+      Connection&& c,
+      std::shared_ptr<HTTPKeepAliveState> keep_alive,
+      const typename HTTP_REQUEST_DATA::ConstructionParams& params = typename HTTP_REQUEST_DATA::ConstructionParams(),
+      const int initial_buffer_size = 16 * 1024 + 1,
+      const double buffer_growth_k = 1.95)
+      : connection_(std::move(c)),
+        keep_alive_state_(std::move(keep_alive)),
+        message_(connection_,
+                 params,
+                 initial_buffer_size,
+                 buffer_growth_k,
+                 keep_alive_state_ ? keep_alive_state_->TakePipelinedData() : std::vector<char>()),
+        keep_alive_(keep_alive_state_ && keep_alive_state_->CanServeOneMoreRequest() &&
+                    message_.KeepAliveRequested()) {}
+
   ~GenericHTTPServerConnection() {
+    if (release_promised_) {
+      // Either way, the serving loop waiting for the promised connection is to be let go.
+      if (responded_ && response_complete_) {
+        keep_alive_state_->Release(connection_, message_.PipelinedData());
+      } else {
+        keep_alive_state_->BreakPromise();
+      }
+    }
     if (!responded_) {
       // If a user code throws an exception in a different thread, it will not be caught.
       // But, at least, capitalized "INTERNAL SERVER ERROR" will be returned.
@@ -571,24 +981,34 @@ class GenericHTTPServerConnection final : public HTTPResponder {
     if (responded_) {
       CURRENT_THROW(AttemptedToSendHTTPResponseMoreThanOnce());
     } else {
-      HTTPResponder::SendHTTPResponse(connection_, std::forward<ARGS>(args)...);
+      release_promised_ = keep_alive_ && keep_alive_state_->PromiseRelease(false);
+      HTTPResponder::SendHTTPResponse(
+          ResponseConnection(connection_, release_promised_ ? ConnectionKeepAlive : ConnectionClose),
+          std::forward<ARGS>(args)...);
       responded_ = true;
+      response_complete_ = true;
     }
   }
 
   // The wrapper to send HTTP response in chunks.
   struct ChunkedResponseSender final {
-    // `struct Impl` is the logic wrapped into an `std::unique_ptr<>` to call the destructor only once.
-    struct Impl final {
-      explicit Impl(Connection& connection) : connection_(connection) {}
-
-      ~Impl() {
+    // `struct Impl` is the logic wrapped into an `std::shared_ptr<>`, for the sender to be movable, and for the flush
+    // timer to refer to it. It is the sender, not the last owner of `Impl`, who closes the response.
+    struct Impl final : ChunkedResponseFlushTimer::Flushable, std::enable_shared_from_this<Impl> {
+      Impl(Connection& connection, bool& response_complete)
+          : connection_(connection), response_complete_(response_complete), can_no_longer_write_(false) {}
+
+      // Flushes the buffered data, and sends the "zero" chunk. Once this is done, the flush timer, which may still
+      // hold on to this `Impl`, no longer touches the connection.
+      void Close() {
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        closed_ = true;
         if (!can_no_longer_write_) {
           try {
-            connection_.BlockingWrite("0", true);
-            // Should send CRLF twice.
-            connection_.BlockingWrite(constants::kCRLF, true);
-            connection_.BlockingWrite(constants::kCRLF, false);
+            FlushFromWriteLockedSection();
+            // The "zero" chunk, followed by CRLF twice.
+            connection_.BlockingWrite("0\r\n\r\n", false);
+            response_complete_ = true;
           } catch (const SocketException& e) {                                          // LCOV_EXCL_LINE
             std::cerr << "Chunked response closure failed: " << e.what() << std::endl;  // LCOV_EXCL_LINE
           }                                                                             // LCOV_EXCL_LINE
@@ -599,21 +1019,125 @@ class GenericHTTPServerConnection final : public HTTPResponder {
       template <typename T>
       void SendImpl(T&& data) {
         if (!data.empty()) {
+          const char* bytes = reinterpret_cast<const char*>(&data[0]);
+          if (can_no_longer_write_) {
+            // A previous write has failed, possibly the delayed one of the buffered data by the flush timer.
+            CURRENT_THROW(SocketWriteException());
+          }
+          bool coalesced = false;
+          {
+            std::lock_guard<std::mutex> lock(buffer_mutex_);
+            if (coalescing_.Enabled()) {
+              coalesced = true;
+              const auto now = std::chrono::steady_clock::now();
+              if (buffer_.empty()) {
+                buffer_begin_ = now;
+                if (coalescing_.max_delay.count() > 0) {
+                  current::Singleton<ChunkedResponseFlushTimer>().Schedule(buffer_begin_ + MaxDelay(),
+                                                                           this->shared_from_this());
+                }
+              }
+              buffer_.append(bytes, data.size());
+              if (buffer_.length() < coalescing_.max_bytes &&
+                  (coalescing_.max_delay.count() == 0 || now - buffer_begin_ < MaxDelay())) {
+                return;
+              }
+            }
+          }
+          std::lock_guard<std::mutex> write_lock(write_mutex_);
+          if (coalesced) {
+            FlushFromWriteLockedSection();
+          } else {
+            WriteChunk(bytes, data.size());
+          }
+        }
+      }
+
+      void Flush() {
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        FlushFromWriteLockedSection();
+      }
+
+      void SetCoalescing(const ChunkedResponseCoalescing& coalescing) {
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        FlushFromWriteLockedSection();
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        coalescing_ = coalescing;
+      }
+
+      // Called by the flush timer. The buffered data may have been sent, and more data may have been buffered since
+      // the deadline was scheduled, in which case the newly buffered data is due by the deadline of its own.
+      // Never blocks: if the sender is writing, it flushes the buffered data by itself, and the socket is only
+      // written to as much as it takes right away, with the rest of the chunk kept in `unsent_`.
+      void FlushIfDue() override {
+        std::unique_lock<std::mutex> write_lock(write_mutex_, std::try_to_lock);
+        if (!write_lock.owns_lock() || closed_ || can_no_longer_write_) {
+          return;
+        }
+        while (true) {
+          if (unsent_.empty()) {
+            std::lock_guard<std::mutex> lock(buffer_mutex_);
+            if (buffer_.empty() || std::chrono::steady_clock::now() - buffer_begin_ < MaxDelay()) {
+              return;
+            }
+            unsent_ = strings::Printf("%lX", buffer_.length()) + constants::kCRLF;
+            unsent_.append(buffer_);
+            unsent_.append(constants::kCRLF, constants::kCRLFLength);
+            buffer_.clear();
+          }
           try {
-            connection_.BlockingWrite(strings::Printf("%lX", data.size()), true);
-            connection_.BlockingWrite(constants::kCRLF, true);
-            connection_.BlockingWrite(std::forward<T>(data), true);
-            // Force every chunk to be sent out by passing `false` as the second argument.
-            connection_.BlockingWrite(constants::kCRLF, false);
+            unsent_.erase(0u, connection_.NonBlockingWrite(unsent_.data(), unsent_.length()));
           } catch (const SocketException&) {
-            // For chunked HTTP responses, if the receiving end has closed the connection,
-            // as detected during `Send`, suppress logging about the failure to send the final "zero" chunk.
+            // Reported by the next `Send()`.
             can_no_longer_write_ = true;
-            throw;
+            return;
+          }
+          if (!unsent_.empty()) {
+            // The receiver is not keeping up. Retry later, unless the sender writes first.
+            current::Singleton<ChunkedResponseFlushTimer>().Schedule(std::chrono::steady_clock::now() + MaxDelay(),
+                                                                     this->shared_from_this());
+            return;
           }
         }
       }
 
+      // Takes the buffered data out, and writes it with `buffer_mutex_` released, so that it is not held up by a write.
+      void FlushFromWriteLockedSection() {
+        chunk_.clear();
+        {
+          std::lock_guard<std::mutex> lock(buffer_mutex_);
+          chunk_.swap(buffer_);
+        }
+        WriteChunk(chunk_.data(), chunk_.length());
+      }
+
+      std::chrono::steady_clock::duration MaxDelay() const {
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(coalescing_.max_delay);
+      }
+
+      // Writes what the flush timer has left unsent, if anything, and then the chunk, unless it is empty.
+      // The chunk header, the data, and the trailing CRLF are written at once.
+      // Every chunk is sent out right away, as `false` is passed as the `more` argument.
+      void WriteChunk(const char* data, size_t size) {
+        try {
+          if (!unsent_.empty()) {
+            connection_.BlockingWrite(unsent_, false);
+            unsent_.clear();
+          }
+          if (size) {
+            const std::string header = strings::Printf("%lX", size) + constants::kCRLF;
+            const Connection::ConstBuffer buffers[3] = {
+                {header.data(), header.length()}, {data, size}, {constants::kCRLF, constants::kCRLFLength}};
+            connection_.BlockingWriteV(buffers, 3u, false);
+          }
+        } catch (const SocketException&) {
+          // For chunked HTTP responses, if the receiving end has closed the connection,
+          // as detected during `Send`, suppress logging about the failure to send the final "zero" chunk.
+          can_no_longer_write_ = true;
+          throw;
+        }
+      }
+
       // Only support STL containers of chars and bytes, this does not yet cover std::string.
       template <typename T>
       inline ENABLE_IF<std::is_same<typename T::value_type, char>::value ||
@@ -637,7 +1161,18 @@ class GenericHTTPServerConnection final : public HTTPResponder {
       }
 
       Connection& connection_;
-      bool can_no_longer_write_ = false;
+      bool& response_complete_;
+      std::atomic_bool can_no_longer_write_;
+      // Serializes the writes of the sender and of the flush timer, and guards `chunk_`, `unsent_`, and `closed_`.
+      std::mutex write_mutex_;
+      std::string chunk_;
+      std::string unsent_;  // The tail of the chunk the flush timer could not write without blocking.
+      bool closed_ = false;
+      // Guards the data being buffered. Never held across a write.
+      std::mutex buffer_mutex_;
+      ChunkedResponseCoalescing coalescing_;
+      std::string buffer_;
+      std::chrono::steady_clock::time_point buffer_begin_;
 
       Impl() = delete;
       Impl(const Impl&) = delete;
@@ -646,7 +1181,15 @@ class GenericHTTPServerConnection final : public HTTPResponder {
       void operator=(Impl&&) = delete;
     };
 
-    explicit ChunkedResponseSender(Connection& connection) : impl_(new Impl(connection)) {}
+    ChunkedResponseSender(Connection& connection, bool& response_complete)
+        : impl_(std::make_shared<Impl>(connection, response_complete)) {}
+    ChunkedResponseSender(ChunkedResponseSender&&) = default;
+
+    ~ChunkedResponseSender() {
+      if (impl_) {
+        impl_->Close();
+      }
+    }
 
     template <typename T>
     inline ChunkedResponseSender& Send(T&& data) {
@@ -672,7 +1215,19 @@ class GenericHTTPServerConnection final : public HTTPResponder {
       return *this;
     }
 
-    std::unique_ptr<Impl> impl_;
+    // Sends the data buffered so far, if any, right away.
+    inline ChunkedResponseSender& Flush() {
+      impl_->Flush();
+      return *this;
+    }
+
+    // Changes how the subsequent data is coalesced into chunks. Flushes the data buffered so far.
+    inline ChunkedResponseSender& SetCoalescing(const ChunkedResponseCoalescing& coalescing) {
+      impl_->SetCoalescing(coalescing);
+      return *this;
+    }
+
+    std::shared_ptr<Impl> impl_;
   };
 
   inline ChunkedResponseSender SendChunkedHTTPResponse(
@@ -683,11 +1238,14 @@ class GenericHTTPServerConnection final : public HTTPResponder {
       CURRENT_THROW(AttemptedToSendHTTPResponseMoreThanOnce());
     } else {
       responded_ = true;
+      release_promised_ = keep_alive_ && keep_alive_state_->PromiseRelease(true);
       std::ostringstream os;
-      PrepareHTTPResponseHeader(os, ConnectionKeepAlive, code, content_type, extra_headers);
+      // As with the regular responses, the connection is only declared persistent if it will be reused.
+      PrepareHTTPResponseHeader(
+          os, release_promised_ ? ConnectionKeepAlive : ConnectionClose, code, content_type, extra_headers);
       os << "Transfer-Encoding: chunked" << constants::kCRLF << constants::kCRLF;
       connection_.BlockingWrite(os.str(), true);
-      return ChunkedResponseSender(connection_);
+      return ChunkedResponseSender(connection_, response_complete_);
     }
   }
 
@@ -709,14 +1267,21 @@ class GenericHTTPServerConnection final : public HTTPResponder {
 
  private:
   bool responded_ = false;
+  // Set once the response has been sent in full, so that the connection can be kept alive.
+  bool response_complete_ = false;
   Connection connection_;
+  std::shared_ptr<HTTPKeepAliveState> keep_alive_state_;
   GenericHTTPRequestData<HTTP_REQUEST_DATA> message_;
+  // Whether the connection can be kept alive, as requested by the client and allowed by the server.
+  const bool keep_alive_;
+  // Whether the response says `Connection: keep-alive`, and the connection is to be released once it is sent.
+  bool release_promised_ = false;
 
   // Disable any copy/move support for extra safety.
   GenericHTTPServerConnection(const GenericHTTPServerConnection&) = delete;
   GenericHTTPServerConnection(const Connection&) = delete;
   GenericHTTPServerConnection(GenericHTTPServerConnection&&) = delete;
-  // The only legit constructor is `GenericHTTPServerConnection(Connection&&)`.
+  // The only legit constructors are `GenericHTTPServerConnection(Connection&&[, keep_alive])`.
   void operator=(const Connection&) = delete;
   void operator=(const GenericHTTPServerConnection&) = delete;
   void operator=(Connection&&) = delete;
@@ -35,6 +35,7 @@ SOFTWARE.
 
 #include "../../../3rdparty/gtest/gtest-main-with-dflags.h"
 
+#include "../../strings/join.h"
 #include "../../strings/printf.h"
 
 DEFINE_int32(net_http_test_port, PickPortForUnitTest(), "Local port to use for the test HTTP server.");
@@ -52,6 +53,9 @@ using current::net::SocketException;
 using current::net::ConnectionResetByPeer;
 using current::net::ChunkSizeNotAValidHEXValue;
 using current::net::AttemptedToSendHTTPResponseMoreThanOnce;
+using current::net::HTTPKeepAliveParams;
+using current::net::HTTPKeepAliveState;
+using current::net::ChunkedResponseCoalescing;
 
 static void ExpectToReceive(const std::string& golden, Connection& connection) {
   std::vector<char> response(golden.length());
@@ -224,7 +228,7 @@ TEST(PosixHTTPServerTest, SmokeChunkedResponse) {
   ExpectToReceive(
       "HTTP/1.1 200 OK\r\n"
       "Content-Type: application/json; charset=utf-8\r\n"
-      "Connection: keep-alive\r\n"
+      "Connection: close\r\n"
       "Access-Control-Allow-Origin: *\r\n"
       "Transfer-Encoding: chunked\r\n"
       "\r\n"
@@ -241,6 +245,243 @@ TEST(PosixHTTPServerTest, SmokeChunkedResponse) {
   t.join();
 }
 
+TEST(PosixHTTPServerTest, CoalescedChunkedResponse) {
+  std::thread t([](Socket s) {
+    HTTPServerConnection c(s.Accept());
+    auto r = c.SendChunkedHTTPResponse();
+    r.SetCoalescing(ChunkedResponseCoalescing(8u, std::chrono::seconds(100)));
+    // Coalesced until there are at least eight bytes.
+    r.Send("one").Send("two").Send("three");
+    // Sent as is after an explicit `Flush()`.
+    r.Send("four").Flush();
+    // Sent by the timer once the oldest piece of data has been waiting long enough, with no more `Send()`-s.
+    r.SetCoalescing(ChunkedResponseCoalescing(100u, std::chrono::milliseconds(20)));
+    r.Send("five").Send("six");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    // With no `max_delay`, coalesced until there are enough bytes, however long it takes.
+    r.SetCoalescing(ChunkedResponseCoalescing(10u));
+    r.Send("eight");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    r.Send("nine").Send("ten");
+    // Flushed before the response is closed.
+    r.Send("seven");
+  }, Socket(FLAGS_net_http_test_port));
+  Connection connection(ClientSocket("localhost", FLAGS_net_http_test_port));
+  connection.BlockingWrite("GET /coalesced HTTP/1.1\r\n", true);
+  connection.BlockingWrite("Host: localhost\r\n", true);
+  connection.BlockingWrite("\r\n", false);
+  ExpectToReceive(
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: application/json; charset=utf-8\r\n"
+      "Connection: close\r\n"
+      "Access-Control-Allow-Origin: *\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n"
+      "B\r\n"
+      "onetwothree\r\n"
+      "4\r\n"
+      "four\r\n"
+      "7\r\n"
+      "fivesix\r\n"
+      "C\r\n"
+      "eightnineten\r\n"
+      "5\r\n"
+      "seven\r\n"
+      "0\r\n",
+      connection);
+  t.join();
+}
+
+// The delayed flush of one response is not held up by another response, the receiver of which does not read.
+TEST(PosixHTTPServerTest, CoalescedChunkedResponseStalledReceiver) {
+  const std::string big_chunk(32 * 1024 * 1024, '.');
+  std::atomic_bool small_chunk_received(false);
+  std::thread t([&big_chunk, &small_chunk_received](Socket s) {
+    HTTPServerConnection stalled(s.Accept());
+    HTTPServerConnection other(s.Accept());
+    auto stalled_response = stalled.SendChunkedHTTPResponse();
+    stalled_response.SetCoalescing(ChunkedResponseCoalescing(big_chunk.length() + 1u, std::chrono::milliseconds(1)));
+    stalled_response.Send(big_chunk);
+    // Give the timer the time to fill up the socket buffers of the stalled connection.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto other_response = other.SendChunkedHTTPResponse();
+    other_response.SetCoalescing(ChunkedResponseCoalescing(100u, std::chrono::milliseconds(1)));
+    other_response.Send("small");
+    while (!small_chunk_received) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }, Socket(FLAGS_net_http_test_port));
+  const std::string golden_header =
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: application/json; charset=utf-8\r\n"
+      "Connection: close\r\n"
+      "Access-Control-Allow-Origin: *\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n";
+  Connection stalled_connection(ClientSocket("localhost", FLAGS_net_http_test_port));
+  stalled_connection.BlockingWrite("GET /stalled HTTP/1.1\r\nHost: localhost\r\n\r\n", false);
+  Connection other_connection(ClientSocket("localhost", FLAGS_net_http_test_port));
+  other_connection.BlockingWrite("GET /other HTTP/1.1\r\nHost: localhost\r\n\r\n", false);
+  ExpectToReceive(golden_header + "5\r\nsmall\r\n", other_connection);
+  small_chunk_received = true;
+  ExpectToReceive(golden_header + "2000000\r\n" + big_chunk + "\r\n0\r\n", stalled_connection);
+  t.join();
+}
+
+TEST(PosixHTTPServerTest, KeepAliveAndPipelining) {
+  std::vector<std::string> served;
+  std::thread t([&served](Socket s) {
+    const auto keep_alive = std::make_shared<HTTPKeepAliveState>(HTTPKeepAliveParams(4u));
+    std::unique_ptr<Connection> connection(new Connection(s.Accept()));
+    while (connection) {
+      {
+        HTTPServerConnection c(std::move(*connection), keep_alive);
+        const std::string request = c.HTTPRequest().Method() + ' ' + c.HTTPRequest().RawPath();
+        served.push_back(request + ' ' + c.HTTPRequest().Body());
+        if (c.HTTPRequest().RawPath() == "/chunked") {
+          c.SendChunkedHTTPResponse(HTTPResponseCode.OK, "text/plain", current::net::http::Headers())("foo")("bar");
+        } else {
+          c.SendHTTPResponse(request);
+        }
+      }
+      connection = keep_alive->TakeReleasedConnection();
+    }
+  }, Socket(FLAGS_net_http_test_port));
+  Connection connection(ClientSocket("localhost", FLAGS_net_http_test_port));
+  // All five requests are sent at once. The fourth one asks to close the connection, so the fifth one is ignored.
+  connection.BlockingWrite(
+      "GET /one HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "\r\n"
+      "POST /two HTTP/1.1\r\n"
+      "Content-Length: 4\r\n"
+      "\r\n"
+      "BODY"
+      "GET /four HTTP/1.1\r\n"
+      "Connection: close\r\n"
+      "\r\n"
+      "GET /five HTTP/1.1\r\n"
+      "\r\n",
+      false);
+  ExpectToReceive(
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: text/plain\r\n"
+      "Connection: keep-alive\r\n"
+      "Content-Length: 8\r\n"
+      "\r\n"
+      "GET /one"
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: text/plain\r\n"
+      "Connection: keep-alive\r\n"
+      "Content-Length: 9\r\n"
+      "\r\n"
+      "POST /two"
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: text/plain\r\n"
+      "Connection: close\r\n"
+      "Content-Length: 9\r\n"
+      "\r\n"
+      "GET /four",
+      connection);
+  t.join();
+  EXPECT_EQ("GET /one |POST /two BODY|GET /four ", current::strings::Join(served, '|'));
+}
+
+TEST(PosixHTTPServerTest, KeepAliveNotPromisedOnceGivenUp) {
+  std::vector<std::string> served;
+  // The response sent once the serving loop is done with the request, as if from another thread, says so.
+  std::thread t([&served](Socket s) {
+    const auto keep_alive = std::make_shared<HTTPKeepAliveState>(HTTPKeepAliveParams(4u));
+    std::unique_ptr<Connection> connection(new Connection(s.Accept()));
+    while (connection) {
+      std::unique_ptr<HTTPServerConnection> c(new HTTPServerConnection(std::move(*connection), keep_alive));
+      served.push_back(c->HTTPRequest().RawPath());
+      if (c->HTTPRequest().RawPath() != "/later") {
+        c->SendHTTPResponse(c->HTTPRequest().RawPath());
+        c = nullptr;
+      }
+      connection = keep_alive->TakeReleasedConnection();
+      if (c) {
+        c->SendHTTPResponse("/later");
+      }
+    }
+  }, Socket(FLAGS_net_http_test_port));
+  {
+    Connection connection(ClientSocket("localhost", FLAGS_net_http_test_port));
+    connection.BlockingWrite("GET /one HTTP/1.1\r\n\r\nGET /later HTTP/1.1\r\n\r\nGET /two HTTP/1.1\r\n\r\n", false);
+    ExpectToReceive(
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain\r\n"
+        "Connection: keep-alive\r\n"
+        "Content-Length: 4\r\n"
+        "\r\n"
+        "/one"
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain\r\n"
+        "Connection: close\r\n"
+        "Content-Length: 6\r\n"
+        "\r\n"
+        "/later",
+        connection);
+  }
+  t.join();
+  // The chunked response, which may well be sent from another thread for as long as it lasts, is not waited for.
+  std::thread t2([&served](Socket s) {
+    const auto keep_alive = std::make_shared<HTTPKeepAliveState>(HTTPKeepAliveParams(4u));
+    HTTPServerConnection c(s.Accept(), keep_alive);
+    served.push_back(c.HTTPRequest().RawPath());
+    c.SendChunkedHTTPResponse(HTTPResponseCode.OK, "text/plain", current::net::http::Headers())("foo");
+  }, Socket(FLAGS_net_http_test_port));
+  {
+    Connection connection(ClientSocket("localhost", FLAGS_net_http_test_port));
+    connection.BlockingWrite("GET /chunked HTTP/1.1\r\n\r\nGET /two HTTP/1.1\r\n\r\n", false);
+    ExpectToReceive(
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain\r\n"
+        "Connection: close\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "3\r\n"
+        "foo\r\n"
+        "0\r\n"
+        "\r\n",
+        connection);
+  }
+  t2.join();
+  EXPECT_EQ("/one,/later,/chunked", current::strings::Join(served, ','));
+}
+
+TEST(PosixHTTPServerTest, KeepAliveRequestsCap) {
+  std::thread t([](Socket s) {
+    const auto keep_alive = std::make_shared<HTTPKeepAliveState>(HTTPKeepAliveParams(2u));
+    std::unique_ptr<Connection> connection(new Connection(s.Accept()));
+    while (connection) {
+      {
+        HTTPServerConnection c(std::move(*connection), keep_alive);
+        c.SendHTTPResponse(c.HTTPRequest().RawPath());
+      }
+      connection = keep_alive->TakeReleasedConnection();
+    }
+  }, Socket(FLAGS_net_http_test_port));
+  Connection connection(ClientSocket("localhost", FLAGS_net_http_test_port));
+  connection.BlockingWrite("GET /1 HTTP/1.1\r\n\r\nGET /2 HTTP/1.1\r\n\r\nGET /3 HTTP/1.1\r\n\r\n", false);
+  ExpectToReceive(
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: text/plain\r\n"
+      "Connection: keep-alive\r\n"
+      "Content-Length: 2\r\n"
+      "\r\n"
+      "/1"
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: text/plain\r\n"
+      "Connection: close\r\n"
+      "Content-Length: 2\r\n"
+      "\r\n"
+      "/2",
+      connection);
+  t.join();
+}
+
 TEST(PosixHTTPServerTest, SmokeWithHeaders) {
   std::thread t([](Socket s) {
     HTTPServerConnection c(s.Accept());
@@ -271,6 +512,47 @@ TEST(PosixHTTPServerTest, SmokeWithHeaders) {
   t.join();
 }
 
+TEST(PosixHTTPServerTest, ParsedInPlace) {
+  const std::string message =
+      "GET /path?a=1&b=%20 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "X-Foo:   bar  \r\n"
+      "Cookie: x=1; y=2\r\n"
+      "Content-Length: 4\r\n"
+      "\r\n"
+      "BODY";
+  // The small initial buffer gets reallocated while the headers are still the views into it.
+  for (const int initial_buffer_size : {16 * 1024 + 1, 8}) {
+    std::thread t([initial_buffer_size](Socket s) {
+      Connection c(s.Accept());
+      const HTTPRequestData data(c, HTTPRequestData::ConstructionParams(), initial_buffer_size);
+      EXPECT_EQ("GET", data.Method());
+      EXPECT_EQ("/path?a=1&b=%20", std::string(data.RawPathView()));
+      EXPECT_EQ("a=1&b=%20", std::string(data.QueryView()));
+      EXPECT_EQ("/path?a=1&b=%20", data.RawPath());
+      EXPECT_EQ("/path", data.URL().path);
+      EXPECT_EQ(" ", data.URL().query["b"]);
+      // The headers are materialized on the first access, which may well be from several threads at once.
+      std::vector<std::thread> readers;
+      for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&data]() {
+          EXPECT_EQ(3u, data.headers().size());
+          EXPECT_EQ("bar", data.headers().Get("X-Foo"));
+          EXPECT_EQ("x=1; y=2", data.headers().CookiesAsString());
+        });
+      }
+      for (auto& reader : readers) {
+        reader.join();
+      }
+      EXPECT_EQ("BODY", data.Body());
+      EXPECT_TRUE(data.KeepAliveRequested());
+    }, Socket(FLAGS_net_http_test_port));
+    Connection connection(ClientSocket("localhost", FLAGS_net_http_test_port));
+    connection.BlockingWrite(message, false);
+    t.join();
+  }
+}
+
 TEST(PosixHTTPServerTest, SmokeWithLowercaseContentLength) {
   std::thread t([](Socket s) {
     HTTPServerConnection c(s.Accept());
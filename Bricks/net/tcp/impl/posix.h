@@ -34,7 +34,9 @@ SOFTWARE.
 #include "../../../util/singleton.h"
 #include "../../../template/enable_if.h"
 
+#include <chrono>
 #include <cstring>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -45,7 +47,9 @@ SOFTWARE.
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 // Bricks uses `SOCKET` for socket handles in *nix.
@@ -165,6 +169,10 @@ class SocketHandle : private SocketSystemInitializer {
 
   // SocketHandle does not expose copy constructor and assignment operator. It should only be moved.
 
+ protected:
+  // Gives up the ownership of the socket, so that it is not closed by the destructor.
+  inline void ReleaseSocket() { socket_ = static_cast<SOCKET>(-1); }
+
  private:
 #ifndef CURRENT_WINDOWS
   SOCKET socket_;
@@ -247,10 +255,63 @@ class Connection : public SocketHandle {
 
   Connection(Connection&& rhs) = default;
 
+  // Event-driven servers do not block on writes. Instead, the data written into the connection is queued,
+  // and sent out as the socket becomes writable. Once the connection is destructed, it is the queue that
+  // closes the socket, after the queued data has been sent out, or keeps serving it.
+  class WriteQueue {
+   public:
+    virtual ~WriteQueue() = default;
+    virtual void Write(const void* buffer, size_t write_length, bool more) = 0;
+    virtual void Close() = 0;
+  };
+
+  ~Connection() {
+    if (write_queue_) {
+      ReleaseSocket();
+      write_queue_->Close();
+    }
+  }
+
+  void SetWriteQueue(std::shared_ptr<WriteQueue> write_queue) { write_queue_ = std::move(write_queue); }
+
   const IPAndPort& LocalIPAndPort() const { return local_ip_and_port_; }
 
   const IPAndPort& RemoteIPAndPort() const { return remote_ip_and_port_; }
 
+  // Waits for up to `timeout` for the data to read, or for the connection to be closed by the peer.
+  // Returns `false` if neither has happened, so that reading from the connection would block.
+  inline bool WaitUntilReadable(std::chrono::milliseconds timeout) {
+#ifndef CURRENT_WINDOWS
+    pollfd fd;
+    fd.fd = socket;
+    fd.events = POLLIN;
+    fd.revents = 0;
+    return ::poll(&fd, 1, static_cast<int>(timeout.count())) > 0;
+#else
+    WSAPOLLFD fd;
+    fd.fd = socket;
+    fd.events = POLLRDNORM;
+    fd.revents = 0;
+    return ::WSAPoll(&fd, 1, static_cast<int>(timeout.count())) > 0;
+#endif
+  }
+
+  // Tells, without blocking, whether the peer has closed the connection, so that the next read would hit the EOF
+  // or fail. Peeks into the socket to tell this apart from the data that is just waiting to be read.
+  inline bool ClosedByPeer() {
+    if (!WaitUntilReadable(std::chrono::milliseconds(0))) {
+      return false;
+    }
+    char c;
+#ifndef CURRENT_WINDOWS
+    const ssize_t retval = ::recv(socket, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return retval == 0 || (retval < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+#else
+    const int retval = ::recv(socket, &c, 1, MSG_PEEK);
+    return retval == 0 || (retval < 0 && ::WSAGetLastError() != WSAEWOULDBLOCK);
+#endif
+  }
+
   // By default, BlockingRead() will return as soon as some data has been read,
   // with the exception being multibyte records (sizeof(T) > 1), where it will keep reading
   // until the boundary of the records, or max_length of them, has been read.
@@ -373,6 +434,10 @@ class Connection : public SocketHandle {
     static_cast<void>(more);  // Supress the 'unused parameter' warning.
 #endif
     CURRENT_ASSERT(buffer);
+    if (write_queue_) {
+      write_queue_->Write(buffer, write_length, more);
+      return *this;
+    }
     CURRENT_BRICKS_NET_LOG(
         "S%05d BlockingWrite(%d bytes) ...\n", static_cast<SOCKET>(socket), static_cast<int>(write_length));
 #if !defined(CURRENT_WINDOWS) && !defined(CURRENT_APPLE)
@@ -393,6 +458,82 @@ class Connection : public SocketHandle {
     return *this;
   }
 
+  // A piece of data for `BlockingWriteV()`.
+  struct ConstBuffer {
+    const void* data;
+    size_t length;
+  };
+
+  // Writes the buffers one after another, with a single `sendmsg()` call where supported.
+  inline Connection& BlockingWriteV(const ConstBuffer* buffers, size_t count, bool more) {
+#if !defined(CURRENT_WINDOWS) && !defined(CURRENT_APPLE)
+    if (!write_queue_) {
+      constexpr size_t kMaxBuffers = 8u;
+      CURRENT_ASSERT(count <= kMaxBuffers);
+      iovec iov[kMaxBuffers];
+      size_t write_length = 0u;
+      for (size_t i = 0; i < count; ++i) {
+        iov[i].iov_base = const_cast<void*>(buffers[i].data);
+        iov[i].iov_len = buffers[i].length;
+        write_length += buffers[i].length;
+      }
+      msghdr message;
+      std::memset(&message, 0, sizeof(message));
+      message.msg_iov = iov;
+      message.msg_iovlen = count;
+      CURRENT_BRICKS_NET_LOG(
+          "S%05d BlockingWriteV(%d bytes) ...\n", static_cast<SOCKET>(socket), static_cast<int>(write_length));
+      const ssize_t result = ::sendmsg(socket, &message, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      if (result < 0) {
+        CURRENT_THROW(SocketWriteException());  // LCOV_EXCL_LINE
+      } else if (static_cast<size_t>(result) != write_length) {
+        CURRENT_THROW(SocketCouldNotWriteEverythingException());  // LCOV_EXCL_LINE
+      }
+      CURRENT_BRICKS_NET_LOG(
+          "S%05d BlockingWriteV(%d bytes) : OK\n", static_cast<SOCKET>(socket), static_cast<int>(write_length));
+      return *this;
+    }
+#endif
+    for (size_t i = 0; i < count; ++i) {
+      if (buffers[i].length) {
+        BlockingWrite(buffers[i].data, buffers[i].length, more || i + 1u < count);
+      }
+    }
+    return *this;
+  }
+
+  // Writes as much of the data as the socket takes right away, and returns the number of bytes written, possibly zero.
+  // With a write queue, the whole data is queued.
+  inline size_t NonBlockingWrite(const void* buffer, size_t write_length) {
+    CURRENT_ASSERT(buffer);
+    if (write_queue_) {
+      write_queue_->Write(buffer, write_length, false);
+      return write_length;
+    }
+#ifndef CURRENT_WINDOWS
+#ifdef CURRENT_APPLE
+    const ssize_t result = ::send(socket, buffer, write_length, MSG_DONTWAIT);
+#else
+    const ssize_t result = ::send(socket, buffer, write_length, MSG_DONTWAIT | MSG_NOSIGNAL);
+#endif
+    if (result < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return 0u;
+      }
+      CURRENT_THROW(SocketWriteException());
+    }
+    CURRENT_BRICKS_NET_LOG("S%05d NonBlockingWrite(%d bytes) : %d written\n",
+                           static_cast<SOCKET>(socket),
+                           static_cast<int>(write_length),
+                           static_cast<int>(result));
+    return static_cast<size_t>(result);
+#else
+    // No per-call non-blocking sends on Windows.
+    BlockingWrite(buffer, write_length, false);
+    return write_length;
+#endif
+  }
+
   inline Connection& BlockingWrite(const char* s, bool more) {
     CURRENT_ASSERT(s);
     return BlockingWrite(s, strlen(s), more);
@@ -417,6 +558,7 @@ class Connection : public SocketHandle {
  private:
   const IPAndPort local_ip_and_port_;
   const IPAndPort remote_ip_and_port_;
+  std::shared_ptr<WriteQueue> write_queue_;
 
   Connection() = delete;
   Connection(const Connection&) = delete;
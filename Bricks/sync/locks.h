@@ -25,6 +25,7 @@ SOFTWARE.
 #ifndef CURRENT_BRICKS_UTIL_LOCK_H
 #define CURRENT_BRICKS_UTIL_LOCK_H
 
+#include <condition_variable>
 #include <mutex>
 #include <type_traits>
 
@@ -45,6 +46,69 @@ using SmartMutexLockGuard =
 static_assert(std::is_same<std::lock_guard<std::mutex>, SmartMutexLockGuard<MutexLockStatus::NeedToLock>>::value, "");
 static_assert(std::is_same<NoOpLock, SmartMutexLockGuard<MutexLockStatus::AlreadyLocked>>::value, "");
 
+// A readers-writer mutex, as `std::shared_mutex` is not available in C++11.
+// Writers are given preference: once a writer is waiting, new readers wait until it is done.
+class SharedMutex final {
+ public:
+  SharedMutex() = default;
+  SharedMutex(const SharedMutex&) = delete;
+  SharedMutex& operator=(const SharedMutex&) = delete;
+
+  void lock() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++writers_waiting_;
+    cv_.wait(lock, [this]() { return !writer_active_ && !readers_active_; });
+    --writers_waiting_;
+    writer_active_ = true;
+  }
+
+  void unlock() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      writer_active_ = false;
+    }
+    cv_.notify_all();
+  }
+
+  void lock_shared() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return !writer_active_ && !writers_waiting_; });
+    ++readers_active_;
+  }
+
+  void unlock_shared() {
+    bool notify;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      notify = !--readers_active_;
+    }
+    if (notify) {
+      cv_.notify_all();
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  size_t readers_active_ = 0u;
+  size_t writers_waiting_ = 0u;
+  bool writer_active_ = false;
+};
+
+// The `std::lock_guard` counterpart for the shared ownership of a `SharedMutex`.
+template <class MUTEX = SharedMutex>
+class SharedLockGuard final {
+ public:
+  explicit SharedLockGuard(MUTEX& mutex) : mutex_(mutex) { mutex_.lock_shared(); }
+  ~SharedLockGuard() { mutex_.unlock_shared(); }
+
+  SharedLockGuard(const SharedLockGuard&) = delete;
+  SharedLockGuard& operator=(const SharedLockGuard&) = delete;
+
+ private:
+  MUTEX& mutex_;
+};
+
 }  // namespace locks
 }  // namespace current
 
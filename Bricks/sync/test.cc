@@ -22,6 +22,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 *******************************************************************************/
 
+#include "locks.h"
 #include "scope_owned.h"
 #include "waitable_atomic.h"
 
@@ -297,3 +298,45 @@ TEST(WaitableAtomic, IntrusiveClientsCanBeTransferred) {
   auto f = [](IntrusiveClient& c) { static_cast<void>(c); };
   std::thread([&f](IntrusiveClient c) { f(c); }, object.RegisterScopedClient()).detach();
 }
+
+TEST(Locks, SharedMutex) {
+  current::locks::SharedMutex mutex;
+
+  // Readers do not block each other.
+  {
+    current::locks::SharedLockGuard<> reader1(mutex);
+    current::locks::SharedLockGuard<> reader2(mutex);
+  }
+
+  // Writers block readers, and readers block writers.
+  std::atomic_int value(0);
+  std::atomic_bool violation(false);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 1000; ++i) {
+        std::lock_guard<current::locks::SharedMutex> lock(mutex);
+        const int before = value;
+        value = before + 1;
+        if (value != before + 1) {
+          violation = true;
+        }
+      }
+    });
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 1000; ++i) {
+        current::locks::SharedLockGuard<> lock(mutex);
+        const int a = value;
+        std::this_thread::yield();
+        if (value != a) {
+          violation = true;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(4000, value);
+  EXPECT_FALSE(violation);
+}
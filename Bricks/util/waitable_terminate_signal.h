@@ -25,7 +25,9 @@ SOFTWARE.
 #ifndef BRICKS_UTIL_WAITABLE_TERMINATE_SIGNAL_H
 #define BRICKS_UTIL_WAITABLE_TERMINATE_SIGNAL_H
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <unordered_set>
@@ -71,6 +73,25 @@ class WaitableTerminateSignal {
     return stop_signal_;
   }
 
+  // Same as the above, but also returns once `deadline` has been reached.
+  template <typename F>
+  bool WaitUntil(std::unique_lock<std::mutex>& lock,
+                 std::chrono::steady_clock::time_point deadline,
+                 F&& external_condition) noexcept {
+    bool wait_done;
+    const auto stop_condition = [this, &external_condition, &wait_done]() {
+      wait_done = stop_signal_ || external_condition();
+      return wait_done;
+    };
+
+    do {
+      condition_variable_.wait_until(
+          lock, std::min(deadline, std::chrono::steady_clock::now() + std::chrono::milliseconds(25)), stop_condition);
+    } while (!wait_done && std::chrono::steady_clock::now() < deadline);
+
+    return stop_signal_;
+  }
+
  private:
   WaitableTerminateSignal(const WaitableTerminateSignal&) = delete;
 
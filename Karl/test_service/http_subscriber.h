@@ -63,6 +63,7 @@ class HTTPStreamSubscriber {
   void Thread() {
     while (!destructing_) {
       const std::string url = remote_stream_url_ + "?i=" + current::ToString(index_);
+      carried_over_data_.clear();
       try {
         HTTP(ChunkedGET(url,
                         [this](const std::string& header, const std::string& value) { OnHeader(header, value); },
@@ -79,13 +80,27 @@ class HTTPStreamSubscriber {
       has_terminate_id_ = true;
     }
   }
+  // A chunk may hold several '\n'-terminated entries, and the last one of them may continue in the next chunk.
   void OnChunk(const std::string& chunk) {
     if (destructing_) {
       return;
     }
-    const auto split = current::strings::Split(chunk, '\t');
+    carried_over_data_ += chunk;
+    size_t begin = 0u;
+    size_t end;
+    while ((end = carried_over_data_.find('\n', begin)) != std::string::npos) {
+      if (end > begin) {
+        OnLine(carried_over_data_.substr(begin, end - begin));
+      }
+      begin = end + 1u;
+    }
+    carried_over_data_.erase(0u, begin);
+  }
+
+  void OnLine(const std::string& line) {
+    const auto split = current::strings::Split(line, '\t');
     if (split.size() != 2u) {
-      std::cerr << "HTTPStreamSubscriber got malformed chunk: '" << chunk << "'." << std::endl;
+      std::cerr << "HTTPStreamSubscriber got malformed line: '" << line << "'." << std::endl;
       CURRENT_ASSERT(false);
     }
     const idxts_t idxts = ParseJSON<idxts_t>(split[0]);
@@ -105,6 +120,7 @@ class HTTPStreamSubscriber {
   std::atomic_bool has_terminate_id_;
   std::thread thread_;
   std::string terminate_id_;
+  std::string carried_over_data_;  // The beginning of the entry to be continued in the next chunk.
 };
 
 #endif  // KARL_TEST_SERVICE_HTTP_SUBSCRIBER_H
@@ -55,6 +55,10 @@ struct RemoteStreamInvalidSchemaException : SherlockException {
   using SherlockException::SherlockException;
 };
 
+struct RemoteStreamMalformedChunkException : SherlockException {
+  using SherlockException::SherlockException;
+};
+
 struct StreamTerminatedBySubscriber : SherlockException {
   using SherlockException::SherlockException;
 };
@@ -0,0 +1,268 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// `SubscriberExecutor` is the shared pool of worker threads running the subscribers of one stream, for the
+// streams configured via `UseSharedSubscriberExecutor()`, as opposed to a dedicated thread per subscriber.
+//
+// Each subscriber is a `Task`, which is either ready, being run, idle, or done. A worker picks the ready task
+// that has been waiting the longest, and gives it one turn: at most `max_entries_per_turn` entries. The task then
+// goes back to the end of the ready queue if it has more to do, or becomes idle if it has caught up with the stream.
+// Since a task is run by at most one worker at a time, the per-subscriber order of the entries is preserved.
+//
+// The stream notifies the executor of each update, i.e. new entries or a new head, by bumping its generation,
+// which is O(1) and wakes up at most one worker. An idle task has caught up with the stream as of some generation,
+// so once the generation has moved on, all the idle tasks have something to do, and are moved into the ready queue
+// at once, with no per-task checks. The idle tasks with a deadline, for the pending batches of the batched
+// subscribers to be passed on time, are also kept ordered by it, and are made ready as their deadlines pass.
+// A task signaled to terminate is made ready by `Wake()`. A worker that takes a task out of the ready queue
+// and leaves more ready tasks behind wakes up one more worker.
+
+#ifndef CURRENT_SHERLOCK_EXECUTOR_H
+#define CURRENT_SHERLOCK_EXECUTOR_H
+
+#include "../port.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace current {
+namespace sherlock {
+
+// The outcome of one turn of the subscriber.
+enum class SubscriberTurnResult : int { MoreToDo = 0, Idle = 1, Done = 2 };
+
+class SubscriberExecutor final {
+ public:
+  class Task;
+
+ private:
+  using deadlines_t = std::multimap<std::chrono::steady_clock::time_point, Task*>;
+
+ public:
+  class Task {
+   public:
+    virtual ~Task() = default;
+
+    // When the idle task will have something to do even if nothing happens to the stream. Called with the stream
+    // mutex locked.
+    virtual std::chrono::steady_clock::time_point IdleDeadlineFromLockedSection() const {
+      return std::chrono::steady_clock::time_point::max();
+    }
+
+    // Runs the subscriber, passing at most `max_entries` entries to it. Called with no locks held.
+    virtual SubscriberTurnResult RunTurn(size_t max_entries) = 0;
+
+    // Called with no locks held, once, after the turn that has returned `Done`.
+    virtual void OnDone() = 0;
+
+   private:
+    friend class SubscriberExecutor;
+    enum class State : int { Ready = 0, Running = 1, Idle = 2, Done = 3 };
+    State state_ = State::Ready;
+    std::list<Task*>::iterator idle_it_;  // Valid while idle.
+    deadlines_t::iterator deadline_it_;   // Valid while idle, if `has_deadline_`.
+    bool has_deadline_ = false;
+    bool woken_while_running_ = false;
+  };
+
+  SubscriberExecutor() = delete;
+  SubscriberExecutor(const SubscriberExecutor&) = delete;
+  SubscriberExecutor& operator=(const SubscriberExecutor&) = delete;
+
+  // `mutex` is the stream mutex, which guards the state of the executor as well.
+  explicit SubscriberExecutor(std::mutex& mutex) : mutex_(mutex), started_(false) {}
+
+  // By the time the executor is destructed, all the tasks are done, as they hold on to the stream.
+  ~SubscriberExecutor() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (std::thread& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  // Returns `false` if the executor has already been started.
+  bool Start(size_t workers_count, size_t max_entries_per_turn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started_) {
+      return false;
+    }
+    started_ = true;
+    max_entries_per_turn_ = std::max(max_entries_per_turn, static_cast<size_t>(1u));
+    for (size_t i = 0; i < std::max(workers_count, static_cast<size_t>(1u)); ++i) {
+      workers_.emplace_back(&SubscriberExecutor::Worker, this);
+    }
+    return true;
+  }
+
+  bool Started() const { return started_; }
+
+  void Add(Task& task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task.state_ = Task::State::Ready;
+    ready_.push_back(&task);
+    work_cv_.notify_one();
+  }
+
+  // To be called by the stream, with its mutex locked, once it has new entries or a new head.
+  void NotifyOfStreamUpdateFromLockedSection() {
+    ++generation_;
+    if (!idle_.empty()) {
+      work_cv_.notify_one();
+    }
+  }
+
+  // Makes the task ready if it is idle, or once its current turn is over if it is running.
+  // To be called after signaling the task to terminate.
+  void Wake(Task& task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (task.state_ == Task::State::Idle) {
+      MakeReadyFromLockedSection(task);
+      work_cv_.notify_one();
+    } else if (task.state_ == Task::State::Running) {
+      task.woken_while_running_ = true;
+    }
+  }
+
+  // Blocks until the task is done. Must not be called from within a task run by this executor.
+  void WaitUntilDone(Task& task) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [&task]() { return task.state_ == Task::State::Done; });
+  }
+
+ private:
+  void Worker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      while (!stopping_ && !PromoteIdleTasksFromLockedSection()) {
+        if (deadlines_.empty()) {
+          work_cv_.wait(lock);
+        } else {
+          work_cv_.wait_until(lock, deadlines_.begin()->first);
+        }
+      }
+      if (stopping_) {
+        return;
+      }
+      Task* task = ready_.front();
+      ready_.pop_front();
+      task->state_ = Task::State::Running;
+      task->woken_while_running_ = false;
+      if (!ready_.empty()) {
+        work_cv_.notify_one();
+      }
+      const uint64_t generation = generation_;
+
+      lock.unlock();
+      const SubscriberTurnResult result = task->RunTurn(max_entries_per_turn_);
+      if (result == SubscriberTurnResult::Done) {
+        task->OnDone();
+      }
+      lock.lock();
+
+      if (result == SubscriberTurnResult::MoreToDo ||
+          (result == SubscriberTurnResult::Idle && (generation_ != generation || task->woken_while_running_))) {
+        // The stream may have been updated, or the task woken up, after the task has seen it,
+        // so an idle task may still have something to do.
+        task->state_ = Task::State::Ready;
+        ready_.push_back(task);
+      } else if (result == SubscriberTurnResult::Idle) {
+        MakeIdleFromLockedSection(*task);
+      } else {
+        // The task may be destructed right after it is marked as done.
+        task->state_ = Task::State::Done;
+        done_cv_.notify_all();
+      }
+    }
+  }
+
+  // The task has caught up with the stream as of its current generation.
+  void MakeIdleFromLockedSection(Task& task) {
+    if (idle_.empty()) {
+      idle_generation_ = generation_;
+    }
+    task.state_ = Task::State::Idle;
+    task.idle_it_ = idle_.insert(idle_.end(), &task);
+    const std::chrono::steady_clock::time_point deadline = task.IdleDeadlineFromLockedSection();
+    task.has_deadline_ = (deadline != std::chrono::steady_clock::time_point::max());
+    if (task.has_deadline_) {
+      task.deadline_it_ = deadlines_.emplace(deadline, &task);
+    }
+  }
+
+  void MakeReadyFromLockedSection(Task& task) {
+    idle_.erase(task.idle_it_);
+    if (task.has_deadline_) {
+      deadlines_.erase(task.deadline_it_);
+    }
+    task.state_ = Task::State::Ready;
+    ready_.push_back(&task);
+  }
+
+  // Moves the idle tasks that have something to do into the ready queue: all of them if the stream has been updated
+  // since they went idle, otherwise the ones whose deadlines have passed. Returns whether there is a ready task.
+  bool PromoteIdleTasksFromLockedSection() {
+    if (idle_generation_ != generation_) {
+      idle_generation_ = generation_;
+      while (!idle_.empty()) {
+        MakeReadyFromLockedSection(*idle_.front());
+      }
+    } else if (!deadlines_.empty()) {
+      const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+        MakeReadyFromLockedSection(*deadlines_.begin()->second);
+      }
+    }
+    return !ready_.empty();
+  }
+
+  std::mutex& mutex_;
+  std::condition_variable work_cv_;  // Notified once there may be a ready task for one more worker.
+  std::condition_variable done_cv_;
+  bool stopping_ = false;
+  std::atomic_bool started_;
+  size_t max_entries_per_turn_ = 0u;
+  uint64_t generation_ = 0u;       // Bumped on each update of the stream.
+  uint64_t idle_generation_ = 0u;  // The generation as of which the tasks in `idle_` have caught up with the stream.
+  std::deque<Task*> ready_;
+  std::list<Task*> idle_;
+  deadlines_t deadlines_;  // The deadlines of the idle tasks that have them, the earliest first.
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace current::sherlock
+}  // namespace current
+
+#endif  // CURRENT_SHERLOCK_EXECUTOR_H
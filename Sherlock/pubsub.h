@@ -33,12 +33,14 @@ SOFTWARE.
 #include "stream_data.h"
 
 #include "../TypeSystem/timestamp.h"
+#include "../TypeSystem/Serialization/binary.h"
 
 #include "../Blocks/SS/ss.h"
 #include "../Blocks/HTTP/api.h"
 
 #include "../Bricks/sync/scope_owned.h"
 #include "../Bricks/time/chrono.h"
+#include "../Bricks/util/crc32.h"
 
 // HTTP publish-subscribe configuration.
 //
@@ -113,6 +115,28 @@ SOFTWARE.
 //    HEAD request : Same as `sizeonly`, but return the total number of records in HTTP header, not body.
 //
 //    `terminate`  : Terminate HTTP connection for the subscription id passed as the value of this parameter.
+//
+// 5. Wire format.
+//
+//    `json`   : `js` or `fs` to use the respective JSON format instead of the default one.
+//
+//    `binary` : Return the records in the compact binary format, as `application/octet-stream`.
+//               Each record is a varint length followed by that many bytes. With `entries_only`, the record
+//               is just the binary entry. Otherwise, it is either 'E' followed by the binary `idxts_t` and
+//               the binary entry, or 'H' followed by the binary head timestamp. `array` is ignored.
+//
+//    `replication` : Return the records in checksummed binary frames, as `application/octet-stream`, for
+//                    `SubscribableRemoteStream` to replicate the stream. Each frame is the four-byte little-endian
+//                    length of its payload, followed by the four-byte little-endian CRC32 of the payload, followed
+//                    by the payload. The payload is either 'B' followed by a batch of entries, each being the binary
+//                    `idxts_t` and the binary entry, or 'H' followed by the binary head timestamp. The head frames
+//                    double as heartbeats. `entries_only` and `array` are ignored.
+//
+//    In the default JSON format, unless `entries_only` or `array` is set, the lines are streamed as persisted,
+//    without parsing and re-serializing the entries.
+//
+//    In any format, the records are coalesced into large HTTP chunks while catching up with the stream,
+//    and are sent right away once the subscriber has caught up.
 
 // TODO(dkorolev): Add timestamps to `sizeonly` and `HEAD` too?
 // TODO(dkorolev): Mention head updates now as we're here?
@@ -120,6 +144,11 @@ SOFTWARE.
 namespace current {
 namespace sherlock {
 
+// By default, the output is coalesced into HTTP chunks of up to this size while catching up with the stream.
+// As soon as the subscriber has caught up, whatever has been coalesced so far is sent right away.
+constexpr static size_t kSherlockHTTPMaxCoalescedChunkSize = 1024 * 1024;
+constexpr static int64_t kSherlockHTTPMaxCoalescedChunkDelayUs = 10000;
+
 struct ParsedHTTPRequestParams {
   // If set, return current stream size.
   // Controlled by `sizeonly` URL parameter or using `HEAD` method.
@@ -158,6 +187,12 @@ struct ParsedHTTPRequestParams {
   bool entries_only = false;
   // If set, wrap the entries into a large JSON array. Mostly to please JSON-beautifying browser extensions.
   bool array = false;
+  // The maximum size of the HTTP chunk to coalesce the output into, zero to send each record as a chunk of its own.
+  // Controlled by `chunk_bytes` URL parameter.
+  size_t max_chunk_bytes = kSherlockHTTPMaxCoalescedChunkSize;
+  // The maximum time the coalesced output is held for before being sent, zero to only send full chunks.
+  // Controlled by `chunk_delay` URL parameter.
+  std::chrono::microseconds max_chunk_delay = std::chrono::microseconds(kSherlockHTTPMaxCoalescedChunkDelayUs);
 };
 
 inline ParsedHTTPRequestParams ParsePubSubHTTPRequest(const Request& r) {
@@ -219,14 +254,142 @@ inline ParsedHTTPRequestParams ParsePubSubHTTPRequest(const Request& r) {
     result.array = true;
     result.entries_only = true;  // Obviously, `array` implies `entries_only`.
   }
+  if (r.url.query.has("chunk_bytes")) {
+    result.max_chunk_bytes = current::FromString<size_t>(r.url.query["chunk_bytes"]);
+  }
+  if (r.url.query.has("chunk_delay")) {
+    result.max_chunk_delay = std::chrono::microseconds(current::FromString<uint64_t>(r.url.query["chunk_delay"]));
+  }
 
   return result;
 }
 
+// The marker type to serve the stream in the binary format.
+struct PubSubBinaryFormat {};
+
+// How the records are formatted for the wire, depending on the requested format.
+template <class J>
+struct PubSubHTTPFormat {
+  constexpr static bool supports_array = true;
+  static const char* ContentType() { return current::net::constants::kDefaultJSONContentType; }
+  template <typename E>
+  static std::string Entry(const E& entry) {
+    return JSON<J>(entry) + '\n';
+  }
+  template <typename E>
+  static std::string IndexedEntry(idxts_t current, const E& entry) {
+    return JSON<J>(current) + '\t' + JSON<J>(entry) + '\n';
+  }
+  static std::string Head(std::chrono::microseconds us) { return JSON<J>(ts_optidx_t(us)) + '\n'; }
+  static std::string TerminationMessage() { return "{\"error\":\"The subscriber has terminated.\"}\n"; }
+};
+
+template <>
+struct PubSubHTTPFormat<PubSubBinaryFormat> {
+  constexpr static bool supports_array = false;
+  static const char* ContentType() { return "application/octet-stream"; }
+  template <typename E>
+  static std::string Entry(const E& entry) {
+    return WithLengthPrefix(Binary(entry));
+  }
+  template <typename E>
+  static std::string IndexedEntry(idxts_t current, const E& entry) {
+    std::string record(1u, 'E');
+    current::serialization::binary::AppendBinary(record, current);
+    current::serialization::binary::AppendBinary(record, entry);
+    return WithLengthPrefix(record);
+  }
+  static std::string Head(std::chrono::microseconds us) {
+    std::string record(1u, 'H');
+    current::serialization::binary::AppendBinary(record, us);
+    return WithLengthPrefix(record);
+  }
+  // No room for an error message in the binary format, the connection is just closed.
+  static std::string TerminationMessage() { return ""; }
+
+ private:
+  static std::string WithLengthPrefix(const std::string& record) {
+    std::string result = Binary(static_cast<uint64_t>(record.length()));
+    result.append(record);
+    return result;
+  }
+};
+
+// The marker type to serve the stream in the binary frames of the `replication` format.
+struct PubSubReplicationFormat {};
+
+namespace replication {
+
+constexpr static size_t kFrameHeaderSize = 8u;
+constexpr static char kBatchFrame = 'B';
+constexpr static char kHeadFrame = 'H';
+// The batch of entries is sent as soon as its frame is this large, or at the end of the subscriber's turn.
+constexpr static size_t kMaxBatchFrameSize = 256 * 1024;
+// The larger frames are deemed corrupted, to not buffer them up indefinitely.
+constexpr static uint32_t kMaxFramePayloadSize = 1u << 30;
+
+// Starts the frame of the given type in the empty `frame`, to append the rest of the payload to it.
+inline void BeginFrame(std::string& frame, char type) {
+  frame.assign(kFrameHeaderSize, '\0');
+  frame += type;
+}
+
+// Fills in the header of the frame once its payload is complete.
+inline void EndFrame(std::string& frame) {
+  const uint32_t length = static_cast<uint32_t>(frame.length() - kFrameHeaderSize);
+  const uint32_t crc32 = current::CRC32(0u, frame.data() + kFrameHeaderSize, length);
+  for (size_t i = 0u; i < 4u; ++i) {
+    frame[i] = static_cast<char>((length >> (8u * i)) & 0xff);
+    frame[4u + i] = static_cast<char>((crc32 >> (8u * i)) & 0xff);
+  }
+}
+
+struct FrameHeader {
+  uint32_t length;
+  uint32_t crc32;
+
+  explicit FrameHeader(const char* header) : length(0u), crc32(0u) {
+    for (size_t i = 0u; i < 4u; ++i) {
+      length |= static_cast<uint32_t>(static_cast<uint8_t>(header[i])) << (8u * i);
+      crc32 |= static_cast<uint32_t>(static_cast<uint8_t>(header[4u + i])) << (8u * i);
+    }
+  }
+};
+
+}  // namespace current::sherlock::replication
+
+template <>
+struct PubSubHTTPFormat<PubSubReplicationFormat> {
+  constexpr static bool supports_array = false;
+  static const char* ContentType() { return "application/octet-stream"; }
+  // Only used with `entries_only`, which is ignored in this format.
+  template <typename E>
+  static std::string Entry(const E& entry) {
+    return Binary(entry);
+  }
+  // The record within the batch frame.
+  template <typename E>
+  static std::string IndexedEntry(idxts_t current, const E& entry) {
+    std::string record = Binary(current);
+    current::serialization::binary::AppendBinary(record, entry);
+    return record;
+  }
+  static std::string Head(std::chrono::microseconds us) {
+    std::string frame;
+    replication::BeginFrame(frame, replication::kHeadFrame);
+    current::serialization::binary::AppendBinary(frame, us);
+    replication::EndFrame(frame);
+    return frame;
+  }
+  static std::string TerminationMessage() { return ""; }
+};
+
 template <typename E, template <typename> class PERSISTENCE_LAYER, class J>
 class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
  public:
   using stream_data_t = StreamData<E, PERSISTENCE_LAYER>;
+  // Whether the records are sent in batches, see `replication::kBatchFrame`.
+  using framed_t = std::integral_constant<bool, std::is_same<J, PubSubReplicationFormat>::value>;
 
   PubSubHTTPEndpointImpl(const std::string& subscription_id,
                          ScopeOwned<stream_data_t>& data,
@@ -235,14 +398,17 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
       : data_(data, [this]() { time_to_terminate_ = true; }),
         http_request_(std::move(r)),
         params_(std::move(params)),
+        raw_(std::is_same<J, JSONFormat::Current>::value && !params_.entries_only && !params_.array),
         output_started_(false),
         http_response_(http_request_.SendChunkedResponse(
             HTTPResponseCode.OK,
-            current::net::constants::kDefaultJSONContentType,
+            PubSubHTTPFormat<J>::ContentType(),
             current::net::http::Headers({
                 {kSherlockHeaderCurrentSubscriptionId, subscription_id},
                 {kSherlockHeaderCurrentStreamSize, current::ToString(data_->persistence.Size())},
             }))) {
+    http_response_.SetCoalescing(
+        current::net::ChunkedResponseCoalescing(params_.max_chunk_bytes, params_.max_chunk_delay));
     if (params_.recent.count() > 0) {
       serving_ = false;  // Start in 'non-serving' mode when `recent` is set.
       from_timestamp_ = r.timestamp - params_.recent;
@@ -253,14 +419,88 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
     if (params_.n > 0u) {
       n_ = params_.n;
     }
+    if (!PubSubHTTPFormat<J>::supports_array) {
+      params_.array = false;
+    }
+    if (framed_t::value) {
+      params_.entries_only = false;
+    }
   }
 
+  // Whether the persisted lines can be streamed as is, see `ss::RawStreamSubscriber`. They can be as long as
+  // each record is the line of `JSON(idx_ts) + '\t' + JSON(entry)` in the default JSON format, as persisted.
+  bool AcceptsRawLines() const { return raw_; }
+
   // The implementation of the subscriber in `PubSubHTTPEndpointImpl` is an example of using:
   // * `current` as the second parameter,
   // * `last` as the third parameter, and
   // * `EntryResponse` as the return value.
   // It does so to respect the URL parameters of the range of entries to subscribe to.
   ss::EntryResponse operator()(const E& entry, idxts_t current, idxts_t last) {
+    return Serve(current, last, [this, &entry, &current](std::string& output) {
+      if (params_.entries_only) {
+        output += PubSubHTTPFormat<J>::Entry(entry);
+      } else {
+        output += PubSubHTTPFormat<J>::IndexedEntry(current, entry);
+      }
+    });
+  }
+
+  // In the raw mode, the persisted lines are passed as is.
+  ss::EntryResponse operator()(const char* line, size_t length, idxts_t current, idxts_t last) {
+    return Serve(current, last, [line, length](std::string& output) {
+      output.append(line, length);
+      output += '\n';
+    });
+  }
+
+  ss::EntryResponse operator()(std::chrono::microseconds us) {
+    if (time_to_terminate_) {
+      return ss::EntryResponse::Done;
+    }
+    if (serving_) {
+      // Stop serving if the limit on timestamp is exceeded.
+      if (to_timestamp_.count() && us > to_timestamp_) {
+        return ss::EntryResponse::Done;
+      }
+      if (!params_.array && !params_.entries_only) {
+        SendFrame(framed_t());
+        http_response_(PubSubHTTPFormat<J>::Head(us)).Flush();
+      }
+    }
+    return ss::EntryResponse::More;
+  }
+
+  // TODO(dkorolev): This is a long shot, but looks right: For type-filtered HTTP subscriptions,
+  // whether we should terminate or no depends on `nowait`.
+  // The last entry of the turn did not pass the type filter, so the turn ends here: the batch frame and the coalesced
+  // output are sent now, not held until an entry that does pass the filter is published.
+  ss::EntryResponse EntryResponseIfNoMorePassTypeFilter() {
+    try {
+      SendFrame(framed_t());
+      http_response_.Flush();
+    } catch (const current::net::NetworkException&) {  // LCOV_EXCL_LINE
+      return ss::EntryResponse::Done;                  // LCOV_EXCL_LINE
+    }
+    return (time_to_terminate_ || params_.no_wait) ? ss::EntryResponse::Done : ss::EntryResponse::More;
+  }
+
+  // LCOV_EXCL_START
+  ss::TerminationResponse Terminate() {
+    const std::string message = PubSubHTTPFormat<J>::TerminationMessage();
+    if (params_.array && output_started_) {
+      http_response_(",\n" + message + "]\n");
+    } else if (!message.empty()) {
+      http_response_(message);
+    }
+    return ss::TerminationResponse::Terminate;
+  }
+  // LCOV_EXCL_STOP
+
+ private:
+  // Outputs the record formatted by `append_record` if it is within the requested range.
+  template <typename F>
+  ss::EntryResponse Serve(idxts_t current, idxts_t last, F&& append_record) {
     const ss::EntryResponse result = [&, this]() {
       if (time_to_terminate_) {
         return ss::EntryResponse::Done;
@@ -286,24 +526,26 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
         if (to_timestamp_.count() && current.us > to_timestamp_) {
           return ss::EntryResponse::Done;
         }
-        const std::string entry_json = [this, &current, &entry]() {
-          if (params_.entries_only) {
-            return JSON<J>(entry) + '\n';
+        std::string& output = BeginRecord(framed_t());
+        if (params_.array) {
+          if (!output_started_) {
+            output += "[\n";
+            output_started_ = true;
           } else {
-            return JSON<J>(current) + '\t' + JSON<J>(entry) + '\n';
+            output += ",\n";
           }
-        }();
-        current_response_size_ += entry_json.length();
+        }
+        const size_t record_begin = output.length();
+        append_record(output);
+        current_response_size_ += output.length() - record_begin;
         try {
-          if (params_.array) {
-            if (!output_started_) {
-              http_response_("[\n");
-              output_started_ = true;
-            } else {
-              http_response_(",\n");
-            }
+          // `last` is the last entry as of the beginning of the subscriber's turn, not the live one, so that the
+          // batch frame is sent and the coalesced output is flushed at the end of each turn even if the stream keeps
+          // growing.
+          SendRecord(framed_t(), current.index == last.index);
+          if (current.index == last.index) {
+            http_response_.Flush();
           }
-          http_response_(std::move(entry_json));
         } catch (const current::net::NetworkException&) {  // LCOV_EXCL_LINE
           return ss::EntryResponse::Done;                  // LCOV_EXCL_LINE
         }
@@ -325,6 +567,12 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
       }
       return ss::EntryResponse::More;
     }();
+    if (result == ss::EntryResponse::Done) {
+      try {
+        SendFrame(framed_t());
+      } catch (const current::net::NetworkException&) {  // LCOV_EXCL_LINE
+      }
+    }
     if (result == ss::EntryResponse::Done && params_.array) {
       if (!output_started_) {
         http_response_("[]\n");
@@ -335,41 +583,37 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
     return result;
   }
 
-  ss::EntryResponse operator()(std::chrono::microseconds us) {
-    if (time_to_terminate_) {
-      return ss::EntryResponse::Done;
-    }
-    if (serving_) {
-      // Stop serving if the limit on timestamp is exceeded.
-      if (to_timestamp_.count() && us > to_timestamp_) {
-        return ss::EntryResponse::Done;
-      }
-      if (!params_.array && !params_.entries_only) {
-        http_response_(JSON<J>(ts_optidx_t(us)) + '\n');
-      }
+  // Returns the buffer to format the next record into: on its own, or as part of the batch frame.
+  std::string& BeginRecord(std::false_type) {
+    record_.clear();
+    return record_;
+  }
+
+  std::string& BeginRecord(std::true_type) {
+    if (frame_.empty()) {
+      replication::BeginFrame(frame_, replication::kBatchFrame);
     }
-    return ss::EntryResponse::More;
+    return frame_;
   }
 
-  // TODO(dkorolev): This is a long shot, but looks right: For type-filtered HTTP subscriptions,
-  // whether we should terminate or no depends on `nowait`.
-  ss::EntryResponse EntryResponseIfNoMorePassTypeFilter() const {
-    return (time_to_terminate_ || params_.no_wait) ? ss::EntryResponse::Done : ss::EntryResponse::More;
+  void SendRecord(std::false_type, bool) { http_response_(record_); }
+
+  void SendRecord(std::true_type, bool end_of_turn) {
+    if (end_of_turn || frame_.length() >= replication::kMaxBatchFrameSize) {
+      SendFrame(std::true_type());
+    }
   }
 
-  // LCOV_EXCL_START
-  ss::TerminationResponse Terminate() {
-    static const std::string message = "{\"error\":\"The subscriber has terminated.\"}\n";
-    if (params_.array && output_started_) {
-      http_response_(",\n" + message + "]\n");
-    } else {
-      http_response_(message);
+  void SendFrame(std::false_type) {}
+
+  void SendFrame(std::true_type) {
+    if (!frame_.empty()) {
+      replication::EndFrame(frame_);
+      http_response_(frame_);
+      frame_.clear();
     }
-    return ss::TerminationResponse::Terminate;
   }
-  // LCOV_EXCL_STOP
 
- private:
   // The HTTP listener must register itself as a user of stream data to ensure the lifetime of stream data.
   ScopeOwnedBySomeoneElse<stream_data_t> data_;
   std::atomic_bool time_to_terminate_{false};
@@ -377,6 +621,8 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
   // `http_request_`:  need to keep the passed in request in scope for the lifetime of the chunked response.
   Request http_request_;
   ParsedHTTPRequestParams params_;
+  // Whether the persisted lines are passed as is.
+  const bool raw_;
   // `output_started_`: will change to `true` is `params_.array` is `true` as the first piece of data
   // has already been sent, thus triggering the need to close the array at the end.
   bool output_started_ = false;
@@ -384,6 +630,10 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
   current::net::HTTPServerConnection::ChunkedResponseSender http_response_;
   // Current response size in bytes.
   size_t current_response_size_ = 0u;
+  // The buffer to format the record being sent into.
+  std::string record_;
+  // The batch frame being formed, in the `replication` format.
+  std::string frame_;
 
   // Conditions on which parts of the stream to serve.
   bool serving_ = true;
@@ -402,7 +652,7 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
 };
 
 template <typename E, template <typename> class PERSISTENCE_LAYER, class J = JSONFormat::Current>
-using PubSubHTTPEndpoint = current::ss::StreamSubscriber<PubSubHTTPEndpointImpl<E, PERSISTENCE_LAYER, J>, E>;
+using PubSubHTTPEndpoint = current::ss::RawStreamSubscriber<PubSubHTTPEndpointImpl<E, PERSISTENCE_LAYER, J>, E>;
 
 }  // namespace sherlock
 }  // namespace current
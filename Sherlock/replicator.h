@@ -29,6 +29,7 @@ SOFTWARE.
 #include <functional>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "exceptions.h"
 #include "sherlock.h"
@@ -39,12 +40,18 @@ SOFTWARE.
 
 #include "../Bricks/sync/scope_owned.h"
 #include "../Bricks/sync/waitable_atomic.h"
+#include "../Bricks/util/crc32.h"
 
 #include "../TypeSystem/Reflection/types.h"
+#include "../TypeSystem/Serialization/binary.h"
 
 namespace current {
 namespace sherlock {
 
+// The wire format to replicate the remote stream in, see "5. Wire format" in `pubsub.h`.
+// The `Binary` one is the batched, checksummed frames of the `replication` format.
+enum class RemoteStreamFormat : int { JSON = 0, Binary = 1 };
+
 template <typename STREAM_ENTRY>
 class SubscribableRemoteStream final {
  public:
@@ -52,11 +59,17 @@ class SubscribableRemoteStream final {
 
   class RemoteStream final {
    public:
-    RemoteStream(const std::string& url, const std::string& entry_name, const std::string& namespace_name)
+    RemoteStream(const std::string& url,
+                 const std::string& entry_name,
+                 const std::string& namespace_name,
+                 RemoteStreamFormat format)
         : url_(url),
           schema_(Value<reflection::ReflectedTypeBase>(reflection::Reflector().ReflectType<entry_t>()).type_id,
                   entry_name,
-                  namespace_name) {}
+                  namespace_name),
+          format_(format) {}
+
+    RemoteStreamFormat Format() const { return format_; }
 
     void CheckSchema() const {
       const auto response = HTTP(GET(url_ + "/schema.simple"));
@@ -79,7 +92,9 @@ class SubscribableRemoteStream final {
       }
     }
 
-    std::string GetURLToSubscribe(uint64_t index) const { return url_ + "?i=" + current::ToString(index); }
+    std::string GetURLToSubscribe(uint64_t index) const {
+      return url_ + (format_ == RemoteStreamFormat::Binary ? "?replication&i=" : "?i=") + current::ToString(index);
+    }
 
     std::string GetURLToTerminate(const std::string& subscription_id) const {
       return url_ + "?terminate=" + subscription_id;
@@ -88,11 +103,17 @@ class SubscribableRemoteStream final {
    private:
     const std::string url_;
     const SubscribableSherlockSchema schema_;
+    const RemoteStreamFormat format_;
   };
 
+  // A batched subscriber, see `ss::BatchedStreamSubscriber`, is passed the entries of each received chunk,
+  // or of each received frame in the binary format, at once, in batches of at most `max_entries`.
+  // Once the connection is lost, or a malformed chunk or frame is received, the thread reconnects, and resumes
+  // from the first entry not yet accepted by the subscriber.
   template <typename F, typename TYPE_SUBSCRIBED_TO>
   class RemoteSubscriberThread final : public current::sherlock::SubscriberScope::SubscriberThread {
     static_assert(current::ss::IsEntrySubscriber<F, TYPE_SUBSCRIBED_TO>::value, "");
+    using batched_t = std::integral_constant<bool, ss::IsBatchedStreamSubscriber<F, TYPE_SUBSCRIBED_TO>::value>;
 
    public:
     RemoteSubscriberThread(ScopeOwned<RemoteStream>& remote_stream,
@@ -104,6 +125,7 @@ class SubscribableRemoteStream final {
           done_callback_(done_callback),
           subscriber_(subscriber),
           index_(start_idx),
+          next_index_(start_idx),
           unused_idxts_(),
           terminate_subscription_requested_(false),
           thread_([this]() { Thread(); }) {
@@ -149,15 +171,24 @@ class SubscribableRemoteStream final {
         }
         try {
           bare_stream.CheckSchema();
+          next_index_ = index_;
+          const bool binary = bare_stream.Format() == RemoteStreamFormat::Binary;
           HTTP(ChunkedGET(bare_stream.GetURLToSubscribe(index_),
                           [this](const std::string& header, const std::string& value) { OnHeader(header, value); },
-                          [this](const std::string& chunk_body) { OnChunk(chunk_body); },
+                          [this, binary](const std::string& chunk_body) {
+                            if (binary) {
+                              OnBinaryChunk(chunk_body);
+                            } else {
+                              OnChunk(chunk_body);
+                            }
+                          },
                           [this]() {}));
         } catch (StreamTerminatedBySubscriber&) {
           break;
         } catch (current::Exception&) {
         }
         carried_over_data_.clear();
+        batch_.clear();
         subscription_id_.MutableScopedAccessor()->clear();
       }
     }
@@ -189,19 +220,105 @@ class SubscribableRemoteStream final {
         if (Exists(tsoptidx.index)) {
           const auto idxts = idxts_t(Value(tsoptidx.index), tsoptidx.us);
           CURRENT_ASSERT(split.size() == 2u);
-          CURRENT_ASSERT(idxts.index == index_);
+          CURRENT_ASSERT(idxts.index == next_index_);
           auto entry = ParseJSON<TYPE_SUBSCRIBED_TO>(split[1]);
-          ++index_;
-          if (subscriber_(std::move(entry), idxts, unused_idxts_) == ss::EntryResponse::Done) {
+          ++next_index_;
+          if (PassEntry(batched_t(), std::move(entry), idxts) == ss::EntryResponse::Done) {
             CURRENT_THROW(StreamTerminatedBySubscriber());
           }
         } else {
           CURRENT_ASSERT(split.size() == 1u);
-          if (subscriber_(tsoptidx.us) == ss::EntryResponse::Done) {
+          if (PassBatch(batched_t()) == ss::EntryResponse::Done ||
+              subscriber_(tsoptidx.us) == ss::EntryResponse::Done) {
             CURRENT_THROW(StreamTerminatedBySubscriber());
           }
         }
       }
+      if (PassBatch(batched_t()) == ss::EntryResponse::Done) {
+        CURRENT_THROW(StreamTerminatedBySubscriber());
+      }
+    }
+
+    // The frames of the binary format may span several chunks, and a chunk may contain several frames.
+    void OnBinaryChunk(const std::string& chunk) {
+      if (terminate_subscription_requested_) {
+        return;
+      }
+
+      carried_over_data_.append(chunk);
+      size_t offset = 0u;
+      while (carried_over_data_.length() - offset >= replication::kFrameHeaderSize) {
+        const char* frame = carried_over_data_.data() + offset;
+        const replication::FrameHeader header(frame);
+        if (header.length > replication::kMaxFramePayloadSize) {
+          CURRENT_THROW(RemoteStreamMalformedChunkException());
+        }
+        if (carried_over_data_.length() - offset - replication::kFrameHeaderSize < header.length) {
+          break;
+        }
+        OnFrame(frame + replication::kFrameHeaderSize, header);
+        offset += replication::kFrameHeaderSize + header.length;
+      }
+      carried_over_data_.erase(0u, offset);
+    }
+
+    void OnFrame(const char* payload, const replication::FrameHeader& header) {
+      if (!header.length || current::CRC32(0u, payload, header.length) != header.crc32) {
+        CURRENT_THROW(RemoteStreamMalformedChunkException());
+      }
+      if (payload[0] == replication::kBatchFrame) {
+        current::serialization::binary::BinaryMemorySource source(payload + 1u, payload + header.length);
+        while (source.Remaining()) {
+          idxts_t idxts;
+          current::serialization::binary::LoadFromBinaryImpl(source, idxts);
+          if (idxts.index != next_index_) {
+            CURRENT_THROW(RemoteStreamMalformedChunkException());
+          }
+          TYPE_SUBSCRIBED_TO entry;
+          current::serialization::binary::LoadFromBinaryImpl(source, entry);
+          ++next_index_;
+          if (PassEntry(batched_t(), std::move(entry), idxts) == ss::EntryResponse::Done) {
+            CURRENT_THROW(StreamTerminatedBySubscriber());
+          }
+        }
+        if (PassBatch(batched_t()) == ss::EntryResponse::Done) {
+          CURRENT_THROW(StreamTerminatedBySubscriber());
+        }
+      } else if (payload[0] == replication::kHeadFrame) {
+        const auto us = ParseBinary<std::chrono::microseconds>(payload + 1u, header.length - 1u);
+        if (subscriber_(us) == ss::EntryResponse::Done) {
+          CURRENT_THROW(StreamTerminatedBySubscriber());
+        }
+      } else {
+        CURRENT_THROW(RemoteStreamMalformedChunkException());
+      }
+    }
+
+    // The index to resume from is only advanced once the subscriber has accepted the entry.
+    ss::EntryResponse PassEntry(std::false_type, TYPE_SUBSCRIBED_TO&& entry, idxts_t idxts) {
+      const ss::EntryResponse response = subscriber_(std::move(entry), idxts, unused_idxts_);
+      index_ = idxts.index + 1u;
+      return response;
+    }
+
+    ss::EntryResponse PassEntry(std::true_type, TYPE_SUBSCRIBED_TO&& entry, idxts_t idxts) {
+      batch_.emplace_back(idxts, std::move(entry));
+      if (batch_.size() >= subscriber_.Batching().max_entries) {
+        return PassBatch(batched_t());
+      }
+      return ss::EntryResponse::More;
+    }
+
+    ss::EntryResponse PassBatch(std::false_type) { return ss::EntryResponse::More; }
+
+    ss::EntryResponse PassBatch(std::true_type) {
+      if (batch_.empty()) {
+        return ss::EntryResponse::More;
+      }
+      const ss::EntryResponse response = subscriber_(batch_, unused_idxts_);
+      index_ = batch_.back().idx_ts.index + 1u;
+      batch_.clear();
+      return response;
     }
 
     void TerminateSubscription() {
@@ -227,12 +344,16 @@ class SubscribableRemoteStream final {
     ScopeOwnedBySomeoneElse<RemoteStream> remote_stream_;
     const std::function<void()> done_callback_;
     F& subscriber_;
+    // The index of the first entry not yet accepted by the subscriber, to resume from.
     uint64_t index_;
+    // The index of the next entry expected from the remote stream over the current connection.
+    uint64_t next_index_;
     const idxts_t unused_idxts_;
     current::WaitableAtomic<std::string> subscription_id_;
     std::atomic_bool terminate_subscription_requested_;
     std::thread thread_;
     std::string carried_over_data_;
+    std::vector<ss::IndexedEntry<TYPE_SUBSCRIBED_TO>> batch_;
   };
 
   template <typename F, typename TYPE_SUBSCRIBED_TO>
@@ -252,16 +373,20 @@ class SubscribableRemoteStream final {
               std::move(std::make_unique<subscriber_thread_t>(remote_stream, subscriber, start_idx, done_callback))) {}
   };
 
-  explicit SubscribableRemoteStream(const std::string& remote_stream_url)
-      : stream_(
-            remote_stream_url, sherlock::constants::kDefaultTopLevelName, sherlock::constants::kDefaultNamespaceName) {
+  explicit SubscribableRemoteStream(const std::string& remote_stream_url,
+                                    RemoteStreamFormat format = RemoteStreamFormat::JSON)
+      : stream_(remote_stream_url,
+                sherlock::constants::kDefaultTopLevelName,
+                sherlock::constants::kDefaultNamespaceName,
+                format) {
     stream_.ObjectAccessorDespitePossiblyDestructing().CheckSchema();
   }
 
   explicit SubscribableRemoteStream(const std::string& remote_stream_url,
                                     const std::string& entry_name,
-                                    const std::string& namespace_name)
-      : stream_(remote_stream_url, entry_name, namespace_name) {
+                                    const std::string& namespace_name,
+                                    RemoteStreamFormat format = RemoteStreamFormat::JSON)
+      : stream_(remote_stream_url, entry_name, namespace_name, format) {
     stream_.ObjectAccessorDespitePossiblyDestructing().CheckSchema();
   }
 
@@ -310,6 +435,13 @@ struct StreamReplicatorImpl {
     return EntryResponse::More;
   }
 
+  // Replicates a batch of entries under one lock of the stream being replicated into.
+  EntryResponse operator()(std::vector<current::ss::IndexedEntry<entry_t>>& entries, idxts_t) {
+    CURRENT_ASSERT(publisher_);
+    publisher_->PublishBatch(entries);
+    return EntryResponse::More;
+  }
+
   EntryResponse operator()(std::chrono::microseconds ts) {
     CURRENT_ASSERT(publisher_);
     publisher_->UpdateHead(ts);
@@ -325,7 +457,7 @@ struct StreamReplicatorImpl {
 };
 
 template <typename STREAM>
-using StreamReplicator = current::ss::StreamSubscriber<StreamReplicatorImpl<STREAM>, typename STREAM::entry_t>;
+using StreamReplicator = current::ss::BatchedStreamSubscriber<StreamReplicatorImpl<STREAM>, typename STREAM::entry_t>;
 
 }  // namespace sherlock
 }  // namespace current
@@ -27,12 +27,15 @@ SOFTWARE.
 
 #include "../port.h"
 
+#include <chrono>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "exceptions.h"
 #include "stream_data.h"
@@ -66,7 +69,9 @@ SOFTWARE.
 // Publishing is done via `my_stream.Publish(ENTRY{...});`.
 //
 // Subscription is done via `auto scope = my_stream.Subscribe(my_subscriber);`, where `my_subscriber`
-// is an instance of the class doing the subscription. Sherlock runs each subscriber in a dedicated thread.
+// is an instance of the class doing the subscription. Sherlock runs each subscriber in a dedicated thread,
+// unless `my_stream.UseSharedSubscriberExecutor(workers_count)` has been called, in which case the subscribers
+// created from then on, including the HTTP ones, share a pool of `workers_count` threads, see `executor.h`.
 //
 // Stack ownership of `my_subscriber` is respected, and `SubscriberScope` is returned for the user to store.
 // As the returned `scope` object leaves the scope, the subscriber is sent a signal to terminate,
@@ -147,6 +152,20 @@ class StreamImpl {
       return PublishImpl<MLS>(std::move(entry), us);
     }
 
+    // Publishes the entries, keeping their timestamps, as one persister batch, and notifies the subscribers once.
+    template <current::locks::MutexLockStatus MLS>
+    void DoPublishBatch(std::vector<ss::IndexedEntry<entry_t>>& entries) {
+      try {
+        auto& data = *data_;
+        current::locks::SmartMutexLockGuard<MLS> lock(data.publish_mutex);
+        data.persistence.template PublishBatch<current::locks::MutexLockStatus::AlreadyLocked>(entries);
+        data.executor.NotifyOfStreamUpdateFromLockedSection();
+        data.notifier.NotifyAllOfExternalWaitableEvent();
+      } catch (const current::sync::InDestructingModeException&) {
+        CURRENT_THROW(StreamInGracefulShutdownException());
+      }
+    }
+
     template <current::locks::MutexLockStatus MLS>
     void DoUpdateHead(const current::time::DefaultTimeArgument) {
       UpdateHeadImpl<MLS>();
@@ -167,6 +186,7 @@ class StreamImpl {
         current::locks::SmartMutexLockGuard<MLS> lock(data.publish_mutex);
         const auto result = data.persistence.template Publish<current::locks::MutexLockStatus::AlreadyLocked>(
             std::forward<ARGS>(args)...);
+        data.executor.NotifyOfStreamUpdateFromLockedSection();
         data.notifier.NotifyAllOfExternalWaitableEvent();
         return result;
       } catch (const current::sync::InDestructingModeException&) {
@@ -181,6 +201,7 @@ class StreamImpl {
         current::locks::SmartMutexLockGuard<MLS> lock(data.publish_mutex);
         data.persistence.template UpdateHead<current::locks::MutexLockStatus::AlreadyLocked>(
             std::forward<ARGS>(args)...);
+        data.executor.NotifyOfStreamUpdateFromLockedSection();
         data.notifier.NotifyAllOfExternalWaitableEvent();
       } catch (const current::sync::InDestructingModeException&) {
         CURRENT_THROW(StreamInGracefulShutdownException());
@@ -282,15 +303,43 @@ class StreamImpl {
     return authority_;
   }
 
+  // Returns `false` if the shared subscriber executor has already been started for this stream.
+  bool UseSharedSubscriberExecutor(size_t workers_count = 4u, size_t max_entries_per_turn = 1000u) {
+    try {
+      ScopeOwnedBySomeoneElse<stream_data_t> scoped_data(own_data_, []() {});
+      return scoped_data->executor.Start(workers_count, max_entries_per_turn);
+    } catch (const current::sync::InDestructingModeException&) {
+      CURRENT_THROW(StreamInGracefulShutdownException());
+    }
+  }
+
+  // The subscriber is either run in its own thread, or, if the shared executor of the stream has been started
+  // by the time of subscribing, as a task of that executor. Either way, it is run turn by turn via `RunTurn()`.
+  // A batched subscriber, see `ss::BatchedStreamSubscriber`, is passed the entries collected into `batch_`.
+  // A raw subscriber, see `ss::RawStreamSubscriber`, which accepts raw lines, is passed the persisted lines instead.
   template <typename TYPE_SUBSCRIBED_TO, typename F>
-  class SubscriberThreadInstance final : public current::sherlock::SubscriberScope::SubscriberThread {
+  class SubscriberThreadInstance final : public current::sherlock::SubscriberScope::SubscriberThread,
+                                         public SubscriberExecutor::Task {
    private:
+    using batched_t = std::integral_constant<bool, ss::IsBatchedStreamSubscriber<F, TYPE_SUBSCRIBED_TO>::value>;
+    using raw_t = std::integral_constant<bool,
+                                         ss::IsRawStreamSubscriber<F, TYPE_SUBSCRIBED_TO>::value &&
+                                             std::is_same<TYPE_SUBSCRIBED_TO, entry_t>::value>;
+
     bool this_is_valid_;
     std::function<void()> done_callback_;
     current::WaitableTerminateSignal terminate_signal_;
     ScopeOwnedBySomeoneElse<stream_data_t> data_;
     F& subscriber_;
     const uint64_t begin_idx_;
+    SubscriberExecutor* const executor_;  // Null if the subscriber runs in its own thread.
+    std::chrono::microseconds head_;
+    uint64_t index_;
+    bool terminate_sent_;
+    const ss::SubscriberBatching batching_;
+    std::vector<ss::IndexedEntry<TYPE_SUBSCRIBED_TO>> batch_;
+    std::chrono::steady_clock::time_point batch_begin_;
+    const bool raw_;
     std::thread thread_;
 
     SubscriberThreadInstance() = delete;
@@ -307,29 +356,40 @@ class StreamImpl {
         : this_is_valid_(false),
           done_callback_(done_callback),
           terminate_signal_(),
-          data_(data,
-                [this]() {
-                  std::lock_guard<std::mutex> lock(data_.ObjectAccessorDespitePossiblyDestructing().publish_mutex);
-                  terminate_signal_.SignalExternalTermination();
-                }),
+          data_(data, [this]() { SignalTermination(); }),
           subscriber_(subscriber),
           begin_idx_(begin_idx),
-          thread_(&SubscriberThreadInstance::Thread, this) {
+          executor_(data_.ObjectAccessorDespitePossiblyDestructing().executor.Started()
+                        ? &data_.ObjectAccessorDespitePossiblyDestructing().executor
+                        : nullptr),
+          head_(-1),
+          index_(begin_idx),
+          terminate_sent_(false),
+          batching_(BatchingOf(batched_t(), subscriber)),
+          raw_(AcceptsRawLines(raw_t(), subscriber)) {
+      if (executor_) {
+        executor_->Add(*this);
+      } else {
+        thread_ = std::thread(&SubscriberThreadInstance::Thread, this);
+      }
       // Must guard against the constructor of `ScopeOwnedBySomeoneElse<stream_data_t> data_` throwing.
       this_is_valid_ = true;
     }
 
     ~SubscriberThreadInstance() {
       if (this_is_valid_) {
-        // The constructor has completed successfully. The thread has started, and `data_` is valid.
-        CURRENT_ASSERT(thread_.joinable());
+        // The constructor has completed successfully. The subscriber has started, and `data_` is valid.
         if (!subscriber_thread_done_) {
-          std::lock_guard<std::mutex> lock(data_.ObjectAccessorDespitePossiblyDestructing().publish_mutex);
-          terminate_signal_.SignalExternalTermination();
+          SignalTermination();
+        }
+        if (executor_) {
+          executor_->WaitUntilDone(*this);
+        } else {
+          CURRENT_ASSERT(thread_.joinable());
+          thread_.join();
         }
-        thread_.join();
       } else {
-        // The constructor has not completed successfully. The thread was not started, and `data_` is garbage.
+        // The constructor has not completed successfully. The subscriber was not started, and `data_` is garbage.
         if (done_callback_) {
           // TODO(dkorolev): Fix this ownership issue.
           done_callback_();
@@ -337,11 +397,36 @@ class StreamImpl {
       }
     }
 
+    void SignalTermination() {
+      {
+        std::lock_guard<std::mutex> lock(data_.ObjectAccessorDespitePossiblyDestructing().publish_mutex);
+        terminate_signal_.SignalExternalTermination();
+      }
+      if (executor_) {
+        executor_->Wake(*this);
+      }
+    }
+
     void Thread() {
       // Keep the subscriber thread exception-safe. By construction, it's guaranteed to live
       // strictly within the scope of existence of `stream_data_t` contained in `data_`.
       stream_data_t& bare_data = data_.ObjectAccessorDespitePossiblyDestructing();
-      ThreadImpl(bare_data, begin_idx_);
+      while (true) {
+        const SubscriberTurnResult result = RunTurn(static_cast<size_t>(-1));
+        if (result == SubscriberTurnResult::Done) {
+          break;
+        } else if (result == SubscriberTurnResult::Idle) {
+          std::unique_lock<std::mutex> lock(bare_data.publish_mutex);
+          current::WaitableTerminateSignalBulkNotifier::Scope scope(bare_data.notifier, terminate_signal_);
+          terminate_signal_.WaitUntil(
+              lock, IdleDeadlineFromLockedSection(), [this]() { return HasWorkFromLockedSection(); });
+        }
+      }
+      OnDone();
+    }
+
+    void OnDone() override {
+      stream_data_t& bare_data = data_.ObjectAccessorDespitePossiblyDestructing();
       subscriber_thread_done_ = true;
       std::lock_guard<std::mutex> lock(bare_data.http_subscriptions_mutex);
       if (done_callback_) {
@@ -349,62 +434,167 @@ class StreamImpl {
       }
     }
 
-    void ThreadImpl(stream_data_t& bare_data, uint64_t begin_idx) {
-      auto head = std::chrono::microseconds(-1);
-      uint64_t index = begin_idx;
-      uint64_t size = 0;
-      bool terminate_sent = false;
-      while (true) {
-        // TODO(dkorolev): This `EXCL` section can and should be tested by subscribing to an empty stream.
-        // TODO(dkorolev): This is actually more a case of `EndReached()` first, right?
-        if (!terminate_sent && terminate_signal_) {
-          terminate_sent = true;
-          if (subscriber_.Terminate() != ss::TerminationResponse::Wait) {
-            return;
-          }
+    // The head is only passed to a batched subscriber after the pending batch.
+    bool HasWorkFromLockedSection() const {
+      const stream_data_t& bare_data = data_.ObjectAccessorDespitePossiblyDestructing();
+      return (terminate_signal_ && !terminate_sent_) || BatchIsDue() ||
+             bare_data.persistence.template Size<current::locks::MutexLockStatus::AlreadyLocked>() > index_ ||
+             (index_ > begin_idx_ && batch_.empty() &&
+              bare_data.persistence.template CurrentHead<current::locks::MutexLockStatus::AlreadyLocked>() > head_);
+    }
+
+    // The pending batch is due by `max_age` after its first entry, even if no more entries are published.
+    std::chrono::steady_clock::time_point IdleDeadlineFromLockedSection() const override {
+      if (batch_.empty()) {
+        return std::chrono::steady_clock::time_point::max();
+      }
+      return batch_begin_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(batching_.max_age);
+    }
+
+    // Passes at most `max_entries` entries, followed by the head, if it has moved, to the subscriber.
+    SubscriberTurnResult RunTurn(size_t max_entries) override {
+      stream_data_t& bare_data = data_.ObjectAccessorDespitePossiblyDestructing();
+      // TODO(dkorolev): This `EXCL` section can and should be tested by subscribing to an empty stream.
+      // TODO(dkorolev): This is actually more a case of `EndReached()` first, right?
+      if (TerminateIfRequested()) {
+        return SubscriberTurnResult::Done;
+      }
+      if (BatchIsDue() && PassBatch(batched_t()) == ss::EntryResponse::Done) {
+        return SubscriberTurnResult::Done;
+      }
+      const auto head_idx = bare_data.persistence.HeadAndLastPublishedIndexAndTimestamp();
+      const uint64_t size = Exists(head_idx.idxts) ? Value(head_idx.idxts).index + 1 : 0;
+      if (!(head_idx.head > head_)) {
+        return SubscriberTurnResult::Idle;
+      }
+      if (size > index_) {
+        const uint64_t end = (size - index_ > max_entries) ? index_ + max_entries : size;
+        // The entries of this turn are passed along with the last entry as of its beginning, which they lead up to.
+        const idxts_t last = Value(head_idx.idxts);
+        if (raw_ ? PassRawLines(raw_t(), bare_data, end, last) : PassEntries(bare_data, end, last)) {
+          return SubscriberTurnResult::Done;
         }
-        auto head_idx = bare_data.persistence.HeadAndLastPublishedIndexAndTimestamp();
-        size = Exists(head_idx.idxts) ? Value(head_idx.idxts).index + 1 : 0;
-        if (head_idx.head > head) {
-          if (size > index) {
-            for (const auto& e : bare_data.persistence.Iterate(index, size)) {
-              if (!terminate_sent && terminate_signal_) {
-                terminate_sent = true;
-                if (subscriber_.Terminate() != ss::TerminationResponse::Wait) {
-                  return;
-                }
-              }
-              if (current::ss::PassEntryToSubscriberIfTypeMatches<TYPE_SUBSCRIBED_TO, entry_t>(
-                      subscriber_,
-                      [this]() -> ss::EntryResponse { return subscriber_.EntryResponseIfNoMorePassTypeFilter(); },
-                      e.entry,
-                      e.idx_ts,
-                      bare_data.persistence.LastPublishedIndexAndTimestamp()) == ss::EntryResponse::Done) {
-                return;
-              }
-            }
-            index = size;
-            head = Value(head_idx.idxts).us;
-          }
-          if (size > begin_idx && head_idx.head > head && subscriber_(head_idx.head) == ss::EntryResponse::Done) {
-            return;
-          }
-          head = head_idx.head;
-        } else {
-          std::unique_lock<std::mutex> lock(bare_data.publish_mutex);
-          current::WaitableTerminateSignalBulkNotifier::Scope scope(bare_data.notifier, terminate_signal_);
-          terminate_signal_.WaitUntil(
-              lock,
-              [this, &bare_data, &index, &begin_idx, &head]() {
-                return terminate_signal_ ||
-                       bare_data.persistence.template Size<current::locks::MutexLockStatus::AlreadyLocked>() > index ||
-                       (index > begin_idx &&
-                        bare_data.persistence.template CurrentHead<current::locks::MutexLockStatus::AlreadyLocked>() >
-                            head);
-              });
+        index_ = end;
+        if (end < size) {
+          // Yield to the other subscribers before passing the rest of the entries.
+          return SubscriberTurnResult::MoreToDo;
+        }
+        head_ = Value(head_idx.idxts).us;
+      }
+      if (!batch_.empty()) {
+        if (!BatchIsDue()) {
+          // Wait for more entries to join the batch.
+          return SubscriberTurnResult::Idle;
+        }
+        if (PassBatch(batched_t()) == ss::EntryResponse::Done) {
+          return SubscriberTurnResult::Done;
+        }
+      }
+      if (size > begin_idx_ && head_idx.head > head_ && subscriber_(head_idx.head) == ss::EntryResponse::Done) {
+        return SubscriberTurnResult::Done;
+      }
+      head_ = head_idx.head;
+      return SubscriberTurnResult::MoreToDo;
+    }
+
+   private:
+    // Returns `true` if the subscriber is done. A batched subscriber is passed its pending batch first.
+    bool TerminateIfRequested() {
+      if (!terminate_sent_ && terminate_signal_) {
+        terminate_sent_ = true;
+        if (PassBatch(batched_t()) == ss::EntryResponse::Done) {
+          return true;
+        }
+        return subscriber_.Terminate() != ss::TerminationResponse::Wait;
+      }
+      return false;
+    }
+
+    // Passes the entries up to `end`. Returns `true` if the subscriber is done.
+    bool PassEntries(stream_data_t& bare_data, uint64_t end, idxts_t last) {
+      for (auto&& e : bare_data.persistence.Iterate(index_, end)) {
+        if (TerminateIfRequested()) {
+          return true;
+        }
+        if (PassEntry(batched_t(), std::move(e.entry), e.idx_ts, last) == ss::EntryResponse::Done) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Passes the persisted lines up to `end` as is, parsing only their `JSON(idx_ts) + '\t'` prefixes.
+    bool PassRawLines(std::true_type, stream_data_t& bare_data, uint64_t end, idxts_t last) {
+      for (auto&& line : bare_data.persistence.template Iterate<ss::IterationMode::Unsafe>(index_, end)) {
+        if (TerminateIfRequested()) {
+          return true;
+        }
+        const char* data = line.data();
+        const size_t length = line.length();
+        const char* tab = static_cast<const char*>(std::memchr(data, '\t', length));
+        CURRENT_ASSERT(tab);
+        const auto current = ParseJSON<idxts_t>(data, static_cast<size_t>(tab - data));
+        if (subscriber_(data, length, current, last) == ss::EntryResponse::Done) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool PassRawLines(std::false_type, stream_data_t& bare_data, uint64_t end, idxts_t last) {
+      return PassEntries(bare_data, end, last);
+    }
+
+    template <typename E>
+    ss::EntryResponse PassEntry(std::false_type, E&& entry, idxts_t current, idxts_t last) {
+      return current::ss::PassEntryToSubscriberIfTypeMatches<TYPE_SUBSCRIBED_TO, entry_t>(
+          subscriber_,
+          [this]() -> ss::EntryResponse { return subscriber_.EntryResponseIfNoMorePassTypeFilter(); },
+          std::forward<E>(entry),
+          current,
+          last);
+    }
+
+    template <typename E>
+    ss::EntryResponse PassEntry(std::true_type, E&& entry, idxts_t current, idxts_t last) {
+      if (ss::AppendEntryToBatchIfTypeMatches<TYPE_SUBSCRIBED_TO, entry_t>(batch_, std::forward<E>(entry), current)) {
+        if (batch_.size() == 1u) {
+          batch_begin_ = std::chrono::steady_clock::now();
+        }
+        if (batch_.size() >= batching_.max_entries) {
+          return PassBatch(batched_t());
+        }
+      } else if (current.index == last.index) {
+        // Same as for the per-entry subscribers: the last entry of the stream did not pass the type filter.
+        if (PassBatch(batched_t()) == ss::EntryResponse::Done) {
+          return ss::EntryResponse::Done;
         }
+        return subscriber_.EntryResponseIfNoMorePassTypeFilter();
       }
+      return ss::EntryResponse::More;
     }
+
+    ss::EntryResponse PassBatch(std::false_type) { return ss::EntryResponse::More; }
+
+    ss::EntryResponse PassBatch(std::true_type) {
+      if (batch_.empty()) {
+        return ss::EntryResponse::More;
+      }
+      const stream_data_t& bare_data = data_.ObjectAccessorDespitePossiblyDestructing();
+      const ss::EntryResponse response = subscriber_(batch_, bare_data.persistence.LastPublishedIndexAndTimestamp());
+      batch_.clear();
+      return response;
+    }
+
+    bool BatchIsDue() const {
+      return !batch_.empty() && std::chrono::steady_clock::now() >= IdleDeadlineFromLockedSection();
+    }
+
+    static ss::SubscriberBatching BatchingOf(std::false_type, F&) { return ss::SubscriberBatching(); }
+    static ss::SubscriberBatching BatchingOf(std::true_type, F& subscriber) { return subscriber.Batching(); }
+
+    static bool AcceptsRawLines(std::false_type, F&) { return false; }
+    static bool AcceptsRawLines(std::true_type, F& subscriber) { return subscriber.AcceptsRawLines(); }
   };
 
   // Expose the means to control the scope of the subscriber.
@@ -573,7 +763,11 @@ class StreamImpl {
   }
 
   void operator()(Request r) {
-    if (r.url.query.has("json")) {
+    if (r.url.query.has("replication")) {
+      ServeDataViaHTTP<PubSubReplicationFormat>(std::move(r));
+    } else if (r.url.query.has("binary")) {
+      ServeDataViaHTTP<PubSubBinaryFormat>(std::move(r));
+    } else if (r.url.query.has("json")) {
       const auto& json = r.url.query["json"];
       if (json == "js") {
         ServeDataViaHTTP<JSONFormat::Minimalistic>(std::move(r));
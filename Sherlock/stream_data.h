@@ -30,6 +30,8 @@ SOFTWARE.
 #include <map>
 #include <thread>
 
+#include "executor.h"
+
 #include "../Blocks/Persistence/persistence.h"
 #include "../Bricks/util/random.h"
 #include "../Bricks/util/sha256.h"
@@ -110,9 +112,12 @@ struct StreamData {
   http_subscriptions_t http_subscriptions;
   std::mutex http_subscriptions_mutex;
 
+  // Runs the subscribers once started, see `StreamImpl::UseSharedSubscriberExecutor()`.
+  SubscriberExecutor executor;
+
   template <typename... ARGS>
   StreamData(ARGS&&... args)
-      : persistence(publish_mutex, std::forward<ARGS>(args)...) {}
+      : persistence(publish_mutex, std::forward<ARGS>(args)...), executor(publish_mutex) {}
 
   static std::string GenerateRandomHTTPSubscriptionID() {
     return current::SHA256("sherlock_http_subscription_" +
@@ -46,6 +46,9 @@ SOFTWARE.
 #include "../3rdparty/gtest/gtest-main-with-dflags.h"
 
 DEFINE_int32(sherlock_http_test_port, PickPortForUnitTest(), "Local port to use for Sherlock unit test.");
+DEFINE_int32(sherlock_http_test_port_event_loop,
+             PickPortForUnitTest(),
+             "Local port to use for Sherlock unit test served by event loops.");
 DEFINE_string(sherlock_test_tmpdir, ".current", "Local path for the test to create temporary files in.");
 
 namespace sherlock_unittest {
@@ -337,6 +340,183 @@ TEST(Sherlock, SubscribeProcessedThreeEntriesBecauseWeWaitInTheScope) {
   EXPECT_EQ("10,11,12", d.results_);
 }
 
+TEST(Sherlock, SharedSubscriberExecutor) {
+  current::time::ResetToZero();
+
+  using namespace sherlock_unittest;
+
+  auto stream = current::sherlock::Stream<Record>();
+  EXPECT_TRUE(stream.UseSharedSubscriberExecutor(2u, 3u));
+  EXPECT_FALSE(stream.UseSharedSubscriberExecutor(2u, 3u));
+
+  for (int i = 1; i <= 5; ++i) {
+    stream.Publish(i, std::chrono::microseconds(i));
+  }
+
+  // Many more subscribers than workers, each of them getting all the entries, in order.
+  const size_t subscribers_count = 50u;
+  std::vector<std::unique_ptr<Data>> data;
+  std::vector<std::unique_ptr<SherlockTestProcessor>> processors;
+  std::vector<current::sherlock::SubscriberScope> scopes;
+  for (size_t i = 0; i < subscribers_count; ++i) {
+    data.push_back(std::make_unique<Data>());
+    processors.push_back(std::make_unique<SherlockTestProcessor>(*data.back(), true));
+    if (i % 2 == 0) {
+      // Half of the subscribers are done after ten entries, the other half are terminated.
+      processors.back()->SetMax(10u);
+    }
+    scopes.push_back(stream.Subscribe(*processors.back()));
+  }
+
+  for (int i = 6; i <= 10; ++i) {
+    stream.Publish(i, std::chrono::microseconds(i));
+  }
+
+  for (size_t i = 0; i < subscribers_count; ++i) {
+    while (data[i]->seen_ < 10u) {
+      std::this_thread::yield();
+    }
+    if (i % 2 == 0) {
+      while (scopes[i]) {
+        std::this_thread::yield();
+      }
+    } else {
+      EXPECT_TRUE(scopes[i]);
+    }
+  }
+
+  scopes.clear();
+  for (size_t i = 0; i < subscribers_count; ++i) {
+    if (i % 2 == 0) {
+      EXPECT_EQ("1,2,3,4,5,6,7,8,9,10", data[i]->results_);
+    } else {
+      EXPECT_EQ("1,2,3,4,5,6,7,8,9,10,TERMINATE", data[i]->results_);
+    }
+  }
+}
+
+namespace sherlock_unittest {
+
+struct BatchedRecordsCollectorImpl {
+  using EntryResponse = current::ss::EntryResponse;
+  using TerminationResponse = current::ss::TerminationResponse;
+
+  std::atomic_size_t count_;
+  std::vector<std::string> batches_;
+  size_t max_ = 0u;
+  bool terminated_ = false;
+
+  BatchedRecordsCollectorImpl() : count_(0u) {}
+
+  EntryResponse operator()(std::vector<current::ss::IndexedEntry<Record>>& entries, idxts_t last) {
+    std::string batch;
+    for (const auto& e : entries) {
+      EXPECT_EQ(static_cast<uint64_t>(e.entry.x - 1), e.idx_ts.index);
+      EXPECT_LE(e.idx_ts.index, last.index);
+      batch += (batch.empty() ? "" : ",") + current::ToString(e.entry.x);
+    }
+    batches_.push_back(batch);
+    count_ += entries.size();
+    return (max_ && count_ >= max_) ? EntryResponse::Done : EntryResponse::More;
+  }
+
+  EntryResponse operator()(std::chrono::microseconds) const { return EntryResponse::More; }
+
+  static EntryResponse EntryResponseIfNoMorePassTypeFilter() { return EntryResponse::More; }
+
+  TerminationResponse Terminate() {
+    terminated_ = true;
+    return TerminationResponse::Terminate;
+  }
+};
+
+using BatchedRecordsCollector = current::ss::BatchedStreamSubscriber<BatchedRecordsCollectorImpl, Record>;
+
+}  // namespace sherlock_unittest
+
+TEST(Sherlock, BatchedSubscriber) {
+  current::time::ResetToZero();
+
+  using namespace sherlock_unittest;
+
+  auto stream = current::sherlock::Stream<Record>();
+  for (int i = 1; i <= 10; ++i) {
+    stream.Publish(i, std::chrono::microseconds(i));
+  }
+
+  {
+    // The entries already in the stream are passed in batches of at most `max_entries`.
+    BatchedRecordsCollector collector;
+    collector.SetBatching(current::ss::SubscriberBatching(4u));
+    collector.max_ = 10u;
+    {
+      const auto scope = stream.Subscribe(collector);
+      while (scope) {
+        std::this_thread::yield();
+      }
+    }
+    EXPECT_EQ("1,2,3,4|5,6,7,8|9,10", current::strings::Join(collector.batches_, '|'));
+    EXPECT_FALSE(collector.terminated_);
+  }
+
+  {
+    // The pending batch is passed to the subscriber before the termination request.
+    BatchedRecordsCollector collector;
+    collector.SetBatching(current::ss::SubscriberBatching(100u, std::chrono::seconds(100)));
+    {
+      const auto scope = stream.Subscribe(collector, 7u);
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      EXPECT_EQ(0u, collector.count_);
+    }
+    EXPECT_EQ("8,9,10", current::strings::Join(collector.batches_, '|'));
+    EXPECT_TRUE(collector.terminated_);
+  }
+
+  {
+    // Once the subscriber has caught up with the stream, the batch is passed without waiting by default.
+    BatchedRecordsCollector collector;
+    collector.max_ = 12u;
+    {
+      const auto scope = stream.Subscribe(collector);
+      while (collector.count_ < 10u) {
+        std::this_thread::yield();
+      }
+      stream.Publish(11, std::chrono::microseconds(11));
+      stream.Publish(12, std::chrono::microseconds(12));
+      while (scope) {
+        std::this_thread::yield();
+      }
+    }
+    EXPECT_EQ(12u, collector.count_);
+    EXPECT_EQ("1,2,3,4,5,6,7,8,9,10", collector.batches_.front());
+  }
+}
+
+TEST(Sherlock, BatchedSubscriberMaxAge) {
+  current::time::ResetToZero();
+
+  using namespace sherlock_unittest;
+
+  for (const bool shared_executor : {false, true}) {
+    auto stream = current::sherlock::Stream<Record>();
+    if (shared_executor) {
+      stream.UseSharedSubscriberExecutor();
+    }
+    stream.Publish(1, std::chrono::microseconds(1));
+
+    // A single pending entry is passed once `max_age` has passed, with no more entries published after it.
+    BatchedRecordsCollector collector;
+    collector.SetBatching(current::ss::SubscriberBatching(100u, std::chrono::milliseconds(50)));
+    const auto begin = std::chrono::steady_clock::now();
+    const auto scope = stream.Subscribe(collector);
+    while (!collector.count_) {
+      std::this_thread::yield();
+    }
+    EXPECT_GE(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(50));
+    EXPECT_EQ("1", current::strings::Join(collector.batches_, '|'));
+  }
+}
+
 namespace sherlock_unittest {
 
 // Collector class for `SubscribeToStreamViaHTTP` test.
@@ -701,6 +881,106 @@ TEST(Sherlock, SubscribeToStreamViaHTTP) {
   // TODO(dkorolev): Add tests that the endpoint is not unregistered until its last client is done. (?)
 }
 
+TEST(Sherlock, SubscribeToStreamViaHTTPInBinaryFormat) {
+  current::time::ResetToZero();
+
+  using namespace sherlock_unittest;
+
+  auto exposed_stream =
+      current::sherlock::Stream<RecordWithTimestamp>(current::ss::StreamNamespaceName("Sherlock", "Transaction"));
+  const std::string base_url = Printf("http://localhost:%d/exposed", FLAGS_sherlock_http_test_port);
+  const auto scope = HTTP(FLAGS_sherlock_http_test_port).Register("/exposed", exposed_stream);
+
+  current::time::SetNow(std::chrono::microseconds(100));
+  exposed_stream.Publish(RecordWithTimestamp("s[0]", std::chrono::microseconds(100)));
+  current::time::SetNow(std::chrono::microseconds(200));
+  exposed_stream.Publish(RecordWithTimestamp("s[1]\n", std::chrono::microseconds(200)));
+
+  {
+    const auto result = HTTP(GET(base_url + "?binary&nowait"));
+    EXPECT_EQ(200, static_cast<int>(result.code));
+    std::istringstream body(result.body);
+    std::vector<std::string> records;
+    while (body.peek() != std::istringstream::traits_type::eof()) {
+      std::string record(static_cast<size_t>(LoadFromBinary<uint64_t>(body)), ' ');
+      ASSERT_TRUE(static_cast<bool>(body.read(&record[0], record.length())));
+      ASSERT_EQ('E', record[0]);
+      std::istringstream record_stream(record.substr(1u));
+      const auto idx_ts = LoadFromBinary<idxts_t>(record_stream);
+      const auto entry = LoadFromBinary<RecordWithTimestamp>(record_stream);
+      records.push_back(JSON(idx_ts) + ' ' + JSON(entry));
+    }
+    EXPECT_EQ(
+        "{\"index\":0,\"us\":100} {\"s\":\"s[0]\",\"t\":100}\n"
+        "{\"index\":1,\"us\":200} {\"s\":\"s[1]\\n\",\"t\":200}",
+        current::strings::Join(records, '\n'));
+  }
+
+  {
+    // With `entries_only`, the records are just the entries. `array` is ignored.
+    const auto result = HTTP(GET(base_url + "?binary&entries_only&array&nowait"));
+    std::istringstream body(result.body);
+    EXPECT_EQ(Binary(Binary(RecordWithTimestamp("s[0]", std::chrono::microseconds(100)))) +
+                  Binary(Binary(RecordWithTimestamp("s[1]\n", std::chrono::microseconds(200)))),
+              result.body);
+  }
+}
+
+TEST(Sherlock, SubscribeToFilePersistedStreamViaHTTPInRawMode) {
+  current::time::ResetToZero();
+
+  using namespace sherlock_unittest;
+
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_sherlock_test_tmpdir, "raw_mode");
+  const auto persistence_file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+
+  auto exposed_stream = current::sherlock::Stream<Record, current::persistence::File>(persistence_file_name);
+  const std::string base_url = Printf("http://localhost:%d/exposed_raw", FLAGS_sherlock_http_test_port);
+  const auto scope = HTTP(FLAGS_sherlock_http_test_port).Register("/exposed_raw", exposed_stream);
+
+  const int n = 1000;
+  std::string expected;
+  for (int i = 0; i < n; ++i) {
+    current::time::SetNow(std::chrono::microseconds((i + 1) * 100));
+    const auto idxts = exposed_stream.Publish(Record(i));
+    expected += JSON(idxts) + '\t' + JSON(Record(i)) + '\n';
+    if (i % 10 == 0) {
+      // The head directives in the file are skipped.
+      current::time::SetNow(std::chrono::microseconds((i + 1) * 100 + 50));
+      exposed_stream.UpdateHead();
+    }
+  }
+
+  {
+    // The persisted lines are served as is, coalesced into a few large chunks.
+    std::string body;
+    size_t chunks = 0u;
+    HTTP(ChunkedGET(base_url + "?nowait",
+                    [](const std::string&, const std::string&) {},
+                    [&body, &chunks](const std::string& chunk) {
+                      body += chunk;
+                      ++chunks;
+                    },
+                    []() {}));
+    EXPECT_EQ(expected, body);
+    EXPECT_LT(chunks, 10u);
+  }
+
+  {
+    // The range parameters are respected.
+    const auto result = HTTP(GET(base_url + "?i=500&n=2"));
+    EXPECT_EQ(
+        "{\"index\":500,\"us\":50100}\t{\"x\":500}\n"
+        "{\"index\":501,\"us\":50200}\t{\"x\":501}\n",
+        result.body);
+  }
+
+  {
+    // The other formats parse and re-serialize each entry. For this record, the output is the same.
+    EXPECT_EQ(expected, HTTP(GET(base_url + "?json=js&nowait")).body);
+  }
+}
+
 TEST(Sherlock, HTTPSubscriptionCanBeTerminated) {
   current::time::ResetToZero();
 
@@ -768,6 +1048,42 @@ TEST(Sherlock, HTTPSubscriptionCanBeTerminated) {
   slow_subscriber.join();
 }
 
+#ifdef CURRENT_POSIX
+TEST(Sherlock, SubscribeToStreamViaHTTPServedByEventLoop) {
+  current::time::ResetToZero();
+
+  using namespace sherlock_unittest;
+
+  auto exposed_stream = current::sherlock::Stream<Record>();
+  const std::string base_url = Printf("http://localhost:%d/exposed", FLAGS_sherlock_http_test_port_event_loop);
+  HTTP(FLAGS_sherlock_http_test_port_event_loop).UseEventLoop(current::http::HTTPServerEventLoopParams(2u));
+  const auto scope = HTTP(FLAGS_sherlock_http_test_port_event_loop).Register("/exposed", exposed_stream);
+
+  // The subscribers wait for the entries to be published, with no server thread blocked on their connections.
+  const size_t n = 50u;
+  std::vector<std::string> results(n);
+  std::vector<std::thread> subscribers;
+  for (size_t i = 0u; i < n; ++i) {
+    subscribers.emplace_back([&base_url, &results, i]() { results[i] = HTTP(GET(base_url + "?n=3")).body; });
+  }
+  exposed_stream.Publish(Record(1), std::chrono::microseconds(100));
+  exposed_stream.Publish(Record(2), std::chrono::microseconds(200));
+  exposed_stream.Publish(Record(3), std::chrono::microseconds(300));
+  for (auto& subscriber : subscribers) {
+    subscriber.join();
+  }
+  const std::string golden =
+      "{\"index\":0,\"us\":100}\t{\"x\":1}\n"
+      "{\"index\":1,\"us\":200}\t{\"x\":2}\n"
+      "{\"index\":2,\"us\":300}\t{\"x\":3}\n";
+  for (const auto& result : results) {
+    EXPECT_EQ(golden, result);
+  }
+
+  HTTP(FLAGS_sherlock_http_test_port_event_loop).UseEventLoop(current::http::HTTPServerEventLoopParams());
+}
+#endif  // CURRENT_POSIX
+
 const std::string golden_signature() {
   current::reflection::StructSchema struct_schema;
   struct_schema.AddType<sherlock_unittest::Record>();
@@ -934,6 +1250,160 @@ TEST(Sherlock, ParseArbitrarilySplitChunks) {
   EXPECT_EQ(sherlock_golden_data, current::FileSystem::ReadFileAsString(persistence_file_name));
 }
 
+TEST(Sherlock, ReplicateViaHTTPInBinaryFrames) {
+  current::time::ResetToZero();
+
+  using namespace sherlock_unittest;
+  using namespace current::sherlock::replication;
+
+  using sherlock_t = current::sherlock::Stream<Record>;
+  sherlock_t exposed_stream(current::ss::StreamNamespaceName("Namespace", "Record"));
+  const std::string base_url = Printf("http://localhost:%d/exposed", FLAGS_sherlock_http_test_port);
+  const auto scope =
+      HTTP(FLAGS_sherlock_http_test_port)
+          .Register("/exposed", URLPathArgs::CountMask::None | URLPathArgs::CountMask::One, exposed_stream);
+
+  for (int x = 1; x <= 3; ++x) {
+    current::time::SetNow(std::chrono::microseconds(x * 100));
+    exposed_stream.Publish(Record(x));
+  }
+  current::time::SetNow(std::chrono::microseconds(500));
+  exposed_stream.UpdateHead();
+
+  {
+    // All the entries already in the stream make up a single checksummed batch frame.
+    const auto result = HTTP(GET(base_url + "?replication&nowait"));
+    EXPECT_EQ(200, static_cast<int>(result.code));
+    ASSERT_LE(kFrameHeaderSize, result.body.length());
+    const FrameHeader header(result.body.data());
+    ASSERT_EQ(kFrameHeaderSize + header.length, result.body.length());
+    const char* payload = result.body.data() + kFrameHeaderSize;
+    EXPECT_EQ(current::CRC32(0u, payload, header.length), header.crc32);
+    ASSERT_EQ(kBatchFrame, payload[0]);
+    current::serialization::binary::BinaryMemorySource source(payload + 1u, payload + header.length);
+    std::vector<std::string> records;
+    while (source.Remaining()) {
+      idxts_t idx_ts;
+      current::serialization::binary::LoadFromBinaryImpl(source, idx_ts);
+      Record record;
+      current::serialization::binary::LoadFromBinaryImpl(source, record);
+      records.push_back(JSON(idx_ts) + ' ' + JSON(record));
+    }
+    EXPECT_EQ(
+        "{\"index\":0,\"us\":100} {\"x\":1}\n"
+        "{\"index\":1,\"us\":200} {\"x\":2}\n"
+        "{\"index\":2,\"us\":300} {\"x\":3}",
+        current::strings::Join(records, '\n'));
+  }
+
+  sherlock_t replicated_stream;
+  current::sherlock::SubscribableRemoteStream<Record> remote_stream(
+      base_url, "Record", "Namespace", current::sherlock::RemoteStreamFormat::Binary);
+  auto replicator = std::make_unique<current::sherlock::StreamReplicator<sherlock_t>>(replicated_stream);
+  {
+    const auto subscriber_scope = remote_stream.Subscribe(*replicator);
+    while (replicated_stream.Persister().CurrentHead() < std::chrono::microseconds(500)) {
+      std::this_thread::yield();
+    }
+  }
+  std::vector<std::string> replicated;
+  for (const auto& e : replicated_stream.Persister().Iterate()) {
+    replicated.push_back(JSON(e.idx_ts) + ' ' + JSON(e.entry));
+  }
+  EXPECT_EQ(
+      "{\"index\":0,\"us\":100} {\"x\":1}\n"
+      "{\"index\":1,\"us\":200} {\"x\":2}\n"
+      "{\"index\":2,\"us\":300} {\"x\":3}",
+      current::strings::Join(replicated, '\n'));
+}
+
+TEST(Sherlock, BinaryReplicationResumesAfterCorruptedFrame) {
+  using namespace sherlock_unittest;
+  using namespace current::sherlock::replication;
+
+  using sherlock_t = current::sherlock::Stream<Record>;
+  sherlock_t replicated_stream;
+
+  const auto batch_frame = [](uint64_t begin, uint64_t end) {
+    std::string frame;
+    BeginFrame(frame, kBatchFrame);
+    for (uint64_t i = begin; i < end; ++i) {
+      current::serialization::binary::AppendBinary(frame, idxts_t(i, std::chrono::microseconds((i + 1u) * 100u)));
+      current::serialization::binary::AppendBinary(frame, Record(static_cast<int>(i + 1u)));
+    }
+    EndFrame(frame);
+    return frame;
+  };
+
+  std::mutex mutex;
+  std::vector<uint64_t> requested_indexes;
+
+  // Serve the first two entries and a corrupted frame with the third one, and then the third one on reconnect.
+  const auto scope =
+      HTTP(FLAGS_sherlock_http_test_port)
+          .Register("/log",
+                    URLPathArgs::CountMask::None | URLPathArgs::CountMask::One,
+                    [&batch_frame, &mutex, &requested_indexes](Request r) {
+                      const std::string subscription_id = "fake_subscription";
+                      if (r.url.query.has("terminate")) {
+                        EXPECT_EQ(r.url.query["terminate"], subscription_id);
+                      } else if (r.url.query.has("i")) {
+                        EXPECT_TRUE(r.url.query.has("replication"));
+                        const auto index = current::FromString<uint64_t>(r.url.query["i"]);
+                        {
+                          std::lock_guard<std::mutex> lock(mutex);
+                          requested_indexes.push_back(index);
+                        }
+                        auto response = r.connection.SendChunkedHTTPResponse(
+                            HTTPResponseCode.OK,
+                            "application/octet-stream",
+                            current::net::http::Headers({{"X-Current-Stream-Subscription-Id", subscription_id}}));
+                        if (index == 0u) {
+                          std::string corrupted_frame = batch_frame(2u, 3u);
+                          corrupted_frame.back() ^= 1;
+                          response.Send(batch_frame(0u, 2u) + corrupted_frame);
+                        } else if (index == 2u) {
+                          response.Send(batch_frame(2u, 3u));
+                        } else {
+                          EXPECT_EQ(3u, index);
+                        }
+                      } else {
+                        r(current::sherlock::SubscribableSherlockSchema(
+                            Value<current::reflection::ReflectedTypeBase>(
+                                current::reflection::Reflector().ReflectType<Record>()).type_id,
+                            "Record",
+                            "Namespace"));
+                      }
+                    });
+
+  current::sherlock::SubscribableRemoteStream<Record> remote_stream(
+      Printf("http://localhost:%d/log", FLAGS_sherlock_http_test_port),
+      "Record",
+      "Namespace",
+      current::sherlock::RemoteStreamFormat::Binary);
+  auto replicator = std::make_unique<current::sherlock::StreamReplicator<sherlock_t>>(replicated_stream);
+  {
+    const auto subscriber_scope = remote_stream.Subscribe(*replicator);
+    while (replicated_stream.Persister().Size() < 3u) {
+      std::this_thread::yield();
+    }
+  }
+
+  std::vector<std::string> replicated;
+  for (const auto& e : replicated_stream.Persister().Iterate()) {
+    replicated.push_back(JSON(e.idx_ts) + ' ' + JSON(e.entry));
+  }
+  EXPECT_EQ(
+      "{\"index\":0,\"us\":100} {\"x\":1}\n"
+      "{\"index\":1,\"us\":200} {\"x\":2}\n"
+      "{\"index\":2,\"us\":300} {\"x\":3}",
+      current::strings::Join(replicated, '\n'));
+  std::lock_guard<std::mutex> lock(mutex);
+  ASSERT_LE(2u, requested_indexes.size());
+  EXPECT_EQ(0u, requested_indexes[0]);
+  EXPECT_EQ(2u, requested_indexes[1]);
+}
+
 TEST(Sherlock, SubscribeWithFilterByType) {
   current::time::ResetToZero();
 
@@ -118,6 +118,16 @@ struct PerFieldRESTfulHandlerGenerator {
   PerFieldRESTfulHandlerGenerator(registerer_t registerer, STORAGE& storage, const std::string& restful_url_prefix)
       : registerer(registerer), storage(storage), restful_url_prefix(restful_url_prefix) {}
 
+  // Runs the POST, PUT, or PATCH, rolling back the transaction with "409 Conflict" if it violates a unique index.
+  template <typename HANDLER, typename INPUT>
+  static Response RunMutatingHandler(const HANDLER& handler, const INPUT& input) {
+    try {
+      return handler.Run(input);
+    } catch (const StorageUniqueIndexViolationException& e) {
+      CURRENT_STORAGE_THROW_ROLLBACK_WITH_VALUE(Response, REST_IMPL::ErrorUniqueIndexViolation(e.index, e.value));
+    }
+  }
+
   template <typename FIELD_TYPE, typename ENTRY_TYPE_WRAPPER>
   void operator()(const char* input_field_name, FIELD_TYPE, ENTRY_TYPE_WRAPPER) {
     auto& storage = this->storage;  // For lambdas.
@@ -195,7 +205,7 @@ struct PerFieldRESTfulHandlerGenerator {
                                                                   field_name,
                                                                   mutable_entry,
                                                                   overwrite);
-                                            return handler.Run(input);
+                                            return RunMutatingHandler(handler, input);
                                           },
                                           std::move(request)).Detach();
               } catch (const TypeSystemParseJSONException& e) {
@@ -227,7 +237,7 @@ struct PerFieldRESTfulHandlerGenerator {
                                                                  url_key,
                                                                  entry,
                                                                  entry_key);
-                                            return handler.Run(input);
+                                            return RunMutatingHandler(handler, input);
                                           },
                                           std::move(request)).Detach();
               } catch (const TypeSystemParseJSONException& e) {          // LCOV_EXCL_LINE
@@ -252,7 +262,7 @@ struct PerFieldRESTfulHandlerGenerator {
                                               RESTfulPATCHInput<STORAGE, specific_field_t, entry_t, key_t>;
                                           const PATCHInput input(
                                               std::move(generic_input), fields, field, field_name, url_key, patch_body);
-                                          return handler.Run(input);
+                                          return RunMutatingHandler(handler, input);
                                         },
                                         std::move(request)).Detach();
             });
@@ -312,12 +322,41 @@ struct PerFieldRESTfulHandlerGenerator {
                                                            URLPathArgs::CountMask::Any,
                                                            generic_data_handler)));
     }
+    RegisterSecondaryIndexHandlers<ENTRY_TYPE_WRAPPER>(field_name);
   }
 
+  template <typename ENTRY_TYPE_WRAPPER>
+  void RegisterSecondaryIndexHandlers(const std::string& field_name) {
+    container::SecondaryIndexes<typename ENTRY_TYPE_WRAPPER::key_t,
+                                typename ENTRY_TYPE_WRAPPER::entry_t,
+                                typename specific_field_t::indexes_t>::
+        ForEachIndex(SecondaryIndexHandlersRegisterer<ENTRY_TYPE_WRAPPER>{*this, field_name});
+  }
+
+  // Registers `/data/field.member` to list the values of the secondary index by `member`, with the number of entries
+  // for each, and `/data/field.member/value` to list the entries with this value, just as the rows of a matrix are.
+  template <typename ENTRY_TYPE_WRAPPER>
+  struct SecondaryIndexHandlersRegisterer {
+    PerFieldRESTfulHandlerGenerator& self;
+    const std::string& field_name;
+
+    template <typename SECONDARY_INDEX>
+    void operator()() const {
+      self.registerer(storage_handlers_map_entry_t(
+          field_name,
+          RESTfulRoute(kRESTfulDataURLComponent,
+                       std::string(".") + SECONDARY_INDEX::Name(),
+                       URLPathArgs::CountMask::None | URLPathArgs::CountMask::One,
+                       self.template GenerateRowOrColHandler<ENTRY_TYPE_WRAPPER,
+                                                             semantics::rest::operation::OnIndex<SECONDARY_INDEX>>(
+                           field_name))));
+    }
+  };
+
   template <typename ENTRY_TYPE_WRAPPER, typename PARTIAL_KEY_OPERATION>
   std::function<void(Request)> GenerateRowOrColHandler(const std::string& field_name) {
-    static_assert(std::is_same<PARTIAL_KEY_OPERATION, semantics::rest::operation::OnMatrixRow>::value ||
-                      std::is_same<PARTIAL_KEY_OPERATION, semantics::rest::operation::OnMatrixCol>::value,
+    static_assert(std::is_same<typename PARTIAL_KEY_OPERATION::key_completeness_t::completeness_family_t,
+                               semantics::key_completeness::MatrixHalfKey>::value,
                   "");
     auto& storage = this->storage;
     const std::string restful_url_prefix = this->restful_url_prefix;
@@ -382,6 +421,7 @@ struct PerFieldRESTfulHandlerGenerator {
                                                            URLPathArgs::CountMask::None | URLPathArgs::CountMask::One,
                                                            col_handler)));
     }
+    RegisterSecondaryIndexHandlers<ENTRY_TYPE_WRAPPER>(field_name);
   }
 };
 
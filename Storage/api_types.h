@@ -276,8 +276,8 @@ struct RESTfulGETInput : RESTfulGenericInput<STORAGE> {
 // A dedicated "GETInput" for the GETs over row or col of a matrix container.
 template <typename STORAGE, typename INCOMPLETE_KEY_TYPE, typename FIELD>
 struct RESTfulGETRowColInput : RESTfulGenericInput<STORAGE> {
-  static_assert(std::is_same<INCOMPLETE_KEY_TYPE, semantics::key_completeness::PartialRowKey>::value ||
-                    std::is_same<INCOMPLETE_KEY_TYPE, semantics::key_completeness::PartialColKey>::value,
+  static_assert(std::is_same<typename INCOMPLETE_KEY_TYPE::completeness_family_t,
+                             semantics::key_completeness::MatrixHalfKey>::value,
                 "");
 
   using field_t = FIELD;
@@ -531,6 +531,35 @@ struct MatrixContainerProxy<semantics::key_completeness::PartialColKey> {
   }
 };
 
+// The secondary index of a dictionary is browsed as if it were a matrix: the value of the indexed member is the "row",
+// and the entries with this value are its "cols", ref. `container/secondary_index.h`.
+template <typename INDEX>
+struct MatrixContainerProxy<semantics::key_completeness::PartialIndexKey<INDEX>> {
+  template <typename ENTRY>
+  using entry_outer_key_t = typename INDEX::value_t;
+
+  template <typename FIELD>
+  using outer_accessor_t = typename container::SecondaryIndex<typename current::decay<FIELD>::key_t,
+                                                              typename current::decay<FIELD>::entry_t,
+                                                              INDEX>::ValuesAccessor;
+
+  template <typename FIELD, typename VALUE>
+  static auto RowOrCol(FIELD&& field, VALUE&& value)
+      -> decltype(field.template Index<INDEX>().Find(std::forward<VALUE>(value))) {
+    return field.template Index<INDEX>().Find(std::forward<VALUE>(value));
+  }
+
+  template <typename FIELD>
+  static outer_accessor_t<FIELD> RowsOrCols(FIELD&& field) {
+    return field.template Index<INDEX>().Values();
+  }
+
+  static const std::string& PartialKeySuffix() {
+    static std::string suffix = INDEX::Name();
+    return suffix;
+  }
+};
+
 // A special type to wrap the iterator passed into matrix row/col metadata rendering.
 // The `OUTER_KEY` type is the type of the row or col respectively, when browsing rows or cols.
 // Its value is accessible as `iterator.key()`.
@@ -690,6 +719,11 @@ struct ExtractRowOrColDimensionType<semantics::key_completeness::PartialColKey,
   using matrix_dimension_t = typename FIELD::col_dimension_t;
 };
 
+template <typename INDEX, typename FIELD>
+struct ExtractRowOrColDimensionType<semantics::key_completeness::PartialIndexKey<INDEX>, FIELD> {
+  using matrix_dimension_t = semantics::matrix_dimension_type::IterableRange;
+};
+
 template <typename PARTIAL_KEY, typename FIELD>
 using GenericMatrixIterator = typename GenericMatrixIteratorImplSelector<
     PARTIAL_KEY,
@@ -28,7 +28,11 @@ SOFTWARE.
 
 #include "../port.h"
 
+#include <algorithm>
 #include <functional>
+#include <memory>
+#include <new>
+#include <vector>
 
 #include "semantics.h"
 #include "transaction.h"
@@ -155,16 +159,93 @@ struct TypeListMapperImpl<FIELDS, current::variadic_indexes::indexes<NS...>> {
 template <typename FIELDS, int COUNT>
 using FieldsTypeList = typename TypeListMapperImpl<FIELDS, current::variadic_indexes::generate_indexes<COUNT>>::result;
 
+constexpr size_t kMutationJournalArenaBlockSize = 64 * 1024;
+
+// The bump allocator for the records of `MutationJournal`. `Reset()` makes all the memory available again,
+// without releasing it, so that, once warmed up, transactions log their mutations with no allocations.
+class MutationJournalArena final {
+ public:
+  MutationJournalArena() = default;
+  MutationJournalArena(const MutationJournalArena&) = delete;
+  MutationJournalArena& operator=(const MutationJournalArena&) = delete;
+
+  void* Allocate(size_t size, size_t alignment) {
+    CURRENT_ASSERT(alignment && !(alignment & (alignment - 1u)) && alignment <= alignof(std::max_align_t));
+    while (true) {
+      if (block_index_ == blocks_.size()) {
+        const size_t block_size = std::max(kMutationJournalArenaBlockSize, size);
+        blocks_.push_back(Block{std::unique_ptr<char[]>(new char[block_size]), block_size});
+      }
+      const Block& block = blocks_[block_index_];
+      const size_t offset = (used_ + alignment - 1u) & ~(alignment - 1u);
+      if (offset + size <= block.size) {
+        used_ = offset + size;
+        return block.data.get() + offset;
+      }
+      ++block_index_;
+      used_ = 0u;
+    }
+  }
+
+  // The objects allocated must have been destroyed by now.
+  void Reset() {
+    block_index_ = 0u;
+    used_ = 0u;
+  }
+
+  void Swap(MutationJournalArena& rhs) {
+    blocks_.swap(rhs.blocks_);
+    std::swap(block_index_, rhs.block_index_);
+    std::swap(used_, rhs.used_);
+  }
+
+ private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  std::vector<Block> blocks_;
+  size_t block_index_ = 0u;
+  size_t used_ = 0u;
+};
+
 // `MutationJournal` keeps all the changes made during one transaction, as well as the way to rollback them.
+// Both the mutations and their typed undo records are kept in the arena, which is reset on commit or rollback.
 struct MutationJournal {
-  TransactionMeta transaction_meta;
-  std::vector<std::unique_ptr<current::CurrentStruct>> commit_log;
-  std::vector<std::function<void()>> rollback_log;
+  // The undo record of a mutation, holding whatever it takes to revert the mutation, typed by the container.
+  struct UndoRecord {
+    virtual ~UndoRecord() = default;
+    virtual void Rollback() = 0;
+  };
+
+  template <typename F>
+  struct TypedUndoRecord final : UndoRecord {
+    F rollback;
+    template <typename ARG>
+    explicit TypedUndoRecord(ARG&& rollback) : rollback(std::forward<ARG>(rollback)) {}
+    void Rollback() override { rollback(); }
+  };
 
-  template <typename T>
-  void LogMutation(T&& entry, std::function<void()> rollback) {
-    commit_log.push_back(std::make_unique<T>(std::move(entry)));
-    rollback_log.push_back(rollback);
+  TransactionMeta transaction_meta;
+  // The mutations, in the arena. The persister moves them out, and `Clear()` destroys what is left of them.
+  std::vector<current::CurrentStruct*> commit_log;
+  std::vector<UndoRecord*> rollback_log;
+
+  MutationJournal() = default;
+  MutationJournal(const MutationJournal&) = delete;
+  MutationJournal& operator=(const MutationJournal&) = delete;
+  ~MutationJournal() { DestroyRecords(); }
+
+  template <typename T, typename F>
+  void LogMutation(T&& entry, F&& rollback) {
+    using entry_t = current::decay<T>;
+    using undo_t = TypedUndoRecord<current::decay<F>>;
+    // Make room in the logs first, so that the records constructed are never lost track of if this throws.
+    commit_log.push_back(nullptr);
+    rollback_log.push_back(nullptr);
+    commit_log.back() = ::new (arena_.Allocate(sizeof(entry_t), alignof(entry_t))) entry_t(std::forward<T>(entry));
+    rollback_log.back() = ::new (arena_.Allocate(sizeof(undo_t), alignof(undo_t))) undo_t(std::forward<F>(rollback));
   }
 
   void BeforeTransaction() { transaction_meta.begin_us = current::time::Now(); }
@@ -173,7 +254,9 @@ struct MutationJournal {
 
   void Rollback() {
     for (auto rit = rollback_log.rbegin(); rit != rollback_log.rend(); ++rit) {
-      (*rit)();
+      if (*rit) {
+        (*rit)->Rollback();
+      }
     }
     Clear();
   }
@@ -182,8 +265,10 @@ struct MutationJournal {
     transaction_meta.begin_us = std::chrono::microseconds(0);
     transaction_meta.end_us = std::chrono::microseconds(0);
     transaction_meta.fields.clear();
+    DestroyRecords();
     commit_log.clear();
     rollback_log.clear();
+    arena_.Reset();
   }
 
   void AssertEmpty() const {
@@ -193,6 +278,30 @@ struct MutationJournal {
     CURRENT_ASSERT(commit_log.empty());
     CURRENT_ASSERT(rollback_log.empty());
   }
+
+  // Exchanges the contents of two journals, for a committed journal to be persisted while the next one is being filled.
+  void Swap(MutationJournal& rhs) {
+    std::swap(transaction_meta, rhs.transaction_meta);
+    commit_log.swap(rhs.commit_log);
+    rollback_log.swap(rhs.rollback_log);
+    arena_.Swap(rhs.arena_);
+  }
+
+ private:
+  void DestroyRecords() {
+    for (current::CurrentStruct* entry : commit_log) {
+      if (entry) {
+        entry->~CurrentStruct();
+      }
+    }
+    for (UndoRecord* undo : rollback_log) {
+      if (undo) {
+        undo->~UndoRecord();
+      }
+    }
+  }
+
+  MutationJournalArena arena_;
 };
 
 template <typename BASE>
@@ -25,6 +25,8 @@ SOFTWARE.
 #ifndef CURRENT_STORAGE_CONTAINER_COMMON_H
 #define CURRENT_STORAGE_CONTAINER_COMMON_H
 
+#include "order_statistics.h"
+
 #include "../../Bricks/util/comparators.h"
 
 namespace current {
@@ -27,6 +27,7 @@ SOFTWARE.
 #define CURRENT_STORAGE_CONTAINER_DICTIONARY_H
 
 #include "common.h"
+#include "secondary_index.h"
 #include "sfinae.h"
 
 #include "../base.h"
@@ -37,12 +38,17 @@ namespace current {
 namespace storage {
 namespace container {
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, template <typename...> class MAP>
+template <typename T,
+          typename UPDATE_EVENT,
+          typename DELETE_EVENT,
+          template <typename...> class MAP,
+          typename INDEXES = TypeListImpl<>>
 class GenericDictionary {
  public:
   using entry_t = T;
   using key_t = sfinae::entry_key_t<T>;
   using map_t = MAP<key_t, T>;
+  using indexes_t = INDEXES;
   using semantics_t = storage::semantics::Dictionary;
 
   GenericDictionary(const std::string& field_name, MutationJournal& journal)
@@ -74,6 +80,7 @@ class GenericDictionary {
   void Add(const T& object) {
     const auto now = current::time::Now();
     const auto key = sfinae::GetKey(object);
+    indexes_.CheckUniqueness(key, object);
     const auto map_iterator = map_.find(key);
     const auto lm_iterator = last_modified_.find(key);
     if (map_iterator != map_.end()) {
@@ -83,7 +90,7 @@ class GenericDictionary {
       journal_.LogMutation(UPDATE_EVENT(now, object),
                            [this, key, previous_object, previous_timestamp]() {
                              last_modified_[key] = previous_timestamp;
-                             map_[key] = previous_object;
+                             DoUpdate(key, previous_object);
                            });
     } else {
       if (lm_iterator != last_modified_.end()) {
@@ -91,18 +98,18 @@ class GenericDictionary {
         journal_.LogMutation(UPDATE_EVENT(now, object),
                              [this, key, previous_timestamp]() {
                                last_modified_[key] = previous_timestamp;
-                               map_.erase(key);
+                               DoErase(key);
                              });
       } else {
         journal_.LogMutation(UPDATE_EVENT(now, object),
                              [this, key]() {
                                last_modified_.erase(key);
-                               map_.erase(key);
+                               DoErase(key);
                              });
       }
     }
     last_modified_[key] = now;
-    map_[key] = object;
+    DoUpdate(key, object);
   }
 
   void Erase(sfinae::CF<key_t> key) {
@@ -116,9 +123,10 @@ class GenericDictionary {
       journal_.LogMutation(DELETE_EVENT(now, previous_object),
                            [this, key, previous_object, previous_timestamp]() {
                              last_modified_[key] = previous_timestamp;
-                             map_[key] = previous_object;
+                             DoUpdate(key, previous_object);
                            });
       last_modified_[key] = now;
+      indexes_.Erase(key, map_iterator->second);
       map_.erase(key);
     }
   }
@@ -126,11 +134,17 @@ class GenericDictionary {
   void operator()(const UPDATE_EVENT& e) {
     const auto key = sfinae::GetKey(e.data);
     last_modified_[key] = e.us;
-    map_[key] = e.data;
+    DoUpdate(key, e.data);
   }
   void operator()(const DELETE_EVENT& e) {
     last_modified_[e.key] = e.us;
-    map_.erase(e.key);
+    DoErase(e.key);
+  }
+
+  // The secondary index declared for this field, ex. `fields.users.Index<UserByEmail>()`.
+  template <typename INDEX>
+  const SecondaryIndex<key_t, T, INDEX>& Index() const {
+    return indexes_;
   }
 
   struct Iterator final {
@@ -151,35 +165,81 @@ class GenericDictionary {
   Iterator begin() const { return Iterator(map_.cbegin()); }
   Iterator end() const { return Iterator(map_.cend()); }
 
+  // For the ordered dictionaries, the first entry with the key greater than `key`, for the cursor-based pagination.
+  template <typename M = map_t, typename = decltype(std::declval<const M&>().upper_bound(std::declval<key_t>()))>
+  Iterator UpperBound(sfinae::CF<key_t> key) const {
+    return Iterator(map_.upper_bound(key));
+  }
+
+  // For the dictionaries with ranks, the `index`-th entry in the order of the keys, or `end()`, in O(log n).
+  template <typename M = map_t, typename = decltype(std::declval<const M&>().Select(0u))>
+  Iterator Select(size_t index) const {
+    return Iterator(map_.Select(index));
+  }
+
+  // For the dictionaries with ranks, the index of `UpperBound(key)`, in O(log n).
+  template <typename M = map_t, typename = decltype(std::declval<const M&>().UpperBoundIndex(std::declval<key_t>()))>
+  size_t UpperBoundIndex(sfinae::CF<key_t> key) const {
+    return map_.UpperBoundIndex(key);
+  }
+
  private:
+  // Every change of `map_` goes through these two, to keep the secondary indexes in sync with it.
+  void DoUpdate(sfinae::CF<key_t> key, const T& object) {
+    T& placeholder = map_[key];
+    indexes_.Erase(key, placeholder);  // A no-op for the newly created entry, which is not indexed yet.
+    placeholder = object;
+    indexes_.Insert(key, placeholder);
+  }
+
+  void DoErase(sfinae::CF<key_t> key) {
+    const auto map_iterator = map_.find(key);
+    if (map_iterator != map_.end()) {
+      indexes_.Erase(key, map_iterator->second);
+      map_.erase(key);
+    }
+  }
+
   const std::string field_name_;
   map_t map_;
+  SecondaryIndexes<key_t, T, INDEXES> indexes_;
   std::unordered_map<key_t, std::chrono::microseconds, CurrentHashFunction<key_t>> last_modified_;
   MutationJournal& journal_;
 };
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using UnorderedDictionary = GenericDictionary<T, UPDATE_EVENT, DELETE_EVENT, Unordered>;
+// `INDEXES` is the `TypeList<>` of the secondary indexes, declared with `CURRENT_STORAGE_INDEX`.
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using UnorderedDictionary = GenericDictionary<T, UPDATE_EVENT, DELETE_EVENT, Unordered, INDEXES>;
+
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using OrderedDictionary = GenericDictionary<T, UPDATE_EVENT, DELETE_EVENT, Ordered, INDEXES>;
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using OrderedDictionary = GenericDictionary<T, UPDATE_EVENT, DELETE_EVENT, Ordered>;
+// The `OrderedDictionary` which also finds its `i`-th entry in O(log n), at the cost of an extra index of its keys.
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using OrderedDictionaryWithRanks = GenericDictionary<T, UPDATE_EVENT, DELETE_EVENT, OrderedWithRanks, INDEXES>;
 
 }  // namespace container
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::UnorderedDictionary<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::UnorderedDictionary<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "UnorderedDictionary"; }
 };
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::OrderedDictionary<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::OrderedDictionary<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "OrderedDictionary"; }
 };
 
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::OrderedDictionaryWithRanks<T, E1, E2, I>> {
+  static const char* HumanReadableName() { return "OrderedDictionaryWithRanks"; }
+};
+
 }  // namespace storage
 }  // namespace current
 
 using current::storage::container::UnorderedDictionary;
 using current::storage::container::OrderedDictionary;
+using current::storage::container::OrderedDictionaryWithRanks;
 
 #endif  // CURRENT_STORAGE_CONTAINER_DICTIONARY_H
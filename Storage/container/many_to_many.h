@@ -27,6 +27,7 @@ SOFTWARE.
 #define CURRENT_STORAGE_CONTAINER_MANY_TO_MANY_H
 
 #include "common.h"
+#include "secondary_index.h"
 #include "sfinae.h"
 
 #include "../base.h"
@@ -44,7 +45,8 @@ template <typename T,
           typename UPDATE_EVENT,
           typename DELETE_EVENT,
           template <typename...> class ROW_MAP,
-          template <typename...> class COL_MAP>
+          template <typename...> class COL_MAP,
+          typename INDEXES = TypeListImpl<>>
 class GenericManyToMany {
  public:
   using entry_t = T;
@@ -56,6 +58,7 @@ class GenericManyToMany {
   using col_elements_map_t = ROW_MAP<row_t, const T*>;
   using forward_map_t = ROW_MAP<row_t, row_elements_map_t>;
   using transposed_map_t = COL_MAP<col_t, col_elements_map_t>;
+  using indexes_t = INDEXES;
   using semantics_t = storage::semantics::ManyToMany;
 
   GenericManyToMany(const std::string& field_name, MutationJournal& journal)
@@ -71,6 +74,7 @@ class GenericManyToMany {
     const auto row = sfinae::GetRow(object);
     const auto col = sfinae::GetCol(object);
     const auto key = std::make_pair(row, col);
+    indexes_.CheckUniqueness(key, object);
     const auto map_cit = map_.find(key);
     const auto lm_cit = last_modified_.find(key);
     if (map_cit != map_.end()) {
@@ -146,6 +150,12 @@ class GenericManyToMany {
   }
   void operator()(const DELETE_EVENT& e) { DoEraseWithLastModified(e.us, std::make_pair(e.key.first, e.key.second)); }
 
+  // The secondary index declared for this field, keyed by the `std::pair<row_t, col_t>`-s of the entries.
+  template <typename INDEX>
+  const SecondaryIndex<key_t, T, INDEX>& Index() const {
+    return indexes_;
+  }
+
   template <typename OUTER_MAP>
   struct OuterAccessor final {
     using OUTER_KEY = typename OUTER_MAP::key_type;
@@ -216,12 +226,20 @@ class GenericManyToMany {
   void DoUpdateWithLastModified(std::chrono::microseconds us, const key_t& key, const T& object) {
     last_modified_[key] = us;
     auto& placeholder = map_[key];
+    if (placeholder) {
+      indexes_.Erase(key, *placeholder);
+    }
     placeholder = std::make_unique<T>(object);
+    indexes_.Insert(key, *placeholder);
     forward_[key.first][key.second] = placeholder.get();
     transposed_[key.second][key.first] = placeholder.get();
   }
 
   void DoEraseWithoutTouchingLastModified(const key_t& key) {
+    const auto map_cit = map_.find(key);
+    if (map_cit != map_.end()) {
+      indexes_.Erase(key, *(map_cit->second));
+    }
     auto& map_row = forward_[key.first];
     map_row.erase(key.second);
     if (map_row.empty()) {
@@ -244,41 +262,42 @@ class GenericManyToMany {
   whole_matrix_map_t map_;
   forward_map_t forward_;
   transposed_map_t transposed_;
+  SecondaryIndexes<key_t, T, INDEXES> indexes_;
   std::unordered_map<key_t, std::chrono::microseconds, CurrentHashFunction<key_t>> last_modified_;
   MutationJournal& journal_;
 };
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using UnorderedManyToUnorderedMany = GenericManyToMany<T, UPDATE_EVENT, DELETE_EVENT, Unordered, Unordered>;
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using UnorderedManyToUnorderedMany = GenericManyToMany<T, UPDATE_EVENT, DELETE_EVENT, Unordered, Unordered, INDEXES>;
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using OrderedManyToOrderedMany = GenericManyToMany<T, UPDATE_EVENT, DELETE_EVENT, Ordered, Ordered>;
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using OrderedManyToOrderedMany = GenericManyToMany<T, UPDATE_EVENT, DELETE_EVENT, Ordered, Ordered, INDEXES>;
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using UnorderedManyToOrderedMany = GenericManyToMany<T, UPDATE_EVENT, DELETE_EVENT, Unordered, Ordered>;
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using UnorderedManyToOrderedMany = GenericManyToMany<T, UPDATE_EVENT, DELETE_EVENT, Unordered, Ordered, INDEXES>;
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using OrderedManyToUnorderedMany = GenericManyToMany<T, UPDATE_EVENT, DELETE_EVENT, Ordered, Unordered>;
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using OrderedManyToUnorderedMany = GenericManyToMany<T, UPDATE_EVENT, DELETE_EVENT, Ordered, Unordered, INDEXES>;
 
 }  // namespace container
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::UnorderedManyToUnorderedMany<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::UnorderedManyToUnorderedMany<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "UnorderedManyToUnorderedMany"; }
 };
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::OrderedManyToOrderedMany<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::OrderedManyToOrderedMany<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "OrderedManyToOrderedMany"; }
 };
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::UnorderedManyToOrderedMany<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::UnorderedManyToOrderedMany<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "UnorderedManyToOrderedMany"; }
 };
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::OrderedManyToUnorderedMany<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::OrderedManyToUnorderedMany<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "OrderedManyToUnorderedMany"; }
 };
 
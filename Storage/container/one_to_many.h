@@ -27,6 +27,7 @@ SOFTWARE.
 #define CURRENT_STORAGE_CONTAINER_ONE_TO_MANY_H
 
 #include "common.h"
+#include "secondary_index.h"
 #include "sfinae.h"
 
 #include "../base.h"
@@ -44,7 +45,8 @@ template <typename T,
           typename UPDATE_EVENT,
           typename DELETE_EVENT,
           template <typename...> class ROW_MAP,
-          template <typename...> class COL_MAP>
+          template <typename...> class COL_MAP,
+          typename INDEXES = TypeListImpl<>>
 class GenericOneToMany {
  public:
   using entry_t = T;
@@ -55,6 +57,7 @@ class GenericOneToMany {
   using row_elements_map_t = COL_MAP<col_t, const T*>;
   using forward_map_t = ROW_MAP<row_t, row_elements_map_t>;
   using transposed_map_t = row_elements_map_t;
+  using indexes_t = INDEXES;
   using semantics_t = storage::semantics::OneToMany;
 
   GenericOneToMany(const std::string& field_name, MutationJournal& journal)
@@ -73,6 +76,8 @@ class GenericOneToMany {
     const auto row = sfinae::GetRow(object);
     const auto col = sfinae::GetCol(object);
     const auto key = std::make_pair(row, col);
+    // The entry with the same col is displaced by this one, and may well have the same values.
+    indexes_.CheckUniqueness(key, object, [&col](const key_t& other) { return other.second == col; });
     const auto map_cit = map_.find(key);
     const auto lm_cit = last_modified_.find(key);
     if (map_cit != map_.end()) {
@@ -193,6 +198,12 @@ class GenericOneToMany {
   }
   void operator()(const DELETE_EVENT& e) { DoEraseWithLastModified(e.us, std::make_pair(e.key.first, e.key.second)); }
 
+  // The secondary index declared for this field, keyed by the `std::pair<row_t, col_t>`-s of the entries.
+  template <typename INDEX>
+  const SecondaryIndex<key_t, T, INDEX>& Index() const {
+    return indexes_;
+  }
+
   template <typename ROWS_MAP>
   struct RowsAccessor final {
     using key_t = typename ROWS_MAP::key_type;
@@ -258,12 +269,20 @@ class GenericOneToMany {
   void DoUpdateWithLastModified(std::chrono::microseconds us, const key_t& key, const T& object) {
     last_modified_[key] = us;
     auto& placeholder = map_[key];
+    if (placeholder) {
+      indexes_.Erase(key, *placeholder);
+    }
     placeholder = std::make_unique<T>(object);
+    indexes_.Insert(key, *placeholder);
     forward_[key.first][key.second] = placeholder.get();
     transposed_[key.second] = placeholder.get();
   }
 
   void DoEraseWithoutTouchingLastModified(const key_t& key) {
+    const auto map_cit = map_.find(key);
+    if (map_cit != map_.end()) {
+      indexes_.Erase(key, *(map_cit->second));
+    }
     auto& map_row = forward_[key.first];
     map_row.erase(key.second);
     if (map_row.empty()) {
@@ -282,41 +301,42 @@ class GenericOneToMany {
   elements_map_t map_;
   forward_map_t forward_;
   transposed_map_t transposed_;
+  SecondaryIndexes<key_t, T, INDEXES> indexes_;
   std::unordered_map<key_t, std::chrono::microseconds, CurrentHashFunction<key_t>> last_modified_;
   MutationJournal& journal_;
 };
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using UnorderedOneToUnorderedMany = GenericOneToMany<T, UPDATE_EVENT, DELETE_EVENT, Unordered, Unordered>;
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using UnorderedOneToUnorderedMany = GenericOneToMany<T, UPDATE_EVENT, DELETE_EVENT, Unordered, Unordered, INDEXES>;
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using OrderedOneToOrderedMany = GenericOneToMany<T, UPDATE_EVENT, DELETE_EVENT, Ordered, Ordered>;
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using OrderedOneToOrderedMany = GenericOneToMany<T, UPDATE_EVENT, DELETE_EVENT, Ordered, Ordered, INDEXES>;
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using UnorderedOneToOrderedMany = GenericOneToMany<T, UPDATE_EVENT, DELETE_EVENT, Unordered, Ordered>;
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using UnorderedOneToOrderedMany = GenericOneToMany<T, UPDATE_EVENT, DELETE_EVENT, Unordered, Ordered, INDEXES>;
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using OrderedOneToUnorderedMany = GenericOneToMany<T, UPDATE_EVENT, DELETE_EVENT, Ordered, Unordered>;
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using OrderedOneToUnorderedMany = GenericOneToMany<T, UPDATE_EVENT, DELETE_EVENT, Ordered, Unordered, INDEXES>;
 
 }  // namespace container
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::UnorderedOneToUnorderedMany<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::UnorderedOneToUnorderedMany<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "UnorderedOneToUnorderedMany"; }
 };
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::OrderedOneToOrderedMany<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::OrderedOneToOrderedMany<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "OrderedOneToOrderedMany"; }
 };
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::UnorderedOneToOrderedMany<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::UnorderedOneToOrderedMany<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "UnorderedOneToOrderedMany"; }
 };
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::OrderedOneToUnorderedMany<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::OrderedOneToUnorderedMany<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "OrderedOneToUnorderedMany"; }
 };
 
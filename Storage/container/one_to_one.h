@@ -27,6 +27,7 @@ SOFTWARE.
 #define CURRENT_STORAGE_CONTAINER_ONE_TO_ONE_H
 
 #include "common.h"
+#include "secondary_index.h"
 #include "sfinae.h"
 
 #include "../base.h"
@@ -43,7 +44,8 @@ template <typename T,
           typename UPDATE_EVENT,
           typename DELETE_EVENT,
           template <typename...> class ROW_MAP,
-          template <typename...> class COL_MAP>
+          template <typename...> class COL_MAP,
+          typename INDEXES = TypeListImpl<>>
 class GenericOneToOne {
  public:
   using entry_t = T;
@@ -53,6 +55,7 @@ class GenericOneToOne {
   using elements_map_t = std::unordered_map<key_t, std::unique_ptr<T>, CurrentHashFunction<key_t>>;
   using forward_map_t = ROW_MAP<row_t, const T*>;
   using transposed_map_t = COL_MAP<col_t, const T*>;
+  using indexes_t = INDEXES;
   using semantics_t = storage::semantics::OneToOne;
 
   GenericOneToOne(const std::string& field_name, MutationJournal& journal)
@@ -71,6 +74,9 @@ class GenericOneToOne {
     const auto row = sfinae::GetRow(object);
     const auto col = sfinae::GetCol(object);
     const auto key = std::make_pair(row, col);
+    // The entries with the same row or col are displaced by this one, and may well have the same values.
+    indexes_.CheckUniqueness(
+        key, object, [&row, &col](const key_t& other) { return other.first == row || other.second == col; });
     const auto map_cit = map_.find(key);
     const auto lm_cit = last_modified_.find(key);
     if (map_cit != map_.end()) {
@@ -246,6 +252,12 @@ class GenericOneToOne {
   }
   void operator()(const DELETE_EVENT& e) { DoEraseWithLastModified(e.us, std::make_pair(e.key.first, e.key.second)); }
 
+  // The secondary index declared for this field, keyed by the `std::pair<row_t, col_t>`-s of the entries.
+  template <typename INDEX>
+  const SecondaryIndex<key_t, T, INDEX>& Index() const {
+    return indexes_;
+  }
+
   using rows_outer_accessor_t = GenericMapAccessor<forward_map_t>;
   rows_outer_accessor_t Rows() const { return GenericMapAccessor<forward_map_t>(forward_); }
 
@@ -262,12 +274,20 @@ class GenericOneToOne {
   void DoUpdateWithLastModified(std::chrono::microseconds us, const key_t& key, const T& object) {
     last_modified_[key] = us;
     auto& placeholder = map_[key];
+    if (placeholder) {
+      indexes_.Erase(key, *placeholder);
+    }
     placeholder = std::make_unique<T>(object);
+    indexes_.Insert(key, *placeholder);
     forward_[key.first] = placeholder.get();
     transposed_[key.second] = placeholder.get();
   }
 
   void DoEraseWithoutTouchingLastModified(const key_t& key) {
+    const auto map_cit = map_.find(key);
+    if (map_cit != map_.end()) {
+      indexes_.Erase(key, *(map_cit->second));
+    }
     forward_.erase(key.first);
     transposed_.erase(key.second);
     map_.erase(key);
@@ -282,41 +302,42 @@ class GenericOneToOne {
   elements_map_t map_;
   forward_map_t forward_;
   transposed_map_t transposed_;
+  SecondaryIndexes<key_t, T, INDEXES> indexes_;
   std::unordered_map<key_t, std::chrono::microseconds, CurrentHashFunction<key_t>> last_modified_;
   MutationJournal& journal_;
 };
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using UnorderedOneToUnorderedOne = GenericOneToOne<T, UPDATE_EVENT, DELETE_EVENT, Unordered, Unordered>;
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using UnorderedOneToUnorderedOne = GenericOneToOne<T, UPDATE_EVENT, DELETE_EVENT, Unordered, Unordered, INDEXES>;
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using OrderedOneToOrderedOne = GenericOneToOne<T, UPDATE_EVENT, DELETE_EVENT, Ordered, Ordered>;
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using OrderedOneToOrderedOne = GenericOneToOne<T, UPDATE_EVENT, DELETE_EVENT, Ordered, Ordered, INDEXES>;
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using UnorderedOneToOrderedOne = GenericOneToOne<T, UPDATE_EVENT, DELETE_EVENT, Unordered, Ordered>;
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using UnorderedOneToOrderedOne = GenericOneToOne<T, UPDATE_EVENT, DELETE_EVENT, Unordered, Ordered, INDEXES>;
 
-template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
-using OrderedOneToUnorderedOne = GenericOneToOne<T, UPDATE_EVENT, DELETE_EVENT, Ordered, Unordered>;
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename INDEXES = TypeListImpl<>>
+using OrderedOneToUnorderedOne = GenericOneToOne<T, UPDATE_EVENT, DELETE_EVENT, Ordered, Unordered, INDEXES>;
 
 }  // namespace container
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::UnorderedOneToUnorderedOne<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::UnorderedOneToUnorderedOne<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "UnorderedOneToUnorderedOne"; }
 };
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::OrderedOneToOrderedOne<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::OrderedOneToOrderedOne<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "OrderedOneToOrderedOne"; }
 };
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::UnorderedOneToOrderedOne<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::UnorderedOneToOrderedOne<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "UnorderedOneToOrderedOne"; }
 };
 
-template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
-struct StorageFieldTypeSelector<container::OrderedOneToUnorderedOne<T, E1, E2>> {
+template <typename T, typename E1, typename E2, typename I>  // Entry, update event, delete event, indexes.
+struct StorageFieldTypeSelector<container::OrderedOneToUnorderedOne<T, E1, E2, I>> {
   static const char* HumanReadableName() { return "OrderedOneToUnorderedOne"; }
 };
 
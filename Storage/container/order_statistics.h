@@ -0,0 +1,232 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+          (c) 2016 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// `OrderedWithRanks<KEY, VALUE>` is the `std::map<>` which also finds its `i`-th element in O(log n).
+//
+// The ranks are kept in a treap of pointers to the keys of the map, with each node knowing the size of its subtree.
+// The nodes of `std::map<>` never move, so the pointers stay valid until the respective elements are erased.
+
+#ifndef CURRENT_STORAGE_CONTAINER_ORDER_STATISTICS_H
+#define CURRENT_STORAGE_CONTAINER_ORDER_STATISTICS_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+
+#include "../../Bricks/util/comparators.h"
+
+namespace current {
+namespace storage {
+namespace container {
+
+template <typename KEY>
+class OrderStatisticsIndex final {
+ public:
+  OrderStatisticsIndex() = default;
+  OrderStatisticsIndex(const OrderStatisticsIndex&) = delete;
+  OrderStatisticsIndex& operator=(const OrderStatisticsIndex&) = delete;
+  OrderStatisticsIndex(OrderStatisticsIndex&&) = default;
+  OrderStatisticsIndex& operator=(OrderStatisticsIndex&&) = default;
+
+  // The key must not be in the index yet.
+  void Insert(const KEY& key) {
+    std::unique_ptr<Node> lhs;
+    std::unique_ptr<Node> rhs;
+    Split(std::move(root_), key, false, lhs, rhs);
+    std::unique_ptr<Node> node(new Node(key, NextPriority()));
+    root_ = Merge(Merge(std::move(lhs), std::move(node)), std::move(rhs));
+  }
+
+  void Erase(const KEY& key) {
+    std::unique_ptr<Node> lhs;
+    std::unique_ptr<Node> mid;
+    std::unique_ptr<Node> rhs;
+    Split(std::move(root_), key, false, lhs, rhs);
+    Split(std::move(rhs), key, true, mid, rhs);
+    root_ = Merge(std::move(lhs), std::move(rhs));
+  }
+
+  // The key with exactly `index` keys less than it. The index must be less than the number of keys.
+  const KEY& Select(size_t index) const {
+    const Node* node = root_.get();
+    while (true) {
+      const size_t lhs_size = Size(node->lhs);
+      if (index < lhs_size) {
+        node = node->lhs.get();
+      } else if (index == lhs_size) {
+        return *node->key;
+      } else {
+        index -= lhs_size + 1u;
+        node = node->rhs.get();
+      }
+    }
+  }
+
+  // The number of keys not greater than `key`, which does not have to be in the index.
+  size_t CountNotGreaterThan(const KEY& key) const {
+    size_t count = 0u;
+    const Node* node = root_.get();
+    while (node) {
+      if (Less(key, *node->key)) {
+        node = node->lhs.get();
+      } else {
+        count += Size(node->lhs) + 1u;
+        node = node->rhs.get();
+      }
+    }
+    return count;
+  }
+
+ private:
+  struct Node {
+    const KEY* key;
+    uint32_t priority;
+    size_t size = 1u;
+    std::unique_ptr<Node> lhs;
+    std::unique_ptr<Node> rhs;
+    Node(const KEY& key, uint32_t priority) : key(&key), priority(priority) {}
+    void UpdateSize() { size = 1u + Size(lhs) + Size(rhs); }
+  };
+
+  static size_t Size(const std::unique_ptr<Node>& node) { return node ? node->size : 0u; }
+
+  static bool Less(const KEY& lhs, const KEY& rhs) { return CurrentComparator<KEY>()(lhs, rhs); }
+
+  // Moves the keys less than `key` into `lhs`, or, with `inclusive`, the keys not greater than `key`, and the rest into
+  // `rhs`.
+  static void Split(std::unique_ptr<Node> node,
+                    const KEY& key,
+                    bool inclusive,
+                    std::unique_ptr<Node>& lhs,
+                    std::unique_ptr<Node>& rhs) {
+    if (!node) {
+      lhs = nullptr;
+      rhs = nullptr;
+    } else if (inclusive ? !Less(key, *node->key) : Less(*node->key, key)) {
+      Split(std::move(node->rhs), key, inclusive, node->rhs, rhs);
+      node->UpdateSize();
+      lhs = std::move(node);
+    } else {
+      Split(std::move(node->lhs), key, inclusive, lhs, node->lhs);
+      node->UpdateSize();
+      rhs = std::move(node);
+    }
+  }
+
+  // All the keys in `lhs` must be less than all the keys in `rhs`.
+  static std::unique_ptr<Node> Merge(std::unique_ptr<Node> lhs, std::unique_ptr<Node> rhs) {
+    if (!lhs) {
+      return rhs;
+    } else if (!rhs) {
+      return lhs;
+    } else if (lhs->priority > rhs->priority) {
+      lhs->rhs = Merge(std::move(lhs->rhs), std::move(rhs));
+      lhs->UpdateSize();
+      return lhs;
+    } else {
+      rhs->lhs = Merge(std::move(lhs), std::move(rhs->lhs));
+      rhs->UpdateSize();
+      return rhs;
+    }
+  }
+
+  // Xorshift, as the priorities only need to be scattered, not unpredictable.
+  uint32_t NextPriority() {
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return seed_;
+  }
+
+  std::unique_ptr<Node> root_;
+  uint32_t seed_ = 2463534242u;
+};
+
+// The subset of the `std::map<>` interface used by the storage containers, plus `Select()` and `UpperBoundIndex()`.
+template <typename KEY, typename VALUE>
+class OrderedWithRanks final {
+ public:
+  using map_t = std::map<KEY, VALUE, CurrentComparator<KEY>>;
+  using iterator = typename map_t::iterator;
+  using const_iterator = typename map_t::const_iterator;
+
+  OrderedWithRanks() = default;
+  OrderedWithRanks(const OrderedWithRanks&) = delete;
+  OrderedWithRanks& operator=(const OrderedWithRanks&) = delete;
+  OrderedWithRanks(OrderedWithRanks&&) = default;
+  OrderedWithRanks& operator=(OrderedWithRanks&&) = default;
+
+  bool empty() const { return map_.empty(); }
+  size_t size() const { return map_.size(); }
+
+  iterator begin() { return map_.begin(); }
+  iterator end() { return map_.end(); }
+  const_iterator begin() const { return map_.begin(); }
+  const_iterator end() const { return map_.end(); }
+  const_iterator cbegin() const { return map_.cbegin(); }
+  const_iterator cend() const { return map_.cend(); }
+
+  iterator find(const KEY& key) { return map_.find(key); }
+  const_iterator find(const KEY& key) const { return map_.find(key); }
+  const_iterator lower_bound(const KEY& key) const { return map_.lower_bound(key); }
+  const_iterator upper_bound(const KEY& key) const { return map_.upper_bound(key); }
+
+  VALUE& operator[](const KEY& key) {
+    iterator map_iterator = map_.lower_bound(key);
+    if (map_iterator == map_.end() || CurrentComparator<KEY>()(key, map_iterator->first)) {
+      map_iterator = map_.emplace_hint(map_iterator, key, VALUE());
+      ranks_.Insert(map_iterator->first);
+    }
+    return map_iterator->second;
+  }
+
+  size_t erase(const KEY& key) {
+    const iterator map_iterator = map_.find(key);
+    if (map_iterator == map_.end()) {
+      return 0u;
+    }
+    ranks_.Erase(key);
+    map_.erase(map_iterator);
+    return 1u;
+  }
+
+  // The `index`-th element in the order of the keys, or `end()` if there are not as many, in O(log n).
+  const_iterator Select(size_t index) const {
+    return index < map_.size() ? map_.find(ranks_.Select(index)) : map_.cend();
+  }
+
+  // The index of `upper_bound(key)`, i.e., the number of keys not greater than `key`, in O(log n).
+  size_t UpperBoundIndex(const KEY& key) const { return ranks_.CountNotGreaterThan(key); }
+
+ private:
+  map_t map_;
+  OrderStatisticsIndex<KEY> ranks_;
+};
+
+}  // namespace container
+}  // namespace storage
+}  // namespace current
+
+#endif  // CURRENT_STORAGE_CONTAINER_ORDER_STATISTICS_H
@@ -0,0 +1,271 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+          (c) 2016 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// Secondary indexes of the dictionaries and the matrices, by a data member of their entries.
+//
+// CURRENT_STORAGE_INDEX(OrderedNonUnique, Employee, team, EmployeeByTeam);
+// CURRENT_STORAGE_INDEX(UnorderedUnique, Employee, email, EmployeeByEmail);
+// CURRENT_STORAGE_FIELD_ENTRY_WITH_INDEXES(UnorderedDictionary, Employee, EmployeeDictionary,
+//                                          EmployeeByTeam, EmployeeByEmail);
+//
+// Within a transaction, `fields.employees.Index<EmployeeByTeam>().Find("ads")` iterates over the employees of the
+// team, and `fields.employees.Index<EmployeeByEmail>()["d@k.com"]` is the `ImmutableOptional<>` employee.
+//
+// Each index maps the value of the member to the entries with this value, keyed by their primary keys, which are
+// the `std::pair<row_t, col_t>`-s for the matrices. The entries stay where the container keeps them, so the index
+// only holds pointers to them.
+
+#ifndef CURRENT_STORAGE_CONTAINER_SECONDARY_INDEX_H
+#define CURRENT_STORAGE_CONTAINER_SECONDARY_INDEX_H
+
+#include "common.h"
+#include "sfinae.h"
+
+#include "../exceptions.h"
+
+#include "../../TypeSystem/optional.h"
+#include "../../TypeSystem/Serialization/json.h"
+
+#include "../../Bricks/strings/util.h"
+#include "../../Bricks/template/typelist.h"
+#include "../../Bricks/util/iterator.h"
+#include "../../Bricks/util/singleton.h"
+
+namespace current {
+namespace storage {
+namespace container {
+namespace impl {
+
+// The value of the indexed member in the error messages: as is for the strings, and as JSON otherwise, as not every
+// type of the member, such as a `CURRENT_STRUCT`, has `current::ToString()`.
+template <typename T>
+std::string IndexedValueAsString(const T& value) {
+  return JSON(value);
+}
+
+inline std::string IndexedValueAsString(const std::string& value) { return value; }
+
+}  // namespace current::storage::container::impl
+
+namespace index {
+
+struct OrderedUnique {
+  constexpr static bool unique = true;
+  template <typename KEY, typename VALUE>
+  using map_t = Ordered<KEY, VALUE>;
+};
+
+struct UnorderedUnique {
+  constexpr static bool unique = true;
+  template <typename KEY, typename VALUE>
+  using map_t = Unordered<KEY, VALUE>;
+};
+
+struct OrderedNonUnique {
+  constexpr static bool unique = false;
+  template <typename KEY, typename VALUE>
+  using map_t = Ordered<KEY, VALUE>;
+};
+
+struct UnorderedNonUnique {
+  constexpr static bool unique = false;
+  template <typename KEY, typename VALUE>
+  using map_t = Unordered<KEY, VALUE>;
+};
+
+}  // namespace current::storage::container::index
+
+template <typename KEY, typename T, typename INDEX>
+class SecondaryIndex {
+ public:
+  using kind_t = typename INDEX::kind_t;
+  using value_t = typename INDEX::value_t;
+  using entries_map_t = typename kind_t::template map_t<KEY, const T*>;
+  using values_map_t = typename kind_t::template map_t<value_t, entries_map_t>;
+
+  static const char* Name() { return INDEX::Name(); }
+
+  // The distinct values of the member, each with its entries. In the order of the values for the ordered indexes.
+  struct ValuesAccessor final {
+    using key_t = value_t;
+    const values_map_t& map_;
+
+    struct ValuesIterator final {
+      using iterator_t = typename values_map_t::const_iterator;
+      iterator_t iterator;
+      explicit ValuesIterator(iterator_t iterator) : iterator(iterator) {}
+      void operator++() { ++iterator; }
+      bool operator==(const ValuesIterator& rhs) const { return iterator == rhs.iterator; }
+      bool operator!=(const ValuesIterator& rhs) const { return !operator==(rhs); }
+      sfinae::CF<typename INDEX::value_t> key() const { return iterator->first; }
+      sfinae::CF<typename INDEX::value_t> OuterKeyForPartialHypermediaCollectionView() const {
+        return iterator->first;
+      }
+      size_t TotalElementsForHypermediaCollectionView() const { return iterator->second.size(); }
+      using value_t = GenericMapAccessor<entries_map_t>;
+      void has_range_element_t() {}
+      using range_element_t = GenericMapAccessor<entries_map_t>;
+      range_element_t operator*() const { return range_element_t(iterator->second); }
+    };
+
+    explicit ValuesAccessor(const values_map_t& map) : map_(map) {}
+
+    bool Empty() const { return map_.empty(); }
+    size_t Size() const { return map_.size(); }
+    bool Has(sfinae::CF<value_t> value) const { return map_.find(value) != map_.end(); }
+
+    ValuesIterator begin() const { return ValuesIterator(map_.cbegin()); }
+    ValuesIterator end() const { return ValuesIterator(map_.cend()); }
+
+    template <typename M = values_map_t,
+              typename = decltype(std::declval<const M&>().lower_bound(std::declval<key_t>()))>
+    ValuesIterator LowerBound(sfinae::CF<value_t> value) const {
+      return ValuesIterator(map_.lower_bound(value));
+    }
+    template <typename M = values_map_t,
+              typename = decltype(std::declval<const M&>().upper_bound(std::declval<key_t>()))>
+    ValuesIterator UpperBound(sfinae::CF<value_t> value) const {
+      return ValuesIterator(map_.upper_bound(value));
+    }
+  };
+
+  ValuesAccessor Values() const { return ValuesAccessor(values_); }
+
+  // The entries with this value of the member, keyed by their primary keys. At most one for the unique indexes.
+  GenericMapAccessor<entries_map_t> Find(sfinae::CF<value_t> value) const {
+    const auto iterator = values_.find(value);
+    return GenericMapAccessor<entries_map_t>(
+        iterator != values_.end() ? iterator->second : current::ThreadLocalSingleton<entries_map_t>());
+  }
+
+  // The entry with this value of the member, for the unique indexes.
+  ImmutableOptional<T> operator[](sfinae::CF<value_t> value) const {
+    static_assert(kind_t::unique, "Only the unique indexes map the value into a single entry, use `Find()` instead.");
+    const auto iterator = values_.find(value);
+    if (iterator != values_.end() && !iterator->second.empty()) {
+      return ImmutableOptional<T>(FromBarePointer(), iterator->second.begin()->second);
+    } else {
+      return nullptr;
+    }
+  }
+
+ protected:
+  // Throws if the entry would take the value of the unique index from another entry, unless that entry is about to be
+  // displaced by this one, as told by `is_displaced(key)`.
+  template <typename F>
+  void CheckUniqueness(sfinae::CF<KEY> key, const T& entry, F&& is_displaced) const {
+    if (kind_t::unique) {
+      const value_t& value = INDEX::GetValue(entry);
+      const auto iterator = values_.find(value);
+      if (iterator != values_.end() && iterator->second.find(key) == iterator->second.end()) {
+        for (const auto& other : iterator->second) {
+          if (!is_displaced(other.first)) {
+            CURRENT_THROW(
+                StorageUniqueIndexViolationExceptionForIndex<INDEX>(impl::IndexedValueAsString(value), value));
+          }
+        }
+      }
+    }
+  }
+
+  void Insert(sfinae::CF<KEY> key, const T& entry) { values_[INDEX::GetValue(entry)][key] = &entry; }
+
+  void Erase(sfinae::CF<KEY> key, const T& entry) {
+    const auto iterator = values_.find(INDEX::GetValue(entry));
+    if (iterator != values_.end()) {
+      iterator->second.erase(key);
+      if (iterator->second.empty()) {
+        values_.erase(iterator);
+      }
+    }
+  }
+
+ private:
+  values_map_t values_;
+};
+
+// All the indexes of the dictionary, each as its own base class, to be found by its type.
+template <typename KEY, typename T, typename INDEXES>
+struct SecondaryIndexes;
+
+template <typename KEY, typename T>
+struct SecondaryIndexes<KEY, T, TypeListImpl<>> {
+  template <typename F>
+  void CheckUniqueness(sfinae::CF<KEY>, const T&, F&&) const {}
+  void CheckUniqueness(sfinae::CF<KEY>, const T&) const {}
+  void Insert(sfinae::CF<KEY>, const T&) {}
+  void Erase(sfinae::CF<KEY>, const T&) {}
+  template <typename F>
+  static void ForEachIndex(F&&) {}
+};
+
+template <typename KEY, typename T, typename INDEX, typename... INDEXES>
+struct SecondaryIndexes<KEY, T, TypeListImpl<INDEX, INDEXES...>> : SecondaryIndex<KEY, T, INDEX>,
+                                                                   SecondaryIndexes<KEY, T, TypeListImpl<INDEXES...>> {
+  using head_t = SecondaryIndex<KEY, T, INDEX>;
+  using tail_t = SecondaryIndexes<KEY, T, TypeListImpl<INDEXES...>>;
+
+  // Unique indexes are checked before the entry is added, but not when it is replayed: the replayed entries made it
+  // into the log, and a unique index just returns the first one of them on a conflict. Checked before any mutation
+  // is logged, so that a caught violation leaves nothing behind in the journal.
+  template <typename F>
+  void CheckUniqueness(sfinae::CF<KEY> key, const T& entry, F&& is_displaced) const {
+    head_t::CheckUniqueness(key, entry, is_displaced);
+    tail_t::CheckUniqueness(key, entry, is_displaced);
+  }
+  void CheckUniqueness(sfinae::CF<KEY> key, const T& entry) const {
+    CheckUniqueness(key, entry, [](sfinae::CF<KEY>) { return false; });
+  }
+  void Insert(sfinae::CF<KEY> key, const T& entry) {
+    head_t::Insert(key, entry);
+    tail_t::Insert(key, entry);
+  }
+  void Erase(sfinae::CF<KEY> key, const T& entry) {
+    head_t::Erase(key, entry);
+    tail_t::Erase(key, entry);
+  }
+
+  // Calls `f.template operator()<INDEX>()` for each index, to expose them via REST.
+  template <typename F>
+  static void ForEachIndex(F&& f) {
+    f.template operator()<INDEX>();
+    tail_t::ForEachIndex(std::forward<F>(f));
+  }
+};
+
+}  // namespace current::storage::container
+}  // namespace current::storage
+}  // namespace current
+
+#define CURRENT_STORAGE_INDEX(index_kind, entry_type, member, index_name)                      \
+  struct index_name {                                                                          \
+    using kind_t = ::current::storage::container::index::index_kind;                           \
+    using entry_t = entry_type;                                                                \
+    using value_t = ::current::decay<decltype(std::declval<const entry_type&>().member)>;      \
+    static const value_t& GetValue(const entry_type& entry) { return entry.member; }           \
+    static const char* Name() { return #member; }                                              \
+  }
+
+#endif  // CURRENT_STORAGE_CONTAINER_SECONDARY_INDEX_H
@@ -76,6 +76,25 @@ struct ReadWriteTransactionInFollowerStorageException : StorageException {
   using StorageException::StorageException;
 };
 
+// Thrown from `Add()`, and thus rolling back the transaction, if another entry already has this value of the member
+// indexed by a unique secondary index. The `value` is for the error messages, see the typed one below.
+struct StorageUniqueIndexViolationException : StorageException {
+  const std::string index;
+  const std::string value;
+  StorageUniqueIndexViolationException(const std::string& index, const std::string& value)
+      : StorageException("Unique index `" + index + "` already has the value `" + value + "`."),
+        index(index),
+        value(value) {}
+};
+
+// The exception actually thrown by the unique index `INDEX`, with the value of the member as is.
+template <typename INDEX>
+struct StorageUniqueIndexViolationExceptionForIndex : StorageUniqueIndexViolationException {
+  const typename INDEX::value_t typed_value;
+  StorageUniqueIndexViolationExceptionForIndex(const std::string& value, const typename INDEX::value_t& typed_value)
+      : StorageUniqueIndexViolationException(INDEX::Name(), value), typed_value(typed_value) {}
+};
+
 struct StorageInGracefulShutdownException : InGracefulShutdownException {
   using InGracefulShutdownException::InGracefulShutdownException;
 };
@@ -91,6 +110,10 @@ struct StorageInGracefulShutdownException : InGracefulShutdownException {
 
 using StorageCannotAppendToFile = const current::storage::StorageCannotAppendToFileException&;
 using StorageRollbackExceptionWithNoValue = const current::storage::StorageRollbackExceptionWithNoValue&;
+using StorageUniqueIndexViolation = const current::storage::StorageUniqueIndexViolationException&;
+template <typename INDEX>
+using StorageUniqueIndexViolationForIndex =
+    const current::storage::StorageUniqueIndexViolationExceptionForIndex<INDEX>&;
 template <typename T>
 using StorageRollbackExceptionWithValue = current::storage::StorageRollbackExceptionWithValue<T>&;
 
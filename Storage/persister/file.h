@@ -60,13 +60,17 @@ class JSONFilePersister<MUTATIONS_VARIANT, NoCustomPersisterParam> {
       if (os.bad()) {
         CURRENT_THROW(StorageCannotAppendToFileException(filename_));  // LCOV_EXCL_LINE
       }
-      for (auto&& entry : journal.commit_log) {
-        os << JSON(variant_t(BypassVariantTypeCheck(), std::move(entry))) << '\n';
+      for (current::CurrentStruct* entry : journal.commit_log) {
+        os << JSON(variant_t(BypassVariantTypeCheck(), std::move(*entry))) << '\n';
       }
     }
     journal.Clear();
   }
 
+  // The file is only ever appended to by `PersistJournal()`, so it needs no storage mutex held.
+  void PipelinedJournalCommitted() {}
+  void PersistPipelinedJournal(MutationJournal& journal) { PersistJournal(journal); }
+
   void InternalExposeStream() {}  // No-op to make it compile.
 
  private:
@@ -26,7 +26,10 @@ SOFTWARE.
 #ifndef CURRENT_STORAGE_PERSISTER_SHERLOCK_H
 #define CURRENT_STORAGE_PERSISTER_SHERLOCK_H
 
+#include <sstream>
+
 #include "common.h"
+#include "snapshot.h"
 #include "../base.h"
 #include "../exceptions.h"
 #include "../transaction.h"
@@ -48,19 +51,21 @@ class SherlockStreamPersisterImpl {
                                                      STREAM_RECORD_TYPE>::type;
   using sherlock_t = sherlock::Stream<sherlock_entry_t, UNDERLYING_PERSISTER>;
   using fields_update_function_t = std::function<void(const variant_t&)>;
+  using snapshot_functions_t = impl::StorageSnapshotFunctions<variant_t>;
+
+  using transactions_batch_t = std::vector<current::ss::IndexedEntry<transaction_t>>;
 
+  // The follower is passed the transactions in batches, to apply each batch under a single storage lock.
   struct SherlockSubscriberImpl {
     using EntryResponse = current::ss::EntryResponse;
     using TerminationResponse = current::ss::TerminationResponse;
-    using replay_function_t = std::function<void(const transaction_t&)>;
+    using replay_function_t = std::function<void(const transactions_batch_t&)>;
     replay_function_t replay_f_;
-    uint64_t next_replay_index_ = 0u;
 
     SherlockSubscriberImpl(replay_function_t f) : replay_f_(f) {}
 
-    EntryResponse operator()(const transaction_t& transaction, idxts_t current, idxts_t) {
-      replay_f_(transaction);
-      next_replay_index_ = current.index + 1u;
+    EntryResponse operator()(transactions_batch_t& transactions, idxts_t) {
+      replay_f_(transactions);
       return EntryResponse::More;
     }
 
@@ -69,39 +74,68 @@ class SherlockStreamPersisterImpl {
     EntryResponse EntryResponseIfNoMorePassTypeFilter() const { return EntryResponse::More; }
     TerminationResponse Terminate() const { return TerminationResponse::Terminate; }
   };
-  using SherlockSubscriber = current::ss::StreamSubscriber<SherlockSubscriberImpl, transaction_t>;
+  using SherlockSubscriber = current::ss::BatchedStreamSubscriber<SherlockSubscriberImpl, transaction_t>;
 
   template <typename... ARGS>
   explicit SherlockStreamPersisterImpl(std::mutex& storage_mutex, fields_update_function_t f, ARGS&&... args)
+      : SherlockStreamPersisterImpl(
+            storage_mutex, f, snapshot_functions_t(), StorageSnapshots(), std::forward<ARGS>(args)...) {}
+
+  // TODO(dkorolev): `ScopeOwnedBySomeoneElse<>` ?
+  explicit SherlockStreamPersisterImpl(std::mutex& storage_mutex,
+                                       fields_update_function_t f,
+                                       sherlock_t& stream_owned_by_someone_else)
+      : SherlockStreamPersisterImpl(
+            storage_mutex, f, snapshot_functions_t(), StorageSnapshots(), stream_owned_by_someone_else) {}
+
+  // With snapshots, the storage starts from the most recent matching snapshot, and only replays the rest of the stream.
+  template <typename... ARGS>
+  explicit SherlockStreamPersisterImpl(std::mutex& storage_mutex,
+                                       fields_update_function_t f,
+                                       snapshot_functions_t snapshot_f,
+                                       StorageSnapshots snapshots,
+                                       ARGS&&... args)
       : storage_mutex_ref_(storage_mutex),
         fields_update_f_(f),
+        snapshot_f_(snapshot_f),
+        snapshots_(std::move(snapshots)),
         stream_owned_if_any_(
             std::make_unique<sherlock::Stream<sherlock_entry_t, UNDERLYING_PERSISTER>>(std::forward<ARGS>(args)...)),
         stream_used_(*stream_owned_if_any_.get()),
         authority_(PersisterDataAuthority::Own) {
+    InitializeSnapshots();
     // Do not use lock since we are in ctor.
-    SyncReplayStream<current::locks::MutexLockStatus::AlreadyLocked>();
+    SyncReplayStream<current::locks::MutexLockStatus::AlreadyLocked>(next_index_);
   }
 
-  // TODO(dkorolev): `ScopeOwnedBySomeoneElse<>` ?
   explicit SherlockStreamPersisterImpl(std::mutex& storage_mutex,
                                        fields_update_function_t f,
+                                       snapshot_functions_t snapshot_f,
+                                       StorageSnapshots snapshots,
                                        sherlock_t& stream_owned_by_someone_else)
-      : storage_mutex_ref_(storage_mutex), fields_update_f_(f), stream_used_(stream_owned_by_someone_else) {
+      : storage_mutex_ref_(storage_mutex),
+        fields_update_f_(f),
+        snapshot_f_(snapshot_f),
+        snapshots_(std::move(snapshots)),
+        stream_used_(stream_owned_by_someone_else) {
     authority_ = (stream_used_.DataAuthority() == current::sherlock::StreamDataAuthority::Own)
                      ? PersisterDataAuthority::Own
                      : PersisterDataAuthority::External;
-    subscriber_ =
-        std::make_unique<SherlockSubscriber>([this](const transaction_t& transaction) { ApplyMutations(transaction); });
+    subscriber_ = std::make_unique<SherlockSubscriber>(
+        [this](const transactions_batch_t& transactions) { ApplyTransactions(transactions); });
+    InitializeSnapshots();
     if (authority_ == PersisterDataAuthority::Own) {
       // Do not use lock since we are in ctor.
-      SyncReplayStream<current::locks::MutexLockStatus::AlreadyLocked>();
+      SyncReplayStream<current::locks::MutexLockStatus::AlreadyLocked>(next_index_);
     } else {
       SubscribeToStream();
     }
   }
 
-  ~SherlockStreamPersisterImpl() { TerminateStreamSubscription(); }
+  ~SherlockStreamPersisterImpl() {
+    TerminateStreamSubscription();
+    snapshot_taker_ = nullptr;  // Takes the requested snapshot, if any, while the storage fields are still there.
+  }
 
   PersisterDataAuthority DataAuthority() const {
     std::lock_guard<std::mutex> lock(storage_mutex_ref_);
@@ -110,21 +144,46 @@ class SherlockStreamPersisterImpl {
 
   void PersistJournal(MutationJournal& journal) {
     if (!journal.commit_log.empty()) {
-#ifndef CURRENT_MOCK_TIME
-      CURRENT_ASSERT(journal.transaction_meta.begin_us < journal.transaction_meta.end_us);
-#else
-      CURRENT_ASSERT(journal.transaction_meta.begin_us <= journal.transaction_meta.end_us);
-#endif
-      transaction_t transaction;
-      for (auto&& entry : journal.commit_log) {
-        transaction.mutations.emplace_back(BypassVariantTypeCheck(), std::move(entry));
-      }
-      std::swap(transaction.meta, journal.transaction_meta);
-      stream_used_.Publish(std::move(transaction));
+      mutations_count_ += journal.commit_log.size();
+      const idxts_t idxts = PublishJournal(journal);
+      next_index_ = idxts.index + 1u;
+      last_entry_us_ = idxts.us;
+      MaybeTakeSnapshot();
     }
     journal.Clear();
   }
 
+  // Called with the storage mutex locked, as the journal is handed over to `PersistPipelinedJournal()`.
+  void PipelinedJournalCommitted() { ++pipelined_journals_pending_; }
+
+  // Called with the storage mutex not locked, in the order of the commits, while the storage fields may already reflect
+  // the journals committed after this one. The snapshots are only taken once the fields are not ahead of the stream.
+  void PersistPipelinedJournal(MutationJournal& journal) {
+    const size_t mutations = journal.commit_log.size();
+    const idxts_t idxts = mutations ? PublishJournal(journal) : idxts_t();
+    journal.Clear();
+    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    if (mutations) {
+      mutations_count_ += mutations;
+      next_index_ = idxts.index + 1u;
+      last_entry_us_ = idxts.us;
+    }
+    CURRENT_ASSERT(pipelined_journals_pending_);
+    --pipelined_journals_pending_;
+    if (!pipelined_journals_pending_ && snapshot_postponed_) {
+      snapshot_postponed_ = false;
+      snapshot_taker_->Request();
+    }
+    MaybeTakeSnapshot();
+  }
+
+  // Requests a snapshot of the storage, regardless of `every_n_entries`.
+  // The snapshot is taken in the background. A no-op without snapshots.
+  void TakeSnapshot() {
+    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    DoTakeSnapshot();
+  }
+
   void ExposeRawLogViaHTTP(uint16_t port, const std::string& route) {
     handlers_scope_ +=
         HTTP(port).Register(route, URLPathArgs::CountMask::None | URLPathArgs::CountMask::One, stream_used_);
@@ -137,7 +196,7 @@ class SherlockStreamPersisterImpl {
     current::locks::SmartMutexLockGuard<MLS> lock(storage_mutex_ref_);
     if (stream_used_.DataAuthority() == current::sherlock::StreamDataAuthority::Own) {
       TerminateStreamSubscription();
-      SyncReplayStream<current::locks::MutexLockStatus::AlreadyLocked>(subscriber_->next_replay_index_);
+      SyncReplayStream<current::locks::MutexLockStatus::AlreadyLocked>(next_index_);
       subscriber_ = nullptr;
     } else {
       CURRENT_THROW(UnderlyingStreamHasExternalDataAuthorityException());
@@ -145,28 +204,141 @@ class SherlockStreamPersisterImpl {
   }
 
  private:
+  idxts_t PublishJournal(MutationJournal& journal) {
+#ifndef CURRENT_MOCK_TIME
+    CURRENT_ASSERT(journal.transaction_meta.begin_us < journal.transaction_meta.end_us);
+#else
+    CURRENT_ASSERT(journal.transaction_meta.begin_us <= journal.transaction_meta.end_us);
+#endif
+    transaction_t transaction;
+    transaction.mutations.reserve(journal.commit_log.size());
+    for (current::CurrentStruct* entry : journal.commit_log) {
+      transaction.mutations.emplace_back(BypassVariantTypeCheck(), std::move(*entry));
+    }
+    std::swap(transaction.meta, journal.transaction_meta);
+    return stream_used_.Publish(std::move(transaction));
+  }
+
   template <current::locks::MutexLockStatus MLS>
-  void SyncReplayStream(uint64_t from_idx = 0u) {
+  void SyncReplayStream(uint64_t from_idx) {
     for (const auto& stream_record : stream_used_.Persister().Iterate(from_idx)) {
       if (Exists<transaction_t>(stream_record.entry)) {
         const transaction_t& transaction = Value<transaction_t>(stream_record.entry);
-        ApplyMutations<MLS>(transaction);
+        ApplyMutations<MLS>(transaction, stream_record.idx_ts);
+      } else {
+        current::locks::SmartMutexLockGuard<MLS> lock(storage_mutex_ref_);
+        next_index_ = stream_record.idx_ts.index + 1u;
+        last_entry_us_ = stream_record.idx_ts.us;
       }
     }
   }
 
   template <current::locks::MutexLockStatus MLS = current::locks::MutexLockStatus::NeedToLock>
-  void ApplyMutations(const transaction_t& transaction) {
+  void ApplyMutations(const transaction_t& transaction, idxts_t idxts) {
     current::locks::SmartMutexLockGuard<MLS> lock(storage_mutex_ref_);
     for (const auto& mutation : transaction.mutations) {
       fields_update_f_(mutation);
     }
+    mutations_count_ += transaction.mutations.size();
+    next_index_ = idxts.index + 1u;
+    last_entry_us_ = idxts.us;
+    MaybeTakeSnapshot();
+  }
+
+  void ApplyTransactions(const transactions_batch_t& transactions) {
+    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    for (const auto& transaction : transactions) {
+      ApplyMutations<current::locks::MutexLockStatus::AlreadyLocked>(transaction.entry, transaction.idx_ts);
+    }
   }
 
   void SubscribeToStream() {
     CURRENT_ASSERT(!subscriber_scope_);
     CURRENT_ASSERT(subscriber_);
-    subscriber_scope_ = std::move(stream_used_.template Subscribe<transaction_t>(*subscriber_));
+    subscriber_scope_ = std::move(stream_used_.template Subscribe<transaction_t>(*subscriber_, next_index_));
+  }
+
+  // Loads the most recent snapshot which matches the stream, if any, and starts the snapshot taker.
+  // Called from the constructor, so does not lock the storage mutex.
+  void InitializeSnapshots() {
+    if (!snapshots_.Enabled()) {
+      return;
+    }
+    CURRENT_ASSERT(snapshot_f_.restore && snapshot_f_.restore_transactions_count && snapshot_f_.size &&
+                   snapshot_f_.snapshot);
+    const uint64_t stream_size = stream_used_.Persister().Size();
+    StorageSnapshotHeader header;
+    for (const auto& snapshot : impl::ListStorageSnapshots(snapshots_.path)) {
+      if (snapshot.first <= stream_size &&
+          impl::ReadStorageSnapshot<variant_t>(snapshot.second,
+                                               header,
+                                               [this, &snapshot](const StorageSnapshotHeader& snapshot_header) {
+                                                 return snapshot_header.index == snapshot.first &&
+                                                        SnapshotMatchesStream(snapshot_header);
+                                               },
+                                               snapshot_f_.restore)) {
+        snapshot_f_.restore_transactions_count(header.transactions);
+        mutations_count_ = header.transactions;
+        next_index_ = header.index;
+        last_entry_us_ = header.us;
+        last_snapshot_index_ = header.index;
+        written_snapshot_index_ = header.index;
+        break;
+      }
+    }
+    snapshot_taker_ = std::make_unique<impl::StorageSnapshotTaker>([this]() { WriteSnapshot(); });
+  }
+
+  bool SnapshotMatchesStream(const StorageSnapshotHeader& header) const {
+    if (!header.index) {
+      return true;
+    }
+    for (const auto& stream_record : stream_used_.Persister().Iterate(header.index - 1u, header.index)) {
+      return stream_record.idx_ts.us == header.us;
+    }
+    return false;
+  }
+
+  // Must be called with the storage mutex locked.
+  void MaybeTakeSnapshot() {
+    if (snapshots_.every_n_entries && next_index_ >= last_snapshot_index_ + snapshots_.every_n_entries) {
+      DoTakeSnapshot();
+    }
+  }
+
+  // Must be called with the storage mutex locked. Only requests the snapshot, which is then taken in the background.
+  void DoTakeSnapshot() {
+    if (snapshot_taker_ && next_index_ != last_snapshot_index_) {
+      snapshot_taker_->Request();
+      last_snapshot_index_ = next_index_;
+    }
+  }
+
+  // Called from the snapshot taker thread. Serializes the storage fields with the storage mutex locked, for them to
+  // reflect exactly the first `next_index_` stream entries, and writes the snapshot file once the mutex is released.
+  // With the `Pipelined` policy, the snapshot is postponed while the fields are ahead of the persisted stream.
+  void WriteSnapshot() {
+    StorageSnapshotHeader header;
+    std::string mutations;
+    {
+      std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+      if (pipelined_journals_pending_) {
+        snapshot_postponed_ = true;
+        return;
+      }
+      if (next_index_ == written_snapshot_index_) {
+        return;
+      }
+      header.index = next_index_;
+      header.us = last_entry_us_;
+      header.mutations = snapshot_f_.size();
+      header.transactions = mutations_count_;
+      std::ostringstream os;
+      snapshot_f_.snapshot([&os](const variant_t& mutation) { os << JSON(mutation) << '\n'; });
+      mutations = os.str();
+      written_snapshot_index_ = next_index_;
+    }
+    impl::WriteStorageSnapshot(snapshots_, header, mutations);
   }
 
   void TerminateStreamSubscription() { subscriber_scope_ = nullptr; }
@@ -174,6 +346,19 @@ class SherlockStreamPersisterImpl {
  private:
   std::mutex& storage_mutex_ref_;
   fields_update_function_t fields_update_f_;
+  snapshot_functions_t snapshot_f_;
+  const StorageSnapshots snapshots_;
+  // The number of stream entries reflected by the storage, and the timestamp of the last of them.
+  uint64_t next_index_ = 0u;
+  std::chrono::microseconds last_entry_us_ = std::chrono::microseconds(0);
+  // The number of mutations in the first `next_index_` stream entries.
+  uint64_t mutations_count_ = 0u;
+  // The stream index the most recent snapshot was requested as of, and the one of the most recent snapshot written.
+  uint64_t last_snapshot_index_ = 0u;
+  uint64_t written_snapshot_index_ = 0u;
+  // The journals handed over by the `Pipelined` policy and not yet persisted, while the snapshot waits for them.
+  uint64_t pipelined_journals_pending_ = 0u;
+  bool snapshot_postponed_ = false;
   // `stream_{used/owned}_` are two variables to support both owning and non-owning Storage usage patterns.
   std::unique_ptr<sherlock::Stream<transaction_t, UNDERLYING_PERSISTER>> stream_owned_if_any_;
   sherlock_t& stream_used_;
@@ -181,6 +366,7 @@ class SherlockStreamPersisterImpl {
   current::sherlock::SubscriberScope subscriber_scope_;
   PersisterDataAuthority authority_;
   HTTPRoutesScope handlers_scope_;
+  std::unique_ptr<impl::StorageSnapshotTaker> snapshot_taker_;
 };
 
 template <typename TYPELIST, typename STREAM_RECORD_TYPE = NoCustomPersisterParam>
@@ -0,0 +1,292 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+          (c) 2016 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// Storage snapshots, for the storage to not replay the whole stream on startup.
+//
+// A snapshot holds the contents of all the storage fields as of a certain point in the stream, as the `Updated`
+// mutations which recreate them. The first line of the snapshot file is `StorageSnapshotHeader`: the number of stream
+// entries reflected by the snapshot, the timestamp of the last of them, the number of mutations to follow, one per
+// line, and the number of mutations in the part of the stream the snapshot replaces, for `TransactionsCount()`.
+// Snapshot files are named `<path>.<index>`, with the index zero-padded to twenty digits. A snapshot is written
+// into a temporary file first, and then renamed, so that the snapshot file is either complete or absent.
+//
+// The snapshots are taken off the commit path, by a dedicated thread. The thread locks the storage mutex only to
+// serialize the contents of the storage fields into a buffer, one mutation at a time, and writes the buffer into the
+// file, syncs it, and removes the older snapshots with the mutex released. The transactions wait for the fields to be
+// serialized, while the read-only ones which do not lock the storage mutex, as with the `SynchronousWithSharedReads`
+// policy, run alongside it. With the `Pipelined` policy, the snapshot is postponed until the storage fields are no
+// longer ahead of the persisted stream.
+// The snapshot file is synced to the disk before it is renamed, and its directory after, to survive a crash intact.
+//
+// On startup, the newest snapshot which matches the stream is loaded, and only the entries past it are replayed.
+// A snapshot matches the stream if the stream has at least `index` entries, and the timestamp of its entry
+// `index - 1` is the one in the snapshot header. The snapshots which do not match, or do not parse, are ignored.
+//
+// NOTE: Snapshots only keep the entries present in the storage. The last modification timestamps of the deleted
+// entries are not preserved.
+
+#ifndef CURRENT_STORAGE_PERSISTER_SNAPSHOT_H
+#define CURRENT_STORAGE_PERSISTER_SNAPSHOT_H
+
+#include "../../port.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifndef CURRENT_WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "../../TypeSystem/struct.h"
+#include "../../TypeSystem/Serialization/json.h"
+
+#include "../../Bricks/file/file.h"
+#include "../../Bricks/strings/printf.h"
+#include "../../Bricks/strings/util.h"
+
+namespace current {
+namespace storage {
+namespace persister {
+
+CURRENT_STRUCT(StorageSnapshotHeader) {
+  CURRENT_FIELD(index, uint64_t, 0u);  // The number of stream entries reflected by the snapshot.
+  CURRENT_FIELD(us, std::chrono::microseconds, std::chrono::microseconds(0));  // The timestamp of the last of them.
+  CURRENT_FIELD(mutations, uint64_t, 0u);
+  CURRENT_FIELD(transactions, uint64_t, 0u);  // The number of mutations in the first `index` stream entries.
+};
+
+// Where to keep the snapshots, how often to take them, and how many of them to keep.
+// With an empty `path`, no snapshots are taken or loaded.
+struct StorageSnapshots final {
+  std::string path;
+  // Take a snapshot once this many stream entries were applied since the previous one. Zero for manual snapshots only.
+  uint64_t every_n_entries;
+  // Keep this many most recent snapshots, removing the older ones. Zero to keep them all.
+  size_t keep;
+
+  StorageSnapshots() : every_n_entries(0u), keep(0u) {}
+  explicit StorageSnapshots(const std::string& path, uint64_t every_n_entries = 1000000u, size_t keep = 2u)
+      : path(path), every_n_entries(every_n_entries), keep(keep) {}
+
+  bool Enabled() const { return !path.empty(); }
+};
+
+namespace impl {
+
+namespace constants {
+constexpr char kSnapshotFileSuffixFormatString[] = ".%020llu";
+constexpr size_t kSnapshotFileSuffixLength = 21u;
+}  // namespace current::storage::persister::impl::constants
+
+inline std::string StorageSnapshotFileName(const std::string& path, uint64_t index) {
+  return path + current::strings::Printf(constants::kSnapshotFileSuffixFormatString,
+                                         static_cast<unsigned long long>(index));
+}
+
+// The `{ index, file name }` pairs of the existing snapshots, the most recent first.
+inline std::vector<std::pair<uint64_t, std::string>> ListStorageSnapshots(const std::string& path) {
+  const size_t separator = path.rfind(current::FileSystem::GetPathSeparator());
+  const std::string directory = (separator == std::string::npos) ? "." : path.substr(0u, separator);
+  const std::string prefix = (separator == std::string::npos) ? path : path.substr(separator + 1u);
+  std::vector<std::pair<uint64_t, std::string>> result;
+  try {
+    current::FileSystem::ScanDir(directory, [&](const current::FileSystem::ScanDirItemInfo& item) {
+      const std::string& name = item.basename;
+      if (name.length() == prefix.length() + constants::kSnapshotFileSuffixLength &&
+          !name.compare(0u, prefix.length(), prefix) && name[prefix.length()] == '.' &&
+          std::all_of(name.begin() + prefix.length() + 1u, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        result.emplace_back(current::strings::FromString<uint64_t>(name.substr(prefix.length() + 1u)), item.pathname);
+      }
+    });
+  } catch (const current::FileException&) {
+    // No directory, no snapshots.
+  }
+  std::sort(result.rbegin(), result.rend());
+  return result;
+}
+
+// Reads the snapshot, passing its mutations to `f` one at a time. Returns `false` if the snapshot is incomplete or does
+// not parse, or if `matches` returns `false` for its header. The snapshot is read twice, to validate it before any
+// mutation is passed, so that a broken snapshot is never applied partially, and is never held in memory in full.
+template <typename VARIANT, typename F_MATCHES, typename F>
+bool ReadStorageSnapshot(const std::string& file_name, StorageSnapshotHeader& header, F_MATCHES&& matches, F&& f) {
+  const auto read = [&file_name, &header](const std::function<void(const VARIANT&)>& g) {
+    std::ifstream fi(file_name);
+    std::string line;
+    uint64_t mutations = 0u;
+    try {
+      if (!std::getline(fi, line)) {
+        return false;
+      }
+      header = ParseJSON<StorageSnapshotHeader>(line);
+      while (std::getline(fi, line)) {
+        if (mutations == header.mutations) {
+          return false;
+        }
+        const VARIANT mutation = ParseJSON<VARIANT>(line);
+        if (g) {
+          g(mutation);
+        }
+        ++mutations;
+      }
+    } catch (const current::Exception&) {
+      return false;
+    }
+    return mutations == header.mutations;
+  };
+  return read(nullptr) && matches(static_cast<const StorageSnapshotHeader&>(header)) && read(f);
+}
+
+// Syncs the file, or the directory, to the disk. Returns `false` if it could not be synced.
+inline bool SyncStorageSnapshotFile(const std::string& file_name) {
+#ifndef CURRENT_WINDOWS
+  const int fd = ::open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  const bool synced = !::fsync(fd);
+  ::close(fd);
+  return synced;
+#else
+  static_cast<void>(file_name);
+  return true;
+#endif
+}
+
+// Writes the snapshot, then removes the ones beyond the retention limit. `mutations` are the `header.mutations`
+// mutations, serialized one per line.
+// A failure to write the snapshot is not fatal, it only results in a longer replay on startup.
+inline void WriteStorageSnapshot(const StorageSnapshots& params,
+                                 const StorageSnapshotHeader& header,
+                                 const std::string& mutations) {
+  const std::string file_name = StorageSnapshotFileName(params.path, header.index);
+  const std::string tmp_file_name = file_name + ".tmp";
+  bool written = false;
+  {
+    std::ofstream fo(tmp_file_name);
+    if (fo.good()) {
+      fo << JSON(header) << '\n';
+      fo << mutations;
+      fo.close();
+      written = fo.good() && SyncStorageSnapshotFile(tmp_file_name);
+    }
+  }
+  try {
+    if (written) {
+      current::FileSystem::RenameFile(tmp_file_name, file_name);
+    } else {
+      current::FileSystem::RmFile(tmp_file_name, current::FileSystem::RmFileParameters::Silent);
+      return;
+    }
+  } catch (const current::FileException&) {
+    current::FileSystem::RmFile(tmp_file_name, current::FileSystem::RmFileParameters::Silent);
+    return;
+  }
+  const size_t separator = params.path.rfind(current::FileSystem::GetPathSeparator());
+  SyncStorageSnapshotFile((separator == std::string::npos) ? "." : params.path.substr(0u, separator));
+  if (params.keep) {
+    const auto snapshots = ListStorageSnapshots(params.path);
+    for (size_t i = params.keep; i < snapshots.size(); ++i) {
+      current::FileSystem::RmFile(snapshots[i].second, current::FileSystem::RmFileParameters::Silent);
+    }
+  }
+}
+
+// The storage side of the snapshots, passed by the storage to its persister.
+// All the functions are called by the persister with the storage mutex locked.
+template <typename VARIANT>
+struct StorageSnapshotFunctions final {
+  // Applies a mutation of the snapshot to the storage fields, without counting it as a transaction.
+  std::function<void(const VARIANT& mutation)> restore;
+  // Sets the number of transactions, once the snapshot which replaces the first `transactions` of them is restored.
+  std::function<void(uint64_t transactions)> restore_transactions_count;
+  // The number of mutations `snapshot` passes, which is the number of entries in all the storage fields.
+  std::function<uint64_t()> size;
+  // Passes the contents of all the storage fields, as the mutations which recreate them, one at a time.
+  std::function<void(const std::function<void(const VARIANT&)>& f)> snapshot;
+};
+
+// Takes the snapshots in a dedicated thread, calling `take_snapshot` once per request. If a snapshot is requested
+// while the previous one is still being taken, the requests are coalesced. The snapshot requested by destruction
+// time is taken before the destructor returns.
+class StorageSnapshotTaker final {
+ public:
+  explicit StorageSnapshotTaker(std::function<void()> take_snapshot)
+      : take_snapshot_(take_snapshot), thread_([this]() { Thread(); }) {}
+
+  ~StorageSnapshotTaker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      destructing_ = true;
+    }
+    condition_variable_.notify_one();
+    thread_.join();
+  }
+
+  void Request() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      requested_ = true;
+    }
+    condition_variable_.notify_one();
+  }
+
+ private:
+  void Thread() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      condition_variable_.wait(lock, [this]() { return requested_ || destructing_; });
+      if (requested_) {
+        requested_ = false;
+        lock.unlock();
+        take_snapshot_();
+        lock.lock();
+      } else {
+        return;
+      }
+    }
+  }
+
+  const std::function<void()> take_snapshot_;
+  std::mutex mutex_;
+  std::condition_variable condition_variable_;
+  bool destructing_ = false;
+  bool requested_ = false;
+  std::thread thread_;
+};
+
+}  // namespace current::storage::persister::impl
+
+}  // namespace persister
+}  // namespace storage
+}  // namespace current
+
+#endif  // CURRENT_STORAGE_PERSISTER_SNAPSHOT_H
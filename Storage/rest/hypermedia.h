@@ -25,7 +25,11 @@ SOFTWARE.
 
 // Hypermedia: A rather hacky solution for Hypermedia REST API supporting:
 // * Rich JSON format (top-level `url_*` fields, and actual data in `data`.)
-// * Poor man's stateless "pagination" through collections and collection "slices" (rows/cols of matrices).
+// * Stateless pagination through collections and collection "slices" (rows/cols of matrices). The ordered
+//   dictionaries are paginated by the cursor, `?after=`, the key of the last entry of the previous page, in O(log n).
+//   The `?i=` offset is O(log n) for the `OrderedDictionaryWithRanks`, and requires walking the collection otherwise.
+//   With the cursor, the `?i=` passed in is ignored, and the `i` of the page is only known, and returned, for the
+//   `OrderedDictionaryWithRanks`. An `?after=` which is not a valid key is a 400.
 // * Full and brief fields sets.
 
 #ifndef CURRENT_STORAGE_REST_HYPERMEDIA_H
@@ -77,15 +81,141 @@ struct PopulateCollectionRecord<ENTRY, current::GenericMapAccessor<MAP>> {
   }
 };
 
+// The keys which can be passed in the URL as the cursor, i.e., the ones `FromString()` parses back from `ToString()`.
+// Not the floating point keys, which `ToString()` rounds, nor the `std::pair<row_t, col_t>` keys of the cells
+// of the matrices, as listed by their secondary indexes.
+template <typename T>
+struct IsCursorKey : std::integral_constant<bool,
+                                            std::is_integral<T>::value || std::is_enum<T>::value ||
+                                                std::is_same<T, std::string>::value ||
+                                                (current::strings::sfinae::HasMemberToString<T>(0) &&
+                                                 current::strings::sfinae::HasMemberFromString<T>(0))> {};
+
+template <>
+struct IsCursorKey<std::chrono::milliseconds> : std::true_type {};
+
+template <>
+struct IsCursorKey<std::chrono::microseconds> : std::true_type {};
+
+// The collections which can seek to the entry right after the key, i.e., the ordered dictionaries and matrix rows/cols,
+// with the keys that can be passed in the URL as the cursor.
+template <typename T>
+constexpr bool HasUpperBound(char) {
+  return false;
+}
+
+template <typename T>
+constexpr auto HasUpperBound(int)
+    -> decltype(std::declval<const T>().UpperBound(std::declval<typename T::key_t>()), bool()) {
+  return IsCursorKey<typename T::key_t>::value;
+}
+
+// The collections which can seek to the `i`-th entry in O(log n), and tell the index of the entry after the key,
+// i.e., the `OrderedDictionaryWithRanks`.
+template <typename T>
+constexpr bool HasSelect(char) {
+  return false;
+}
+
+template <typename T>
+constexpr auto HasSelect(int) -> decltype(std::declval<const T>().Select(0u), bool()) {
+  return true;
+}
+
+// Seeks to the first entry of the page: right after the cursor if it is given and supported, or to the `i`-th entry.
+// Sets `page_i` to the index of that entry, unless it is unknown, as for the cursor into a collection with no ranks.
+template <typename ITERABLE,
+          bool HAS_UPPER_BOUND = HasUpperBound<ITERABLE>(0),
+          bool HAS_SELECT = HasSelect<ITERABLE>(0)>
+struct Paginator {
+  static constexpr bool cursor_supported = false;
+  static bool IsValidCursor(const std::string&) { return true; }
+  template <typename SPAN>
+  static auto Seek(SPAN& span, uint64_t index, const std::string&, Optional<uint64_t>& page_i)
+      -> decltype(span.begin()) {
+    page_i = index;
+    auto iterator = span.begin();
+    for (uint64_t i = 0; i < index && iterator != span.end(); ++i) {
+      ++iterator;
+    }
+    return iterator;
+  }
+  // No cursor, so nothing to remember.
+  struct LastKey {
+    template <typename ITERATOR>
+    void Remember(const ITERATOR&) {}
+    std::string Cursor() const { return ""; }
+  };
+};
+
+template <typename ITERABLE, bool HAS_SELECT>
+struct Paginator<ITERABLE, true, HAS_SELECT> {
+  using key_t = typename ITERABLE::key_t;
+  static constexpr bool cursor_supported = true;
+  static bool IsValidCursor(const std::string& cursor) {
+    return cursor.empty() || current::ToString(current::FromString<key_t>(cursor)) == cursor;
+  }
+  template <typename SPAN>
+  static auto Seek(SPAN& span, uint64_t index, const std::string& cursor, Optional<uint64_t>& page_i)
+      -> decltype(span.begin()) {
+    if (!cursor.empty()) {
+      const key_t key = current::FromString<key_t>(cursor);
+      SetUpperBoundIndex(std::integral_constant<bool, HAS_SELECT>(), span, key, page_i);
+      return span.UpperBound(key);
+    } else {
+      return Paginator<ITERABLE, false, HAS_SELECT>::Seek(span, index, cursor, page_i);
+    }
+  }
+  // The key of the last entry of the page, turned into the cursor to the next page once the page is complete.
+  class LastKey {
+   public:
+    template <typename ITERATOR>
+    void Remember(const ITERATOR& iterator) {
+      key_ = iterator.key();
+      remembered_ = true;
+    }
+    std::string Cursor() const { return remembered_ ? current::ToString(key_) : ""; }
+
+   private:
+    key_t key_;
+    bool remembered_ = false;
+  };
+
+ private:
+  template <typename SPAN>
+  static void SetUpperBoundIndex(std::true_type, SPAN& span, const key_t& key, Optional<uint64_t>& page_i) {
+    page_i = static_cast<uint64_t>(span.UpperBoundIndex(key));
+  }
+  template <typename SPAN>
+  static void SetUpperBoundIndex(std::false_type, SPAN&, const key_t&, Optional<uint64_t>& page_i) {
+    page_i = nullptr;
+  }
+};
+
+template <typename ITERABLE>
+struct Paginator<ITERABLE, false, true> {
+  static constexpr bool cursor_supported = false;
+  static bool IsValidCursor(const std::string&) { return true; }
+  template <typename SPAN>
+  static auto Seek(SPAN& span, uint64_t index, const std::string&, Optional<uint64_t>& page_i)
+      -> decltype(span.begin()) {
+    page_i = index;
+    return span.Select(static_cast<size_t>(index));
+  }
+  using LastKey = typename Paginator<ITERABLE, false, false>::LastKey;
+};
+
 struct HypermediaResponseFormatter {
   // TODO(dkorolev): We could move to per-HTTP-VERB context type as it's high performance time.
   struct Context {
     // For per-record view, whether a full or brief format should be used.
     bool brief = false;
 
-    // For poor man's pagination when viewing the collection.
+    // For pagination when viewing the collection.
     mutable uint64_t query_i = 0u;
     mutable uint64_t query_n = 10u;  // Default page size.
+    // The key of the last entry of the previous page, for the collections which support it; empty for the first page.
+    std::string query_after;
   };
 
   template <typename ENTRY>
@@ -119,13 +249,24 @@ struct HypermediaResponseFormatter {
     HypermediaRESTCollectionResponse<collection_element_t> response;
     response.url_directory = collection_url;
 
-    // Poor man's pagination.
+    using paginator_t = Paginator<current::decay<ITERABLE>>;
+
+    if (!paginator_t::IsValidCursor(context.query_after)) {
+      return ErrorResponse(InvalidKeyError("Invalid `after` cursor.", {{"after", context.query_after}}),
+                           HTTPResponseCode.BadRequest);
+    }
+
     const size_t total = span.Size();
-    bool has_previous_page = false;
-    bool has_next_page = false;
-    uint64_t current_index = 0;
-    response.data.reserve(context.query_n);
-    for (auto iterator = span.begin(); iterator != span.end(); ++iterator) {
+    if (context.query_i > total) {
+      context.query_i = total;
+    }
+
+    // The index of the first entry of the page, as opposed to the `i` passed in along with the cursor.
+    Optional<uint64_t> page_i;
+    auto iterator = paginator_t::Seek(span, context.query_i, context.query_after, page_i);
+    typename paginator_t::LastKey last_key;
+    response.data.reserve(std::min(context.query_n, static_cast<uint64_t>(total)));
+    for (; iterator != span.end() && response.data.size() < context.query_n; ++iterator) {
       using iterator_t = decltype(iterator);
       // NOTE(dkorolev): This `iterator` can be of more than three different kinds, among which are:
       // 1) container/many_to_many.h. ManyToMany::OuterAccessor::OuterIterator
@@ -134,41 +275,51 @@ struct HypermediaResponseFormatter {
       //    where SE stands for SingleElement.
       // 4) GenericMapAccessor<>.
       // To keep the generic code generic, it's accesses as `iterator`, not via a range-based loop.
-      if (current_index >= context.query_i && current_index < context.query_i + context.query_n) {
-        response.data.resize(response.data.size() + 1);
-        collection_element_t& record = response.data.back();
-
-        record.url = collection_url + '/' + ComposeRESTfulKey<PARTICULAR_FIELD, ENTRY>(iterator);
-        PopulateCollectionRecord<ENTRY, typename current::decay<typename iterator_t::value_t>>::DoIt(
-            record.DataOrBriefByRef(), iterator);
-      } else if (current_index < context.query_i) {
-        has_previous_page = true;
-      } else if (current_index >= context.query_i + context.query_n) {
-        has_next_page = true;
-        break;
+      response.data.resize(response.data.size() + 1);
+      collection_element_t& record = response.data.back();
+
+      record.url = collection_url + '/' + ComposeRESTfulKey<PARTICULAR_FIELD, ENTRY>(iterator);
+      PopulateCollectionRecord<ENTRY, typename current::decay<typename iterator_t::value_t>>::DoIt(
+          record.DataOrBriefByRef(), iterator);
+      if (response.data.size() == context.query_n) {
+        // The cursor is only needed for the next page, i.e., if the page is full, so only its last key is kept.
+        last_key.Remember(iterator);
       }
-      ++current_index;
     }
-
-    const auto gen_page_url = [&pagination_url](uint64_t url_i, uint64_t url_n) {
-      return pagination_url + "?i=" + current::ToString(url_i) + "&n=" + current::ToString(url_n);
+    const std::string last_key_cursor = last_key.Cursor();
+    const bool has_previous_page = Exists(page_i) && Value(page_i) > 0u && total > 0u;
+    const bool has_next_page = (iterator != span.end());
+
+    // The `i` is left out of the URL if it is not known.
+    const auto gen_page_url = [&pagination_url](
+        const Optional<uint64_t>& url_i, uint64_t url_n, const std::string& after) {
+      return pagination_url + '?' + (Exists(url_i) ? "i=" + current::ToString(Value(url_i)) + '&' : "") + "n=" +
+             current::ToString(url_n) + (after.empty() ? "" : "&after=" + current::url::URL::EncodeURIComponent(after));
     };
 
-    if (context.query_i > total) {
-      context.query_i = total;
-    }
-    response.url = gen_page_url(context.query_i, context.query_n);
-    response.i = context.query_i;
-    response.n = std::min(context.query_n, total - context.query_i);
+    response.url = gen_page_url(page_i, context.query_n, context.query_after);
+    response.i = page_i;
+    response.n = response.data.size();
     response.total = total;
     if (has_previous_page) {
-      response.url_previous_page =
-          gen_page_url(context.query_i >= context.query_n ? context.query_i - context.query_n : 0, context.query_n);
+      const uint64_t i = Value(page_i);
+      response.url_previous_page = gen_page_url(i >= context.query_n ? i - context.query_n : 0, context.query_n, "");
     }
     if (has_next_page) {
-      response.url_next_page = gen_page_url(
-          context.query_i + context.query_n * 2 > total ? total - context.query_n : context.query_i + context.query_n,
-          context.query_n);
+      if (paginator_t::cursor_supported) {
+        // The next page starts right after the last entry of this one, even if the collection has changed since.
+        Optional<uint64_t> next_i;
+        if (Exists(page_i)) {
+          next_i = Value(page_i) + response.data.size();
+        }
+        response.url_next_page = gen_page_url(next_i, context.query_n, last_key_cursor);
+      } else {
+        const uint64_t i = Value(page_i);
+        response.url_next_page =
+            gen_page_url(i + context.query_n * 2 > total ? total - context.query_n : i + context.query_n,
+                         context.query_n,
+                         "");
+      }
     }
 
     return Response(response, HTTPResponseCode.OK);
@@ -199,6 +350,7 @@ struct Hypermedia : generic::Structured<hypermedia::HypermediaResponseFormatter>
       context.brief = ((q["fields"] == "brief") || q.has("brief")) && !q.has("full");
       context.query_i = current::FromString<uint64_t>(q.get("i", current::ToString(context.query_i)));
       context.query_n = current::FromString<uint64_t>(q.get("n", current::ToString(context.query_n)));
+      context.query_after = q.get("after", "");
 
       SUPER_GET_HANDLER_GENERATOR::Enter(std::move(request), std::forward<F>(next));
     }
@@ -326,6 +326,10 @@ struct Plain {
     return Response("Method " + method + " not allowed. " + error_message + '\n', HTTPResponseCode.MethodNotAllowed);
   }
   // LCOV_EXCL_STOP
+
+  static Response ErrorUniqueIndexViolation(const std::string& index, const std::string& value) {
+    return Response("Unique index `" + index + "` already has the value `" + value + "`.\n", HTTPResponseCode.Conflict);
+  }
 };
 
 }  // namespace current::storage::rest::plain
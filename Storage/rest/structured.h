@@ -510,6 +510,12 @@ struct Structured {
   static Response ErrorMethodNotAllowed(const std::string& method, const std::string& error_message) {
     return ErrorResponse(MethodNotAllowedError(error_message, method), HTTPResponseCode.MethodNotAllowed);
   }
+
+  static Response ErrorUniqueIndexViolation(const std::string& index, const std::string& value) {
+    return ErrorResponse(
+        UniqueIndexViolationError("Another resource has the same value of the unique field.", index, value),
+        HTTPResponseCode.Conflict);
+  }
 };
 
 }  // namespace current::storage::rest::generic
@@ -148,6 +148,12 @@ inline generic::RESTError ResourceAlreadyExistsError(const std::string& message,
   return generic::RESTError("ResourceAlreadyExists", message, details);
 }
 
+inline generic::RESTError UniqueIndexViolationError(const std::string& message,
+                                                    const std::string& index,
+                                                    const std::string& value) {
+  return generic::RESTError("UniqueIndexViolation", message, {{"index", index}, {"value", value}});
+}
+
 inline generic::RESTError ResourceWasModifiedError(const std::string& message,
                                                    std::chrono::microseconds requested,
                                                    std::chrono::microseconds last_modified) {
@@ -227,7 +233,7 @@ CURRENT_STRUCT_T(HypermediaRESTCollectionResponse) {
   CURRENT_FIELD(url, std::string);
   CURRENT_FIELD(url_directory, std::string);
   // TODO(dkorolev): `url_full_directory` for half-matrices? Tagging with #DIMA_FIXME.
-  CURRENT_FIELD(i, uint64_t);
+  CURRENT_FIELD(i, Optional<uint64_t>);  // Unknown for the page after the cursor in a collection with no ranks.
   CURRENT_FIELD(n, uint64_t);
   CURRENT_FIELD(total, uint64_t);
   CURRENT_FIELD(url_next_page, Optional<std::string>);
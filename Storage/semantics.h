@@ -94,6 +94,11 @@ struct PartialRowKey {
 struct PartialColKey {
   using completeness_family_t = MatrixHalfKey;
 };
+// The value of the member indexed by the secondary index `INDEX` of a dictionary, browsed the same way as a matrix row.
+template <typename INDEX>
+struct PartialIndexKey {
+  using completeness_family_t = MatrixHalfKey;
+};
 }  // namespace current::storage::semantics::key_completeness
 
 // TODO(dkorolev): These actually belong to REST, not to storage/container semantics.
@@ -113,6 +118,10 @@ struct OnMatrixRow {
 struct OnMatrixCol {
   using key_completeness_t = semantics::key_completeness::PartialColKey;
 };
+template <typename INDEX>
+struct OnIndex {
+  using key_completeness_t = semantics::key_completeness::PartialIndexKey<INDEX>;
+};
 
 template <typename>
 struct TopLevelOperationSelector;
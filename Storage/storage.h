@@ -28,11 +28,13 @@ SOFTWARE.
 // * (Ordered/Unordered)Dictionary<T> <=> std::(map/unordered_map)<key_t, T>
 //   Empty(), Size(), operator[](key), Erase(key) [, iteration, {lower/upper}_bound].
 //   `key_t` is either the type of `T.key` or of `T.get_key()`.
+//   With `CURRENT_STORAGE_FIELD_ENTRY_WITH_INDEXES`, also Index<I>().Find(value) / Index<I>()[value], by `T.member`.
 //
 // * (Ordered/Unordered)(One/Many)To(One/Many)<T> <=> { row_t, col_t } -> T, two `std::(map/unordered_map)<>`-s.
 //   Entries are stored in third `std::unordered_map<std::pair<row_t, col_t>, std::unique_ptr<T>>`.
 //   Empty(), Size(), Rows()/Cols(), Add(cell), Delete(row, col) [, iteration, {lower/upper}_bound].
 //   `row_t` and `col_t` are either the type of `T.row` / `T.col`, or of `T.get_row()` / `T.get_col()`.
+//   The secondary indexes are declared and used the same way as for the dictionaries.
 //
 // All Current-friendly types support persistence.
 //
@@ -56,6 +58,7 @@ SOFTWARE.
 #include "container/one_to_many.h"
 
 #include "persister/file.h"
+#include "persister/snapshot.h"
 
 #include "../TypeSystem/struct.h"
 #include "../TypeSystem/Serialization/json.h"
@@ -69,7 +72,7 @@ SOFTWARE.
 namespace current {
 namespace storage {
 
-#define CURRENT_STORAGE_FIELD_ENTRY_Dictionary_IMPL(dictionary_type, entry_type, entry_name)        \
+#define CURRENT_STORAGE_FIELD_ENTRY_Dictionary_IMPL(dictionary_type, entry_type, entry_name, ...)   \
   struct entry_name;                                                                                \
   CURRENT_STRUCT(entry_name##Updated) {                                                             \
     CURRENT_FIELD(us, std::chrono::microseconds);                                                   \
@@ -89,7 +92,7 @@ namespace storage {
   };                                                                                                \
   struct entry_name {                                                                               \
     template <typename T, typename E1, typename E2>                                                 \
-    using field_t = dictionary_type<T, E1, E2>;                                                     \
+    using field_t = dictionary_type<T, E1, E2, ::current::metaprogramming::TypeList<__VA_ARGS__>>;  \
     using entry_t = entry_type;                                                                     \
     using key_t = ::current::storage::sfinae::entry_key_t<entry_type>;                              \
     using update_event_t = entry_name##Updated;                                                     \
@@ -98,13 +101,16 @@ namespace storage {
     using persisted_event_2_t = entry_name##Deleted;                                                \
   }
 
-#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedDictionary(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Dictionary_IMPL(UnorderedDictionary, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedDictionary(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Dictionary_IMPL(UnorderedDictionary, entry_type, entry_name, __VA_ARGS__)
 
-#define CURRENT_STORAGE_FIELD_ENTRY_OrderedDictionary(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Dictionary_IMPL(OrderedDictionary, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_OrderedDictionary(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Dictionary_IMPL(OrderedDictionary, entry_type, entry_name, __VA_ARGS__)
 
-#define CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(matrix_type, entry_type, entry_name)                                   \
+#define CURRENT_STORAGE_FIELD_ENTRY_OrderedDictionaryWithRanks(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Dictionary_IMPL(OrderedDictionaryWithRanks, entry_type, entry_name, __VA_ARGS__)
+
+#define CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(matrix_type, entry_type, entry_name, ...)                              \
   struct entry_name;                                                                                                   \
   CURRENT_STRUCT(entry_name##Updated) {                                                                                \
     CURRENT_FIELD(us, std::chrono::microseconds);                                                                      \
@@ -127,7 +133,7 @@ namespace storage {
   };                                                                                                                   \
   struct entry_name {                                                                                                  \
     template <typename T, typename E1, typename E2>                                                                    \
-    using field_t = matrix_type<T, E1, E2>;                                                                            \
+    using field_t = matrix_type<T, E1, E2, ::current::metaprogramming::TypeList<__VA_ARGS__>>;                         \
     using entry_t = entry_type;                                                                                        \
     using row_t = ::current::storage::sfinae::entry_row_t<entry_type>;                                                 \
     using col_t = ::current::storage::sfinae::entry_col_t<entry_type>;                                                 \
@@ -138,44 +144,48 @@ namespace storage {
     using persisted_event_2_t = entry_name##Deleted;                                                                   \
   }
 
-#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedManyToUnorderedMany(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(UnorderedManyToUnorderedMany, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedManyToUnorderedMany(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(UnorderedManyToUnorderedMany, entry_type, entry_name, __VA_ARGS__)
 
-#define CURRENT_STORAGE_FIELD_ENTRY_OrderedManyToOrderedMany(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(OrderedManyToOrderedMany, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_OrderedManyToOrderedMany(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(OrderedManyToOrderedMany, entry_type, entry_name, __VA_ARGS__)
 
-#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedManyToOrderedMany(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(UnorderedManyToOrderedMany, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedManyToOrderedMany(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(UnorderedManyToOrderedMany, entry_type, entry_name, __VA_ARGS__)
 
-#define CURRENT_STORAGE_FIELD_ENTRY_OrderedManyToUnorderedMany(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(OrderedManyToUnorderedMany, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_OrderedManyToUnorderedMany(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(OrderedManyToUnorderedMany, entry_type, entry_name, __VA_ARGS__)
 
-#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedOneToUnorderedOne(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(UnorderedOneToUnorderedOne, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedOneToUnorderedOne(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(UnorderedOneToUnorderedOne, entry_type, entry_name, __VA_ARGS__)
 
-#define CURRENT_STORAGE_FIELD_ENTRY_OrderedOneToOrderedOne(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(OrderedOneToOrderedOne, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_OrderedOneToOrderedOne(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(OrderedOneToOrderedOne, entry_type, entry_name, __VA_ARGS__)
 
-#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedOneToOrderedOne(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(UnorderedOneToOrderedOne, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedOneToOrderedOne(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(UnorderedOneToOrderedOne, entry_type, entry_name, __VA_ARGS__)
 
-#define CURRENT_STORAGE_FIELD_ENTRY_OrderedOneToUnorderedOne(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(OrderedOneToUnorderedOne, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_OrderedOneToUnorderedOne(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(OrderedOneToUnorderedOne, entry_type, entry_name, __VA_ARGS__)
 
-#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedOneToUnorderedMany(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(UnorderedOneToUnorderedMany, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedOneToUnorderedMany(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(UnorderedOneToUnorderedMany, entry_type, entry_name, __VA_ARGS__)
 
-#define CURRENT_STORAGE_FIELD_ENTRY_OrderedOneToOrderedMany(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(OrderedOneToOrderedMany, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_OrderedOneToOrderedMany(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(OrderedOneToOrderedMany, entry_type, entry_name, __VA_ARGS__)
 
-#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedOneToOrderedMany(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(UnorderedOneToOrderedMany, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_UnorderedOneToOrderedMany(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(UnorderedOneToOrderedMany, entry_type, entry_name, __VA_ARGS__)
 
-#define CURRENT_STORAGE_FIELD_ENTRY_OrderedOneToUnorderedMany(entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(OrderedOneToUnorderedMany, entry_type, entry_name)
+#define CURRENT_STORAGE_FIELD_ENTRY_OrderedOneToUnorderedMany(entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(OrderedOneToUnorderedMany, entry_type, entry_name, __VA_ARGS__)
 
 #define CURRENT_STORAGE_FIELD_ENTRY(container, entry_type, entry_name) \
-  CURRENT_STORAGE_FIELD_ENTRY_##container(entry_type, entry_name)
+  CURRENT_STORAGE_FIELD_ENTRY_##container(entry_type, entry_name, )
+
+// The field with the secondary indexes, declared with `CURRENT_STORAGE_INDEX`, ref. `container/secondary_index.h`.
+#define CURRENT_STORAGE_FIELD_ENTRY_WITH_INDEXES(container, entry_type, entry_name, ...) \
+  CURRENT_STORAGE_FIELD_ENTRY_##container(entry_type, entry_name, __VA_ARGS__)
 
 #define CURRENT_STORAGE_FIELDS_HELPERS(name)                                                                   \
   template <typename T>                                                                                        \
@@ -238,6 +248,24 @@ class GenericStorageImpl {
                                                                                    : StorageRole::Follower;
   }
 
+  // The storage which periodically snapshots its fields, and starts from the most recent snapshot.
+  // Requires a persister which supports snapshots, such as `SherlockStreamPersister`.
+  template <typename... ARGS>
+  GenericStorageImpl(persister::StorageSnapshots snapshots, ARGS&&... args)
+      : transactions_count_(0u),
+        persister_(mutex_,
+                   [this](const fields_variant_t& entry) {
+                     entry.Call(fields_);
+                     transactions_count_.MutableUse([](uint64_t& value) { ++value; });
+                   },
+                   SnapshotFunctions(),
+                   std::move(snapshots),
+                   std::forward<ARGS>(args)...),
+        transaction_policy_(mutex_, persister_, fields_.current_storage_mutation_journal_) {
+    role_ = (persister_.DataAuthority() == persister::PersisterDataAuthority::Own) ? StorageRole::Master
+                                                                                   : StorageRole::Follower;
+  }
+
   StorageRole GetRole() const { return role_; }
 
   // Used for applying updates by dispatching corresponding events.
@@ -305,6 +333,50 @@ class GenericStorageImpl {
   }
 
   void GracefulShutdown() { transaction_policy_.GracefulShutdown(); }
+
+ private:
+  // Called from the constructor of the persister.
+  persister::impl::StorageSnapshotFunctions<fields_variant_t> SnapshotFunctions() {
+    persister::impl::StorageSnapshotFunctions<fields_variant_t> result;
+    result.restore = [this](const fields_variant_t& mutation) { mutation.Call(fields_); };
+    result.restore_transactions_count = [this](uint64_t transactions) {
+      transactions_count_.MutableUse([transactions](uint64_t& value) { value = transactions; });
+    };
+    result.size = [this]() { return SnapshotFieldByIndex<void, FIELDS_COUNT>::Size(fields_); };
+    result.snapshot = [this](const std::function<void(const fields_variant_t&)>& f) {
+      SnapshotFieldByIndex<void, FIELDS_COUNT>::Snapshot(fields_, f);
+    };
+    return result;
+  }
+
+  // Passes the entries of each field as its `Updated` events, with their last modification timestamps.
+  // The `BLAH` template parameter is required to fight the "explicit specialization in class scope" error.
+  template <typename BLAH, int I>
+  struct SnapshotFieldByIndex {
+    static uint64_t Size(const FIELDS& fields) {
+      return SnapshotFieldByIndex<BLAH, I - 1>::Size(fields) +
+             fields(::current::storage::ImmutableFieldByIndex<I - 1>()).Size();
+    }
+    static void Snapshot(const FIELDS& fields, const std::function<void(const fields_variant_t&)>& f) {
+      SnapshotFieldByIndex<BLAH, I - 1>::Snapshot(fields, f);
+      using field_info_t = decltype(std::declval<FIELDS>()(::current::storage::FieldInfoByIndex<I - 1>()));
+      using update_event_t = typename field_info_t::update_event_t;
+      using delete_event_t = typename field_info_t::delete_event_t;
+      const auto& field = fields(::current::storage::ImmutableFieldByIndex<I - 1>());
+      for (const auto& entry : field) {
+        // The `Deleted` event is the one place which knows the key of the entry for any container type.
+        const auto last_modified = field.LastModified(delete_event_t(std::chrono::microseconds(0), entry).key);
+        f(fields_variant_t(
+            update_event_t(Exists(last_modified) ? Value(last_modified) : std::chrono::microseconds(0), entry)));
+      }
+    }
+  };
+
+  template <typename BLAH>
+  struct SnapshotFieldByIndex<BLAH, 0> {
+    static uint64_t Size(const FIELDS&) { return 0u; }
+    static void Snapshot(const FIELDS&, const std::function<void(const fields_variant_t&)>&) {}
+  };
 };
 
 #define CURRENT_STORAGE_IMPLEMENTATION(name)                                                                   \
@@ -342,6 +414,9 @@ class NullStoragePersisterImpl {
 
   void PersistJournal(MutationJournal& journal) { journal.Clear(); }
 
+  void PipelinedJournalCommitted() {}
+  void PersistPipelinedJournal(MutationJournal& journal) { journal.Clear(); }
+
   PersisterDataAuthority DataAuthority() const { return PersisterDataAuthority::Own; }
 };
 
@@ -1189,6 +1189,42 @@ TEST(TransactionalStorage, Exceptions) {
   }
 }
 
+TEST(TransactionalStorage, MutationJournal) {
+  using namespace transactional_storage_test;
+  using current::storage::MutationJournal;
+
+  MutationJournal journal;
+  std::vector<int32_t> rolled_back;
+  const auto undo_counter = std::make_shared<int>(0);
+
+  // More mutations than would fit into a single block of the arena.
+  const std::string padding(1000u, '.');
+  for (int32_t i = 0; i < 1000; ++i) {
+    journal.LogMutation(Record(padding, i), [&rolled_back, undo_counter, i]() { rolled_back.push_back(i); });
+  }
+  ASSERT_EQ(1000u, journal.commit_log.size());
+  EXPECT_EQ(999, dynamic_cast<Record&>(*journal.commit_log.back()).rhs);
+  EXPECT_EQ(1001, undo_counter.use_count());
+
+  // The mutations are rolled back in the reverse order, and the undo records are destroyed.
+  journal.Rollback();
+  journal.AssertEmpty();
+  ASSERT_EQ(1000u, rolled_back.size());
+  EXPECT_EQ(999, rolled_back.front());
+  EXPECT_EQ(0, rolled_back.back());
+  EXPECT_EQ(1, undo_counter.use_count());
+
+  // The memory of the arena is reused by the next transaction.
+  rolled_back.clear();
+  journal.LogMutation(Element(42), [&rolled_back, undo_counter]() { rolled_back.push_back(42); });
+  EXPECT_EQ(42, dynamic_cast<Element&>(*journal.commit_log.front()).x);
+  EXPECT_EQ(2, undo_counter.use_count());
+  journal.Clear();
+  journal.AssertEmpty();
+  EXPECT_TRUE(rolled_back.empty());
+  EXPECT_EQ(1, undo_counter.use_count());
+}
+
 TEST(TransactionalStorage, TransactionMetaFields) {
   current::time::ResetToZero();
 
@@ -2527,7 +2563,7 @@ TEST(TransactionalStorage, RESTfulAPIMatrixTest) {
       EXPECT_EQ(
           "{\"success\":true,\"url\":\"/data/composite_m2m.1/!2?i=0&n=1\",\"url_directory\":\"/data/"
           "composite_m2m\",\"i\":0,\"n\":1,\"total\":2,\"url_next_page\":\"/data/composite_m2m.1/"
-          "!2?i=1&n=1\",\"url_previous_page\":null,\"data\":[{\"url\":\"/data/composite_m2m/!2/"
+          "!2?i=1&n=1&after=1\",\"url_previous_page\":null,\"data\":[{\"url\":\"/data/composite_m2m/!2/"
           "1\",\"data\":{\"row\":\"!2\",\"col\":1}}]}\n",
           response.body);
     }
@@ -2541,13 +2577,28 @@ TEST(TransactionalStorage, RESTfulAPIMatrixTest) {
           "3\",\"data\":{\"row\":\"!2\",\"col\":3}}]}\n",
           response.body);
     }
+    {
+      // The cursor into the row, which has no ranks, does not tell the index of the page.
+      const auto response = HTTP(GET(base_url + "/hypermedia/data/composite_m2m.1/!2?n=1&after=1"));
+      EXPECT_EQ(200, static_cast<int>(response.code));
+      EXPECT_EQ(
+          "{\"success\":true,\"url\":\"/data/composite_m2m.1/!2?n=1&after=1\",\"url_directory\":\"/data/"
+          "composite_m2m\",\"i\":null,\"n\":1,\"total\":2,\"url_next_page\":null,\"url_previous_page\":null,"
+          "\"data\":[{\"url\":\"/data/composite_m2m/!2/3\",\"data\":{\"row\":\"!2\",\"col\":3}}]}\n",
+          response.body);
+    }
+    {
+      // The cursor which is not a valid key is rejected.
+      const auto response = HTTP(GET(base_url + "/hypermedia/data/composite_m2m.1/!2?n=1&after=one"));
+      EXPECT_EQ(400, static_cast<int>(response.code));
+    }
     {
       const auto response = HTTP(GET(base_url + "/hypermedia/data/composite_m2m.2/3?n=1"));
       EXPECT_EQ(200, static_cast<int>(response.code));
       EXPECT_EQ(
           "{\"success\":true,\"url\":\"/data/composite_m2m.2/3?i=0&n=1\",\"url_directory\":\"/data/"
           "composite_m2m\",\"i\":0,\"n\":1,\"total\":2,\"url_next_page\":\"/data/composite_m2m.2/"
-          "3?i=1&n=1\",\"url_previous_page\":null,\"data\":[{\"url\":\"/data/composite_m2m/!1/"
+          "3?i=1&n=1&after=!1\",\"url_previous_page\":null,\"data\":[{\"url\":\"/data/composite_m2m/!1/"
           "3\",\"data\":{\"row\":\"!1\",\"col\":3}}]}\n",
           response.body);
     }
@@ -3137,6 +3188,179 @@ TEST(TransactionalStorage, UseExternallyProvidedSherlockStreamOfBroaderType) {
   }
 }
 
+TEST(TransactionalStorage, SharedReadOnlyTransactions) {
+  current::time::ResetToZero();
+
+  using namespace transactional_storage_test;
+  using storage_t =
+      TestStorage<SherlockInMemoryStreamPersister, current::storage::transaction_policy::SynchronousWithSharedReads>;
+
+  storage_t storage;
+
+  {
+    // Let the mock time advance by itself, as the transactions below are run from multiple threads.
+    current::time::SetNow(std::chrono::microseconds(100), std::chrono::microseconds(1000 * 1000));
+    const auto result = storage.ReadWriteTransaction([](MutableFields<storage_t> fields) {
+      fields.d.Add(Record{"one", 1});
+      fields.d.Add(Record{"two", 2});
+    }).Go();
+    EXPECT_TRUE(WasCommitted(result));
+  }
+
+  // Confirm two read-only transactions run concurrently: each one waits for the other one to begin.
+  // With the exclusive `Synchronous` policy this code would hang.
+  {
+    std::atomic_int readers_inside(0);
+    const auto reader = [&storage, &readers_inside]() {
+      const auto result = storage.ReadOnlyTransaction([&readers_inside](ImmutableFields<storage_t> fields) {
+        ++readers_inside;
+        while (readers_inside < 2) {
+          std::this_thread::yield();
+        }
+        return fields.d.Size();
+      }).Go();
+      EXPECT_TRUE(WasCommitted(result));
+      EXPECT_EQ(2u, Value(result));
+    };
+    std::thread t1(reader);
+    std::thread t2(reader);
+    t1.join();
+    t2.join();
+  }
+
+  // Confirm read-write transactions, including the rolled back ones, interleave with read-only ones correctly.
+  {
+    std::vector<std::thread> threads;
+    std::atomic_bool inconsistent(false);
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&storage, t]() {
+        for (int i = 0; i < 50; ++i) {
+          storage.ReadWriteTransaction([t, i](MutableFields<storage_t> fields) {
+            fields.d.Add(Record{current::ToString(t * 1000 + i), i});
+            if (i % 2) {
+              CURRENT_STORAGE_THROW_ROLLBACK();
+            }
+          }).Go();
+        }
+      });
+      threads.emplace_back([&storage, &inconsistent]() {
+        for (int i = 0; i < 50; ++i) {
+          storage.ReadOnlyTransaction([&inconsistent](ImmutableFields<storage_t> fields) {
+            size_t size = 0u;
+            for (const auto& record : fields.d) {
+              static_cast<void>(record);
+              ++size;
+            }
+            if (size != fields.d.Size()) {
+              inconsistent = true;
+            }
+          }).Go();
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    EXPECT_FALSE(inconsistent);
+    const auto result = storage.ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+      return fields.d.Size();
+    }).Go();
+    EXPECT_EQ(2u + 4u * 25u, Value(result));
+  }
+}
+
+TEST(TransactionalStorage, PipelinedTransactions) {
+  current::time::ResetToZero();
+
+  using namespace transactional_storage_test;
+  using storage_t = TestStorage<SherlockInMemoryStreamPersister, current::storage::transaction_policy::Pipelined>;
+
+  // Let the mock time advance by itself, as the journals are persisted from the background thread.
+  current::time::SetNow(std::chrono::microseconds(100), std::chrono::microseconds(1000 * 1000));
+
+  storage_t storage;
+  const auto persisted = [&storage]() { return storage.InternalExposeStream().Persister().Size(); };
+
+  // Transactions are executed without waiting for the previous ones to be persisted, and, once the future of
+  // a transaction is resolved, this transaction, along with all the previous ones, is persisted.
+  {
+    std::vector<current::Future<current::storage::TransactionResult<size_t>, current::StrictFuture::Strict>> futures;
+    for (int i = 0; i < 100; ++i) {
+      futures.push_back(storage.ReadWriteTransaction([i](MutableFields<storage_t> fields) {
+        fields.d.Add(Record{current::ToString(i), i});
+        return fields.d.Size();
+      }));
+    }
+    for (auto& future : futures) {
+      const auto result = future.Go();
+      ASSERT_TRUE(WasCommitted(result));
+      EXPECT_GE(persisted(), Value(result));
+    }
+    EXPECT_EQ(100u, persisted());
+  }
+
+  // Read-only, rolled back and failed transactions are resolved only once the data they may have seen is persisted.
+  {
+    storage.ReadWriteTransaction([](MutableFields<storage_t> fields) { fields.d.Add(Record{"one", 1}); }).Detach();
+    const auto result = storage.ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+      return Exists(fields.d["one"]);
+    }).Go();
+    EXPECT_TRUE(WasCommitted(result));
+    EXPECT_TRUE(Value(result));
+    EXPECT_EQ(101u, persisted());
+
+    storage.ReadWriteTransaction([](MutableFields<storage_t> fields) { fields.d.Add(Record{"two", 2}); }).Detach();
+    const auto rolled_back = storage.ReadWriteTransaction([](MutableFields<storage_t> fields) {
+      fields.d.Erase("two");
+      CURRENT_STORAGE_THROW_ROLLBACK();
+    }).Go();
+    EXPECT_FALSE(WasCommitted(rolled_back));
+    EXPECT_EQ(102u, persisted());
+
+    storage.ReadWriteTransaction([](MutableFields<storage_t> fields) {
+      fields.d.Add(Record{"three", 3});
+    }).Detach();
+    EXPECT_THROW(storage.ReadWriteTransaction([](MutableFields<storage_t> fields) {
+      fields.d.Erase("three");
+      CURRENT_THROW(current::Exception("Oops."));
+    }).Go(), current::Exception);
+    EXPECT_EQ(103u, persisted());
+  }
+
+  // The two-step transaction calls `f2` once its `f1` is persisted.
+  {
+    size_t persisted_in_f2 = 0u;
+    const auto result = storage.ReadWriteTransaction(
+        [](MutableFields<storage_t> fields) {
+          fields.d.Add(Record{"four", 4});
+          return fields.d.Size();
+        },
+        [&persisted_in_f2, &persisted](size_t) { persisted_in_f2 = persisted(); }).Go();
+    EXPECT_TRUE(WasCommitted(result));
+    EXPECT_EQ(104u, persisted_in_f2);
+  }
+
+  // The stream is persisted in the order of the commits, and replays into the very same storage.
+  {
+    using replayed_storage_t = TestStorage<SherlockInMemoryStreamPersister>;
+    typename replayed_storage_t::persister_t::sherlock_t stream;
+    for (const auto& e : storage.InternalExposeStream().Persister().Iterate()) {
+      stream.Publish(e.entry, e.idx_ts.us);
+    }
+    replayed_storage_t replayed(stream);
+    const auto result = replayed.ReadOnlyTransaction([](ImmutableFields<replayed_storage_t> fields) {
+      EXPECT_EQ(104u, fields.d.Size());
+      for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(Exists(fields.d[current::ToString(i)]));
+        EXPECT_EQ(i, Value(fields.d[current::ToString(i)]).rhs);
+      }
+      EXPECT_TRUE(Exists(fields.d["two"]));
+      EXPECT_TRUE(Exists(fields.d["three"]));
+    }).Go();
+    EXPECT_TRUE(WasCommitted(result));
+  }
+}
+
 TEST(TransactionalStorage, FollowingStorageFlipsToMaster) {
   current::time::ResetToZero();
 
@@ -3278,4 +3502,707 @@ TEST(TransactionalStorage, FollowingStorageFlipsToMaster) {
   }
 }
 
+TEST(TransactionalStorage, Snapshots) {
+  current::time::ResetToZero();
+
+  using namespace transactional_storage_test;
+  using Storage = TestStorage<SherlockStreamPersister>;
+  using current::storage::persister::StorageSnapshots;
+  using current::storage::persister::impl::ListStorageSnapshots;
+  using current::storage::persister::impl::StorageSnapshotFileName;
+
+  const std::string storage_file_name =
+      current::FileSystem::JoinPath(FLAGS_transactional_storage_test_tmpdir, "storage_with_snapshots");
+  const auto storage_file_remover = current::FileSystem::ScopedRmFile(storage_file_name);
+  const std::string snapshots_path =
+      current::FileSystem::JoinPath(FLAGS_transactional_storage_test_tmpdir, "storage_snapshot");
+  const auto remove_snapshots = [&snapshots_path]() {
+    for (const auto& snapshot : ListStorageSnapshots(snapshots_path)) {
+      current::FileSystem::RmFile(snapshot.second);
+    }
+  };
+  remove_snapshots();
+  const auto snapshots_remover = current::MakeScopeGuard(remove_snapshots);
+
+  // Snapshot every two stream entries, keeping the two most recent snapshots.
+  {
+    Storage storage(StorageSnapshots(snapshots_path, 2u, 2u), storage_file_name);
+    current::time::SetNow(std::chrono::microseconds(1));
+    storage.ReadWriteTransaction([](MutableFields<Storage> fields) { fields.d.Add(Record{"one", 1}); }).Go();
+    current::time::SetNow(std::chrono::microseconds(2));
+    storage.ReadWriteTransaction([](MutableFields<Storage> fields) { fields.d.Add(Record{"two", 2}); }).Go();
+    current::time::SetNow(std::chrono::microseconds(3));
+    storage.ReadWriteTransaction([](MutableFields<Storage> fields) {
+      fields.umany_to_umany.Add(Cell{1, "a", 100});
+      fields.oone_to_oone.Add(Cell{2, "b", 200});
+    }).Go();
+    current::time::SetNow(std::chrono::microseconds(4));
+    storage.ReadWriteTransaction([](MutableFields<Storage> fields) { fields.d.Erase("one"); }).Go();
+    current::time::SetNow(std::chrono::microseconds(5));
+    storage.ReadWriteTransaction([](MutableFields<Storage> fields) { fields.d.Add(Record{"three", 3}); }).Go();
+  }
+
+  // The snapshot requested after the fourth entry is written by the time the storage is gone. It is taken from the
+  // storage fields as of when the snapshot thread gets to it, so it may as well reflect the fifth entry.
+  {
+    const auto snapshots = ListStorageSnapshots(snapshots_path);
+    ASSERT_FALSE(snapshots.empty());
+    EXPECT_LE(snapshots.size(), 2u);
+    EXPECT_LE(4u, snapshots.front().first);
+    EXPECT_GE(5u, snapshots.front().first);
+    EXPECT_EQ(StorageSnapshotFileName(snapshots_path, snapshots.front().first), snapshots.front().second);
+    EXPECT_THROW(current::FileSystem::GetFileSize(snapshots.front().second + ".tmp"), current::FileException);
+  }
+
+  // A snapshot beyond the end of the stream, and a snapshot which does not match the stream, are ignored.
+  current::FileSystem::WriteStringToFile("{\"index\":100,\"us\":100,\"mutations\":0}\n",
+                                         StorageSnapshotFileName(snapshots_path, 100u).c_str());
+  current::FileSystem::WriteStringToFile("{\"index\":5,\"us\":42,\"mutations\":0}\n",
+                                         StorageSnapshotFileName(snapshots_path, 5u).c_str());
+
+  const auto verify = [](ImmutableFields<Storage> fields) {
+    EXPECT_EQ(2u, fields.d.Size());
+    EXPECT_FALSE(Exists(fields.d["one"]));
+    ASSERT_TRUE(Exists(fields.d["two"]));
+    EXPECT_EQ(2, Value(fields.d["two"]).rhs);
+    ASSERT_TRUE(Exists(fields.d["three"]));
+    EXPECT_EQ(3, Value(fields.d["three"]).rhs);
+    EXPECT_EQ(2, Value(fields.d.LastModified("two")).count());
+    EXPECT_EQ(5, Value(fields.d.LastModified("three")).count());
+    EXPECT_EQ(1u, fields.umany_to_umany.Size());
+    ASSERT_TRUE(Exists(fields.umany_to_umany.Get(1, "a")));
+    EXPECT_EQ(100, Value(fields.umany_to_umany.Get(1, "a")).phew);
+    EXPECT_EQ(3, Value(fields.umany_to_umany.LastModified(1, "a")).count());
+    EXPECT_EQ(1u, fields.oone_to_oone.Size());
+    ASSERT_TRUE(Exists(fields.oone_to_oone.Get(2, "b")));
+    EXPECT_EQ(200, Value(fields.oone_to_oone.Get(2, "b")).phew);
+  };
+
+  // With snapshots, the storage loads the most recent matching snapshot, and only replays the entries past it.
+  // The transactions count is the same as if the whole stream was replayed.
+  {
+    Storage storage(StorageSnapshots(snapshots_path, 2u, 2u), storage_file_name);
+    EXPECT_EQ(6u, storage.TransactionsCount());
+    EXPECT_TRUE(WasCommitted(storage.ReadOnlyTransaction(verify).Go()));
+  }
+
+  // Without snapshots, the storage replays the whole stream, to the very same state.
+  {
+    Storage storage(storage_file_name);
+    EXPECT_EQ(6u, storage.TransactionsCount());
+    EXPECT_TRUE(WasCommitted(storage.ReadOnlyTransaction(verify).Go()));
+  }
+
+  // A manual snapshot reflects the whole stream, and is the one used next time.
+  {
+    Storage storage(StorageSnapshots(snapshots_path, 0u, 0u), storage_file_name);
+    storage.Persister().TakeSnapshot();
+  }
+  EXPECT_TRUE(current::FileSystem::GetFileSize(StorageSnapshotFileName(snapshots_path, 5u)) > 100u);
+  {
+    Storage storage(StorageSnapshots(snapshots_path, 0u, 0u), storage_file_name);
+    EXPECT_EQ(6u, storage.TransactionsCount());
+    EXPECT_TRUE(WasCommitted(storage.ReadOnlyTransaction(verify).Go()));
+  }
+
+  // A snapshot does not apply to a different stream.
+  current::FileSystem::RmFile(storage_file_name);
+  {
+    Storage storage(StorageSnapshots(snapshots_path, 0u, 0u), storage_file_name);
+    EXPECT_EQ(0u, storage.TransactionsCount());
+  }
+
+  // With the `Pipelined` policy, the snapshots are taken as of the persisted index, even though the storage fields
+  // may be ahead of the stream.
+  {
+    using pipelined_storage_t = TestStorage<SherlockStreamPersister, current::storage::transaction_policy::Pipelined>;
+    current::time::SetNow(std::chrono::microseconds(100), std::chrono::microseconds(1000 * 1000));
+    remove_snapshots();
+    {
+      pipelined_storage_t storage(StorageSnapshots(snapshots_path, 2u, 2u), storage_file_name);
+      for (int i = 0; i < 10; ++i) {
+        storage.ReadWriteTransaction([i](MutableFields<pipelined_storage_t> fields) {
+          fields.d.Add(Record{current::ToString(i), i});
+        }).Detach();
+      }
+    }
+    const auto snapshots = ListStorageSnapshots(snapshots_path);
+    ASSERT_FALSE(snapshots.empty());
+    EXPECT_EQ(10u, snapshots.front().first);
+    pipelined_storage_t storage(StorageSnapshots(snapshots_path, 2u, 2u), storage_file_name);
+    const auto result = storage.ReadOnlyTransaction([](ImmutableFields<pipelined_storage_t> fields) {
+      EXPECT_EQ(10u, fields.d.Size());
+      for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(Exists(fields.d[current::ToString(i)]));
+        EXPECT_EQ(i, Value(fields.d[current::ToString(i)]).rhs);
+      }
+    }).Go();
+    EXPECT_TRUE(WasCommitted(result));
+  }
+}
+
 #endif  // STORAGE_ONLY_RUN_RESTFUL_TESTS
+
+namespace transactional_storage_test {
+
+CURRENT_STORAGE_FIELD_ENTRY(OrderedDictionaryWithRanks, Record, RecordDictionaryWithRanks);
+
+CURRENT_STORAGE(PaginatedStorage) {
+  CURRENT_STORAGE_FIELD(ordered, RecordDictionary);
+  CURRENT_STORAGE_FIELD(ranked, RecordDictionaryWithRanks);
+};
+
+}  // namespace transactional_storage_test
+
+TEST(TransactionalStorage, OrderedDictionaryWithRanks) {
+  using namespace transactional_storage_test;
+  using Storage = PaginatedStorage<SherlockInMemoryStreamPersister>;
+
+  Storage storage;
+
+  {
+    const auto result = storage.ReadWriteTransaction([](MutableFields<Storage> fields) {
+      for (const char* key : {"c", "a", "e", "b", "d"}) {
+        fields.ranked.Add(Record(key, 0));
+      }
+      fields.ranked.Erase("b");
+      std::string keys;
+      for (size_t i = 0; i <= fields.ranked.Size(); ++i) {
+        const auto cit = fields.ranked.Select(i);
+        keys += cit != fields.ranked.end() ? (*cit).lhs : "-";
+      }
+      EXPECT_EQ("acde-", keys);
+      EXPECT_EQ("d", (*fields.ranked.UpperBound("c")).lhs);
+      EXPECT_TRUE(fields.ranked.UpperBound("e") == fields.ranked.end());
+    }).Go();
+    EXPECT_TRUE(WasCommitted(result));
+  }
+
+  {
+    // The ranks are rolled back along with the rest of the dictionary.
+    const auto result = storage.ReadWriteTransaction([](MutableFields<Storage> fields) {
+      fields.ranked.Add(Record("b", 0));
+      fields.ranked.Erase("c");
+      CURRENT_STORAGE_THROW_ROLLBACK();
+    }).Go();
+    EXPECT_FALSE(WasCommitted(result));
+  }
+
+  storage.ReadOnlyTransaction([](ImmutableFields<Storage> fields) {
+    std::string keys;
+    for (size_t i = 0; i < fields.ranked.Size(); ++i) {
+      keys += (*fields.ranked.Select(i)).lhs;
+    }
+    EXPECT_EQ("acde", keys);
+  }).Wait();
+}
+
+TEST(TransactionalStorage, RESTfulAPICursorPaginationTest) {
+  current::time::ResetToZero();
+
+  using namespace transactional_storage_test;
+  using namespace current::storage::rest;
+  using Storage = PaginatedStorage<SherlockInMemoryStreamPersister>;
+  using parsed_t = hypermedia::HypermediaRESTCollectionResponse<hypermedia::HypermediaRESTFullCollectionRecord<Record>>;
+
+  Storage storage;
+
+  const auto base_url = current::strings::Printf("http://localhost:%d", FLAGS_transactional_storage_test_port);
+  const auto rest = RESTfulStorage<Storage, current::storage::rest::Hypermedia>(
+      storage, FLAGS_transactional_storage_test_port, "/api", "");
+
+  storage.ReadWriteTransaction([](MutableFields<Storage> fields) {
+    for (int32_t i = 0; i < 25; ++i) {
+      const std::string key = current::strings::Printf("k%02d", i);
+      fields.ordered.Add(Record(key, i));
+      fields.ranked.Add(Record(key, i));
+    }
+  }).Wait();
+
+  const auto get_page = [&base_url](const std::string& url, std::string& keys) -> parsed_t {
+    const auto response = HTTP(GET(base_url + "/api" + url));
+    EXPECT_EQ(200, static_cast<int>(response.code));
+    parsed_t parsed;
+    ParseJSON<parsed_t>(response.body, parsed);
+    keys.clear();
+    for (const auto& record : parsed.data) {
+      keys += record.data.lhs + ' ';
+    }
+    return parsed;
+  };
+
+  {
+    // The next page of an ordered dictionary continues after the last key returned.
+    std::string keys;
+    const auto page1 = get_page("/data/ordered?n=10", keys);
+    EXPECT_EQ("k00 k01 k02 k03 k04 k05 k06 k07 k08 k09 ", keys);
+    ASSERT_TRUE(Exists(page1.url_next_page));
+    EXPECT_EQ("/data/ordered?i=10&n=10&after=k09", Value(page1.url_next_page));
+    EXPECT_FALSE(Exists(page1.url_previous_page));
+
+    // A record inserted before the cursor does not shift the next page.
+    storage.ReadWriteTransaction([](MutableFields<Storage> fields) { fields.ordered.Add(Record("k005", 100)); })
+        .Wait();
+
+    // Past the cursor, the index of the page is not known without the ranks.
+    const auto page2 = get_page(Value(page1.url_next_page), keys);
+    EXPECT_EQ("k10 k11 k12 k13 k14 k15 k16 k17 k18 k19 ", keys);
+    EXPECT_FALSE(Exists(page2.i));
+    EXPECT_EQ("/data/ordered?n=10&after=k09", page2.url);
+    ASSERT_TRUE(Exists(page2.url_next_page));
+    EXPECT_EQ("/data/ordered?n=10&after=k19", Value(page2.url_next_page));
+    EXPECT_FALSE(Exists(page2.url_previous_page));
+
+    const auto page3 = get_page(Value(page2.url_next_page), keys);
+    EXPECT_EQ("k20 k21 k22 k23 k24 ", keys);
+    EXPECT_EQ(5u, page3.n);
+    EXPECT_FALSE(Exists(page3.url_next_page));
+  }
+
+  {
+    // The cursor is URL-encoded.
+    storage.ReadWriteTransaction([](MutableFields<Storage> fields) { fields.ordered.Add(Record("k09 & more", 0)); })
+        .Wait();
+    std::string keys;
+    const auto page = get_page("/data/ordered?n=12", keys);
+    ASSERT_TRUE(Exists(page.url_next_page));
+    EXPECT_EQ("/data/ordered?i=12&n=12&after=k09%20%26%20more", Value(page.url_next_page));
+    get_page(Value(page.url_next_page), keys);
+    EXPECT_EQ("k10 k11 k12 k13 k14 k15 k16 k17 k18 k19 k20 k21 ", keys);
+  }
+
+  {
+    // The offset into the dictionary with ranks is found without walking over the preceding records.
+    std::string keys;
+    const auto page = get_page("/data/ranked?i=20&n=10", keys);
+    EXPECT_EQ("k20 k21 k22 k23 k24 ", keys);
+    EXPECT_EQ(20u, Value(page.i));
+    EXPECT_EQ(25u, page.total);
+    EXPECT_FALSE(Exists(page.url_next_page));
+    get_page("/data/ranked?i=7&n=3", keys);
+    EXPECT_EQ("k07 k08 k09 ", keys);
+  }
+
+  {
+    // The index of the page after the cursor is found from the ranks, regardless of the `i` passed in.
+    std::string keys;
+    const auto page = get_page("/data/ranked?i=3&n=10&after=k09", keys);
+    EXPECT_EQ("k10 k11 k12 k13 k14 k15 k16 k17 k18 k19 ", keys);
+    EXPECT_EQ(10u, Value(page.i));
+    EXPECT_EQ("/data/ranked?i=10&n=10&after=k09", page.url);
+    ASSERT_TRUE(Exists(page.url_next_page));
+    EXPECT_EQ("/data/ranked?i=20&n=10&after=k19", Value(page.url_next_page));
+    ASSERT_TRUE(Exists(page.url_previous_page));
+    EXPECT_EQ("/data/ranked?i=0&n=10", Value(page.url_previous_page));
+    get_page("/data/ranked?n=10&after=k095", keys);
+    EXPECT_EQ("k10 k11 k12 k13 k14 k15 k16 k17 k18 k19 ", keys);
+  }
+}
+
+namespace transactional_storage_test {
+
+CURRENT_STRUCT(Employee) {
+  CURRENT_FIELD(key, std::string);
+  CURRENT_FIELD(email, std::string);
+  CURRENT_FIELD(team, std::string);
+  CURRENT_CONSTRUCTOR(Employee)(
+      const std::string& key = "", const std::string& email = "", const std::string& team = "")
+      : key(key), email(email), team(team) {}
+};
+
+CURRENT_STORAGE_INDEX(UnorderedUnique, Employee, email, EmployeeByEmail);
+CURRENT_STORAGE_INDEX(OrderedNonUnique, Employee, team, EmployeeByTeam);
+CURRENT_STORAGE_FIELD_ENTRY_WITH_INDEXES(
+    UnorderedDictionary, Employee, EmployeeDictionary, EmployeeByEmail, EmployeeByTeam);
+
+CURRENT_STORAGE(IndexedStorage) { CURRENT_STORAGE_FIELD(employee, EmployeeDictionary); };
+
+}  // namespace transactional_storage_test
+
+TEST(TransactionalStorage, SecondaryIndexes) {
+  current::time::ResetToZero();
+
+  using namespace transactional_storage_test;
+  using Storage = IndexedStorage<JSONFilePersister>;
+
+  const std::string persistence_file_name =
+      current::FileSystem::JoinPath(FLAGS_transactional_storage_test_tmpdir, "data");
+  const auto persistence_file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+
+  // The keys of the employees of the team, and the number of teams, as seen via the ordered non-unique index.
+  const auto team = [](ImmutableFields<Storage> fields, const std::string& team) {
+    std::string keys;
+    for (const auto& employee : fields.employee.Index<EmployeeByTeam>().Find(team)) {
+      keys += employee.key + ' ';
+    }
+    return keys + '/' + current::ToString(fields.employee.Index<EmployeeByTeam>().Values().Size());
+  };
+
+  {
+    Storage storage(persistence_file_name);
+
+    current::time::SetNow(std::chrono::microseconds(1));
+    EXPECT_TRUE(WasCommitted(storage.ReadWriteTransaction([](MutableFields<Storage> fields) {
+      fields.employee.Add(Employee("alice", "a@x.com", "core"));
+      fields.employee.Add(Employee("bob", "b@x.com", "core"));
+      fields.employee.Add(Employee("carol", "c@x.com", "web"));
+    }).Go()));
+
+    storage.ReadOnlyTransaction([&team](ImmutableFields<Storage> fields) {
+      ASSERT_TRUE(Exists(fields.employee.Index<EmployeeByEmail>()["b@x.com"]));
+      EXPECT_EQ("bob", Value(fields.employee.Index<EmployeeByEmail>()["b@x.com"]).key);
+      EXPECT_FALSE(Exists(fields.employee.Index<EmployeeByEmail>()["d@x.com"]));
+      EXPECT_EQ("alice bob /2", team(fields, "core"));
+      EXPECT_EQ("carol /2", team(fields, "web"));
+      EXPECT_EQ("/2", team(fields, "ads"));
+      std::string teams;
+      for (const auto& values : fields.employee.Index<EmployeeByTeam>().Values()) {
+        teams += current::ToString(values.Size());
+      }
+      EXPECT_EQ("21", teams);
+    }).Wait();
+
+    // Updating and erasing the entries updates the indexes.
+    current::time::SetNow(std::chrono::microseconds(2));
+    EXPECT_TRUE(WasCommitted(storage.ReadWriteTransaction([](MutableFields<Storage> fields) {
+      fields.employee.Add(Employee("bob", "bob@x.com", "web"));
+      fields.employee.Erase("carol");
+      fields.employee.Add(Employee("dave", "c@x.com", "ads"));
+    }).Go()));
+
+    storage.ReadOnlyTransaction([&team](ImmutableFields<Storage> fields) {
+      EXPECT_FALSE(Exists(fields.employee.Index<EmployeeByEmail>()["b@x.com"]));
+      EXPECT_EQ("bob", Value(fields.employee.Index<EmployeeByEmail>()["bob@x.com"]).key);
+      EXPECT_EQ("dave", Value(fields.employee.Index<EmployeeByEmail>()["c@x.com"]).key);
+      EXPECT_EQ("alice /3", team(fields, "core"));
+      EXPECT_EQ("bob /3", team(fields, "web"));
+      EXPECT_EQ("dave /3", team(fields, "ads"));
+    }).Wait();
+
+    // The indexes are rolled back along with the entries.
+    current::time::SetNow(std::chrono::microseconds(3));
+    EXPECT_FALSE(WasCommitted(storage.ReadWriteTransaction([&team](MutableFields<Storage> fields) {
+      fields.employee.Add(Employee("alice", "a@x.com", "web"));
+      fields.employee.Erase("dave");
+      fields.employee.Add(Employee("erin", "e@x.com", "core"));
+      EXPECT_EQ("erin /2", team(fields, "core"));
+      EXPECT_EQ("alice bob /2", team(fields, "web"));
+      EXPECT_EQ("/2", team(fields, "ads"));
+      CURRENT_STORAGE_THROW_ROLLBACK();
+    }).Go()));
+
+    // Adding the entry with the value of a unique index taken by another entry throws, and rolls back the transaction.
+    current::time::SetNow(std::chrono::microseconds(4));
+    bool thrown = false;
+    try {
+      storage.ReadWriteTransaction([](MutableFields<Storage> fields) {
+        fields.employee.Add(Employee("erin", "e@x.com", "core"));
+        fields.employee.Add(Employee("frank", "a@x.com", "core"));
+      }).Go();
+    } catch (StorageUniqueIndexViolation e) {
+      EXPECT_EQ("email", e.index);
+      EXPECT_EQ("a@x.com", e.value);
+      thrown = true;
+    }
+    EXPECT_TRUE(thrown);
+
+    storage.ReadOnlyTransaction([&team](ImmutableFields<Storage> fields) {
+      EXPECT_EQ(3u, fields.employee.Size());
+      EXPECT_EQ("alice", Value(fields.employee.Index<EmployeeByEmail>()["a@x.com"]).key);
+      EXPECT_FALSE(Exists(fields.employee.Index<EmployeeByEmail>()["e@x.com"]));
+      EXPECT_EQ("alice /3", team(fields, "core"));
+      EXPECT_EQ("bob /3", team(fields, "web"));
+      EXPECT_EQ("dave /3", team(fields, "ads"));
+    }).Wait();
+  }
+
+  {
+    // The indexes are rebuilt when the storage is replayed.
+    Storage replayed(persistence_file_name);
+    replayed.ReadOnlyTransaction([&team](ImmutableFields<Storage> fields) {
+      EXPECT_EQ("dave", Value(fields.employee.Index<EmployeeByEmail>()["c@x.com"]).key);
+      EXPECT_EQ("alice /3", team(fields, "core"));
+      EXPECT_EQ("bob /3", team(fields, "web"));
+      EXPECT_EQ("dave /3", team(fields, "ads"));
+      const auto values = fields.employee.Index<EmployeeByTeam>().Values();
+      ASSERT_TRUE(values.UpperBound("ads") != values.end());
+      EXPECT_EQ("core", values.UpperBound("ads").key());
+    }).Wait();
+  }
+}
+
+namespace transactional_storage_test {
+
+CURRENT_STORAGE_INDEX(OrderedNonUnique, Cell, phew, CellByPhew);
+CURRENT_STORAGE_INDEX(UnorderedUnique, Cell, phew, CellByUniquePhew);
+CURRENT_STORAGE_FIELD_ENTRY_WITH_INDEXES(OrderedManyToOrderedMany, Cell, IndexedCellManyToMany, CellByPhew);
+CURRENT_STORAGE_FIELD_ENTRY_WITH_INDEXES(UnorderedOneToUnorderedMany, Cell, IndexedCellOneToMany, CellByUniquePhew);
+
+CURRENT_STORAGE(IndexedMatrixStorage) {
+  CURRENT_STORAGE_FIELD(many, IndexedCellManyToMany);
+  CURRENT_STORAGE_FIELD(one, IndexedCellOneToMany);
+};
+
+}  // namespace transactional_storage_test
+
+TEST(TransactionalStorage, MatrixSecondaryIndexes) {
+  current::time::ResetToZero();
+
+  using namespace transactional_storage_test;
+  using Storage = IndexedMatrixStorage<JSONFilePersister>;
+
+  const std::string persistence_file_name =
+      current::FileSystem::JoinPath(FLAGS_transactional_storage_test_tmpdir, "data");
+  const auto persistence_file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+
+  // The `row,col` keys of the cells with this `phew`, and the number of distinct `phew`-s.
+  const auto many = [](ImmutableFields<Storage> fields, int32_t phew) {
+    std::string keys;
+    for (const auto& cell : fields.many.Index<CellByPhew>().Find(phew)) {
+      keys += current::ToString(cell.foo) + ',' + cell.bar + ' ';
+    }
+    return keys + '/' + current::ToString(fields.many.Index<CellByPhew>().Values().Size());
+  };
+  const auto one = [](ImmutableFields<Storage> fields, int32_t phew) -> std::string {
+    const auto cell = fields.one.Index<CellByUniquePhew>()[phew];
+    return Exists(cell) ? current::ToString(Value(cell).foo) + ',' + Value(cell).bar : "none";
+  };
+
+  {
+    Storage storage(persistence_file_name);
+
+    current::time::SetNow(std::chrono::microseconds(1));
+    EXPECT_TRUE(WasCommitted(storage.ReadWriteTransaction([](MutableFields<Storage> fields) {
+      fields.many.Add(Cell(1, "a", 7));
+      fields.many.Add(Cell(1, "b", 7));
+      fields.many.Add(Cell(2, "a", 8));
+      fields.one.Add(Cell(1, "a", 7));
+      fields.one.Add(Cell(1, "b", 8));
+    }).Go()));
+
+    storage.ReadOnlyTransaction([&many, &one](ImmutableFields<Storage> fields) {
+      EXPECT_EQ("1,a 1,b /2", many(fields, 7));
+      EXPECT_EQ("2,a /2", many(fields, 8));
+      EXPECT_EQ("1,a", one(fields, 7));
+      EXPECT_EQ("1,b", one(fields, 8));
+      EXPECT_EQ("none", one(fields, 9));
+    }).Wait();
+
+    // Updating and erasing the cells updates the indexes, including the cells displaced from their cols, which may
+    // have the very value of the unique index the new cell takes.
+    current::time::SetNow(std::chrono::microseconds(2));
+    EXPECT_TRUE(WasCommitted(storage.ReadWriteTransaction([](MutableFields<Storage> fields) {
+      fields.many.Add(Cell(1, "b", 8));
+      fields.many.Erase(2, "a");
+      fields.one.Add(Cell(2, "a", 7));
+    }).Go()));
+
+    storage.ReadOnlyTransaction([&many, &one](ImmutableFields<Storage> fields) {
+      EXPECT_EQ("1,a /2", many(fields, 7));
+      EXPECT_EQ("1,b /2", many(fields, 8));
+      EXPECT_EQ(2u, fields.one.Size());
+      EXPECT_EQ("2,a", one(fields, 7));
+      EXPECT_EQ("1,b", one(fields, 8));
+    }).Wait();
+
+    // The indexes are rolled back along with the cells.
+    current::time::SetNow(std::chrono::microseconds(3));
+    EXPECT_FALSE(WasCommitted(storage.ReadWriteTransaction([&many, &one](MutableFields<Storage> fields) {
+      fields.many.Add(Cell(3, "c", 9));
+      fields.many.Erase(1, "a");
+      fields.one.Erase(2, "a");
+      fields.one.Add(Cell(3, "c", 7));
+      EXPECT_EQ("/2", many(fields, 7));
+      EXPECT_EQ("3,c /2", many(fields, 9));
+      EXPECT_EQ("3,c", one(fields, 7));
+      CURRENT_STORAGE_THROW_ROLLBACK();
+    }).Go()));
+
+    // The unique index throws the exception with the value as is.
+    current::time::SetNow(std::chrono::microseconds(4));
+    bool thrown = false;
+    try {
+      storage.ReadWriteTransaction([](MutableFields<Storage> fields) { fields.one.Add(Cell(3, "c", 8)); }).Go();
+    } catch (StorageUniqueIndexViolationForIndex<CellByUniquePhew> e) {
+      EXPECT_EQ("phew", e.index);
+      EXPECT_EQ("8", e.value);
+      EXPECT_EQ(8, e.typed_value);
+      thrown = true;
+    }
+    EXPECT_TRUE(thrown);
+
+    storage.ReadOnlyTransaction([&many, &one](ImmutableFields<Storage> fields) {
+      EXPECT_EQ("1,a /2", many(fields, 7));
+      EXPECT_EQ("1,b /2", many(fields, 8));
+      EXPECT_EQ("2,a", one(fields, 7));
+      EXPECT_EQ("1,b", one(fields, 8));
+      EXPECT_FALSE(Exists(fields.one.Get(3, "c")));
+    }).Wait();
+
+    // The violation caught within the transaction leaves no trace, not even of the cell it would have displaced.
+    current::time::SetNow(std::chrono::microseconds(5));
+    EXPECT_TRUE(WasCommitted(storage.ReadWriteTransaction([](MutableFields<Storage> fields) {
+      bool thrown = false;
+      try {
+        fields.one.Add(Cell(3, "a", 8));
+      } catch (const StorageUniqueIndexViolation&) {
+        thrown = true;
+      }
+      EXPECT_TRUE(thrown);
+    }).Go()));
+
+    storage.ReadOnlyTransaction([&one](ImmutableFields<Storage> fields) {
+      EXPECT_EQ(2u, fields.one.Size());
+      EXPECT_EQ("2,a", one(fields, 7));
+      EXPECT_EQ("1,b", one(fields, 8));
+    }).Wait();
+  }
+
+  {
+    // The indexes are rebuilt when the storage is replayed.
+    Storage replayed(persistence_file_name);
+    replayed.ReadOnlyTransaction([&many, &one](ImmutableFields<Storage> fields) {
+      EXPECT_EQ("1,a /2", many(fields, 7));
+      EXPECT_EQ("1,b /2", many(fields, 8));
+      EXPECT_EQ(2u, fields.one.Size());
+      EXPECT_EQ("2,a", one(fields, 7));
+      EXPECT_EQ("1,b", one(fields, 8));
+    }).Wait();
+  }
+}
+
+TEST(TransactionalStorage, RESTfulAPISecondaryIndexesTest) {
+  current::time::ResetToZero();
+
+  using namespace transactional_storage_test;
+  using namespace current::storage::rest;
+  using Storage = IndexedStorage<SherlockInMemoryStreamPersister>;
+
+  Storage storage;
+
+  const auto base_url = current::strings::Printf("http://localhost:%d", FLAGS_transactional_storage_test_port);
+
+  const auto rest1 = RESTfulStorage<Storage>(storage, FLAGS_transactional_storage_test_port, "/plain", "");
+  const auto rest2 = RESTfulStorage<Storage, current::storage::rest::Hypermedia>(
+      storage, FLAGS_transactional_storage_test_port, "/hypermedia", "");
+
+  EXPECT_EQ(201,
+            static_cast<int>(
+                HTTP(PUT(base_url + "/plain/data/employee/alice", Employee("alice", "a@x.com", "core"))).code));
+  EXPECT_EQ(201,
+            static_cast<int>(
+                HTTP(PUT(base_url + "/plain/data/employee/bob", Employee("bob", "b@x.com", "web"))).code));
+  EXPECT_EQ(201,
+            static_cast<int>(
+                HTTP(PUT(base_url + "/hypermedia/data/employee/carol", Employee("carol", "c@x.com", "web"))).code));
+
+  {
+    const auto response = HTTP(GET(base_url + "/plain/data/employee.team"));
+    EXPECT_EQ(200, static_cast<int>(response.code));
+    EXPECT_EQ("core\t1\nweb\t2\n", response.body);
+  }
+  {
+    const auto response = HTTP(GET(base_url + "/plain/data/employee.email/b@x.com"));
+    EXPECT_EQ(200, static_cast<int>(response.code));
+    EXPECT_EQ("{\"key\":\"bob\",\"email\":\"b@x.com\",\"team\":\"web\"}\n", response.body);
+  }
+  {
+    const auto response = HTTP(GET(base_url + "/plain/data/employee.team/ads"));
+    EXPECT_EQ(404, static_cast<int>(response.code));
+  }
+  {
+    const auto response = HTTP(GET(base_url + "/hypermedia/data/employee.team"));
+    EXPECT_EQ(200, static_cast<int>(response.code));
+    EXPECT_EQ(
+        "{\"success\":true,\"url\":\"/data/employee.team?i=0&n=10\",\"url_directory\":\"/data/employee.team\","
+        "\"i\":0,\"n\":2,\"total\":2,\"url_next_page\":null,\"url_previous_page\":null,\"data\":["
+        "{\"url\":\"/data/employee.team/core\",\"data\":{\"total\":1,\"preview\":["
+        "{\"key\":\"alice\",\"email\":\"a@x.com\",\"team\":\"core\"}]}},"
+        "{\"url\":\"/data/employee.team/web\",\"data\":{\"total\":2,\"preview\":["
+        "{\"key\":\"bob\",\"email\":\"b@x.com\",\"team\":\"web\"},"
+        "{\"key\":\"carol\",\"email\":\"c@x.com\",\"team\":\"web\"}]}}]}\n",
+        response.body);
+  }
+  {
+    const auto response = HTTP(GET(base_url + "/hypermedia/data/employee.team/web?n=1"));
+    EXPECT_EQ(200, static_cast<int>(response.code));
+    EXPECT_EQ(
+        "{\"success\":true,\"url\":\"/data/employee.team/web?i=0&n=1\",\"url_directory\":\"/data/employee\","
+        "\"i\":0,\"n\":1,\"total\":2,\"url_next_page\":\"/data/employee.team/web?i=1&n=1&after=bob\","
+        "\"url_previous_page\":null,\"data\":[{\"url\":\"/data/employee/bob\",\"data\":"
+        "{\"key\":\"bob\",\"email\":\"b@x.com\",\"team\":\"web\"}}]}\n",
+        response.body);
+  }
+  {
+    const auto response = HTTP(GET(base_url + "/hypermedia/data/employee.team/web?i=1&n=1&after=bob"));
+    EXPECT_EQ(200, static_cast<int>(response.code));
+    EXPECT_EQ(
+        "{\"success\":true,\"url\":\"/data/employee.team/web?n=1&after=bob\",\"url_directory\":\"/data/employee\","
+        "\"i\":null,\"n\":1,\"total\":2,\"url_next_page\":null,\"url_previous_page\":null,"
+        "\"data\":[{\"url\":\"/data/employee/carol\",\"data\":"
+        "{\"key\":\"carol\",\"email\":\"c@x.com\",\"team\":\"web\"}}]}\n",
+        response.body);
+  }
+
+  // Taking the email of another employee is a conflict, and leaves the storage intact.
+  {
+    const auto response = HTTP(PUT(base_url + "/plain/data/employee/bob", Employee("bob", "a@x.com", "web")));
+    EXPECT_EQ(409, static_cast<int>(response.code));
+    EXPECT_EQ("Unique index `email` already has the value `a@x.com`.\n", response.body);
+  }
+  {
+    const auto response = HTTP(PUT(base_url + "/hypermedia/data/employee/dave", Employee("dave", "c@x.com", "ads")));
+    EXPECT_EQ(409, static_cast<int>(response.code));
+    EXPECT_EQ(
+        "{\"success\":false,\"message\":null,\"error\":{\"name\":\"UniqueIndexViolation\",\"message\":"
+        "\"Another resource has the same value of the unique field.\",\"details\":{\"index\":\"email\",\"value\":"
+        "\"c@x.com\"}}}\n",
+        response.body);
+  }
+  {
+    const auto response = HTTP(GET(base_url + "/plain/data/employee.email/a@x.com"));
+    EXPECT_EQ(200, static_cast<int>(response.code));
+    EXPECT_EQ("{\"key\":\"alice\",\"email\":\"a@x.com\",\"team\":\"core\"}\n", response.body);
+  }
+  {
+    const auto response = HTTP(GET(base_url + "/plain/data/employee.team"));
+    EXPECT_EQ(200, static_cast<int>(response.code));
+    EXPECT_EQ("core\t1\nweb\t2\n", response.body);
+  }
+
+  // The secondary indexes of the matrices are browsed the same way, and link to the cells by their rows and cols.
+  IndexedMatrixStorage<SherlockInMemoryStreamPersister> matrix_storage;
+  const auto rest3 = RESTfulStorage<IndexedMatrixStorage<SherlockInMemoryStreamPersister>>(
+      matrix_storage, FLAGS_transactional_storage_test_port, "/matrix", "");
+  const auto rest4 = RESTfulStorage<IndexedMatrixStorage<SherlockInMemoryStreamPersister>, Hypermedia>(
+      matrix_storage, FLAGS_transactional_storage_test_port, "/hypermatrix", "");
+  EXPECT_EQ(201, static_cast<int>(HTTP(PUT(base_url + "/matrix/data/many/1/a", Cell(1, "a", 7))).code));
+  EXPECT_EQ(201, static_cast<int>(HTTP(PUT(base_url + "/matrix/data/many/2/b", Cell(2, "b", 7))).code));
+  EXPECT_EQ(201, static_cast<int>(HTTP(PUT(base_url + "/matrix/data/many/2/c", Cell(2, "c", 8))).code));
+  EXPECT_EQ(201, static_cast<int>(HTTP(PUT(base_url + "/matrix/data/one/1/a", Cell(1, "a", 7))).code));
+  {
+    const auto response = HTTP(GET(base_url + "/matrix/data/many.phew"));
+    EXPECT_EQ(200, static_cast<int>(response.code));
+    EXPECT_EQ("7\t2\n8\t1\n", response.body);
+  }
+  {
+    const auto response = HTTP(GET(base_url + "/hypermatrix/data/many.phew/7"));
+    EXPECT_EQ(200, static_cast<int>(response.code));
+    EXPECT_EQ(
+        "{\"success\":true,\"url\":\"/data/many.phew/7?i=0&n=10\",\"url_directory\":\"/data/many\","
+        "\"i\":0,\"n\":2,\"total\":2,\"url_next_page\":null,\"url_previous_page\":null,\"data\":["
+        "{\"url\":\"/data/many/1/a\",\"data\":{\"foo\":1,\"bar\":\"a\",\"phew\":7}},"
+        "{\"url\":\"/data/many/2/b\",\"data\":{\"foo\":2,\"bar\":\"b\",\"phew\":7}}]}\n",
+        response.body);
+  }
+  {
+    const auto response = HTTP(GET(base_url + "/matrix/data/one.phew/7"));
+    EXPECT_EQ(200, static_cast<int>(response.code));
+    EXPECT_EQ("{\"foo\":1,\"bar\":\"a\",\"phew\":7}\n", response.body);
+  }
+  {
+    const auto response = HTTP(PUT(base_url + "/matrix/data/one/2/b", Cell(2, "b", 7)));
+    EXPECT_EQ(409, static_cast<int>(response.code));
+    EXPECT_EQ("Unique index `phew` already has the value `7`.\n", response.body);
+  }
+}
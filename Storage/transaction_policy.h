@@ -25,12 +25,21 @@ SOFTWARE.
 #ifndef CURRENT_STORAGE_TRANSACTION_POLICY_H
 #define CURRENT_STORAGE_TRANSACTION_POLICY_H
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include "base.h"
 #include "exceptions.h"
 #include "transaction_result.h"
 
+#include "persister/common.h"
+
+#include "../Bricks/sync/locks.h"
 #include "../Bricks/util/future.h"
 
 #include "../Blocks/SS/ss.h"
@@ -40,16 +49,119 @@ namespace current {
 namespace storage {
 namespace transaction_policy {
 
+namespace locking {
+
+// All transactions, read-write and read-only, hold the storage mutex exclusively.
+template <class PERSISTER>
+class Exclusive final {
+ public:
+  Exclusive(std::mutex& storage_mutex, PERSISTER&) : storage_mutex_ref_(storage_mutex) {}
+
+  class ReadWriteScope final {
+   public:
+    explicit ReadWriteScope(Exclusive& self) : lock_(self.storage_mutex_ref_) {}
+
+   private:
+    std::lock_guard<std::mutex> lock_;
+  };
+  using ReadOnlyScope = ReadWriteScope;
+
+ private:
+  std::mutex& storage_mutex_ref_;
+};
+
+// Read-write transactions hold the storage mutex, and, on top of it, the readers-writer mutex exclusively.
+// Read-only transactions only hold the readers-writer mutex, in shared mode, and thus run concurrently.
+//
+// The mutations replayed by a follower storage are applied by the persister from under the storage mutex alone.
+// Thus, shared reads are only enabled once the persister owns the data, which, for a given storage, is permanent.
+// Until then, read-only transactions hold the storage mutex exclusively, same as with the `Exclusive` locking.
 template <class PERSISTER>
-class Synchronous final {
+class SharedReads final {
+ public:
+  SharedReads(std::mutex& storage_mutex, PERSISTER& persister)
+      : storage_mutex_ref_(storage_mutex), persister_(persister), shared_reads_enabled_(false) {}
+
+  class ReadWriteScope final {
+   public:
+    explicit ReadWriteScope(SharedReads& self) : storage_lock_(self.storage_mutex_ref_), rw_lock_(self.rw_mutex_) {}
+
+   private:
+    std::lock_guard<std::mutex> storage_lock_;
+    std::lock_guard<current::locks::SharedMutex> rw_lock_;
+  };
+
+  class ReadOnlyScope final {
+   public:
+    explicit ReadOnlyScope(SharedReads& self) : self_(self), shared_(self.SharedReadsEnabled()) {
+      if (shared_) {
+        self_.rw_mutex_.lock_shared();
+      } else {
+        self_.storage_mutex_ref_.lock();
+      }
+    }
+    ~ReadOnlyScope() {
+      if (shared_) {
+        self_.rw_mutex_.unlock_shared();
+      } else {
+        self_.storage_mutex_ref_.unlock();
+      }
+    }
+
+   private:
+    SharedReads& self_;
+    const bool shared_;
+  };
+
+ private:
+  bool SharedReadsEnabled() {
+    if (!shared_reads_enabled_ && persister_.DataAuthority() == persister::PersisterDataAuthority::Own) {
+      shared_reads_enabled_ = true;
+    }
+    return shared_reads_enabled_;
+  }
+
+  std::mutex& storage_mutex_ref_;
+  PERSISTER& persister_;
+  current::locks::SharedMutex rw_mutex_;
+  std::atomic_bool shared_reads_enabled_;
+};
+
+}  // namespace current::storage::transaction_policy::locking
+
+namespace impl {
+
+// The storage has already been mutated by the time the journal is persisted, so failing to persist it is fatal.
+template <typename F>
+void PersistJournalOrExit(F&& persist) {
+  try {
+    persist();
+  } catch (const ss::InconsistentTimestampException& e) {
+    std::cerr << "PersistJournal() failed with InconsistentTimestampException: " << e.what() << std::endl;
+#ifdef CURRENT_MOCK_TIME
+    std::cerr << "Binary is compiled with `CURRENT_MOCK_TIME`. Probably `SetNow()` wasn't properly called."
+              << std::endl;
+#endif
+    std::exit(-1);
+  } catch (const std::exception& e) {
+    std::cerr << "PersistJournal() failed with exception: " << e.what() << std::endl;
+    std::exit(-1);
+  }
+}
+
+}  // namespace current::storage::transaction_policy::impl
+
+template <class PERSISTER, template <typename> class LOCKING>
+class GenericSynchronous final {
  public:
   using transaction_t = typename PERSISTER::transaction_t;
+  using locking_t = LOCKING<PERSISTER>;
 
-  Synchronous(std::mutex& storage_mutex, PERSISTER& persister, MutationJournal& journal)
-      : storage_mutex_ref_(storage_mutex), persister_(persister), journal_(journal) {}
+  GenericSynchronous(std::mutex& storage_mutex, PERSISTER& persister, MutationJournal& journal)
+      : locking_(storage_mutex, persister), persister_(persister), journal_(journal) {}
 
-  ~Synchronous() {
-    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+  ~GenericSynchronous() {
+    typename locking_t::ReadWriteScope lock(locking_);
     destructing_ = true;
   }
 
@@ -60,7 +172,7 @@ class Synchronous final {
   template <typename F, class = std::enable_if_t<!std::is_void<f_result_t<F>>::value>>
   Future<TransactionResult<f_result_t<F>>, StrictFuture::Strict> Transaction(F&& f) {
     using result_t = f_result_t<F>;
-    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    typename locking_t::ReadWriteScope lock(locking_);
     journal_.AssertEmpty();
     std::promise<TransactionResult<result_t>> promise;
     if (destructing_) {
@@ -85,7 +197,7 @@ class Synchronous final {
         try {
           promise.set_exception(std::current_exception());
         } catch (const std::exception& e) {
-          std::cerr << "`promise.set_exception()` failed in Synchronous::Transaction: " << e.what() << std::endl;
+          std::cerr << "`promise.set_exception()` failed in GenericSynchronous::Transaction: " << e.what() << std::endl;
           std::exit(-1);
         }
         // LCOV_EXCL_STOP
@@ -102,7 +214,7 @@ class Synchronous final {
   template <typename F, class = std::enable_if_t<!std::is_void<f_result_t<F>>::value>>
   Future<TransactionResult<f_result_t<F>>, StrictFuture::Strict> Transaction(F&& f) const {
     using result_t = f_result_t<F>;
-    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    typename locking_t::ReadOnlyScope lock(locking_);
     journal_.AssertEmpty();
     std::promise<TransactionResult<result_t>> promise;
     if (destructing_) {
@@ -122,7 +234,7 @@ class Synchronous final {
         try {
           promise.set_exception(std::current_exception());
         } catch (const std::exception& e) {
-          std::cerr << "`promise.set_exception()` failed in Synchronous::Transaction: " << e.what() << std::endl;
+          std::cerr << "`promise.set_exception()` failed in GenericSynchronous::Transaction: " << e.what() << std::endl;
           std::exit(-1);
         }
         // LCOV_EXCL_STOP
@@ -137,7 +249,7 @@ class Synchronous final {
   // Read-write transaction returning void type.
   template <typename F, class = std::enable_if_t<std::is_void<f_result_t<F>>::value>>
   Future<TransactionResult<void>, StrictFuture::Strict> Transaction(F&& f) {
-    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    typename locking_t::ReadWriteScope lock(locking_);
     journal_.AssertEmpty();
     std::promise<TransactionResult<void>> promise;
     if (destructing_) {
@@ -160,7 +272,7 @@ class Synchronous final {
         try {
           promise.set_exception(std::current_exception());
         } catch (const std::exception& e) {
-          std::cerr << "`promise.set_exception()` failed in Synchronous::Transaction: " << e.what() << std::endl;
+          std::cerr << "`promise.set_exception()` failed in GenericSynchronous::Transaction: " << e.what() << std::endl;
           std::exit(-1);
         }
         // LCOV_EXCL_STOP
@@ -176,7 +288,7 @@ class Synchronous final {
   // Read-only transaction returning void type.
   template <typename F, class = std::enable_if_t<std::is_void<f_result_t<F>>::value>>
   Future<TransactionResult<void>, StrictFuture::Strict> Transaction(F&& f) const {
-    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    typename locking_t::ReadOnlyScope lock(locking_);
     journal_.AssertEmpty();
     std::promise<TransactionResult<void>> promise;
     if (destructing_) {
@@ -193,7 +305,7 @@ class Synchronous final {
         try {
           promise.set_exception(std::current_exception());
         } catch (const std::exception& e) {
-          std::cerr << "`promise.set_exception()` failed in Synchronous::Transaction: " << e.what() << std::endl;
+          std::cerr << "`promise.set_exception()` failed in GenericSynchronous::Transaction: " << e.what() << std::endl;
           std::exit(-1);
         }
         // LCOV_EXCL_STOP
@@ -210,7 +322,7 @@ class Synchronous final {
   template <typename F1, typename F2, class = std::enable_if_t<!std::is_void<f_result_t<F1>>::value>>
   Future<TransactionResult<void>, StrictFuture::Strict> Transaction(F1&& f1, F2&& f2) {
     using result_t = f_result_t<F1>;
-    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    typename locking_t::ReadWriteScope lock(locking_);
     journal_.AssertEmpty();
     std::promise<TransactionResult<void>> promise;
     if (destructing_) {
@@ -239,7 +351,7 @@ class Synchronous final {
         try {
           promise.set_exception(std::current_exception());
         } catch (const std::exception& e) {
-          std::cerr << "`promise.set_exception()` failed in Synchronous::Transaction: " << e.what() << std::endl;
+          std::cerr << "`promise.set_exception()` failed in GenericSynchronous::Transaction: " << e.what() << std::endl;
           std::exit(-1);
         }
         // LCOV_EXCL_STOP
@@ -252,7 +364,7 @@ class Synchronous final {
   template <typename F1, typename F2, class = std::enable_if_t<!std::is_void<f_result_t<F1>>::value>>
   Future<TransactionResult<void>, StrictFuture::Strict> Transaction(F1&& f1, F2&& f2) const {
     using result_t = f_result_t<F1>;
-    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    typename locking_t::ReadOnlyScope lock(locking_);
     journal_.AssertEmpty();
     std::promise<TransactionResult<void>> promise;
     if (destructing_) {
@@ -273,7 +385,7 @@ class Synchronous final {
         try {
           promise.set_exception(std::current_exception());
         } catch (const std::exception& e) {
-          std::cerr << "`promise.set_exception()` failed in Synchronous::Transaction: " << e.what() << std::endl;
+          std::cerr << "`promise.set_exception()` failed in GenericSynchronous::Transaction: " << e.what() << std::endl;
           std::exit(-1);
         }
         // LCOV_EXCL_STOP
@@ -283,34 +395,388 @@ class Synchronous final {
   }
 
   void GracefulShutdown() {
-    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    typename locking_t::ReadWriteScope lock(locking_);
     destructing_ = true;
   }
 
  private:
   void PersistJournal() {
-    try {
-      persister_.PersistJournal(journal_);
-    } catch (const ss::InconsistentTimestampException& e) {
-      std::cerr << "PersistJournal() failed with InconsistentTimestampException: " << e.what() << std::endl;
-#ifdef CURRENT_MOCK_TIME
-      std::cerr << "Binary is compiled with `CURRENT_MOCK_TIME`. Probably `SetNow()` wasn't properly called."
-                << std::endl;
-#endif
-      std::exit(-1);
-    } catch (const std::exception& e) {
-      std::cerr << "PersistJournal() failed with exception: " << e.what() << std::endl;
-      std::exit(-1);
+    impl::PersistJournalOrExit([this]() { persister_.PersistJournal(journal_); });
+  }
+
+  mutable locking_t locking_;
+  PERSISTER& persister_;
+  MutationJournal& journal_;
+  bool destructing_ = false;
+};
+
+// Read-write transactions are applied to the storage one at a time, under the storage mutex, but their journals are
+// persisted by a background thread, in the order of the commits, with the storage mutex released. Thus, the next
+// transaction runs while the previous one is still being persisted.
+//
+// The future returned by a transaction, read-only and rolled back ones included, is only resolved once every
+// transaction committed before it, as well as the transaction itself, is persisted. Thus, no result which depends on
+// the data that is not yet durable is ever observed. As with the `Synchronous` policy, a failure to persist is fatal.
+//
+// The persister must support `PersistPipelinedJournal()`, called from the background thread, with the storage mutex
+// not locked, in the order in which the journals are committed. Before that, `PipelinedJournalCommitted()` is called
+// with the storage mutex locked, as each journal is handed over, for the persister to know the storage fields are
+// ahead of what it has persisted.
+template <class PERSISTER>
+class Pipelined final {
+ public:
+  using transaction_t = typename PERSISTER::transaction_t;
+
+  Pipelined(std::mutex& storage_mutex, PERSISTER& persister, MutationJournal& journal)
+      : storage_mutex_ref_(storage_mutex),
+        persister_(persister),
+        journal_(journal),
+        thread_([this]() { PersistingThread(); }) {}
+
+  // Persists all the journals handed over before returning.
+  ~Pipelined() {
+    {
+      std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+      destructing_ = true;
+    }
+    {
+      std::lock_guard<std::mutex> lock(pipeline_mutex_);
+      stopping_ = true;
+    }
+    pipeline_condition_.notify_one();
+    thread_.join();
+  }
+
+  template <typename F>
+  using f_result_t = typename std::result_of<F()>::type;
+
+  // Read-write transaction returning non-void type.
+  template <typename F, class = std::enable_if_t<!std::is_void<f_result_t<F>>::value>>
+  Future<TransactionResult<f_result_t<F>>, StrictFuture::Strict> Transaction(F&& f) {
+    using result_t = f_result_t<F>;
+    const auto promise = std::make_shared<std::promise<TransactionResult<result_t>>>();
+    Future<TransactionResult<result_t>, StrictFuture::Strict> future(promise->get_future());
+    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    journal_.AssertEmpty();
+    if (destructing_) {
+      promise->set_exception(std::make_exception_ptr(StorageInGracefulShutdownException()));  // LCOV_EXCL_LINE
+    } else {
+      const auto f_result = std::make_shared<result_t>();
+      bool successful = false;
+      try {
+        journal_.BeforeTransaction();
+        *f_result = f();
+        journal_.AfterTransaction();
+        successful = true;
+      } catch (StorageRollbackExceptionWithValue<result_t> e) {
+        journal_.Rollback();
+        *f_result = std::move(e.value);
+        Resolve([promise, f_result]() {
+          promise->set_value(TransactionResult<result_t>::RolledBack(std::move(*f_result)));
+        });
+      } catch (StorageRollbackExceptionWithNoValue) {
+        journal_.Rollback();
+        Resolve([promise]() { promise->set_value(TransactionResult<result_t>::RolledBack(OptionalResultMissing())); });
+      } catch (...) {  // The exception is captured with `std::current_exception()` below.
+        journal_.Rollback();
+        const std::exception_ptr e = std::current_exception();
+        Resolve([promise, e]() { promise->set_exception(e); });
+      }
+      if (successful) {
+        Commit([promise, f_result]() {
+          promise->set_value(TransactionResult<result_t>::Committed(std::move(*f_result)));
+        });
+      }
+    }
+    return future;
+  }
+
+  // Read-only transaction returning non-void type.
+  template <typename F, class = std::enable_if_t<!std::is_void<f_result_t<F>>::value>>
+  Future<TransactionResult<f_result_t<F>>, StrictFuture::Strict> Transaction(F&& f) const {
+    using result_t = f_result_t<F>;
+    const auto promise = std::make_shared<std::promise<TransactionResult<result_t>>>();
+    Future<TransactionResult<result_t>, StrictFuture::Strict> future(promise->get_future());
+    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    journal_.AssertEmpty();
+    if (destructing_) {
+      promise->set_exception(std::make_exception_ptr(StorageInGracefulShutdownException()));  // LCOV_EXCL_LINE
+    } else {
+      const auto f_result = std::make_shared<result_t>();
+      try {
+        *f_result = f();
+        Resolve([promise, f_result]() {
+          promise->set_value(TransactionResult<result_t>::Committed(std::move(*f_result)));
+        });
+      } catch (StorageRollbackExceptionWithValue<result_t> e) {
+        *f_result = std::move(e.value);
+        Resolve([promise, f_result]() {
+          promise->set_value(TransactionResult<result_t>::RolledBack(std::move(*f_result)));
+        });
+      } catch (StorageRollbackExceptionWithNoValue) {
+        Resolve([promise]() { promise->set_value(TransactionResult<result_t>::RolledBack(OptionalResultMissing())); });
+      } catch (...) {  // The exception is captured with `std::current_exception()` below.
+        const std::exception_ptr e = std::current_exception();
+        Resolve([promise, e]() { promise->set_exception(e); });
+      }
+    }
+    return future;
+  }
+
+  // Read-write transaction returning void type.
+  template <typename F, class = std::enable_if_t<std::is_void<f_result_t<F>>::value>>
+  Future<TransactionResult<void>, StrictFuture::Strict> Transaction(F&& f) {
+    const auto promise = std::make_shared<std::promise<TransactionResult<void>>>();
+    Future<TransactionResult<void>, StrictFuture::Strict> future(promise->get_future());
+    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    journal_.AssertEmpty();
+    if (destructing_) {
+      promise->set_exception(std::make_exception_ptr(StorageInGracefulShutdownException()));  // LCOV_EXCL_LINE
+    } else {
+      bool successful = false;
+      try {
+        journal_.BeforeTransaction();
+        f();
+        journal_.AfterTransaction();
+        successful = true;
+      } catch (StorageRollbackExceptionWithNoValue) {
+        journal_.Rollback();
+        Resolve([promise]() { promise->set_value(TransactionResult<void>::RolledBack(OptionalResultExists())); });
+      } catch (...) {  // The exception is captured with `std::current_exception()` below.
+        journal_.Rollback();
+        const std::exception_ptr e = std::current_exception();
+        Resolve([promise, e]() { promise->set_exception(e); });
+      }
+      if (successful) {
+        Commit([promise]() { promise->set_value(TransactionResult<void>::Committed(OptionalResultExists())); });
+      }
+    }
+    return future;
+  }
+
+  // Read-only transaction returning void type.
+  template <typename F, class = std::enable_if_t<std::is_void<f_result_t<F>>::value>>
+  Future<TransactionResult<void>, StrictFuture::Strict> Transaction(F&& f) const {
+    const auto promise = std::make_shared<std::promise<TransactionResult<void>>>();
+    Future<TransactionResult<void>, StrictFuture::Strict> future(promise->get_future());
+    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    journal_.AssertEmpty();
+    if (destructing_) {
+      promise->set_exception(std::make_exception_ptr(StorageInGracefulShutdownException()));  // LCOV_EXCL_LINE
+    } else {
+      try {
+        f();
+        Resolve([promise]() { promise->set_value(TransactionResult<void>::Committed(OptionalResultExists())); });
+      } catch (StorageRollbackExceptionWithNoValue) {
+        Resolve([promise]() { promise->set_value(TransactionResult<void>::RolledBack(OptionalResultExists())); });
+      } catch (...) {  // The exception is captured with `std::current_exception()` below.
+        const std::exception_ptr e = std::current_exception();
+        Resolve([promise, e]() { promise->set_exception(e); });
+      }
+    }
+    return future;
+  }
+
+  // Read-write two-step transaction. `f2` is called from the background thread, once `f1` is persisted.
+  template <typename F1, typename F2, class = std::enable_if_t<!std::is_void<f_result_t<F1>>::value>>
+  Future<TransactionResult<void>, StrictFuture::Strict> Transaction(F1&& f1, F2&& f2) {
+    using result_t = f_result_t<F1>;
+    const auto promise = std::make_shared<std::promise<TransactionResult<void>>>();
+    Future<TransactionResult<void>, StrictFuture::Strict> future(promise->get_future());
+    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    journal_.AssertEmpty();
+    if (destructing_) {
+      promise->set_exception(std::make_exception_ptr(StorageInGracefulShutdownException()));  // LCOV_EXCL_LINE
+    } else {
+      const auto f1_result = std::make_shared<result_t>();
+      const auto f2_copy = std::make_shared<current::decay<F2>>(std::forward<F2>(f2));
+      bool successful = false;
+      try {
+        journal_.BeforeTransaction();
+        *f1_result = f1();
+        journal_.AfterTransaction();
+        successful = true;
+      } catch (StorageRollbackExceptionWithValue<result_t> e) {
+        // Transaction was rolled back, but returned a value, which we try to pass again to `f2`.
+        journal_.Rollback();
+        *f1_result = std::move(e.value);
+        Resolve([promise, f1_result, f2_copy]() {
+          try {
+            (*f2_copy)(std::move(*f1_result));
+            promise->set_value(TransactionResult<void>::RolledBack(OptionalResultMissing()));
+          } catch (...) {
+            promise->set_exception(std::current_exception());
+          }
+        });
+      } catch (StorageRollbackExceptionWithNoValue) {
+        // Transaction was rolled back and returned nothing we can pass to `f2`.
+        journal_.Rollback();
+        Resolve([promise]() { promise->set_value(TransactionResult<void>::RolledBack(OptionalResultMissing())); });
+      } catch (...) {  // The exception is captured with `std::current_exception()` below.
+        journal_.Rollback();
+        const std::exception_ptr e = std::current_exception();
+        Resolve([promise, e]() { promise->set_exception(e); });
+      }
+      if (successful) {
+        Commit([promise, f1_result, f2_copy]() {
+          try {
+            (*f2_copy)(std::move(*f1_result));
+            promise->set_value(TransactionResult<void>::Committed(OptionalResultExists()));
+          } catch (...) {
+            promise->set_exception(std::current_exception());
+          }
+        });
+      }
+    }
+    return future;
+  }
+
+  // Read-only two-step transaction.
+  template <typename F1, typename F2, class = std::enable_if_t<!std::is_void<f_result_t<F1>>::value>>
+  Future<TransactionResult<void>, StrictFuture::Strict> Transaction(F1&& f1, F2&& f2) const {
+    using result_t = f_result_t<F1>;
+    const auto promise = std::make_shared<std::promise<TransactionResult<void>>>();
+    Future<TransactionResult<void>, StrictFuture::Strict> future(promise->get_future());
+    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    journal_.AssertEmpty();
+    if (destructing_) {
+      promise->set_exception(std::make_exception_ptr(StorageInGracefulShutdownException()));  // LCOV_EXCL_LINE
+    } else {
+      const auto f1_result = std::make_shared<result_t>();
+      const auto f2_copy = std::make_shared<current::decay<F2>>(std::forward<F2>(f2));
+      bool committed = false;
+      try {
+        *f1_result = f1();
+        committed = true;
+      } catch (StorageRollbackExceptionWithValue<result_t> e) {
+        *f1_result = std::move(e.value);
+      } catch (StorageRollbackExceptionWithNoValue) {
+        Resolve([promise]() { promise->set_value(TransactionResult<void>::RolledBack(OptionalResultMissing())); });
+        return future;
+      } catch (...) {  // The exception is captured with `std::current_exception()` below.
+        const std::exception_ptr e = std::current_exception();
+        Resolve([promise, e]() { promise->set_exception(e); });
+        return future;
+      }
+      Resolve([promise, f1_result, f2_copy, committed]() {
+        try {
+          (*f2_copy)(std::move(*f1_result));
+          promise->set_value(committed ? TransactionResult<void>::Committed(OptionalResultExists())
+                                       : TransactionResult<void>::RolledBack(OptionalResultMissing()));
+        } catch (...) {
+          promise->set_exception(std::current_exception());
+        }
+      });
+    }
+    return future;
+  }
+
+  void GracefulShutdown() {
+    std::lock_guard<std::mutex> lock(storage_mutex_ref_);
+    destructing_ = true;
+  }
+
+ private:
+  // A journal to persist, if any, and the way to resolve the future of its transaction once it is persisted.
+  struct PipelineEntry {
+    std::unique_ptr<MutationJournal> journal;
+    std::function<void()> resolve;
+  };
+
+  // Must be called with the storage mutex locked, for the journals to be handed over in the order of the commits.
+  void Commit(std::function<void()> resolve) {
+    std::unique_ptr<MutationJournal> journal;
+    {
+      std::lock_guard<std::mutex> lock(pipeline_mutex_);
+      if (!spare_journals_.empty()) {
+        journal = std::move(spare_journals_.back());
+        spare_journals_.pop_back();
+      }
+    }
+    if (!journal) {
+      journal = std::make_unique<MutationJournal>();
+    }
+    journal->Swap(journal_);
+    persister_.PipelinedJournalCommitted();
+    Enqueue(std::move(journal), std::move(resolve));
+  }
+
+  // Must be called with the storage mutex locked. Resolves the future right away if nothing is being persisted,
+  // or once everything committed before it is persisted otherwise.
+  void Resolve(std::function<void()> resolve) const {
+    {
+      std::lock_guard<std::mutex> lock(pipeline_mutex_);
+      if (unresolved_) {
+        pipeline_.push_back(PipelineEntry{nullptr, std::move(resolve)});
+        ++unresolved_;
+        return;
+      }
+    }
+    resolve();
+  }
+
+  void Enqueue(std::unique_ptr<MutationJournal> journal, std::function<void()> resolve) {
+    {
+      std::lock_guard<std::mutex> lock(pipeline_mutex_);
+      pipeline_.push_back(PipelineEntry{std::move(journal), std::move(resolve)});
+      ++unresolved_;
+    }
+    pipeline_condition_.notify_one();
+  }
+
+  // Persists the journals in batches, taking all of those handed over while the previous batch was being persisted.
+  void PersistingThread() {
+    std::deque<PipelineEntry> batch;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(pipeline_mutex_);
+        for (PipelineEntry& entry : batch) {
+          if (entry.journal) {
+            spare_journals_.push_back(std::move(entry.journal));
+          }
+        }
+        unresolved_ -= batch.size();
+        batch.clear();
+        pipeline_condition_.wait(lock, [this]() { return stopping_ || !pipeline_.empty(); });
+        if (pipeline_.empty()) {
+          return;
+        }
+        batch.swap(pipeline_);
+      }
+      for (PipelineEntry& entry : batch) {
+        if (entry.journal) {
+          MutationJournal& journal = *entry.journal;
+          impl::PersistJournalOrExit([this, &journal]() { persister_.PersistPipelinedJournal(journal); });
+        }
+        entry.resolve();
+      }
     }
   }
 
   std::mutex& storage_mutex_ref_;
   PERSISTER& persister_;
   MutationJournal& journal_;
-  std::mutex mutex_;
   bool destructing_ = false;
+
+  mutable std::mutex pipeline_mutex_;
+  mutable std::condition_variable pipeline_condition_;
+  mutable std::deque<PipelineEntry> pipeline_;
+  // The entries handed over to the background thread, and not yet resolved by it.
+  mutable size_t unresolved_ = 0u;
+  std::vector<std::unique_ptr<MutationJournal>> spare_journals_;
+  bool stopping_ = false;
+  std::thread thread_;
 };
 
+// The default transaction policy: all transactions are executed one at a time.
+template <class PERSISTER>
+using Synchronous = GenericSynchronous<PERSISTER, locking::Exclusive>;
+
+// Read-only transactions are executed concurrently with each other. Read-write ones are executed one at a time,
+// with no read-only transactions running, and are persisted the same way as with the `Synchronous` policy.
+template <class PERSISTER>
+using SynchronousWithSharedReads = GenericSynchronous<PERSISTER, locking::SharedReads>;
+
 }  // namespace transaction_policy
 }  // namespace storage
 }  // namespace current
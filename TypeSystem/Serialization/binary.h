@@ -25,6 +25,18 @@ SOFTWARE.
 #ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_H
 #define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_H
 
-// TBD.
+#include "serialization.h"
+
+#include "binary/enum.h"
+#include "binary/map.h"
+#include "binary/optional.h"
+#include "binary/pair.h"
+#include "binary/primitives.h"
+#include "binary/set.h"
+#include "binary/struct.h"
+#include "binary/unordered_map.h"
+#include "binary/unordered_set.h"
+#include "binary/variant.h"
+#include "binary/vector.h"
 
 #endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_H
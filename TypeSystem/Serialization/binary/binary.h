@@ -0,0 +1,401 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+
+// The compact binary format of Current:
+// * Unsigned integers are varints, seven bits per byte, least significant group first.
+// * Signed integers are zigzag-encoded varints. Single-byte types, `char` and `[u]int8_t`, are written as is.
+// * `bool` is one byte, `float` and `double` are four and eight bytes, little-endian.
+// * Strings and containers are prefixed by their length, as a varint.
+// * `CURRENT_STRUCT`-s are the fields of the base struct followed by their own fields, in the declaration order.
+// * `Optional` is a one-byte flag followed by the value, if present.
+// * `Variant` is the varint `TypeID` of the case, or zero for an uninitialized `Variant`, followed by the object.
+// The format carries no field names, so both sides must agree on the schema.
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_BINARY_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_BINARY_H
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "exceptions.h"
+
+#include "../serialization.h"
+
+#include "../../struct.h"
+#include "../../optional.h"
+#include "../../helpers.h"
+
+#include "../../../Bricks/strings/chunk.h"
+
+namespace current {
+namespace serialization {
+namespace binary {
+
+class BinarySerializer final {
+ public:
+  explicit BinarySerializer(std::string& output) : output_(output) {}
+
+  void WriteByte(uint8_t byte) { output_.push_back(static_cast<char>(byte)); }
+  void WriteBytes(const char* data, size_t size) { output_.append(data, size); }
+
+  void WriteVarInt(uint64_t value) {
+    char buffer[10];
+    size_t i = 0u;
+    while (value >= 0x80) {
+      buffer[i++] = static_cast<char>((value & 0x7f) | 0x80);
+      value >>= 7;
+    }
+    buffer[i++] = static_cast<char>(value);
+    output_.append(buffer, i);
+  }
+
+  void WriteZigZagVarInt(int64_t value) {
+    WriteVarInt((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+  }
+
+  template <typename T>
+  void WriteLittleEndian(T value) {
+    char buffer[sizeof(T)];
+    for (size_t i = 0u; i < sizeof(T); ++i) {
+      buffer[i] = static_cast<char>(value & 0xff);
+      value >>= 8;
+    }
+    output_.append(buffer, sizeof(T));
+  }
+
+  void WriteString(const std::string& s) {
+    WriteVarInt(s.length());
+    output_.append(s);
+  }
+
+ private:
+  std::string& output_;
+};
+
+// Reads a contiguous block of memory, which is the fast path.
+class BinaryMemorySource final {
+ public:
+  BinaryMemorySource(const char* begin, const char* end) : current_(begin), end_(end) {}
+
+  bool ReadByte(uint8_t& byte) {
+    if (current_ == end_) {
+      return false;
+    }
+    byte = static_cast<uint8_t>(*current_++);
+    return true;
+  }
+
+  bool ReadBytes(char* destination, size_t size) {
+    if (static_cast<size_t>(end_ - current_) < size) {
+      return false;
+    }
+    std::copy(current_, current_ + size, destination);
+    current_ += size;
+    return true;
+  }
+
+  bool ReadString(std::string& destination, size_t length) {
+    if (static_cast<size_t>(end_ - current_) < length) {
+      return false;
+    }
+    destination.assign(current_, length);
+    current_ += length;
+    return true;
+  }
+
+  size_t Remaining() const { return static_cast<size_t>(end_ - current_); }
+
+  // Each element takes at least one byte, so the size of a container can be validated before reading it.
+  bool MayContain(uint64_t elements) const { return elements <= Remaining(); }
+  size_t Preallocatable(size_t elements) const { return elements; }
+
+ private:
+  const char* current_;
+  const char* end_;
+};
+
+// Reads from an `std::istream`, leaving it positioned right after the object read.
+class BinaryStreamSource final {
+ public:
+  explicit BinaryStreamSource(std::istream& istream) : istream_(istream) {}
+
+  bool ReadByte(uint8_t& byte) {
+    const auto c = istream_.get();
+    if (c == std::istream::traits_type::eof()) {
+      return false;
+    }
+    byte = static_cast<uint8_t>(c);
+    return true;
+  }
+
+  bool ReadBytes(char* destination, size_t size) {
+    return istream_.read(destination, size) && static_cast<size_t>(istream_.gcount()) == size;
+  }
+
+  // Grow the string gradually, so that a corrupted length does not result in a huge allocation.
+  bool ReadString(std::string& destination, size_t length) {
+    constexpr static size_t kBlockSize = 64 * 1024;
+    destination.clear();
+    while (destination.length() < length) {
+      const size_t offset = destination.length();
+      const size_t block = std::min(kBlockSize, length - offset);
+      destination.resize(offset + block);
+      if (!ReadBytes(&destination[offset], block)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The size of the stream is not known upfront, so only preallocate a limited number of elements.
+  bool MayContain(uint64_t) const { return true; }
+  size_t Preallocatable(size_t elements) const { return std::min(elements, static_cast<size_t>(64 * 1024)); }
+
+ private:
+  std::istream& istream_;
+};
+
+// Whether the binary representation of the type may take zero bytes. Only the structs with no fields, or with the
+// fields which themselves may take zero bytes, can; everything else begins with at least one byte.
+template <typename T, typename = void>
+struct BinaryMayBeEmpty {
+  constexpr static bool value = false;
+};
+
+template <typename TF, typename TS>
+struct BinaryMayBeEmpty<std::pair<TF, TS>> {
+  constexpr static bool value = BinaryMayBeEmpty<TF>::value && BinaryMayBeEmpty<TS>::value;
+};
+
+template <typename T>
+struct BinaryFieldMayBeEmpty;
+
+template <typename T>
+struct BinaryFieldMayBeEmpty<reflection::FieldTypeWrapper<T>> {
+  constexpr static bool value = BinaryMayBeEmpty<T>::value;
+};
+
+template <typename T, int I, int N>
+struct BinaryStructFieldsMayBeEmpty {
+  constexpr static bool value = BinaryFieldMayBeEmpty<decltype(std::declval<T>().CURRENT_REFLECTION(
+                                    reflection::Index<reflection::FieldType, I>()))>::value &&
+                                BinaryStructFieldsMayBeEmpty<T, I + 1, N>::value;
+};
+
+template <typename T, int N>
+struct BinaryStructFieldsMayBeEmpty<T, N, N> {
+  constexpr static bool value = true;
+};
+
+template <typename T>
+struct BinaryMayBeEmpty<T, std::enable_if_t<IS_CURRENT_STRUCT(T) && !std::is_same<T, CurrentStruct>::value>> {
+  constexpr static bool value = BinaryMayBeEmpty<reflection::SuperType<T>>::value &&
+                                BinaryStructFieldsMayBeEmpty<T, 0, reflection::FieldCounter<T>::value>::value;
+};
+
+template <>
+struct BinaryMayBeEmpty<CurrentStruct> {
+  constexpr static bool value = true;
+};
+
+template <class SOURCE>
+class BinaryDeserializer final {
+ public:
+  explicit BinaryDeserializer(SOURCE& source) : source_(source) {}
+
+  uint8_t ReadByte() {
+    uint8_t byte;
+    if (!source_.ReadByte(byte)) {
+      CURRENT_THROW(BinaryLoadFromStreamException("Unexpected end of binary data."));
+    }
+    return byte;
+  }
+
+  void ReadBytes(char* destination, size_t size) {
+    if (!source_.ReadBytes(destination, size)) {
+      CURRENT_THROW(BinaryLoadFromStreamException("Unexpected end of binary data."));
+    }
+  }
+
+  uint64_t ReadVarInt() {
+    uint64_t result = 0u;
+    for (int shift = 0; shift < 64; shift += 7) {
+      const uint8_t byte = ReadByte();
+      if (shift == 63 && byte > 1u) {
+        CURRENT_THROW(BinaryLoadFromStreamException("Varint overflows 64 bits."));
+      }
+      result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        return result;
+      }
+    }
+    CURRENT_THROW(BinaryLoadFromStreamException("Varint overflows 64 bits."));  // LCOV_EXCL_LINE
+  }
+
+  int64_t ReadZigZagVarInt() {
+    const uint64_t value = ReadVarInt();
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1u);
+  }
+
+  template <typename T>
+  T ReadLittleEndian() {
+    char buffer[sizeof(T)];
+    ReadBytes(buffer, sizeof(T));
+    T result = 0;
+    for (size_t i = 0u; i < sizeof(T); ++i) {
+      result |= static_cast<T>(static_cast<uint8_t>(buffer[i])) << (8u * i);
+    }
+    return result;
+  }
+
+  void ReadString(std::string& destination) {
+    const uint64_t length = ReadVarInt();
+    if (!source_.ReadString(destination, static_cast<size_t>(length))) {
+      CURRENT_THROW(BinaryLoadFromStreamException("Unexpected end of binary data."));
+    }
+  }
+
+  // The size of the container of `ELEMENT`-s, validated against the size of the data unless the elements may take
+  // zero bytes each.
+  template <typename ELEMENT>
+  size_t ReadContainerSize() {
+    const uint64_t size = ReadVarInt();
+    if (!BinaryMayBeEmpty<ELEMENT>::value && !source_.MayContain(size)) {
+      CURRENT_THROW(BinaryLoadFromStreamException("Container size exceeds the size of binary data."));
+    }
+    return static_cast<size_t>(size);
+  }
+
+  // The number of elements it is safe to `reserve()` the memory for before reading them.
+  template <typename ELEMENT>
+  size_t Preallocatable(size_t size) const {
+    constexpr static size_t kMaxPreallocatedEmptyElements = 64 * 1024;
+    return BinaryMayBeEmpty<ELEMENT>::value ? std::min(size, kMaxPreallocatedEmptyElements)
+                                            : source_.Preallocatable(size);
+  }
+
+ private:
+  SOURCE& source_;
+};
+
+template <typename T>
+inline void AppendBinary(std::string& output, const T& source) {
+  BinarySerializer binary_serializer(output);
+  Serialize(binary_serializer, source);
+}
+
+template <typename T>
+inline std::string Binary(const T& source) {
+  std::string result;
+  AppendBinary(result, source);
+  return result;
+}
+
+template <typename T>
+inline void SaveIntoBinary(std::ostream& ostream, const T& source) {
+  const std::string binary = Binary(source);
+  ostream.write(binary.data(), binary.length());
+}
+
+template <typename T, class SOURCE>
+inline void LoadFromBinaryImpl(SOURCE& source, T& destination) {
+  try {
+    BinaryDeserializer<SOURCE> binary_deserializer(source);
+    Deserialize(binary_deserializer, destination);
+    CheckIntegrity(destination);
+  } catch (const UninitializedVariant&) {
+    CURRENT_THROW(BinaryUninitializedVariantObjectException());
+  }
+}
+
+// Parses exactly one object out of the buffer, which must not contain any extra bytes.
+template <typename T>
+inline void ParseBinary(const char* data, size_t length, T& destination) {
+  BinaryMemorySource source(data, data + length);
+  LoadFromBinaryImpl(source, destination);
+  if (source.Remaining()) {
+    CURRENT_THROW(BinaryLoadFromStreamException("Extra bytes after the end of the binary object."));
+  }
+}
+
+template <typename T>
+inline void ParseBinary(const std::string& source, T& destination) {
+  ParseBinary(source.data(), source.length(), destination);
+}
+
+template <typename T>
+inline T ParseBinary(const char* data, size_t length) {
+  T result;
+  ParseBinary(data, length, result);
+  return result;
+}
+
+template <typename T>
+inline T ParseBinary(const std::string& source) {
+  return ParseBinary<T>(source.data(), source.length());
+}
+
+template <typename T>
+inline T ParseBinary(const strings::Chunk& source) {
+  return ParseBinary<T>(source.c_str(), source.length());
+}
+
+template <typename T>
+inline void LoadFromBinary(std::istream& istream, T& destination) {
+  BinaryStreamSource source(istream);
+  LoadFromBinaryImpl(source, destination);
+}
+
+template <typename T>
+inline T LoadFromBinary(std::istream& istream) {
+  T result;
+  LoadFromBinary(istream, result);
+  return result;
+}
+
+}  // namespace current::serialization::binary
+}  // namespace current::serialization
+
+// Keep top-level symbols both in `current::` and in global namespace.
+using serialization::binary::Binary;
+using serialization::binary::ParseBinary;
+using serialization::binary::SaveIntoBinary;
+using serialization::binary::LoadFromBinary;
+using serialization::binary::BinaryLoadFromStreamException;
+using serialization::binary::BinaryUninitializedVariantObjectException;
+}  // namespace current
+
+using current::Binary;
+using current::ParseBinary;
+using current::SaveIntoBinary;
+using current::LoadFromBinary;
+using current::BinaryLoadFromStreamException;
+using current::BinaryUninitializedVariantObjectException;
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_BINARY_H
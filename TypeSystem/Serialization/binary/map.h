@@ -0,0 +1,66 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_MAP_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_MAP_H
+
+#include <map>
+
+#include "binary.h"
+
+namespace current {
+namespace serialization {
+
+template <typename TK, typename TV, typename TC, typename TA>
+struct SerializeImpl<binary::BinarySerializer, std::map<TK, TV, TC, TA>> {
+  static void DoSerialize(binary::BinarySerializer& binary_serializer, const std::map<TK, TV, TC, TA>& value) {
+    binary_serializer.WriteVarInt(value.size());
+    for (const auto& element : value) {
+      Serialize(binary_serializer, element.first);
+      Serialize(binary_serializer, element.second);
+    }
+  }
+};
+
+template <class SOURCE, typename TK, typename TV, typename TC, typename TA>
+struct DeserializeImpl<binary::BinaryDeserializer<SOURCE>, std::map<TK, TV, TC, TA>> {
+  static void DoDeserialize(binary::BinaryDeserializer<SOURCE>& binary_deserializer,
+                            std::map<TK, TV, TC, TA>& destination) {
+    const size_t size = binary_deserializer.template ReadContainerSize<std::pair<TK, TV>>();
+    destination.clear();
+    for (size_t i = 0u; i < size; ++i) {
+      TK k;
+      TV v;
+      Deserialize(binary_deserializer, k);
+      Deserialize(binary_deserializer, v);
+      destination.emplace(std::move(k), std::move(v));
+    }
+  }
+};
+
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_MAP_H
@@ -0,0 +1,65 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_OPTIONAL_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_OPTIONAL_H
+
+#include "primitives.h"
+
+#include "../../optional.h"
+
+namespace current {
+namespace serialization {
+
+template <typename T>
+struct SerializeImpl<binary::BinarySerializer, Optional<T>> {
+  static void DoSerialize(binary::BinarySerializer& binary_serializer, const Optional<T>& value) {
+    if (Exists(value)) {
+      binary_serializer.WriteByte(1u);
+      Serialize(binary_serializer, Value(value));
+    } else {
+      binary_serializer.WriteByte(0u);
+    }
+  }
+};
+
+template <class SOURCE, typename T>
+struct DeserializeImpl<binary::BinaryDeserializer<SOURCE>, Optional<T>> {
+  static void DoDeserialize(binary::BinaryDeserializer<SOURCE>& binary_deserializer, Optional<T>& destination) {
+    bool exists;
+    Deserialize(binary_deserializer, exists);
+    if (exists) {
+      destination = T();
+      Deserialize(binary_deserializer, Value(destination));
+    } else {
+      destination = nullptr;
+    }
+  }
+};
+
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_OPTIONAL_H
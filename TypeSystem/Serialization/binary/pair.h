@@ -0,0 +1,55 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_PAIR_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_PAIR_H
+
+#include <utility>
+
+#include "binary.h"
+
+namespace current {
+namespace serialization {
+
+template <typename TF, typename TS>
+struct SerializeImpl<binary::BinarySerializer, std::pair<TF, TS>> {
+  static void DoSerialize(binary::BinarySerializer& binary_serializer, const std::pair<TF, TS>& value) {
+    Serialize(binary_serializer, value.first);
+    Serialize(binary_serializer, value.second);
+  }
+};
+
+template <class SOURCE, typename TF, typename TS>
+struct DeserializeImpl<binary::BinaryDeserializer<SOURCE>, std::pair<TF, TS>> {
+  static void DoDeserialize(binary::BinaryDeserializer<SOURCE>& binary_deserializer, std::pair<TF, TS>& destination) {
+    Deserialize(binary_deserializer, destination.first);
+    Deserialize(binary_deserializer, destination.second);
+  }
+};
+
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_PAIR_H
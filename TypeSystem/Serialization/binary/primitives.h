@@ -0,0 +1,200 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_PRIMITIVES_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_PRIMITIVES_H
+
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "binary.h"
+
+#include "../../../Bricks/template/enable_if.h"
+
+namespace current {
+namespace serialization {
+
+namespace binary {
+
+// Integers other than `bool`. The single-byte ones are written as is, the rest are varints.
+template <typename T, bool IS_SINGLE_BYTE = (sizeof(T) == 1u), bool IS_SIGNED = std::numeric_limits<T>::is_signed>
+struct BinaryInteger;
+
+template <typename T, bool IS_SIGNED>
+struct BinaryInteger<T, true, IS_SIGNED> {
+  static void Write(BinarySerializer& binary_serializer, T value) {
+    binary_serializer.WriteByte(static_cast<uint8_t>(value));
+  }
+  template <class SOURCE>
+  static T Read(BinaryDeserializer<SOURCE>& binary_deserializer) {
+    return static_cast<T>(binary_deserializer.ReadByte());
+  }
+};
+
+template <typename T>
+struct BinaryInteger<T, false, false> {
+  static void Write(BinarySerializer& binary_serializer, T value) {
+    binary_serializer.WriteVarInt(static_cast<uint64_t>(value));
+  }
+  template <class SOURCE>
+  static T Read(BinaryDeserializer<SOURCE>& binary_deserializer) {
+    const uint64_t value = binary_deserializer.ReadVarInt();
+    if (value > static_cast<uint64_t>(std::numeric_limits<T>::max())) {
+      CURRENT_THROW(BinaryLoadFromStreamException("Unsigned integer out of range."));
+    }
+    return static_cast<T>(value);
+  }
+};
+
+template <typename T>
+struct BinaryInteger<T, false, true> {
+  static void Write(BinarySerializer& binary_serializer, T value) {
+    binary_serializer.WriteZigZagVarInt(static_cast<int64_t>(value));
+  }
+  template <class SOURCE>
+  static T Read(BinaryDeserializer<SOURCE>& binary_deserializer) {
+    const int64_t value = binary_deserializer.ReadZigZagVarInt();
+    if (value < static_cast<int64_t>(std::numeric_limits<T>::min()) ||
+        value > static_cast<int64_t>(std::numeric_limits<T>::max())) {
+      CURRENT_THROW(BinaryLoadFromStreamException("Signed integer out of range."));
+    }
+    return static_cast<T>(value);
+  }
+};
+
+}  // namespace current::serialization::binary
+
+template <typename T>
+struct SerializeImpl<binary::BinarySerializer,
+                     T,
+                     std::enable_if_t<std::numeric_limits<T>::is_integer && !std::is_same<T, bool>::value>> {
+  static void DoSerialize(binary::BinarySerializer& binary_serializer, T value) {
+    binary::BinaryInteger<T>::Write(binary_serializer, value);
+  }
+};
+
+template <class SOURCE, typename T>
+struct DeserializeImpl<binary::BinaryDeserializer<SOURCE>,
+                       T,
+                       std::enable_if_t<std::numeric_limits<T>::is_integer && !std::is_same<T, bool>::value>> {
+  static void DoDeserialize(binary::BinaryDeserializer<SOURCE>& binary_deserializer, T& destination) {
+    destination = binary::BinaryInteger<T>::Read(binary_deserializer);
+  }
+};
+
+// `bool`.
+template <>
+struct SerializeImpl<binary::BinarySerializer, bool> {
+  static void DoSerialize(binary::BinarySerializer& binary_serializer, bool value) {
+    binary_serializer.WriteByte(value ? 1u : 0u);
+  }
+};
+
+template <class SOURCE>
+struct DeserializeImpl<binary::BinaryDeserializer<SOURCE>, bool> {
+  static void DoDeserialize(binary::BinaryDeserializer<SOURCE>& binary_deserializer, bool& destination) {
+    const uint8_t byte = binary_deserializer.ReadByte();
+    if (byte > 1u) {
+      CURRENT_THROW(BinaryLoadFromStreamException("Invalid value for `bool`."));
+    }
+    destination = (byte != 0u);
+  }
+};
+
+// `float`.
+template <>
+struct SerializeImpl<binary::BinarySerializer, float> {
+  static void DoSerialize(binary::BinarySerializer& binary_serializer, float value) {
+    static_assert(sizeof(float) == sizeof(uint32_t), "");
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    binary_serializer.WriteLittleEndian(bits);
+  }
+};
+
+template <class SOURCE>
+struct DeserializeImpl<binary::BinaryDeserializer<SOURCE>, float> {
+  static void DoDeserialize(binary::BinaryDeserializer<SOURCE>& binary_deserializer, float& destination) {
+    const uint32_t bits = binary_deserializer.template ReadLittleEndian<uint32_t>();
+    std::memcpy(&destination, &bits, sizeof(bits));
+  }
+};
+
+// `double`.
+template <>
+struct SerializeImpl<binary::BinarySerializer, double> {
+  static void DoSerialize(binary::BinarySerializer& binary_serializer, double value) {
+    static_assert(sizeof(double) == sizeof(uint64_t), "");
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    binary_serializer.WriteLittleEndian(bits);
+  }
+};
+
+template <class SOURCE>
+struct DeserializeImpl<binary::BinaryDeserializer<SOURCE>, double> {
+  static void DoDeserialize(binary::BinaryDeserializer<SOURCE>& binary_deserializer, double& destination) {
+    const uint64_t bits = binary_deserializer.template ReadLittleEndian<uint64_t>();
+    std::memcpy(&destination, &bits, sizeof(bits));
+  }
+};
+
+// `std::string`.
+template <>
+struct SerializeImpl<binary::BinarySerializer, std::string> {
+  static void DoSerialize(binary::BinarySerializer& binary_serializer, const std::string& value) {
+    binary_serializer.WriteString(value);
+  }
+};
+
+template <class SOURCE>
+struct DeserializeImpl<binary::BinaryDeserializer<SOURCE>, std::string> {
+  static void DoDeserialize(binary::BinaryDeserializer<SOURCE>& binary_deserializer, std::string& destination) {
+    binary_deserializer.ReadString(destination);
+  }
+};
+
+// `std::chrono::milliseconds` and `std::chrono::microseconds`.
+template <typename REP, typename PERIOD>
+struct SerializeImpl<binary::BinarySerializer, std::chrono::duration<REP, PERIOD>> {
+  static void DoSerialize(binary::BinarySerializer& binary_serializer, std::chrono::duration<REP, PERIOD> value) {
+    binary_serializer.WriteZigZagVarInt(static_cast<int64_t>(value.count()));
+  }
+};
+
+template <class SOURCE, typename REP, typename PERIOD>
+struct DeserializeImpl<binary::BinaryDeserializer<SOURCE>, std::chrono::duration<REP, PERIOD>> {
+  static void DoDeserialize(binary::BinaryDeserializer<SOURCE>& binary_deserializer,
+                            std::chrono::duration<REP, PERIOD>& destination) {
+    destination = std::chrono::duration<REP, PERIOD>(static_cast<REP>(binary_deserializer.ReadZigZagVarInt()));
+  }
+};
+
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_PRIMITIVES_H
@@ -0,0 +1,122 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_STRUCT_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_STRUCT_H
+
+#include <type_traits>
+
+#include "binary.h"
+
+#include "../../Reflection/reflection.h"
+
+#include "../../../Bricks/template/enable_if.h"
+
+namespace current {
+namespace serialization {
+
+namespace binary {
+class BinaryStructFieldsSerializer {
+ public:
+  explicit BinaryStructFieldsSerializer(BinarySerializer& binary_serializer) : binary_serializer_(binary_serializer) {}
+
+  template <typename U>
+  void operator()(const char*, const U& source) const {
+    Serialize(binary_serializer_, source);
+  }
+
+ private:
+  BinarySerializer& binary_serializer_;
+};
+
+template <typename T>
+struct SerializeStructImpl {
+  static void SerializeStruct(BinaryStructFieldsSerializer& visitor, const T& source) {
+    using decayed_t = current::decay<T>;
+    using super_t = current::reflection::SuperType<decayed_t>;
+
+    SerializeStructImpl<super_t>::SerializeStruct(visitor, source);
+
+    current::reflection::VisitAllFields<decayed_t, current::reflection::FieldNameAndImmutableValue>::WithObject(
+        source, visitor);
+  }
+};
+
+template <>
+struct SerializeStructImpl<CurrentStruct> {
+  static void SerializeStruct(BinaryStructFieldsSerializer&, const CurrentStruct&) {}
+};
+
+}  // namespace current::serialization::binary
+
+template <typename T>
+struct SerializeImpl<binary::BinarySerializer,
+                     T,
+                     std::enable_if_t<IS_CURRENT_STRUCT(T) && !std::is_same<T, CurrentStruct>::value>> {
+  static void DoSerialize(binary::BinarySerializer& binary_serializer, const T& value) {
+    binary::BinaryStructFieldsSerializer visitor(binary_serializer);
+    binary::SerializeStructImpl<T>::SerializeStruct(visitor, value);
+  }
+};
+
+template <class SOURCE>
+struct DeserializeImpl<binary::BinaryDeserializer<SOURCE>, CurrentStruct> {
+  static void DoDeserialize(binary::BinaryDeserializer<SOURCE>&, CurrentStruct&) {}
+};
+
+template <class SOURCE, typename T>
+struct DeserializeImpl<binary::BinaryDeserializer<SOURCE>,
+                       T,
+                       std::enable_if_t<IS_CURRENT_STRUCT(T) && !std::is_same<T, CurrentStruct>::value>> {
+  class DeserializeSingleField {
+   public:
+    explicit DeserializeSingleField(binary::BinaryDeserializer<SOURCE>& binary_deserializer)
+        : binary_deserializer_(binary_deserializer) {}
+
+    template <typename U>
+    void operator()(const char*, U& value) const {
+      Deserialize(binary_deserializer_, value);
+    }
+
+   private:
+    binary::BinaryDeserializer<SOURCE>& binary_deserializer_;
+  };
+
+  static void DoDeserialize(binary::BinaryDeserializer<SOURCE>& binary_deserializer, T& destination) {
+    using decayed_t = current::decay<T>;
+    using super_t = current::reflection::SuperType<decayed_t>;
+
+    if (!std::is_same<super_t, CurrentStruct>::value) {
+      Deserialize(binary_deserializer, static_cast<super_t&>(destination));
+    }
+    current::reflection::VisitAllFields<decayed_t, current::reflection::FieldNameAndMutableValue>::WithObject(
+        destination, DeserializeSingleField(binary_deserializer));
+  }
+};
+
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_STRUCT_H
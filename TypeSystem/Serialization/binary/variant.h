@@ -0,0 +1,145 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_VARIANT_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_VARIANT_H
+
+#include <type_traits>
+#include <unordered_map>
+
+#include "primitives.h"
+
+#include "../../variant.h"
+#include "../../Reflection/reflection.h"
+
+#include "../../../Bricks/template/call_all_constructors.h"
+#include "../../../Bricks/template/enable_if.h"
+#include "../../../Bricks/util/comparators.h"
+
+namespace current {
+namespace serialization {
+
+namespace binary {
+
+// The `TypeID` of a `Variant` case, which is its tag in the binary format. Reflected once per type.
+template <typename X>
+reflection::TypeID BinaryVariantCaseTypeID() {
+  static const reflection::TypeID type_id =
+      Value<reflection::ReflectedTypeBase>(reflection::Reflector().ReflectType<X>()).type_id;
+  return type_id;
+}
+
+class BinaryVariantSerializer {
+ public:
+  explicit BinaryVariantSerializer(BinarySerializer& binary_serializer) : binary_serializer_(binary_serializer) {}
+
+  template <typename X>
+  std::enable_if_t<IS_CURRENT_STRUCT_OR_VARIANT(X)> operator()(const X& object) {
+    binary_serializer_.WriteVarInt(static_cast<uint64_t>(BinaryVariantCaseTypeID<X>()));
+    Serialize(binary_serializer_, object);
+  }
+
+ private:
+  BinarySerializer& binary_serializer_;
+};
+
+template <class SOURCE, typename VARIANT>
+class BinaryVariantDeserializer {
+ public:
+  static void DoLoadVariant(BinaryDeserializer<SOURCE>& binary_deserializer, VARIANT& destination) {
+    const uint64_t type_id = binary_deserializer.ReadVarInt();
+    if (!type_id) {
+      CURRENT_THROW(BinaryUninitializedVariantObjectException());
+    }
+    const auto& deserializers = Instance().deserializers_;
+    const auto cit = deserializers.find(static_cast<reflection::TypeID>(type_id));
+    if (cit != deserializers.end()) {
+      cit->second(binary_deserializer, destination);
+    } else {
+      CURRENT_THROW(BinaryLoadFromStreamException("Type ID " + current::ToString(type_id) +
+                                                  " is not listed in the type list of the `Variant`."));
+    }
+  }
+
+ private:
+  using deserializer_t = void (*)(BinaryDeserializer<SOURCE>&, IHasUncheckedMoveFromUniquePtr&);
+  using deserializers_map_t =
+      std::unordered_map<reflection::TypeID, deserializer_t, CurrentHashFunction<::current::reflection::TypeID>>;
+
+  template <typename X>
+  static void DeserializeCase(BinaryDeserializer<SOURCE>& binary_deserializer,
+                              IHasUncheckedMoveFromUniquePtr& destination) {
+    auto result = std::make_unique<X>();
+    Deserialize(binary_deserializer, *result);
+    destination.UncheckedMoveFromUniquePtr(std::move(result));
+  }
+
+  template <typename X>
+  struct Registerer {
+    Registerer(deserializers_map_t& deserializers) {
+      // Silently discard duplicate types in the input type list. They would be deserialized correctly.
+      deserializers[BinaryVariantCaseTypeID<X>()] = &DeserializeCase<X>;
+    }
+  };
+
+  BinaryVariantDeserializer() {
+    current::metaprogramming::call_all_constructors_with<Registerer,
+                                                         deserializers_map_t,
+                                                         typename VARIANT::typelist_t>(deserializers_);
+  }
+
+  static const BinaryVariantDeserializer& Instance() {
+    static BinaryVariantDeserializer impl;
+    return impl;
+  }
+
+  deserializers_map_t deserializers_;
+};
+
+}  // namespace current::serialization::binary
+
+template <typename T>
+struct SerializeImpl<binary::BinarySerializer, T, std::enable_if_t<IS_CURRENT_VARIANT(T)>> {
+  static void DoSerialize(binary::BinarySerializer& binary_serializer, const T& value) {
+    if (Exists(value)) {
+      binary::BinaryVariantSerializer impl(binary_serializer);
+      value.Call(impl);
+    } else {
+      binary_serializer.WriteVarInt(0u);
+    }
+  }
+};
+
+template <class SOURCE, typename T>
+struct DeserializeImpl<binary::BinaryDeserializer<SOURCE>, T, std::enable_if_t<IS_CURRENT_VARIANT(T)>> {
+  static void DoDeserialize(binary::BinaryDeserializer<SOURCE>& binary_deserializer, T& value) {
+    binary::BinaryVariantDeserializer<SOURCE, T>::DoLoadVariant(binary_deserializer, value);
+  }
+};
+
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_VARIANT_H
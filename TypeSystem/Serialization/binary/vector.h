@@ -0,0 +1,63 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_VECTOR_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_VECTOR_H
+
+#include <vector>
+
+#include "binary.h"
+
+namespace current {
+namespace serialization {
+
+template <typename T, typename ALLOCATOR>
+struct SerializeImpl<binary::BinarySerializer, std::vector<T, ALLOCATOR>> {
+  static void DoSerialize(binary::BinarySerializer& binary_serializer, const std::vector<T, ALLOCATOR>& value) {
+    binary_serializer.WriteVarInt(value.size());
+    for (const auto& element : value) {
+      Serialize(binary_serializer, element);
+    }
+  }
+};
+
+template <class SOURCE, typename T, typename ALLOCATOR>
+struct DeserializeImpl<binary::BinaryDeserializer<SOURCE>, std::vector<T, ALLOCATOR>> {
+  static void DoDeserialize(binary::BinaryDeserializer<SOURCE>& binary_deserializer,
+                            std::vector<T, ALLOCATOR>& destination) {
+    const size_t size = binary_deserializer.template ReadContainerSize<T>();
+    destination.clear();
+    destination.reserve(binary_deserializer.template Preallocatable<T>(size));
+    for (size_t i = 0u; i < size; ++i) {
+      destination.emplace_back();
+      Deserialize(binary_deserializer, destination.back());
+    }
+  }
+};
+
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_VECTOR_H
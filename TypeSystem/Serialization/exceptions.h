@@ -26,6 +26,7 @@ SOFTWARE.
 #define TYPE_SYSTEM_SERIALIZATION_EXCEPTIONS_H
 
 #include "exceptions_base.h"
+#include "binary/exceptions.h"
 #include "json/exceptions.h"
 
 #endif  // TYPE_SYSTEM_SERIALIZATION_EXCEPTIONS_H
@@ -41,4 +41,6 @@ SOFTWARE.
 #include "json/variant.h"
 #include "json/vector.h"
 
+#include "json/streaming.h"
+
 #endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_H
@@ -26,8 +26,13 @@ SOFTWARE.
 #ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_JSON_H
 #define CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_JSON_H
 
+#include <cstring>
+#include <ostream>
+#include <string>
+
 #include "exceptions.h"
 #include "rapidjson.h"
+#include "writer.h"
 
 #include "../serialization.h"
 
@@ -37,6 +42,7 @@ SOFTWARE.
 
 #include "../../../Bricks/strings/chunk.h"
 #include "../../../Bricks/template/pod.h"  // `current::copy_free`.
+#include "../../../Bricks/util/singleton.h"
 
 namespace current {
 namespace serialization {
@@ -119,64 +125,160 @@ struct IsJSONSerializableImpl<false, false, false, T> {
   constexpr static bool value = false;
 };
 
-// For RapidJSON value assignments, specifically strings (use `SetString`, not `SetValue`) and `std::chrono::*`.
+// For writing scalar values, specifically strings (use `String`, not a number) and `std::chrono::*`.
+// The overloads of `WriteJSONNumber()` mirror the constructors of `rapidjson::Value`, so that the types
+// which used to be converted implicitly, such as `uint8_t`, `char`, or `float`, are written the same way.
+inline bool WriteJSONNumber(JSONWriter& writer, bool value) { return writer.Bool(value); }
+inline bool WriteJSONNumber(JSONWriter& writer, int value) { return writer.Int(value); }
+inline bool WriteJSONNumber(JSONWriter& writer, unsigned value) { return writer.Uint(value); }
+inline bool WriteJSONNumber(JSONWriter& writer, int64_t value) { return writer.Int64(value); }
+inline bool WriteJSONNumber(JSONWriter& writer, uint64_t value) { return writer.Uint64(value); }
+inline bool WriteJSONNumber(JSONWriter& writer, double value) { return writer.Double(value); }
+
 template <typename T>
-struct JSONValueAssignerImpl {
-  static void AssignValue(rapidjson::Value& destination, current::copy_free<T> value) { destination = value; }
+struct JSONValueWriterImpl {
+  static bool WriteValue(JSONWriter& writer, current::copy_free<T> value) { return WriteJSONNumber(writer, value); }
 };
 
-template <class JSON_FORMAT>
-class JSONStringifier final {
+// The buffer is reused across `JSON()` calls from the same thread, so that, once warm, serializing an object
+// does not allocate beyond the resulting string. A nested `JSON()` call, made while the buffer is in use,
+// gets a fresh buffer of its own. The buffer is released after an oversized object, not to hold on to its memory.
+struct JSONStringifierBuffer {
+  constexpr static size_t kMaxRetainedCapacity = 1024u * 1024u;
+  std::string buffer;
+  bool in_use = false;
+};
+
+class ScopedJSONStringifierBuffer final {
  public:
-  JSONStringifier() {
-    // Can't assign in the initializer list, `current_` is the field before `document_`.
-    // And I've confirmed keeping `document_` first results in performance degradation. -- D.K.
-    current_ = &document_;
+  ScopedJSONStringifierBuffer() : shared_(current::ThreadLocalSingleton<JSONStringifierBuffer>()) {
+    if (!shared_.in_use) {
+      shared_.in_use = true;
+      shared_.buffer.clear();
+      buffer_ = &shared_.buffer;
+    } else {
+      buffer_ = &owned_;
+    }
   }
 
-  rapidjson::Value& Current() { return *current_; }
-  rapidjson::Document::AllocatorType& Allocator() { return document_.GetAllocator(); }
+  ~ScopedJSONStringifierBuffer() {
+    if (buffer_ == &shared_.buffer) {
+      if (shared_.buffer.capacity() > JSONStringifierBuffer::kMaxRetainedCapacity) {
+        std::string().swap(shared_.buffer);
+      }
+      shared_.in_use = false;
+    }
+  }
+
+  std::string& Buffer() { return *buffer_; }
+
+ private:
+  JSONStringifierBuffer& shared_;
+  std::string owned_;
+  std::string* buffer_;
+};
+
+// Writes the JSON tokens directly into the output string, walking the object once, with no DOM in between.
+// The key of an object member is written lazily, along with the first token of its value, as the value may end up
+// absent, in which case the key is dropped. Example: A `Variant` or `Optional` in the `Minimalistic` format.
+template <class JSON_FORMAT>
+class JSONStringifier final {
+ public:
+  explicit JSONStringifier(std::string& output) : writer_(output) {}
 
   template <typename T>
   void operator=(T&& x) {
-    JSONValueAssignerImpl<current::decay<T>>::AssignValue(*current_, std::forward<T>(x));
+    if (BeginValue()) {
+      ok_ = JSONValueWriterImpl<current::decay<T>>::WriteValue(writer_, std::forward<T>(x));
+    }
+  }
+
+  void Null() {
+    if (BeginValue()) {
+      ok_ = writer_.Null();
+    }
   }
 
+  void String(const char* s, size_t length) {
+    if (BeginValue()) {
+      ok_ = writer_.String(s, length);
+    }
+  }
+  void String(const char* s) { String(s, strlen(s)); }
+  void String(const std::string& s) { String(s.data(), s.length()); }
+
+  void StartObject() {
+    if (BeginValue()) {
+      ok_ = writer_.StartObject();
+    }
+  }
+  void EndObject() {
+    if (ok_) {
+      ok_ = writer_.EndObject();
+    }
+  }
+
+  void StartArray() {
+    if (BeginValue()) {
+      ok_ = writer_.StartArray();
+    }
+  }
+  void EndArray() {
+    if (ok_) {
+      ok_ = writer_.EndArray();
+    }
+  }
+
+  // Write an object member, the value of which is guaranteed to be valid.
+  void Key(const char* key, size_t length) {
+    if (ok_) {
+      ok_ = writer_.Key(key, length);
+    }
+  }
+  void Key(const char* key) { Key(key, strlen(key)); }
+  void Key(const std::string& key) { Key(key.data(), key.length()); }
+
   // Serialize another object, in an inner scope. The object is guaranteed to result in a valid value.
   template <typename T>
-  void Inner(rapidjson::Value* inner_value, T&& x) {
-    std::swap(current_, inner_value);
+  void Inner(T&& x) {
     Serialize(*this, std::forward<T>(x));
-    std::swap(current_, inner_value);
+    if (absent_) {
+      absent_ = false;
+      Null();
+    }
   }
 
-  // Serialize another object, in an inner scope. The object may end up a no-op, which should be ignored.
+  // Serialize another object, as an object member. The object may end up a no-op, which should be ignored.
   // Example: A `Variant` or `Optional` in the `Minimalistic` format.
-  void MarkAsAbsentValue() { current_ = nullptr; }
+  void MarkAsAbsentValue() { absent_ = true; }
   template <typename T>
-  bool MaybeInner(rapidjson::Value* inner_value, T&& x) {
-    rapidjson::Value* previous = current_;
-    current_ = inner_value;
+  bool MaybeInner(const char* key, T&& x) {
+    pending_key_ = key;
     Serialize(*this, std::forward<T>(x));
-    if (current_) {
-      current_ = previous;
-      return true;
-    } else {
-      current_ = previous;
+    pending_key_ = nullptr;
+    if (absent_) {
+      absent_ = false;
       return false;
+    } else {
+      return true;
     }
   }
 
-  std::string ResultingJSON() const {
-    rapidjson::StringBuffer string_buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(string_buffer);
-    document_.Accept(writer);
-    return string_buffer.GetString();
+ private:
+  // Flushes the pending key, if any. Once the writer has failed, which happens for NaN-s and infinities,
+  // nothing else is written, so that the output stops where it did when it was produced via a RapidJSON DOM.
+  bool BeginValue() {
+    if (pending_key_ && ok_) {
+      ok_ = writer_.Key(pending_key_, strlen(pending_key_));
+    }
+    pending_key_ = nullptr;
+    return ok_;
   }
 
- private:
-  rapidjson::Value* current_;
-  rapidjson::Document document_;
+  JSONWriter writer_;
+  const char* pending_key_ = nullptr;
+  bool absent_ = false;
+  bool ok_ = true;
 };
 
 enum class JSONVariantStyle : int { Current, Simple, NewtonsoftFSharp };
@@ -329,11 +431,31 @@ void ParseJSONViaRapidJSON(const char* json, T& destination) {
   Deserialize(json_parser, destination);
 }
 
+// Fills `destination` straight from the input, with no DOM. Returns `false` if the input is to be parsed via the DOM,
+// which is the case for any input it is not certain about, the malformed one included. Defined in `streaming.h`.
+// The input is the `[json, end)` range, or the null-terminated string if `end` is `nullptr`.
+template <class J, typename T>
+bool ParseJSONViaStreamingParser(const char* json, const char* end, T& destination);
+
+// Appends the JSON to `output`. A reused `output` makes serialization allocation-free once its capacity is warm.
+template <class J = JSONFormat::Current, typename T>
+inline void AppendJSON(std::string& output, const T& source) {
+  JSONStringifier<J> json_stringifier(output);
+  json_stringifier.Inner(source);
+}
+
 template <class J = JSONFormat::Current, typename T>
 inline std::string JSON(const T& source) {
-  JSONStringifier<J> json_stringifier;
-  Serialize(json_stringifier, source);
-  return json_stringifier.ResultingJSON();
+  ScopedJSONStringifierBuffer buffer;
+  AppendJSON<J>(buffer.Buffer(), source);
+  return buffer.Buffer();
+}
+
+template <class J = JSONFormat::Current, typename T>
+inline std::ostream& WriteJSON(std::ostream& os, const T& source) {
+  ScopedJSONStringifierBuffer buffer;
+  AppendJSON<J>(buffer.Buffer(), source);
+  return os.write(buffer.Buffer().data(), static_cast<std::streamsize>(buffer.Buffer().length()));
 }
 
 template <class J = JSONFormat::Current>
@@ -344,7 +466,9 @@ inline std::string JSON(const char* special_case_bare_c_string) {
 template <typename T, class J = JSONFormat::Current>
 inline void ParseJSON(const char* source, T& destination) {
   try {
-    ParseJSONViaRapidJSON<J>(source, destination);
+    if (!ParseJSONViaStreamingParser<J>(source, nullptr, destination)) {
+      ParseJSONViaRapidJSON<J>(source, destination);
+    }
     CheckIntegrity(destination);
   } catch (UninitializedVariant) {
     CURRENT_THROW(JSONUninitializedVariantObjectException());
@@ -356,6 +480,21 @@ inline void ParseJSON(const std::string& source, T& destination) {
   ParseJSON(source.c_str(), destination);
 }
 
+// Parses the JSON occupying exactly `length` bytes at `source`, which does not have to be null-terminated.
+// Used to parse the JSON right where it is, such as in the memory-mapped file, with no copy made.
+template <typename T, class J = JSONFormat::Current>
+inline void ParseJSON(const char* source, size_t length, T& destination) {
+  try {
+    if (!ParseJSONViaStreamingParser<J>(source, source + length, destination)) {
+      // The DOM requires the null-terminated input. It is rarely needed, so the copy is fine.
+      ParseJSONViaRapidJSON<J>(std::string(source, length).c_str(), destination);
+    }
+    CheckIntegrity(destination);
+  } catch (UninitializedVariant) {
+    CURRENT_THROW(JSONUninitializedVariantObjectException());
+  }
+}
+
 template <typename T, class J = JSONFormat::Current>
 inline void ParseJSON(const strings::Chunk& source, T& destination) {
   ParseJSON(source.c_str(), destination);
@@ -394,6 +533,13 @@ inline T ParseJSON(const std::string& source) {
   return ParseJSON<T, J>(source.c_str());
 }
 
+template <typename T, class J = JSONFormat::Current>
+inline T ParseJSON(const char* source, size_t length) {
+  T result;
+  ParseJSON<T, J>(source, length, result);
+  return result;
+}
+
 template <typename T, class J = JSONFormat::Current>
 inline T ParseJSON(const strings::Chunk& source) {
   return ParseJSON<T, J>(source.c_str());
@@ -425,6 +571,8 @@ inline Optional<T> TryParseJSON(const strings::Chunk& source) {
 
 // Keep top-level symbols both in `current::` and in global namespace.
 using serialization::json::JSON;
+using serialization::json::AppendJSON;
+using serialization::json::WriteJSON;
 using serialization::json::ParseJSON;
 using serialization::json::TryParseJSON;
 using serialization::json::PatchObjectWithJSON;
@@ -436,6 +584,8 @@ using serialization::json::JSONUninitializedVariantObjectException;
 }  // namespace current
 
 using current::JSON;
+using current::AppendJSON;
+using current::WriteJSON;
 using current::ParseJSON;
 using current::TryParseJSON;
 using current::PatchObjectWithJSON;
@@ -43,7 +43,7 @@ struct SerializeImpl<json::JSONStringifier<JSON_FORMAT>, Optional<T>> {
     } else {
       // Current's default JSON parser would accept a missing field as well for no value,
       // but output it as `null` nonetheless, for clarity.
-      json_stringifier.Current().SetNull();
+      json_stringifier.Null();
     }
   }
 };
@@ -68,16 +68,14 @@ struct SerializeImpl<json::JSONStringifier<json::JSONFormat::NewtonsoftFSharp>,
   static void DoSerialize(json::JSONStringifier<json::JSONFormat::NewtonsoftFSharp>& json_stringifier,
                           const Optional<T>& value) {
     if (Exists(value)) {
-      rapidjson::Value ultimate_destination;
-      json_stringifier.Inner(&ultimate_destination, Value(value));
-      rapidjson::Value array_of_one_element_containing_value;
-      array_of_one_element_containing_value.SetArray();
-      array_of_one_element_containing_value.PushBack(std::move(ultimate_destination.Move()),
-                                                     json_stringifier.Allocator());
-      json_stringifier.Current().SetObject();
-      json_stringifier.Current().AddMember("Case", "Some", json_stringifier.Allocator());
-      json_stringifier.Current().AddMember(
-          "Fields", std::move(array_of_one_element_containing_value.Move()), json_stringifier.Allocator());
+      json_stringifier.StartObject();
+      json_stringifier.Key("Case");
+      json_stringifier.String("Some");
+      json_stringifier.Key("Fields");
+      json_stringifier.StartArray();
+      json_stringifier.Inner(Value(value));
+      json_stringifier.EndArray();
+      json_stringifier.EndObject();
     } else {
       json_stringifier.MarkAsAbsentValue();
     }
@@ -36,24 +36,20 @@ namespace serialization {
 
 namespace json {
 template <>
-struct JSONValueAssignerImpl<std::string> {
-  static void AssignValue(rapidjson::Value& destination, const std::string& value) {
-    destination = rapidjson::StringRef(value);
+struct JSONValueWriterImpl<std::string> {
+  static bool WriteValue(JSONWriter& writer, const std::string& value) {
+    return writer.String(value.data(), value.length());
   }
 };
 
 template <>
-struct JSONValueAssignerImpl<std::chrono::microseconds> {
-  static void AssignValue(rapidjson::Value& destination, std::chrono::microseconds value) {
-    destination.SetInt64(value.count());
-  }
+struct JSONValueWriterImpl<std::chrono::microseconds> {
+  static bool WriteValue(JSONWriter& writer, std::chrono::microseconds value) { return writer.Int64(value.count()); }
 };
 
 template <>
-struct JSONValueAssignerImpl<std::chrono::milliseconds> {
-  static void AssignValue(rapidjson::Value& destination, std::chrono::milliseconds value) {
-    destination.SetInt64(value.count());
-  }
+struct JSONValueWriterImpl<std::chrono::milliseconds> {
+  static bool WriteValue(JSONWriter& writer, std::chrono::milliseconds value) { return writer.Int64(value.count()); }
 };
 }  // namespace curent::serialization::json
 
@@ -39,6 +39,7 @@ inline void RapidJSONAssertThrow(const char* text, const char* file, int line) {
 #define RAPIDJSON_ASSERT(x) ((x) ? static_cast<void>(0) : RapidJSONAssertThrow(#x, __FILE__, __LINE__))
 
 #include "../../../3rdparty/rapidjson/document.h"
+#include "../../../3rdparty/rapidjson/memorystream.h"
 #include "../../../3rdparty/rapidjson/prettywriter.h"
 
 #endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_RAPIDJSON_H
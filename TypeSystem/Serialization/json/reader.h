@@ -0,0 +1,267 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_READER_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_READER_H
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "rapidjson.h"
+
+namespace current {
+namespace serialization {
+namespace json {
+
+// Reads JSON tokens one by one from a null-terminated string, or from the `[json, end)` range, with no DOM built.
+// The values it reports are exactly the ones a `rapidjson::Document` would hold, as plain integers and strings
+// with no escape sequences are the only ones read here, and everything else is handed over to `rapidjson::Reader`.
+// Each method returns `false` if the input is not what the caller expects, or is malformed; the position in the input
+// is then unspecified, as the caller is expected to give up on this input.
+class JSONReader final {
+ public:
+  // A number the way RapidJSON sees it: either an integer, as its sign and magnitude, or a double.
+  struct Number {
+    bool is_integer = true;
+    bool negative = false;
+    uint64_t magnitude = 0u;
+    double value = 0.0;
+
+    bool IsUint64() const { return is_integer && (!negative || !magnitude); }
+    bool IsInt64() const {
+      return is_integer &&
+             magnitude <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + (negative ? 1u : 0u);
+    }
+    uint64_t GetUint64() const { return magnitude; }
+    int64_t GetInt64() const {
+      return negative ? static_cast<int64_t>(0u - magnitude) : static_cast<int64_t>(magnitude);
+    }
+    double GetDouble() const {
+      if (is_integer) {
+        return negative ? -static_cast<double>(magnitude) : static_cast<double>(magnitude);
+      } else {
+        return value;
+      }
+    }
+  };
+
+  // With `end` set, the input is not required to be null-terminated, and is never read at or past `end`.
+  explicit JSONReader(const char* json, const char* end = nullptr) : p_(json), end_(end) {}
+
+  JSONReader(const JSONReader&) = delete;
+  JSONReader& operator=(const JSONReader&) = delete;
+
+  // Skips the whitespace, and returns the next character, or '\0' at the end of the input.
+  char Peek() {
+    while (At(p_) == ' ' || At(p_) == '\n' || At(p_) == '\r' || At(p_) == '\t') {
+      ++p_;
+    }
+    return At(p_);
+  }
+
+  bool Consume(char c) {
+    if (Peek() == c) {
+      ++p_;
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  bool AtEnd() { return Peek() == '\0'; }
+
+  bool Null() { return Peek() == 'n' && Literal("null", 4u); }
+
+  bool Bool(bool& value) {
+    const char c = Peek();
+    if (c == 't' && Literal("true", 4u)) {
+      value = true;
+      return true;
+    } else if (c == 'f' && Literal("false", 5u)) {
+      value = false;
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  // Points `data` to the string, which stays valid until the next call. The string is read in place if it has
+  // no escape sequences, and is unescaped by RapidJSON otherwise.
+  bool StringView(const char*& data, size_t& length) {
+    if (Peek() != '"') {
+      return false;
+    }
+    const char* const begin = p_ + 1;
+    for (const char* p = begin;; ++p) {
+      const unsigned char c = static_cast<unsigned char>(At(p));
+      if (c == '"') {
+        data = begin;
+        length = static_cast<size_t>(p - begin);
+        p_ = p + 1;
+        return true;
+      } else if (c == '\\') {
+        StringHandler handler(scratch_);
+        if (!ParseValueViaRapidJSON(handler)) {
+          return false;
+        }
+        data = scratch_.data();
+        length = scratch_.length();
+        return true;
+      } else if (c < 0x20) {
+        // Includes the end of the input. RapidJSON would reject the control characters too.
+        return false;
+      }
+    }
+  }
+
+  bool String(std::string& value) {
+    const char* data;
+    size_t length;
+    if (!StringView(data, length)) {
+      return false;
+    }
+    value.assign(data, length);
+    return true;
+  }
+
+  bool ReadNumber(Number& number) {
+    const char* p = Peek() == '-' ? p_ + 1 : p_;
+    if (At(p) < '0' || At(p) > '9') {
+      return false;
+    }
+    // Up to 19 digits always fit in an `uint64_t`.
+    const char* const digits = p;
+    uint64_t magnitude = 0u;
+    if (At(p) == '0') {
+      ++p;
+    } else {
+      while (At(p) >= '0' && At(p) <= '9' && p - digits < 19) {
+        magnitude = magnitude * 10u + static_cast<uint64_t>(*p - '0');
+        ++p;
+      }
+    }
+    const bool negative = (p_ != digits);
+    const char next = At(p);
+    if (next == '.' || next == 'e' || next == 'E' || (next >= '0' && next <= '9') ||
+        (negative && magnitude > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1u)) {
+      // Fractions, exponents, and the integers that may not fit into 64 bits are up to RapidJSON.
+      NumberHandler handler(number);
+      return ParseValueViaRapidJSON(handler);
+    }
+    number.is_integer = true;
+    number.negative = negative;
+    number.magnitude = magnitude;
+    p_ = p;
+    return true;
+  }
+
+  // Skips one value, of any type, checking that it is well-formed.
+  bool Skip() {
+    rapidjson::BaseReaderHandler<> handler;
+    return ParseValueViaRapidJSON(handler);
+  }
+
+ private:
+  // The character at `p`, or '\0' at the end of the input. Never reads past `end_`, as the input is read sequentially.
+  char At(const char* p) const { return p == end_ ? '\0' : *p; }
+
+  bool Literal(const char* literal, size_t length) {
+    for (size_t i = 0u; i < length; ++i) {
+      if (At(p_ + i) != literal[i]) {
+        return false;
+      }
+    }
+    p_ += length;
+    return true;
+  }
+
+  template <typename HANDLER>
+  bool ParseValueViaRapidJSON(HANDLER& handler) {
+    if (end_) {
+      rapidjson::MemoryStream stream(p_, static_cast<size_t>(end_ - p_));
+      return ParseValueViaRapidJSON(stream, handler);
+    } else {
+      rapidjson::StringStream stream(p_);
+      return ParseValueViaRapidJSON(stream, handler);
+    }
+  }
+
+  template <typename STREAM, typename HANDLER>
+  bool ParseValueViaRapidJSON(STREAM& stream, HANDLER& handler) {
+    if (reader_.Parse<rapidjson::kParseStopWhenDoneFlag>(stream, handler).IsError()) {
+      return false;
+    }
+    p_ += stream.Tell();
+    return true;
+  }
+
+  // Accepts nothing but a string.
+  struct StringHandler : rapidjson::BaseReaderHandler<rapidjson::UTF8<>, StringHandler> {
+    std::string& value;
+    explicit StringHandler(std::string& value) : value(value) {}
+    bool Default() { return false; }
+    bool String(const char* data, rapidjson::SizeType length, bool) {
+      value.assign(data, length);
+      return true;
+    }
+  };
+
+  // Accepts nothing but a number.
+  struct NumberHandler : rapidjson::BaseReaderHandler<rapidjson::UTF8<>, NumberHandler> {
+    Number& number;
+    explicit NumberHandler(Number& number) : number(number) {}
+    bool Default() { return false; }
+    bool Int(int x) { return Int64(x); }
+    bool Uint(unsigned x) { return Uint64(x); }
+    bool Int64(int64_t x) {
+      number.is_integer = true;
+      number.negative = (x < 0);
+      number.magnitude = number.negative ? 0u - static_cast<uint64_t>(x) : static_cast<uint64_t>(x);
+      return true;
+    }
+    bool Uint64(uint64_t x) {
+      number.is_integer = true;
+      number.negative = false;
+      number.magnitude = x;
+      return true;
+    }
+    bool Double(double x) {
+      number.is_integer = false;
+      number.value = x;
+      return true;
+    }
+  };
+
+  const char* p_;
+  const char* const end_;  // `nullptr` for the null-terminated input.
+  std::string scratch_;
+  rapidjson::Reader reader_;
+};
+
+}  // namespace current::serialization::json
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_READER_H
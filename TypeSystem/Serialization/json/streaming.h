@@ -0,0 +1,685 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_STREAMING_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_STREAMING_H
+
+// The streaming JSON parser, which fills the destination object directly as it reads the input, with no DOM built.
+//
+// It is the fast path of `ParseJSON()`. It only handles the input it is certain about, and gives up on everything
+// else: malformed JSON, a schema mismatch, a duplicate key, a missing field that is not an `Optional`, an unknown type,
+// or the `NewtonsoftFSharp` format altogether. The input is then parsed again via the RapidJSON DOM, which produces
+// the very same exceptions, with the very same messages, as it always has.
+
+#include <bitset>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "json.h"
+#include "reader.h"
+
+#include "../../struct.h"
+#include "../../variant.h"
+#include "../../optional.h"
+#include "../../Reflection/reflection.h"
+
+namespace current {
+namespace serialization {
+namespace json {
+
+// Thrown, and caught, within the streaming parser only; never seen by the user.
+struct JSONStreamingParserGiveUp {};
+
+template <class JSON_FORMAT>
+struct JSONStreamingParserSupportsFormat {
+  constexpr static bool value = JSON_FORMAT::variant_style != JSONVariantStyle::NewtonsoftFSharp;
+};
+
+template <class JSON_FORMAT>
+class JSONStreamingParser;
+
+// The types without a specialization below are left to the DOM.
+template <class JSON_FORMAT, typename T, typename ENABLE = void>
+struct JSONStreamingParseImpl {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, T&) { parser.GiveUp(); }
+};
+
+// What to do when a field of this type is missing in the object. Only `Optional`-s, and `Variant`-s in the formats
+// with no `null`-s for them, may be missing; for the rest the DOM throws the "missing field" exception.
+template <class JSON_FORMAT, typename T, typename ENABLE = void>
+struct JSONStreamingMissingFieldImpl {
+  static void OnMissingField(JSONStreamingParser<JSON_FORMAT>& parser, T&) { parser.GiveUp(); }
+};
+
+template <class JSON_FORMAT>
+class JSONStreamingParser final {
+ public:
+  // With `end` set, the input is the `[json, end)` range, not required to be null-terminated.
+  explicit JSONStreamingParser(const char* json, const char* end = nullptr) : reader_(json, end) {}
+
+  JSONReader& Reader() { return reader_; }
+
+  template <typename T>
+  void Inner(T& destination) {
+    JSONStreamingParseImpl<JSON_FORMAT, T>::Parse(*this, destination);
+  }
+
+  template <typename T>
+  void InnerMissing(T& destination) {
+    JSONStreamingMissingFieldImpl<JSON_FORMAT, T>::OnMissingField(*this, destination);
+  }
+
+  void Require(bool condition) {
+    if (!condition) {
+      GiveUp();
+    }
+  }
+
+  void GiveUp() { throw JSONStreamingParserGiveUp(); }
+
+ private:
+  JSONReader reader_;
+};
+
+// Only the canonical "T<digits>" form, which the DOM would read as the same number.
+inline bool ParseCanonicalTypeID(const char* data, size_t length, uint64_t& result) {
+  if (length < 2u || length > 20u || data[0] != 'T' || (data[1] == '0' && length > 2u)) {
+    return false;
+  }
+  result = 0u;
+  for (size_t i = 1u; i < length; ++i) {
+    if (data[i] < '0' || data[i] > '9') {
+      return false;
+    }
+    result = result * 10u + static_cast<uint64_t>(data[i] - '0');
+  }
+  return true;
+}
+
+// `uint*_t`.
+template <class JSON_FORMAT, typename T>
+struct JSONStreamingParseImpl<JSON_FORMAT,
+                              T,
+                              std::enable_if_t<std::numeric_limits<T>::is_integer &&
+                                               !std::numeric_limits<T>::is_signed && !std::is_same<T, bool>::value>> {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, T& destination) {
+    JSONReader::Number number;
+    parser.Require(parser.Reader().ReadNumber(number) && number.IsUint64());
+    destination = static_cast<T>(number.GetUint64());
+  }
+};
+
+// `int*_t`.
+template <class JSON_FORMAT, typename T>
+struct JSONStreamingParseImpl<
+    JSON_FORMAT,
+    T,
+    std::enable_if_t<std::numeric_limits<T>::is_integer && std::numeric_limits<T>::is_signed>> {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, T& destination) {
+    JSONReader::Number number;
+    parser.Require(parser.Reader().ReadNumber(number) && number.IsInt64());
+    destination = static_cast<T>(number.GetInt64());
+  }
+};
+
+// `float` and `double`.
+template <class JSON_FORMAT, typename T>
+struct JSONStreamingParseImpl<JSON_FORMAT, T, std::enable_if_t<std::is_floating_point<T>::value>> {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, T& destination) {
+    JSONReader::Number number;
+    parser.Require(parser.Reader().ReadNumber(number));
+    destination = static_cast<T>(number.GetDouble());
+  }
+};
+
+template <class JSON_FORMAT>
+struct JSONStreamingParseImpl<JSON_FORMAT, std::string> {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, std::string& destination) {
+    parser.Require(parser.Reader().String(destination));
+  }
+};
+
+template <class JSON_FORMAT>
+struct JSONStreamingParseImpl<JSON_FORMAT, bool> {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, bool& destination) {
+    parser.Require(parser.Reader().Bool(destination));
+  }
+};
+
+template <class JSON_FORMAT, typename DURATION>
+struct JSONStreamingParseDuration {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, DURATION& destination) {
+    JSONReader::Number number;
+    parser.Require(parser.Reader().ReadNumber(number) && number.IsInt64());
+    destination = DURATION(number.GetInt64());
+  }
+};
+
+template <class JSON_FORMAT>
+struct JSONStreamingParseImpl<JSON_FORMAT, std::chrono::milliseconds>
+    : JSONStreamingParseDuration<JSON_FORMAT, std::chrono::milliseconds> {};
+
+template <class JSON_FORMAT>
+struct JSONStreamingParseImpl<JSON_FORMAT, std::chrono::microseconds>
+    : JSONStreamingParseDuration<JSON_FORMAT, std::chrono::microseconds> {};
+
+template <class JSON_FORMAT, typename T>
+struct JSONStreamingParseImpl<JSON_FORMAT, T, std::enable_if_t<std::is_enum<T>::value>> {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, T& destination) {
+    JSONReader::Number number;
+    parser.Require(parser.Reader().ReadNumber(number));
+    if (std::numeric_limits<typename std::underlying_type<T>::type>::is_signed) {
+      parser.Require(number.IsInt64());
+      destination = static_cast<T>(number.GetInt64());
+    } else {
+      parser.Require(number.IsUint64());
+      destination = static_cast<T>(number.GetUint64());
+    }
+  }
+};
+
+template <class JSON_FORMAT>
+struct JSONStreamingParseImpl<JSON_FORMAT, reflection::TypeID> {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, reflection::TypeID& destination) {
+    const char* data;
+    size_t length;
+    uint64_t value;
+    parser.Require(parser.Reader().StringView(data, length) && ParseCanonicalTypeID(data, length, value));
+    destination = static_cast<reflection::TypeID>(value);
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct JSONStreamingParseImpl<JSON_FORMAT, Optional<T>> {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, Optional<T>& destination) {
+    if (parser.Reader().Null()) {
+      destination = nullptr;
+    } else {
+      destination = T();
+      parser.Inner(Value(destination));
+    }
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct JSONStreamingMissingFieldImpl<JSON_FORMAT, Optional<T>> {
+  static void OnMissingField(JSONStreamingParser<JSON_FORMAT>&, Optional<T>& destination) { destination = nullptr; }
+};
+
+// Parses into the elements already in the vector, the way the DOM-based parser does.
+template <class JSON_FORMAT, typename T, typename A>
+struct JSONStreamingParseImpl<JSON_FORMAT, std::vector<T, A>> {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, std::vector<T, A>& destination) {
+    JSONReader& reader = parser.Reader();
+    parser.Require(reader.Consume('['));
+    size_t size = 0u;
+    if (!reader.Consume(']')) {
+      do {
+        if (size == destination.size()) {
+          destination.emplace_back();
+        }
+        parser.Inner(destination[size]);
+        ++size;
+      } while (reader.Consume(','));
+      parser.Require(reader.Consume(']'));
+    }
+    destination.resize(size);
+  }
+};
+
+template <class JSON_FORMAT, typename SET>
+struct JSONStreamingParseSet {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, SET& destination) {
+    JSONReader& reader = parser.Reader();
+    destination.clear();
+    parser.Require(reader.Consume('['));
+    if (!reader.Consume(']')) {
+      do {
+        typename SET::value_type element;
+        parser.Inner(element);
+        destination.insert(std::move(element));
+      } while (reader.Consume(','));
+      parser.Require(reader.Consume(']'));
+    }
+  }
+};
+
+template <class JSON_FORMAT, typename T, typename C, typename A>
+struct JSONStreamingParseImpl<JSON_FORMAT, std::set<T, C, A>>
+    : JSONStreamingParseSet<JSON_FORMAT, std::set<T, C, A>> {};
+
+template <class JSON_FORMAT, typename T, typename H, typename E, typename A>
+struct JSONStreamingParseImpl<JSON_FORMAT, std::unordered_set<T, H, E, A>>
+    : JSONStreamingParseSet<JSON_FORMAT, std::unordered_set<T, H, E, A>> {};
+
+// The maps keyed by strings are objects, and the rest of the maps are arrays of two-element arrays.
+// As with the DOM, a repeated key keeps its first value.
+template <class JSON_FORMAT, typename MAP, typename K = typename MAP::key_type>
+struct JSONStreamingParseMap {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, MAP& destination) {
+    JSONReader& reader = parser.Reader();
+    parser.Require(reader.Consume('['));
+    destination.clear();
+    if (!reader.Consume(']')) {
+      do {
+        K k;
+        typename MAP::mapped_type v;
+        parser.Require(reader.Consume('['));
+        parser.Inner(k);
+        parser.Require(reader.Consume(','));
+        parser.Inner(v);
+        parser.Require(reader.Consume(']'));
+        destination.emplace(std::move(k), std::move(v));
+      } while (reader.Consume(','));
+      parser.Require(reader.Consume(']'));
+    }
+  }
+};
+
+template <class JSON_FORMAT, typename MAP>
+struct JSONStreamingParseMap<JSON_FORMAT, MAP, std::string> {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, MAP& destination) {
+    JSONReader& reader = parser.Reader();
+    parser.Require(reader.Consume('{'));
+    destination.clear();
+    if (!reader.Consume('}')) {
+      std::string k;
+      typename MAP::mapped_type v;
+      do {
+        parser.Require(reader.String(k) && reader.Consume(':'));
+        parser.Inner(v);
+        destination.emplace(std::move(k), std::move(v));
+      } while (reader.Consume(','));
+      parser.Require(reader.Consume('}'));
+    }
+  }
+};
+
+template <class JSON_FORMAT, typename K, typename V, typename C, typename A>
+struct JSONStreamingParseImpl<JSON_FORMAT, std::map<K, V, C, A>>
+    : JSONStreamingParseMap<JSON_FORMAT, std::map<K, V, C, A>> {};
+
+template <class JSON_FORMAT, typename K, typename V, typename H, typename E, typename A>
+struct JSONStreamingParseImpl<JSON_FORMAT, std::unordered_map<K, V, H, E, A>>
+    : JSONStreamingParseMap<JSON_FORMAT, std::unordered_map<K, V, H, E, A>> {};
+
+template <class JSON_FORMAT, typename F, typename S>
+struct JSONStreamingParseImpl<JSON_FORMAT, std::pair<F, S>> {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, std::pair<F, S>& destination) {
+    JSONReader& reader = parser.Reader();
+    parser.Require(reader.Consume('['));
+    parser.Inner(destination.first);
+    parser.Require(reader.Consume(','));
+    parser.Inner(destination.second);
+    parser.Require(reader.Consume(']'));
+  }
+};
+
+// The fields of a `CURRENT_STRUCT`, including the fields of its super types, looked up by their names. The fields
+// are expected in the order in which `JSON()` writes them, so that it takes one comparison per key to find one.
+template <class JSON_FORMAT, typename T>
+class JSONStreamingStructFields final {
+ public:
+  using parser_t = JSONStreamingParser<JSON_FORMAT>;
+
+  struct Field {
+    const char* name;
+    size_t length;
+    void (*parse)(parser_t&, T&);
+    void (*missing)(parser_t&, T&);
+  };
+
+  // A `CURRENT_STRUCT` can shadow a field of its super type. The DOM fills both then, and so should the caller.
+  struct Fields {
+    std::vector<Field> fields;
+    bool has_duplicate_names = false;
+  };
+
+  static const Fields& Instance() {
+    static const Fields instance = ListAllFields();
+    return instance;
+  }
+
+  // Returns `fields.size()` if there is no such field.
+  static size_t Find(const std::vector<Field>& fields, const char* name, size_t length, size_t expected) {
+    if (expected < fields.size() && Matches(fields[expected], name, length)) {
+      return expected;
+    }
+    for (size_t i = 0u; i < fields.size(); ++i) {
+      if (Matches(fields[i], name, length)) {
+        return i;
+      }
+    }
+    return fields.size();
+  }
+
+ private:
+  static bool Matches(const Field& field, const char* name, size_t length) {
+    return field.length == length && !std::memcmp(field.name, name, length);
+  }
+
+  template <typename BASE, int I>
+  struct FieldImpl {
+    struct Parser {
+      parser_t& parser;
+      template <typename U>
+      void operator()(const char*, U& value) const {
+        parser.Inner(value);
+      }
+    };
+    struct MissingParser {
+      parser_t& parser;
+      template <typename U>
+      void operator()(const char*, U& value) const {
+        parser.InnerMissing(value);
+      }
+    };
+    static void Parse(parser_t& parser, T& destination) {
+      static_cast<BASE&>(destination)
+          .CURRENT_REFLECTION(Parser{parser}, reflection::Index<reflection::FieldNameAndMutableValue, I>());
+    }
+    static void Missing(parser_t& parser, T& destination) {
+      static_cast<BASE&>(destination)
+          .CURRENT_REFLECTION(MissingParser{parser}, reflection::Index<reflection::FieldNameAndMutableValue, I>());
+    }
+  };
+
+  template <typename BASE>
+  struct FieldsLister {
+    std::vector<Field>& fields;
+    template <typename U, int I>
+    void operator()(reflection::TypeSelector<U>, const char* name, reflection::SimpleIndex<I>) const {
+      fields.push_back(Field{name, std::strlen(name), &FieldImpl<BASE, I>::Parse, &FieldImpl<BASE, I>::Missing});
+    }
+  };
+
+  static void ListFields(std::vector<Field>&, reflection::TypeSelector<CurrentStruct>) {}
+
+  template <typename BASE>
+  static void ListFields(std::vector<Field>& fields, reflection::TypeSelector<BASE>) {
+    ListFields(fields, reflection::TypeSelector<reflection::SuperType<BASE>>());
+    reflection::VisitAllFields<BASE, reflection::FieldTypeAndNameAndIndex>::WithoutObject(
+        FieldsLister<BASE>{fields});
+  }
+
+  static Fields ListAllFields() {
+    Fields result;
+    ListFields(result.fields, reflection::TypeSelector<T>());
+    for (size_t i = 0u; i < result.fields.size(); ++i) {
+      if (Find(result.fields, result.fields[i].name, result.fields[i].length, i) != i) {
+        result.has_duplicate_names = true;
+      }
+    }
+    return result;
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct JSONStreamingParseImpl<JSON_FORMAT,
+                              T,
+                              std::enable_if_t<IS_CURRENT_STRUCT(T) && !std::is_same<T, CurrentStruct>::value>> {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, T& destination) {
+    using fields_t = JSONStreamingStructFields<JSON_FORMAT, T>;
+    const auto& instance = fields_t::Instance();
+    const auto& fields = instance.fields;
+    parser.Require(!instance.has_duplicate_names);
+
+    JSONReader& reader = parser.Reader();
+    parser.Require(reader.Consume('{'));
+    std::bitset<reflection::TotalFieldCounter<T>::value> seen;
+    if (!reader.Consume('}')) {
+      size_t expected = 0u;
+      do {
+        const char* key;
+        size_t length;
+        parser.Require(reader.StringView(key, length) && reader.Consume(':'));
+        const size_t i = fields_t::Find(fields, key, length, expected);
+        if (i == fields.size()) {
+          parser.Require(reader.Skip());
+        } else {
+          // The DOM takes the first one of the duplicate keys; leave this case to it.
+          parser.Require(!seen[i]);
+          seen[i] = true;
+          fields[i].parse(parser, destination);
+          expected = i + 1u;
+        }
+      } while (reader.Consume(','));
+      parser.Require(reader.Consume('}'));
+    }
+    if (seen.count() != fields.size()) {
+      for (size_t i = 0u; i < fields.size(); ++i) {
+        if (!seen[i]) {
+          fields[i].missing(parser, destination);
+        }
+      }
+    }
+  }
+};
+
+// The cases of a `Variant`, by their names and type IDs. Ambiguous names or type IDs are left to the DOM.
+template <class JSON_FORMAT, typename VARIANT, typename TYPELIST = typename VARIANT::typelist_t>
+class JSONStreamingVariantCases;
+
+template <class JSON_FORMAT, typename VARIANT, typename... TS>
+class JSONStreamingVariantCases<JSON_FORMAT, VARIANT, TypeListImpl<TS...>> final {
+ public:
+  using parser_t = JSONStreamingParser<JSON_FORMAT>;
+
+  struct Case {
+    const char* name;
+    size_t length;
+    uint64_t type_id;
+    void (*parse)(parser_t&, VARIANT&);
+  };
+
+  struct Cases {
+    std::vector<Case> cases;
+    bool ambiguous = false;
+  };
+
+  static const Cases& Instance() {
+    static const Cases instance = ListAllCases();
+    return instance;
+  }
+
+  static const Case* Find(const Cases& instance, const char* name, size_t length) {
+    for (const Case& c : instance.cases) {
+      if (c.length == length && !std::memcmp(c.name, name, length)) {
+        return &c;
+      }
+    }
+    return nullptr;
+  }
+
+ private:
+  template <typename X>
+  static void ParseCase(parser_t& parser, VARIANT& destination) {
+    X value;
+    parser.Inner(value);
+    destination = std::move(value);
+  }
+
+  template <typename X>
+  static Case MakeCase() {
+    const char* name = reflection::CurrentTypeName<X, reflection::NameFormat::Z>();
+    return Case{name,
+                std::strlen(name),
+                static_cast<uint64_t>(
+                    Value<reflection::ReflectedTypeBase>(reflection::Reflector().ReflectType<X>()).type_id),
+                &ParseCase<X>};
+  }
+
+  static Cases ListAllCases() {
+    Cases result;
+    result.cases = std::vector<Case>{MakeCase<TS>()...};
+    for (size_t i = 0u; i < result.cases.size(); ++i) {
+      for (size_t j = 0u; j < i; ++j) {
+        if (!std::strcmp(result.cases[i].name, result.cases[j].name) ||
+            result.cases[i].type_id == result.cases[j].type_id) {
+          result.ambiguous = true;
+        }
+      }
+    }
+    return result;
+  }
+};
+
+template <JSONVariantStyle STYLE>
+struct JSONStreamingVariantImpl;
+
+// `{"Case":{...},"":"T9..."}`. The type ID may come before or after the case, and must match it.
+template <>
+struct JSONStreamingVariantImpl<JSONVariantStyle::Current> {
+  template <class JSON_FORMAT, typename VARIANT>
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, VARIANT& destination) {
+    using cases_t = JSONStreamingVariantCases<JSON_FORMAT, VARIANT>;
+    const auto& instance = cases_t::Instance();
+    parser.Require(!instance.ambiguous);
+
+    JSONReader& reader = parser.Reader();
+    parser.Require(reader.Consume('{'));
+    const typename cases_t::Case* parsed_case = nullptr;
+    bool has_type_id = false;
+    uint64_t type_id = 0u;
+    if (!reader.Consume('}')) {
+      do {
+        const char* key;
+        size_t length;
+        parser.Require(reader.StringView(key, length) && reader.Consume(':'));
+        if (!length) {
+          const char* data;
+          size_t data_length;
+          parser.Require(!has_type_id && reader.StringView(data, data_length) &&
+                         ParseCanonicalTypeID(data, data_length, type_id));
+          has_type_id = true;
+        } else {
+          const typename cases_t::Case* c = cases_t::Find(instance, key, length);
+          if (!c) {
+            parser.Require(reader.Skip());
+          } else {
+            parser.Require(!parsed_case);
+            parsed_case = c;
+            c->parse(parser, destination);
+          }
+        }
+      } while (reader.Consume(','));
+      parser.Require(reader.Consume('}'));
+    }
+    parser.Require(parsed_case && has_type_id && parsed_case->type_id == type_id);
+  }
+};
+
+// `{"Case":{...}}`, with the `""` and `"$"` keys, if any, ignored.
+template <>
+struct JSONStreamingVariantImpl<JSONVariantStyle::Simple> {
+  template <class JSON_FORMAT, typename VARIANT>
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, VARIANT& destination) {
+    JSONReader& reader = parser.Reader();
+    if (reader.Null()) {
+      return;
+    }
+
+    using cases_t = JSONStreamingVariantCases<JSON_FORMAT, VARIANT>;
+    const auto& instance = cases_t::Instance();
+    parser.Require(!instance.ambiguous);
+
+    parser.Require(reader.Consume('{'));
+    bool parsed = false;
+    if (!reader.Consume('}')) {
+      do {
+        const char* key;
+        size_t length;
+        parser.Require(reader.StringView(key, length) && reader.Consume(':'));
+        if (!length || (length == 1u && *key == '$')) {
+          parser.Require(reader.Skip());
+        } else {
+          const typename cases_t::Case* c = cases_t::Find(instance, key, length);
+          parser.Require(c && !parsed);
+          parsed = true;
+          c->parse(parser, destination);
+        }
+      } while (reader.Consume(','));
+      parser.Require(reader.Consume('}'));
+    }
+    parser.Require(parsed);
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct JSONStreamingParseImpl<JSON_FORMAT, T, std::enable_if_t<IS_CURRENT_VARIANT(T)>> {
+  static void Parse(JSONStreamingParser<JSON_FORMAT>& parser, T& destination) {
+    JSONStreamingVariantImpl<JSON_FORMAT::variant_style>::Parse(parser, destination);
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct JSONStreamingMissingFieldImpl<JSON_FORMAT, T, std::enable_if_t<IS_CURRENT_VARIANT(T)>> {
+  static void OnMissingField(JSONStreamingParser<JSON_FORMAT>& parser, T&) {
+    parser.Require(!JSONVariantStyleUseNulls<JSON_FORMAT::variant_style>::value);
+  }
+};
+
+template <class JSON_FORMAT, bool SUPPORTED = JSONStreamingParserSupportsFormat<JSON_FORMAT>::value>
+struct ParseJSONViaStreamingParserImpl {
+  template <typename T>
+  static bool DoParse(const char* json, const char* end, T& destination) {
+    try {
+      JSONStreamingParser<JSON_FORMAT> parser(json, end);
+      parser.Inner(destination);
+      return parser.Reader().AtEnd();
+    } catch (const JSONStreamingParserGiveUp&) {
+      return false;
+    }
+  }
+};
+
+template <class JSON_FORMAT>
+struct ParseJSONViaStreamingParserImpl<JSON_FORMAT, false> {
+  template <typename T>
+  static bool DoParse(const char*, const char*, T&) {
+    return false;
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+bool ParseJSONViaStreamingParser(const char* json, const char* end, T& destination) {
+  return ParseJSONViaStreamingParserImpl<JSON_FORMAT>::DoParse(json, end, destination);
+}
+
+template <class JSON_FORMAT, typename T>
+bool ParseJSONViaStreamingParser(const char* json, T& destination) {
+  return ParseJSONViaStreamingParserImpl<JSON_FORMAT>::DoParse(json, nullptr, destination);
+}
+
+}  // namespace current::serialization::json
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_STREAMING_H
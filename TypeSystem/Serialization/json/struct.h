@@ -44,15 +44,10 @@ class JSONStructFieldsSerializer {
   explicit JSONStructFieldsSerializer(json::JSONStringifier<JSON_FORMAT>& json_stringifier)
       : json_stringifier_(json_stringifier) {}
 
-  // IMPORTANT: Must take name as `const char* name`, as `const std::string& name`
-  // would fail memory-allocation-wise due to over-smartness of RapidJSON.
+  // The key is only written if the value is not absent.
   template <typename U>
   void operator()(const char* name, const U& source) const {
-    rapidjson::Value placeholder;
-    if (json_stringifier_.MaybeInner(&placeholder, source)) {
-      json_stringifier_.Current().AddMember(
-          rapidjson::StringRef(name), std::move(placeholder.Move()), json_stringifier_.Allocator());
-    }
+    json_stringifier_.MaybeInner(name, source);
   }
 
  private:
@@ -84,9 +79,10 @@ struct SerializeImpl<json::JSONStringifier<JSON_FORMAT>,
                      T,
                      std::enable_if_t<IS_CURRENT_STRUCT(T) && !std::is_same<T, CurrentStruct>::value>> {
   static void DoSerialize(json::JSONStringifier<JSON_FORMAT>& json_stringifier, const T& value) {
-    json_stringifier.Current().SetObject();
+    json_stringifier.StartObject();
     json::JSONStructFieldsSerializer<JSON_FORMAT> visitor(json_stringifier);
     json::SerializeStructImpl<JSON_FORMAT, T>::SerializeStruct(visitor, value);
+    json_stringifier.EndObject();
   }
 };
 
@@ -38,7 +38,17 @@ namespace serialization {
 template <class JSON_FORMAT>
 struct SerializeImpl<json::JSONStringifier<JSON_FORMAT>, reflection::TypeID> {
   static void DoSerialize(json::JSONStringifier<JSON_FORMAT>& json_stringifier, reflection::TypeID value) {
-    json_stringifier.Current().SetString("T" + current::ToString(value), json_stringifier.Allocator());
+    // Formatted in place, as a `Variant` is serialized along with its type ID, and this is on the hot path.
+    char buffer[24];
+    char* end = buffer + sizeof(buffer);
+    char* begin = end;
+    uint64_t x = static_cast<uint64_t>(value);
+    do {
+      *--begin = static_cast<char>('0' + x % 10u);
+      x /= 10u;
+    } while (x);
+    *--begin = 'T';
+    json_stringifier.String(begin, static_cast<size_t>(end - begin));
   }
 };
 
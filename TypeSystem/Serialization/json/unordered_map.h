@@ -41,18 +41,14 @@ template <class JSON_FORMAT, typename TK, typename TV, class HASH, class EQ, cla
 struct SerializeImpl<json::JSONStringifier<JSON_FORMAT>, std::unordered_map<TK, TV, HASH, EQ, ALLOCATOR>> {
   static void DoSerialize(json::JSONStringifier<JSON_FORMAT>& json_stringifier,
                           const std::unordered_map<TK, TV, HASH, EQ, ALLOCATOR>& value) {
-    json_stringifier.Current().SetArray();
+    json_stringifier.StartArray();
     for (const auto& element : value) {
-      rapidjson::Value key_value_as_array;
-      key_value_as_array.SetArray();
-      rapidjson::Value populated_key;
-      rapidjson::Value populated_value;
-      json_stringifier.Inner(&populated_key, element.first);
-      json_stringifier.Inner(&populated_value, element.second);
-      key_value_as_array.PushBack(std::move(populated_key.Move()), json_stringifier.Allocator());
-      key_value_as_array.PushBack(std::move(populated_value.Move()), json_stringifier.Allocator());
-      json_stringifier.Current().PushBack(std::move(key_value_as_array.Move()), json_stringifier.Allocator());
+      json_stringifier.StartArray();
+      json_stringifier.Inner(element.first);
+      json_stringifier.Inner(element.second);
+      json_stringifier.EndArray();
     }
+    json_stringifier.EndArray();
   }
 };
 
@@ -60,13 +56,12 @@ template <class JSON_FORMAT, typename TV, class HASH, class EQ, class ALLOCATOR>
 struct SerializeImpl<json::JSONStringifier<JSON_FORMAT>, std::unordered_map<std::string, TV, HASH, EQ, ALLOCATOR>> {
   static void DoSerialize(json::JSONStringifier<JSON_FORMAT>& json_stringifier,
                           const std::unordered_map<std::string, TV, HASH, EQ, ALLOCATOR>& value) {
-    json_stringifier.Current().SetObject();
+    json_stringifier.StartObject();
     for (const auto& element : value) {
-      rapidjson::Value populated_value;
-      json_stringifier.Inner(&populated_value, element.second);
-      json_stringifier.Current().AddMember(
-          rapidjson::StringRef(element.first), std::move(populated_value.Move()), json_stringifier.Allocator());
+      json_stringifier.Key(element.first);
+      json_stringifier.Inner(element.second);
     }
+    json_stringifier.EndObject();
   }
 };
 
@@ -0,0 +1,195 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_WRITER_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_WRITER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "rapidjson.h"
+
+namespace current {
+namespace serialization {
+namespace json {
+
+// Writes JSON tokens straight into an `std::string`, appending to it.
+// The output is byte-for-byte the one of `rapidjson::Writer`, with its default flags, as the numbers are
+// formatted by the very RapidJSON routines, and the strings are escaped the very same way. Unlike RapidJSON,
+// it does not keep a stack of nesting levels, as the caller is responsible for the tokens to be well-formed.
+// Each method returns `false` if the token could not be written, which only happens for NaN-s and infinities.
+//
+// The string is grown ahead of time and written into directly, and is cut down to what has actually been written
+// once the writer goes out of scope. It is grown by as much as has been written so far, so that the bytes `resize()`
+// fills with zeroes are proportional to the output, regardless of how much capacity the string has already.
+class JSONWriter final {
+ public:
+  explicit JSONWriter(std::string& output) : output_(output), begin_(output.size()), size_(begin_) {}
+  ~JSONWriter() { output_.resize(size_); }
+
+  JSONWriter(const JSONWriter&) = delete;
+  JSONWriter& operator=(const JSONWriter&) = delete;
+
+  bool Null() { return Literal("null", 4u); }
+  bool Bool(bool value) { return value ? Literal("true", 4u) : Literal("false", 5u); }
+
+  bool Int(int value) {
+    char* p = Prefix(11u);
+    return Commit(rapidjson::internal::i32toa(value, p));
+  }
+
+  bool Uint(unsigned value) {
+    char* p = Prefix(10u);
+    return Commit(rapidjson::internal::u32toa(value, p));
+  }
+
+  bool Int64(int64_t value) {
+    char* p = Prefix(21u);
+    return Commit(rapidjson::internal::i64toa(value, p));
+  }
+
+  bool Uint64(uint64_t value) {
+    char* p = Prefix(20u);
+    return Commit(rapidjson::internal::u64toa(value, p));
+  }
+
+  bool Double(double value) {
+    char* p = Prefix(25u);
+    if (rapidjson::internal::Double(value).IsNanOrInf()) {
+      size_ = static_cast<size_t>(p - &output_[0]);
+      return false;
+    }
+    return Commit(rapidjson::internal::dtoa(value, p));
+  }
+
+  bool String(const char* s, size_t length) {
+    char* p = Prefix(2u + length * 6u);
+    return Commit(WriteEscaped(p, s, length));
+  }
+
+  bool Key(const char* s, size_t length) {
+    char* p = Prefix(3u + length * 6u);
+    p = WriteEscaped(p, s, length);
+    *p++ = ':';
+    size_ = static_cast<size_t>(p - &output_[0]);
+    need_comma_ = false;
+    return true;
+  }
+
+  bool StartObject() { return Start('{'); }
+  bool EndObject() { return End('}'); }
+  bool StartArray() { return Start('['); }
+  bool EndArray() { return End(']'); }
+
+ private:
+  // Makes sure there is room for `length` more bytes, and returns the pointer to write them at.
+  char* Reserve(size_t length) {
+    constexpr static size_t kMinimumGrowth = 64u;
+    if (output_.size() - size_ < length) {
+      output_.resize(size_ + std::max(length, std::max(size_ - begin_, kMinimumGrowth)));
+    }
+    return &output_[size_];
+  }
+
+  // Same as `Reserve()`, but also writes the comma, if needed, before the token.
+  char* Prefix(size_t length) {
+    char* p = Reserve(length + 1u);
+    if (need_comma_) {
+      *p++ = ',';
+    }
+    return p;
+  }
+
+  bool Commit(char* end) {
+    size_ = static_cast<size_t>(end - &output_[0]);
+    need_comma_ = true;
+    return true;
+  }
+
+  bool Literal(const char* s, size_t length) {
+    char* p = Prefix(length);
+    std::memcpy(p, s, length);
+    return Commit(p + length);
+  }
+
+  bool Start(char c) {
+    char* p = Prefix(1u);
+    *p++ = c;
+    size_ = static_cast<size_t>(p - &output_[0]);
+    need_comma_ = false;
+    return true;
+  }
+
+  bool End(char c) {
+    char* p = Reserve(1u);
+    *p++ = c;
+    return Commit(p);
+  }
+
+  static char* WriteEscaped(char* p, const char* s, size_t length) {
+    static const char hex_digits[] = "0123456789ABCDEF";
+    // clang-format off
+    static const char escape[256] = {
+      'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+      'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+        0,   0, '"',   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,'\\',   0,   0,   0,
+    };
+    // clang-format on
+    *p++ = '"';
+    for (const char* const end = s + length; s != end; ++s) {
+      const unsigned char c = static_cast<unsigned char>(*s);
+      const char e = escape[c];
+      if (!e) {
+        *p++ = static_cast<char>(c);
+      } else {
+        *p++ = '\\';
+        *p++ = e;
+        if (e == 'u') {
+          *p++ = '0';
+          *p++ = '0';
+          *p++ = hex_digits[c >> 4];
+          *p++ = hex_digits[c & 0xf];
+        }
+      }
+    }
+    *p++ = '"';
+    return p;
+  }
+
+  std::string& output_;
+  const size_t begin_;
+  size_t size_;
+  bool need_comma_ = false;
+};
+
+}  // namespace current::serialization::json
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_WRITER_H
@@ -166,8 +166,6 @@ CURRENT_STRUCT(WithInnerVariant) { CURRENT_FIELD(v, InnerVariant); };
 }  // namespace serialization_test::named_variant
 }  // namespace serialization_test
 
-#if 0
-// TODO(dkorolev): DIMA FIXME binary format.
 TEST(Serialization, Binary) {
   using namespace serialization_test;
 
@@ -238,7 +236,6 @@ TEST(Serialization, Binary) {
     ASSERT_THROW(LoadFromBinary<ComplexSerializable>(is), BinaryLoadFromStreamException);
   }
 }
-#endif
 
 TEST(JSONSerialization, CPPTypes) {
   // `bool`.
@@ -316,8 +313,6 @@ TEST(JSONSerialization, CPPTypes) {
   }
 }
 
-#if 0
-// TODO(dkorolev): DIMA FIXME binary format.
 TEST(Serialization, OptionalAsBinary) {
   using namespace serialization_test;
 
@@ -360,7 +355,106 @@ TEST(Serialization, OptionalAsBinary) {
     EXPECT_TRUE(Value(parsed_with_b.b));
   }
 }
-#endif
+
+TEST(Serialization, BinaryVariantsAndContainers) {
+  using namespace serialization_test;
+
+  // Varints and zigzag.
+  EXPECT_EQ(1u, Binary(static_cast<uint64_t>(127)).length());
+  EXPECT_EQ(2u, Binary(static_cast<uint64_t>(128)).length());
+  EXPECT_EQ(10u, Binary(static_cast<uint64_t>(-1)).length());
+  EXPECT_EQ(1u, Binary(static_cast<int64_t>(-64)).length());
+  EXPECT_EQ(static_cast<uint64_t>(-1), ParseBinary<uint64_t>(Binary(static_cast<uint64_t>(-1))));
+  EXPECT_EQ(std::numeric_limits<int64_t>::min(),
+            ParseBinary<int64_t>(Binary(std::numeric_limits<int64_t>::min())));
+  EXPECT_EQ(-42, ParseBinary<int32_t>(Binary(static_cast<int32_t>(-42))));
+  EXPECT_EQ('x', ParseBinary<char>(Binary('x')));
+  EXPECT_EQ(0.1f, ParseBinary<float>(Binary(0.1f)));
+  EXPECT_EQ(-1e100, ParseBinary<double>(Binary(-1e100)));
+  EXPECT_EQ(std::string("a\0b\n", 4), ParseBinary<std::string>(Binary(std::string("a\0b\n", 4))));
+  EXPECT_EQ(std::chrono::microseconds(-5),
+            ParseBinary<std::chrono::microseconds>(Binary(std::chrono::microseconds(-5))));
+
+  // Containers.
+  {
+    WithVectorOfPairs with_vector_of_pairs;
+    with_vector_of_pairs.v.emplace_back(-1, "minus one");
+    with_vector_of_pairs.v.emplace_back(100, "one hundred");
+    EXPECT_EQ(JSON(with_vector_of_pairs), JSON(ParseBinary<WithVectorOfPairs>(Binary(with_vector_of_pairs))));
+
+    WithTrivialSet with_set;
+    with_set.s.insert("foo");
+    with_set.s.insert("bar");
+    EXPECT_EQ(JSON(with_set), JSON(ParseBinary<WithTrivialSet>(Binary(with_set))));
+
+    WithNontrivialUnorderedMap with_unordered_map;
+    with_unordered_map.q[Serializable(1)] = "one";
+    with_unordered_map.q[Serializable(2)] = "two";
+    const auto parsed_unordered_map = ParseBinary<WithNontrivialUnorderedMap>(Binary(with_unordered_map));
+    ASSERT_EQ(2u, parsed_unordered_map.q.size());
+    EXPECT_EQ("two", parsed_unordered_map.q.at(Serializable(2)));
+
+    WithNontrivialUnorderedSet with_unordered_set;
+    with_unordered_set.s.insert(Serializable(3));
+    const auto parsed_unordered_set = ParseBinary<WithNontrivialUnorderedSet>(Binary(with_unordered_set));
+    ASSERT_EQ(1u, parsed_unordered_set.s.size());
+    EXPECT_EQ(1u, parsed_unordered_set.s.count(Serializable(3)));
+  }
+
+  // Containers of the elements which take zero bytes each.
+  {
+    static_assert(current::serialization::binary::BinaryMayBeEmpty<Empty>::value, "");
+    static_assert(!current::serialization::binary::BinaryMayBeEmpty<Serializable>::value, "");
+
+    const std::vector<Empty> empties(1000u);
+    const std::string binary = Binary(empties);
+    EXPECT_EQ(2u, binary.length());
+    EXPECT_EQ(1000u, ParseBinary<std::vector<Empty>>(binary).size());
+
+    std::map<int, std::vector<Empty>> map_of_empties;
+    map_of_empties[1].resize(3u);
+    map_of_empties[2].resize(300u);
+    const auto parsed_map_of_empties = ParseBinary<std::map<int, std::vector<Empty>>>(Binary(map_of_empties));
+    ASSERT_EQ(2u, parsed_map_of_empties.size());
+    EXPECT_EQ(300u, parsed_map_of_empties.at(2).size());
+  }
+
+  // Variants, including nested ones.
+  {
+    ContainsVariant contains_variant;
+    contains_variant.variant = ComplexSerializable('a', 'c');
+    const auto parsed = ParseBinary<ContainsVariant>(Binary(contains_variant));
+    ASSERT_TRUE(Exists<ComplexSerializable>(parsed.variant));
+    EXPECT_EQ(JSON(contains_variant), JSON(parsed));
+
+    contains_variant.variant = Empty();
+    EXPECT_TRUE(Exists<Empty>(ParseBinary<ContainsVariant>(Binary(contains_variant)).variant));
+    contains_variant.variant = AlternativeEmpty();
+    EXPECT_TRUE(Exists<AlternativeEmpty>(ParseBinary<ContainsVariant>(Binary(contains_variant)).variant));
+
+    named_variant::WrappedQ wrapped(named_variant::OuterB{});
+    Value<named_variant::OuterB>(wrapped).b = named_variant::T();
+    EXPECT_EQ(JSON(wrapped), JSON(ParseBinary<named_variant::WrappedQ>(Binary(wrapped))));
+  }
+
+  // Errors.
+  {
+    ContainsVariant uninitialized;
+    EXPECT_THROW(ParseBinary<ContainsVariant>(Binary(uninitialized)), BinaryUninitializedVariantObjectException);
+
+    ContainsVariant contains_variant;
+    contains_variant.variant = Serializable(42);
+    const std::string binary = Binary(contains_variant);
+    EXPECT_THROW(ParseBinary<ContainsVariant>(binary.substr(0u, binary.length() - 1u)),
+                 BinaryLoadFromStreamException);
+    EXPECT_THROW(ParseBinary<ContainsVariant>(binary + 'x'), BinaryLoadFromStreamException);
+    EXPECT_THROW(ParseBinary<ContainsVariant>(Binary(static_cast<uint64_t>(12345))), BinaryLoadFromStreamException);
+    EXPECT_THROW(ParseBinary<uint8_t>(Binary(static_cast<uint16_t>(300))), BinaryLoadFromStreamException);
+    EXPECT_THROW(ParseBinary<bool>(std::string("\x02")), BinaryLoadFromStreamException);
+    EXPECT_THROW(ParseBinary<std::vector<std::string>>(Binary(static_cast<uint64_t>(1000000))),
+                 BinaryLoadFromStreamException);
+  }
+}
 
 TEST(JSONSerialization, CurrentStructs) {
   using namespace serialization_test;
@@ -829,8 +923,6 @@ TEST(JSONSerialization, Time) {
   }
 }
 
-#if 0
-// TODO(dkorolev): DIMA FIXME binary format.
 TEST(Serialization, TimeAsBinary) {
   using namespace serialization_test;
 
@@ -838,7 +930,7 @@ TEST(Serialization, TimeAsBinary) {
     WithTime zero;
     std::ostringstream oss;
     SaveIntoBinary(oss, zero);
-    EXPECT_EQ(16u, oss.str().length());
+    EXPECT_EQ(2u, oss.str().length());
   }
 
   {
@@ -853,7 +945,6 @@ TEST(Serialization, TimeAsBinary) {
     EXPECT_EQ(6ll, parsed.micros.count());
   }
 }
-#endif
 
 TEST(JSONSerialization, Optional) {
   using namespace serialization_test;
@@ -1502,4 +1593,107 @@ TEST(JSONSerialization, IntegerZeroIsADouble) {
   EXPECT_EQ(0, ParseJSON<Float>(JSON(Int())).x);
 }
 
+TEST(JSONSerialization, AppendAndWriteJSON) {
+  using namespace serialization_test;
+
+  std::string output = "[";
+  AppendJSON(output, Serializable(1, "one", true, Enum::SET));
+  output += ',';
+  AppendJSON<JSONFormat::Minimalistic>(output, Optional<int>());
+  output += ']';
+  EXPECT_EQ("[{\"i\":1,\"s\":\"one\",\"b\":true,\"e\":100},null]", output);
+
+  std::ostringstream os;
+  WriteJSON(os, Serializable(2, "two", false, Enum::DEFAULT)) << '\n';
+  WriteJSON<JSONFormat::NewtonsoftFSharp>(os, simple_variant_t(Empty()));
+  EXPECT_EQ("{\"i\":2,\"s\":\"two\",\"b\":false,\"e\":0}\n{\"Case\":\"Empty\"}", os.str());
+
+  // The strings are escaped the way RapidJSON does it.
+  EXPECT_EQ("\"\\\"\\\\/\\b\\f\\n\\r\\t\\u0000\\u001F\xD0\xAF\"",
+            JSON(std::string("\"\\/\b\f\n\r\t\0\x1F\xD0\xAF", 12)));
+
+  // The per-thread buffer does not keep the memory taken by an oversized object.
+  auto& shared_buffer = current::ThreadLocalSingleton<current::serialization::json::JSONStringifierBuffer>().buffer;
+  EXPECT_EQ(4000002u, JSON(std::string(4000000u, 'x')).length());
+  EXPECT_LE(shared_buffer.capacity(), 1024u * 1024u);
+  EXPECT_EQ("[1,2,3]", JSON(std::vector<int>({1, 2, 3})));
+
+  // The string appended to is grown by as much as has been written, not by its own capacity.
+  std::string large;
+  large.reserve(1000000u);
+  AppendJSON(large, 42);
+  EXPECT_EQ("42", large);
+}
+
+TEST(JSONSerialization, StreamingParser) {
+  using namespace serialization_test;
+  using current::serialization::json::ParseJSONViaStreamingParser;
+
+  {
+    ComplexSerializable object;
+    object.j = 42u;
+    object.q = "q";
+    object.v = {"a", "b\n"};
+    object.z = Serializable(1, "one", true, Enum::SET);
+    ComplexSerializable parsed;
+    EXPECT_TRUE(ParseJSONViaStreamingParser<JSONFormat::Current>(JSON(object).c_str(), parsed));
+    EXPECT_EQ(JSON(object), JSON(parsed));
+  }
+
+  {
+    // Out-of-order and unknown keys, escaped key names, and whitespace.
+    DerivedSerializable parsed;
+    EXPECT_TRUE(ParseJSONViaStreamingParser<JSONFormat::Current>(
+        " { \"d\" : 0.5 , \"skip\" : [ { \"x\" : null } ] , \"\\u0069\":1,\"s\":\"s\",\"b\":false,\"e\":0 } ",
+        parsed));
+    EXPECT_EQ("{\"i\":1,\"s\":\"s\",\"b\":false,\"e\":0,\"d\":0.5}", JSON(parsed));
+  }
+
+  {
+    // Variants, in the `Current` and in the `Minimalistic` formats.
+    ContainsVariant object;
+    object.variant = Serializable(2, "two", false, Enum::DEFAULT);
+    ContainsVariant parsed;
+    EXPECT_TRUE(ParseJSONViaStreamingParser<JSONFormat::Current>(JSON(object).c_str(), parsed));
+    EXPECT_EQ(JSON(object), JSON(parsed));
+    object.variant = Empty();
+    EXPECT_TRUE(ParseJSONViaStreamingParser<JSONFormat::Minimalistic>(
+        JSON<JSONFormat::Minimalistic>(object).c_str(), parsed));
+    EXPECT_TRUE(Exists<Empty>(parsed.variant));
+  }
+
+  {
+    // The JSON which is not null-terminated, such as a line of a memory-mapped file, is parsed right where it is.
+    const std::string lines =
+        "{\"i\":1,\"s\":\"one\",\"b\":true,\"e\":100}\n{\"s\":\"two\\n\",\"i\":2,\"d\":[0.5],\"b\":false,\"e\":0}\n";
+    const size_t eol = lines.find('\n');
+    EXPECT_EQ("{\"i\":1,\"s\":\"one\",\"b\":true,\"e\":100}", JSON(ParseJSON<Serializable>(lines.data(), eol)));
+    EXPECT_EQ("{\"i\":2,\"s\":\"two\\n\",\"b\":false,\"e\":0}",
+              JSON(ParseJSON<Serializable>(lines.data() + eol + 1u, lines.length() - eol - 2u)));
+    // The input is never read past its end, even if the JSON is incomplete there.
+    EXPECT_THROW(ParseJSON<Serializable>(lines.data(), eol - 1u), TypeSystemParseJSONException);
+    EXPECT_THROW(ParseJSON<Serializable>(lines.data(), 5u), TypeSystemParseJSONException);
+  }
+
+  {
+    // Whatever the streaming parser is not certain about is left to the DOM, which produces the same result.
+    WithOptional parsed;
+    EXPECT_TRUE(ParseJSONViaStreamingParser<JSONFormat::Current>("{\"i\":1}", parsed));
+    EXPECT_FALSE(ParseJSONViaStreamingParser<JSONFormat::Current>("{\"i\":1,\"i\":2}", parsed));
+    EXPECT_EQ(1, Value(ParseJSON<WithOptional>("{\"i\":1,\"i\":2}").i));
+    EXPECT_FALSE(ParseJSONViaStreamingParser<JSONFormat::NewtonsoftFSharp>("{\"i\":1}", parsed));
+    Serializable serializable;
+    EXPECT_FALSE(ParseJSONViaStreamingParser<JSONFormat::Current>("{\"i\":1}", serializable));
+    EXPECT_FALSE(ParseJSONViaStreamingParser<JSONFormat::Current>("{\"i\":-1}", serializable));
+    EXPECT_FALSE(ParseJSONViaStreamingParser<JSONFormat::Current>("{\"i\":1.0}", serializable));
+    EXPECT_FALSE(ParseJSONViaStreamingParser<JSONFormat::Current>("{}}", serializable));
+    try {
+      ParseJSON<Serializable>("{\"i\":1}");
+      ASSERT_TRUE(false);
+    } catch (const JSONSchemaException& e) {
+      EXPECT_EQ("Expected string for `s`, got: missing field.", e.OriginalDescription());
+    }
+  }
+}
+
 #endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_TEST_CC
@@ -1272,6 +1272,122 @@ TEST(TypeSystemTest, VariantSmokeTestMultipleTypes) {
   }
 }
 
+TEST(TypeSystemTest, VariantInlineAndHeapStorage) {
+  using namespace struct_definition_test;
+  using current::BypassVariantTypeCheck;
+
+  using variant_t = Variant<Foo, Baz>;
+  const auto is_inline = [](const variant_t& v, const void* value) {
+    const char* begin = reinterpret_cast<const char*>(&v);
+    const char* address = reinterpret_cast<const char*>(value);
+    return address >= begin && address < begin + sizeof(variant_t);
+  };
+
+  variant_t p(Foo(1u));
+  EXPECT_TRUE(is_inline(p, &Value<Foo>(p)));
+
+  variant_t q(std::move(p));
+  EXPECT_FALSE(Exists(p));
+  EXPECT_TRUE(is_inline(q, &Value<Foo>(q)));
+  EXPECT_EQ(1u, Value<Foo>(q).i);
+
+  // Assigning the value of a `Variant`, or its part, to the very `Variant`.
+  q = Value<Foo>(q);
+  EXPECT_EQ(1u, Value<Foo>(q).i);
+  const variant_t& cq = q;
+  q = cq;
+  EXPECT_EQ(1u, Value<Foo>(q).i);
+
+  q = Baz();
+  EXPECT_FALSE(is_inline(q, &Value<Baz>(q)));
+  Value<Baz>(q).v2.push_back(Foo(2u));
+  q = Value<Baz>(q).v2.front();
+  EXPECT_EQ(2u, Value<Foo>(q).i);
+
+  variant_t r(q);
+  EXPECT_TRUE(is_inline(r, &Value<Foo>(r)));
+  EXPECT_EQ(2u, Value<Foo>(q).i);
+  EXPECT_EQ(2u, Value<Foo>(r).i);
+
+  {
+    // A derived type, moved in unchecked, can be retrieved as its base type, but can not be `Call()`-ed upon.
+    Variant<Foo> d(BypassVariantTypeCheck(), std::make_unique<DerivedFromFoo>(3u));
+    EXPECT_EQ(3003u, Value<Foo>(d).i);
+    EXPECT_EQ(3003u, Value<DerivedFromFoo>(d).i);
+    const auto lambda = [](const Foo&) {};
+    EXPECT_THROW(d.Call(lambda), current::metaprogramming::UnlistedTypeException);
+    Variant<Foo> e(std::move(d));
+    EXPECT_FALSE(Exists(d));
+    EXPECT_EQ(3003u, Value<Foo>(e).i);
+  }
+
+  {
+    // A value moved in by its dynamic type is stored the very same way as if it was moved in typed.
+    Foo foo(4u);
+    current::variant::object_base_t& foo_base = foo;
+    variant_t f(BypassVariantTypeCheck(), std::move(foo_base));
+    EXPECT_TRUE(is_inline(f, &Value<Foo>(f)));
+    EXPECT_EQ(4u, Value<Foo>(f).i);
+    Baz baz;
+    baz.v2.push_back(Foo(5u));
+    current::variant::object_base_t& baz_base = baz;
+    variant_t g(BypassVariantTypeCheck(), std::move(baz_base));
+    EXPECT_FALSE(is_inline(g, &Value<Baz>(g)));
+    EXPECT_EQ(5u, Value<Baz>(g).v2.front().i);
+    EXPECT_TRUE(baz.v2.empty());
+    DerivedFromFoo derived(6u);
+    current::variant::object_base_t& derived_base = derived;
+    EXPECT_THROW(variant_t(BypassVariantTypeCheck(), std::move(derived_base)),
+                 IncompatibleVariantTypeException<current::variant::object_base_t>);
+  }
+}
+
+namespace struct_definition_test {
+CURRENT_FORWARD_DECLARE_STRUCT(VariantTreeNode);
+CURRENT_STRUCT(VariantTreeLeaf) { CURRENT_FIELD(s, std::string); };
+CURRENT_STRUCT(VariantTreeHeapLeaf) {
+  CURRENT_FIELD(s, std::string);
+  CURRENT_FIELD(t, std::string);
+  CURRENT_FIELD(u, std::string);
+};
+using variant_tree_t = Variant<VariantTreeNode, VariantTreeLeaf, VariantTreeHeapLeaf>;
+CURRENT_STRUCT(VariantTreeNode) { CURRENT_FIELD(children, std::vector<variant_tree_t>); };
+}  // namespace struct_definition_test
+
+TEST(TypeSystemTest, VariantMoveAssignFromItsOwnPart) {
+  using namespace struct_definition_test;
+
+  VariantTreeLeaf leaf;
+  leaf.s = std::string(100u, 'x');
+  VariantTreeNode inner;
+  inner.children.push_back(leaf);
+  VariantTreeNode outer;
+  outer.children.push_back(inner);
+  outer.children.push_back(leaf);
+
+  // Both the node and the leaf are stored inline, and the value moved in lives inside the very `Variant`.
+  variant_tree_t v(outer);
+  v = std::move(Value<VariantTreeNode>(v).children[0]);
+  ASSERT_EQ(1u, Value<VariantTreeNode>(v).children.size());
+  v = std::move(Value<VariantTreeNode>(v).children[0]);
+  EXPECT_EQ(std::string(100u, 'x'), Value<VariantTreeLeaf>(v).s);
+
+  // The value moved in is on the heap, and is taken over as is.
+  VariantTreeHeapLeaf heap_leaf;
+  heap_leaf.u = std::string(100u, 'y');
+  VariantTreeNode node;
+  node.children.push_back(heap_leaf);
+  v = node;
+  const VariantTreeHeapLeaf* const heap_leaf_ptr = &Value<VariantTreeHeapLeaf>(Value<VariantTreeNode>(v).children[0]);
+  v = std::move(Value<VariantTreeNode>(v).children[0]);
+  EXPECT_EQ(heap_leaf_ptr, &Value<VariantTreeHeapLeaf>(v));
+  EXPECT_EQ(std::string(100u, 'y'), Value<VariantTreeHeapLeaf>(v).u);
+
+  // The previous value is on the heap.
+  v = variant_tree_t(VariantTreeLeaf());
+  EXPECT_TRUE(Value<VariantTreeLeaf>(v).s.empty());
+}
+
 namespace struct_definition_test {
 CURRENT_STRUCT(WithTimestampUS) {
   CURRENT_FIELD(t, std::chrono::microseconds);
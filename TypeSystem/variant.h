@@ -34,7 +34,12 @@ SOFTWARE.
 
 #include "../port.h"  // `make_unique`.
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
 
 #ifdef VARIANT_CHECKS_AT_RUNTIME_INSTEAD_OF_COMPILE_TIME
 // For runtime, not compile-time, extra checks.
@@ -66,8 +71,50 @@ using object_base_t = CurrentSuper;
 
 struct BypassVariantTypeCheck {};
 
+// The values of the types that fit into `CURRENT_VARIANT_INLINE_STORAGE_SIZE` bytes, and can be moved without throwing,
+// are stored within the `Variant` itself. The values of larger types, and nested `Variant`-s, are heap-allocated.
+#ifndef CURRENT_VARIANT_INLINE_STORAGE_SIZE
+#define CURRENT_VARIANT_INLINE_STORAGE_SIZE 64
+#endif
+
 namespace variant {
 
+// The index of the type of the value held by a `Variant`, within its type list.
+using type_index_t = uint16_t;
+
+// The index of an empty `Variant`, and of a type not present in the type list.
+constexpr type_index_t npos = static_cast<type_index_t>(-1);
+
+// The index of a value moved into a `Variant` unchecked, the type of which is not present in the type list.
+// Only `Exists<>` and `Value<>` are supported for such values, and `Call()` throws, as it did before.
+constexpr type_index_t unlisted = static_cast<type_index_t>(-2);
+
+template <typename T, typename... TS>
+struct TypeIndex;
+
+template <typename T>
+struct TypeIndex<T> {
+  static constexpr type_index_t value = npos;
+};
+
+template <typename T, typename... TS>
+struct TypeIndex<T, T, TS...> {
+  static constexpr type_index_t value = 0u;
+};
+
+template <typename T, typename U, typename... TS>
+struct TypeIndex<T, U, TS...> {
+  static constexpr type_index_t value =
+      TypeIndex<T, TS...>::value == npos ? npos : static_cast<type_index_t>(TypeIndex<T, TS...>::value + 1u);
+};
+
+template <typename T>
+struct FitsInline {
+  static constexpr bool value = sizeof(T) <= CURRENT_VARIANT_INLINE_STORAGE_SIZE &&
+                                alignof(T) <= alignof(std::max_align_t) &&
+                                std::is_nothrow_move_constructible<T>::value;
+};
+
 #ifdef VARIANT_CHECKS_AT_RUNTIME_INSTEAD_OF_COMPILE_TIME
 template <typename T>
 struct RegisterType {
@@ -124,10 +171,10 @@ struct IHasUncheckedMoveFromUniquePtr : CurrentVariant {
 // The user hold the risk of having duplicate types, and it's their responsibility to pass in a `TypeList<...>`
 // instead of a `TypeListImpl<...>` in such a case, to ensure type de-duplication takes place.
 
-// Initializes an `std::unique_ptr<current::variant::object_base_t>` given the object of the right type.
-// The input object could be an object itself (in which case it's copied),
-// an `std::move()`-d `std::unique_ptr` to that object (in which case it's moved),
-// or a bare pointer (in which case it's captured).
+// The value is stored inline when it fits, and on the heap otherwise. Either way, `object_` points to it, and `index_`
+// is the index of its type in `TYPES...`, so that `Call()`, copies and moves dispatch via compile-time jump tables.
+// The RTTI is only used for the values moved in unchecked, via `BypassVariantTypeCheck` and deserialization,
+// and to retrieve a base type from a derived one in `VariantExistsImpl<>()` and `VariantValueImpl<>()`.
 template <typename NAME, typename TYPE_LIST>
 struct VariantImpl;
 
@@ -136,14 +183,27 @@ struct VariantImpl<NAME, TypeListImpl<TYPES...>> : IHasUncheckedMoveFromUniquePt
   using typelist_t = TypeListImpl<TYPES...>;
 
   static constexpr size_t typelist_size = typelist_t::size;
+  static_assert(typelist_size < variant::unlisted, "Too many types in a `Variant`.");
 
   template <typename OTHER_NAME, typename OTHER_TYPE_LIST>
   friend struct VariantImpl;
 
   VariantImpl() {}
 
-  VariantImpl(BypassVariantTypeCheck, std::unique_ptr<current::variant::object_base_t>&& rhs)
-      : object_(std::move(rhs)) {}
+  VariantImpl(BypassVariantTypeCheck, std::unique_ptr<current::variant::object_base_t>&& rhs) {
+    AdoptUnchecked(rhs.release());
+  }
+
+  // Moves the value in by its dynamic type, which must be in the type list, so that it is stored inline if it fits.
+  VariantImpl(BypassVariantTypeCheck, current::variant::object_base_t&& rhs) {
+    const variant::type_index_t index = DynamicTypeIndex(typeid(rhs));
+    if (index == variant::unlisted) {
+      CURRENT_THROW(IncompatibleVariantTypeException<current::variant::object_base_t>());
+    }
+    static void (*const construct[])(VariantImpl&, current::variant::object_base_t&) = {
+        &VariantImpl::MoveConstructOne<TYPES>...};
+    construct[index](*this, rhs);
+  }
 
   // Use deep copy helper for all Variant types, including our own.
   VariantImpl(const VariantImpl& rhs) { CopyFrom(rhs); }
@@ -152,8 +212,8 @@ struct VariantImpl<NAME, TypeListImpl<TYPES...>> : IHasUncheckedMoveFromUniquePt
     CopyFrom(rhs);
   }
 
-  // Default move constructor for the same Variant type as ours.
-  VariantImpl(VariantImpl&& rhs) = default;
+  // The move constructor for the same Variant type as ours, leaves `rhs` empty.
+  VariantImpl(VariantImpl&& rhs) noexcept { MoveFromSameType(rhs); }
 
 #ifdef VARIANT_CHECKS_AT_RUNTIME_INSTEAD_OF_COMPILE_TIME
   template <typename... RHS>
@@ -172,25 +232,56 @@ struct VariantImpl<NAME, TypeListImpl<TYPES...>> : IHasUncheckedMoveFromUniquePt
   VariantImpl(X&& input) {
     using decayed_t = current::decay<X>;
     variant::RuntimeTypeListHelpers<typelist_t>::template AssertContains<decayed_t>();
-    object_ = std::make_unique<decayed_t>(std::forward<X>(input));
+    Construct<decayed_t>(std::forward<X>(input));
   }
 #else
   template <typename X, class ENABLE = std::enable_if_t<TypeListContains<typelist_t, current::decay<X>>::value>>
   VariantImpl(X&& input) {
     using decayed_t = current::decay<X>;
-    object_ = std::make_unique<decayed_t>(std::forward<X>(input));
+    Construct<decayed_t>(std::forward<X>(input));
   }
 #endif  // VARIANT_CHECKS_AT_RUNTIME_INSTEAD_OF_COMPILE_TIME
 
-  void operator=(std::nullptr_t) { object_ = nullptr; }
+  ~VariantImpl() { Reset(); }
+
+  void operator=(std::nullptr_t) { Reset(); }
 
   VariantImpl& operator=(const VariantImpl& rhs) {
-    CopyFrom(rhs);
+    if (rhs.object_) {
+      TypeAwareClone cloner(*this);
+      rhs.Call(cloner);
+    } else {
+      Reset();
+    }
     return *this;
   }
 
   VariantImpl& operator=(VariantImpl&& rhs) {
-    object_ = std::move(rhs.object_);
+    if (&rhs != this) {
+      // The previous value is destroyed only once `rhs` is no longer needed, as `rhs` may be part of it.
+      if (!object_) {
+        MoveFromSameType(rhs);
+      } else if (!is_inline_) {
+        std::unique_ptr<current::variant::object_base_t> previous(object_);
+        object_ = nullptr;
+        index_ = variant::npos;
+        MoveFromSameType(rhs);
+      } else if (!rhs.object_ || !rhs.is_inline_) {
+        current::variant::object_base_t* const object = rhs.object_;
+        const variant::type_index_t index = rhs.index_;
+        rhs.object_ = nullptr;
+        rhs.index_ = variant::npos;
+        Reset();
+        object_ = object;
+        index_ = index;
+        is_inline_ = false;
+      } else {
+        // Both values are inline, so `rhs` is moved into a temporary before the previous value is destroyed.
+        VariantImpl value(std::move(rhs));
+        Reset();
+        MoveFromSameType(value);
+      }
+    }
     return *this;
   }
 
@@ -204,31 +295,40 @@ struct VariantImpl<NAME, TypeListImpl<TYPES...>> : IHasUncheckedMoveFromUniquePt
 #ifdef VARIANT_CHECKS_AT_RUNTIME_INSTEAD_OF_COMPILE_TIME
     variant::RuntimeTypeListHelpers<typelist_t>::template AssertContains<decayed_t>();
 #endif  // VARIANT_CHECKS_AT_RUNTIME_INSTEAD_OF_COMPILE_TIME
-    object_ = std::make_unique<decayed_t>(std::forward<X>(input));
+    Emplace<decayed_t>(std::forward<X>(input));
     return *this;
   }
 
   void UncheckedMoveFromUniquePtr(std::unique_ptr<current::variant::object_base_t> input) override {
-    object_ = std::move(input);
+    Reset();
+    AdoptUnchecked(input.release());
   }
 
   operator bool() const { return object_ ? true : false; }
 
   template <typename F>
   void Call(F&& f) {
-    if (object_) {
+    if (!object_) {
+      CURRENT_THROW(UninitializedVariantOfTypeException<TYPES...>());
+    } else if (index_ == variant::unlisted) {
       current::metaprogramming::RTTIDynamicCall<typelist_t>(*object_, std::forward<F>(f));
     } else {
-      CURRENT_THROW(UninitializedVariantOfTypeException<TYPES...>());
+      static void (*const dispatch[])(current::variant::object_base_t&, F&) = {&VariantImpl::CallOne<F, TYPES>...};
+      dispatch[index_](*object_, f);
     }
   }
 
   template <typename F>
   void Call(F&& f) const {
-    if (object_) {
-      current::metaprogramming::RTTIDynamicCall<typelist_t>(*object_, std::forward<F>(f));
-    } else {
+    if (!object_) {
       CURRENT_THROW(UninitializedVariantOfTypeException<TYPES...>());
+    } else if (index_ == variant::unlisted) {
+      current::metaprogramming::RTTIDynamicCall<typelist_t>(
+          static_cast<const current::variant::object_base_t&>(*object_), std::forward<F>(f));
+    } else {
+      static void (*const dispatch[])(const current::variant::object_base_t&, F&) = {
+          &VariantImpl::CallOneConst<F, TYPES>...};
+      dispatch[index_](*object_, f);
     }
   }
 
@@ -237,17 +337,21 @@ struct VariantImpl<NAME, TypeListImpl<TYPES...>> : IHasUncheckedMoveFromUniquePt
   // and thus will successfully retrieve a derived type as a base one,
   // regardless of whether the base one is present in `typelist_t`.
   // Use `Call()` to run a strict check.
+  // If the value is exactly of type `X`, it is returned without the `dynamic_cast<>`.
 
-  bool ExistsImpl() const { return (object_.get() != nullptr); }
+  bool ExistsImpl() const { return (object_ != nullptr); }
 
   template <typename X>
   std::enable_if_t<!std::is_same<X, current::variant::object_base_t>::value, bool> VariantExistsImpl() const {
-    return dynamic_cast<const X*>(object_.get()) != nullptr;
+    return ExactValuePtr<X>() != nullptr || dynamic_cast<const X*>(object_) != nullptr;
   }
 
   template <typename X>
   std::enable_if_t<!std::is_same<X, current::variant::object_base_t>::value, X&> VariantValueImpl() {
-    X* ptr = dynamic_cast<X*>(object_.get());
+    X* ptr = ExactValuePtr<X>();
+    if (!ptr) {
+      ptr = dynamic_cast<X*>(object_);
+    }
     if (ptr) {
       return *ptr;
     } else {
@@ -257,7 +361,10 @@ struct VariantImpl<NAME, TypeListImpl<TYPES...>> : IHasUncheckedMoveFromUniquePt
 
   template <typename X>
   const X& VariantValueImpl() const {
-    const X* ptr = dynamic_cast<const X*>(object_.get());
+    const X* ptr = ExactValuePtr<X>();
+    if (!ptr) {
+      ptr = dynamic_cast<const X*>(object_);
+    }
     if (ptr) {
       return *ptr;
     } else {
@@ -275,21 +382,154 @@ struct VariantImpl<NAME, TypeListImpl<TYPES...>> : IHasUncheckedMoveFromUniquePt
   }
 
  private:
+  template <typename F, typename T>
+  static void CallOne(current::variant::object_base_t& object, F& f) {
+    f(static_cast<T&>(object));
+  }
+
+  template <typename T>
+  static void MoveConstructOne(VariantImpl& self, current::variant::object_base_t& object) {
+    self.template Construct<T>(std::move(static_cast<T&>(object)));
+  }
+
+  template <typename F, typename T>
+  static void CallOneConst(const current::variant::object_base_t& object, F& f) {
+    f(static_cast<const T&>(object));
+  }
+
+  template <typename T>
+  static std::enable_if_t<variant::FitsInline<T>::value, current::variant::object_base_t*> MoveInline(
+      current::variant::object_base_t& from, void* into) {
+    return ::new (into) T(std::move(static_cast<T&>(from)));
+  }
+
+  // Never called, as the values of such types are always on the heap.
+  template <typename T>
+  static std::enable_if_t<!variant::FitsInline<T>::value, current::variant::object_base_t*> MoveInline(
+      current::variant::object_base_t&, void*) {
+    return nullptr;  // LCOV_EXCL_LINE
+  }
+
+  template <typename X>
+  std::enable_if_t<variant::TypeIndex<X, TYPES...>::value != variant::npos, X*> ExactValuePtr() const {
+    return (object_ && index_ == variant::TypeIndex<X, TYPES...>::value) ? static_cast<X*>(object_) : nullptr;
+  }
+
+  template <typename X>
+  std::enable_if_t<variant::TypeIndex<X, TYPES...>::value == variant::npos, X*> ExactValuePtr() const {
+    return nullptr;
+  }
+
+  static variant::type_index_t DynamicTypeIndex(const std::type_info& type) {
+    static const std::type_info* const types[] = {&typeid(TYPES)...};
+    for (size_t i = 0; i < typelist_size; ++i) {
+      if (*types[i] == type) {
+        return static_cast<variant::type_index_t>(i);
+      }
+    }
+    return variant::unlisted;
+  }
+
+  // Requires the `Variant` to be empty.
+  void AdoptUnchecked(current::variant::object_base_t* object) {
+    if (object) {
+      object_ = object;
+      index_ = DynamicTypeIndex(typeid(*object));
+      is_inline_ = false;
+    }
+  }
+
+  // Requires the `Variant` to be empty.
+  template <typename T, typename... ARGS>
+  std::enable_if_t<variant::FitsInline<T>::value> Construct(ARGS&&... args) {
+    object_ = ::new (&storage_) T(std::forward<ARGS>(args)...);
+    index_ = variant::TypeIndex<T, TYPES...>::value;
+    is_inline_ = true;
+  }
+
+  template <typename T, typename... ARGS>
+  std::enable_if_t<!variant::FitsInline<T>::value> Construct(ARGS&&... args) {
+    object_ = new T(std::forward<ARGS>(args)...);
+    index_ = variant::TypeIndex<T, TYPES...>::value;
+    is_inline_ = false;
+  }
+
+  // Replaces the value of the `Variant`. The new value is constructed before the previous one is destroyed,
+  // as `args` may refer to the previous value or to its part. If the construction throws, the `Variant` is unchanged.
+  template <typename T, typename... ARGS>
+  std::enable_if_t<variant::FitsInline<T>::value> Emplace(ARGS&&... args) {
+    if (!object_) {
+      Construct<T>(std::forward<ARGS>(args)...);
+    } else if (!is_inline_) {
+      current::variant::object_base_t* value = ::new (&storage_) T(std::forward<ARGS>(args)...);
+      delete object_;
+      object_ = value;
+      index_ = variant::TypeIndex<T, TYPES...>::value;
+      is_inline_ = true;
+    } else {
+      T value(std::forward<ARGS>(args)...);
+      Reset();
+      Construct<T>(std::move(value));
+    }
+  }
+
+  template <typename T, typename... ARGS>
+  std::enable_if_t<!variant::FitsInline<T>::value> Emplace(ARGS&&... args) {
+    std::unique_ptr<T> value(new T(std::forward<ARGS>(args)...));
+    Reset();
+    object_ = value.release();
+    index_ = variant::TypeIndex<T, TYPES...>::value;
+    is_inline_ = false;
+  }
+
+  void Reset() {
+    if (object_) {
+      if (is_inline_) {
+        using object_base_t = current::variant::object_base_t;
+        object_->~object_base_t();  // The destructor is virtual.
+      } else {
+        delete object_;
+      }
+      object_ = nullptr;
+      index_ = variant::npos;
+    }
+  }
+
+  // Requires the `Variant` to be empty.
+  void MoveFromSameType(VariantImpl& rhs) noexcept {
+    if (rhs.object_) {
+      if (rhs.is_inline_) {
+        static current::variant::object_base_t* (*const move[])(current::variant::object_base_t&, void*) = {
+            &VariantImpl::MoveInline<TYPES>...};
+        object_ = move[rhs.index_](*rhs.object_, &storage_);
+        index_ = rhs.index_;
+        is_inline_ = true;
+        rhs.Reset();
+      } else {
+        object_ = rhs.object_;
+        index_ = rhs.index_;
+        is_inline_ = false;
+        rhs.object_ = nullptr;
+        rhs.index_ = variant::npos;
+      }
+    }
+  }
+
   struct TypeAwareClone {
-    std::unique_ptr<current::variant::object_base_t>& into;
-    TypeAwareClone(std::unique_ptr<current::variant::object_base_t>& into) : into(into) {}
+    VariantImpl& into;
+    TypeAwareClone(VariantImpl& into) : into(into) {}
 
 #ifdef VARIANT_CHECKS_AT_RUNTIME_INSTEAD_OF_COMPILE_TIME
     template <typename U>
     void operator()(const U& instance) {
       using decayed_u = current::decay<U>;
       variant::RuntimeTypeListHelpers<typelist_t>::template AssertContains<decayed_u>();
-      into = std::make_unique<decayed_u>(instance);
+      into.template Emplace<decayed_u>(instance);
     }
 #else
     template <typename U>
     std::enable_if_t<TypeListContains<typelist_t, current::decay<U>>::value> operator()(const U& instance) {
-      into = std::make_unique<current::decay<U>>(instance);
+      into.template Emplace<current::decay<U>>(instance);
     }
 
     template <typename U>
@@ -299,56 +539,71 @@ struct VariantImpl<NAME, TypeListImpl<TYPES...>> : IHasUncheckedMoveFromUniquePt
 #endif  // VARIANT_CHECKS_AT_RUNTIME_INSTEAD_OF_COMPILE_TIME
   };
 
+  template <typename RHS_VARIANT>
   struct TypeAwareMove {
     // `from` should not be an rvalue reference, as the move operation in `operator()` may still throw.
-    std::unique_ptr<current::variant::object_base_t>& from;
-    std::unique_ptr<current::variant::object_base_t>& into;
-    TypeAwareMove(std::unique_ptr<current::variant::object_base_t>& from,
-                  std::unique_ptr<current::variant::object_base_t>& into)
-        : from(from), into(into) {}
+    RHS_VARIANT& from;
+    VariantImpl& into;
+    TypeAwareMove(RHS_VARIANT& from, VariantImpl& into) : from(from), into(into) {}
 
 #ifdef VARIANT_CHECKS_AT_RUNTIME_INSTEAD_OF_COMPILE_TIME
     template <typename U>
-    void operator()(U&&) {
+    void operator()(U& instance) {
       using decayed_u = current::decay<U>;
       variant::RuntimeTypeListHelpers<typelist_t>::template AssertContains<decayed_u>();
-      into = std::move(from);
+      Move<decayed_u>(instance);
     }
 #else
     template <typename U>
-    std::enable_if_t<TypeListContains<typelist_t, current::decay<U>>::value> operator()(U&&) {
-      into = std::move(from);
+    std::enable_if_t<TypeListContains<typelist_t, current::decay<U>>::value> operator()(U& instance) {
+      Move<current::decay<U>>(instance);
     }
 
     template <typename U>
-    std::enable_if_t<!TypeListContains<typelist_t, current::decay<U>>::value> operator()(U&&) {
+    std::enable_if_t<!TypeListContains<typelist_t, current::decay<U>>::value> operator()(U&) {
       CURRENT_THROW(IncompatibleVariantTypeException<current::decay<U>>());
     }
 #endif  // VARIANT_CHECKS_AT_RUNTIME_INSTEAD_OF_COMPILE_TIME
+
+    // A heap-allocated value is handed over as is, an inline one is moved, and `from` is left empty either way.
+    template <typename T>
+    void Move(T& instance) {
+      if (from.is_inline_) {
+        into.template Construct<T>(std::move(instance));
+        from.Reset();
+      } else {
+        into.object_ = from.object_;
+        into.index_ = variant::TypeIndex<T, TYPES...>::value;
+        into.is_inline_ = false;
+        from.object_ = nullptr;
+        from.index_ = variant::npos;
+      }
+    }
   };
 
+  // Requires the `Variant` to be empty.
   template <typename... RHS>
   void CopyFrom(const VariantImpl<RHS...>& rhs) {
     if (rhs.object_) {
-      TypeAwareClone cloner(object_);
+      TypeAwareClone cloner(*this);
       rhs.Call(cloner);
-    } else {
-      object_ = nullptr;
     }
   }
 
+  // Requires the `Variant` to be empty.
   template <typename... RHS>
   void MoveFrom(VariantImpl<RHS...>&& rhs) {
     if (rhs.object_) {
-      TypeAwareMove mover(rhs.object_, object_);
+      TypeAwareMove<VariantImpl<RHS...>> mover(rhs, *this);
       rhs.Call(mover);
-    } else {
-      object_ = nullptr;
     }
   }
 
  private:
-  std::unique_ptr<current::variant::object_base_t> object_;
+  typename std::aligned_storage<CURRENT_VARIANT_INLINE_STORAGE_SIZE, alignof(std::max_align_t)>::type storage_;
+  current::variant::object_base_t* object_ = nullptr;
+  variant::type_index_t index_ = variant::npos;
+  bool is_inline_ = false;
 };
 
 // `Variant<...>` can accept either a list of types, or a `TypeList<...>`.
@@ -31,9 +31,16 @@ using namespace current;
 
 DEFINE_string(benchmark_local_route, "/add", "The route spawn the server on.");
 DEFINE_int32(benchmark_local_port, PickPortForUnitTest(), "The local port to spawn the server on.");
+DEFINE_uint64(benchmark_workers, 0u, "The number of worker threads to serve requests from, zero for none.");
+DEFINE_uint64(benchmark_max_queue_depth, 1024u, "The maximum number of connections waiting for a worker thread.");
+DEFINE_uint64(benchmark_handler_us, 0u, "The time, in microseconds, for the `/add` handler to sleep for.");
 
 int main(int argc, char** argv) {
   ParseDFlags(&argc, &argv);
 
-  BenchmarkTestServer(FLAGS_benchmark_local_port, FLAGS_benchmark_local_route).Join();
+  BenchmarkTestServer(FLAGS_benchmark_local_port,
+                      FLAGS_benchmark_local_route,
+                      static_cast<size_t>(FLAGS_benchmark_workers),
+                      static_cast<size_t>(FLAGS_benchmark_max_queue_depth),
+                      std::chrono::microseconds(FLAGS_benchmark_handler_us)).Join();
 }
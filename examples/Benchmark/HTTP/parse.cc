@@ -0,0 +1,98 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// Measures the cost of parsing an HTTP request, with no network involved: the message is passed to the parser as if
+// it was pipelined after the previous one, so that no bytes are read from the socket.
+//
+// Reports the time and the number of heap allocations per request, both when only the method and the path are
+// looked at, as the router does, and when the URL, the headers, and the body are all accessed.
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "../../../current.h"
+
+using namespace current;
+
+DEFINE_int32(port, PickPortForUnitTest(), "The local port to open the connection to parse the requests from.");
+DEFINE_int32(n, 1000000, "The number of requests to parse in each mode.");
+DEFINE_int32(headers, 12, "The number of extra `X-Header-*` headers in the request.");
+DEFINE_int32(body_length, 64, "The length of the body of the request.");
+
+static std::atomic_size_t allocations(0u);
+
+void* operator new(size_t size) {
+  ++allocations;
+  void* p = std::malloc(size ? size : 1u);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+  ParseDFlags(&argc, &argv);
+
+  std::string message = "POST /api/v1/users/42/profile?fields=name,email&format=json HTTP/1.1\r\n";
+  message += "Host: localhost\r\n";
+  message += "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n";
+  message += "Accept: application/json\r\n";
+  message += "Cookie: session=0123456789abcdef; theme=dark\r\n";
+  for (int i = 0; i < FLAGS_headers; ++i) {
+    message += strings::Printf("X-Header-%d: value-%d\r\n", i, i);
+  }
+  message += "Content-Length: " + current::ToString(FLAGS_body_length) + "\r\n\r\n";
+  message += std::string(FLAGS_body_length, 'x');
+  const std::vector<char> pipelined_data(message.begin(), message.end());
+
+  // The parser needs a connection, even though it will never read from it.
+  net::Socket socket(FLAGS_port);
+  net::Connection client(net::ClientSocket("localhost", FLAGS_port));
+  net::Connection server(socket.Accept());
+
+  const auto Run = [&](const char* name, bool materialize) {
+    size_t checksum = 0u;
+    const size_t allocations_before = allocations;
+    const auto begin = time::Now();
+    for (int i = 0; i < FLAGS_n; ++i) {
+      const net::HTTPRequestData request(
+          server, net::HTTPRequestData::ConstructionParams(), 16 * 1024 + 1, 1.95, pipelined_data);
+      checksum += request.Method().length() + request.RawPathView().length();
+      if (materialize) {
+        checksum += request.URL().path.length() + request.headers().size() + request.Body().length();
+      }
+    }
+    const auto end = time::Now();
+    std::cout << name << ": " << strings::Printf("%.1lf", 1e3 * (end - begin).count() / FLAGS_n) << " ns and "
+              << strings::Printf("%.1lf", static_cast<double>(allocations - allocations_before) / FLAGS_n)
+              << " allocations per request, checksum " << checksum << std::endl;
+  };
+
+  std::cout << message.length() << " bytes per request, " << FLAGS_n << " requests." << std::endl;
+  Run("Method and path only", false);
+  Run("URL, headers, and body", true);
+}
@@ -0,0 +1,28 @@
+#!/bin/bash
+
+# Runs the "A+B over HTTP" benchmark against the number of worker threads of the HTTP server,
+# with the handler emulating waiting on I/O for `HANDLER_US` microseconds. Zero workers stands for the default mode,
+# where the requests are served from the listening thread.
+
+HANDLER_US=${HANDLER_US:-1000}
+PORT=${PORT:-18080}
+
+for BINARY in binary benchmark ; do
+  if [ ! -f .current/$BINARY ] ; then
+    echo "Building '.current/$BINARY' to run the tests. You may want to check the compilation flags."
+    make .current/$BINARY
+  fi
+done
+
+for WORKERS in 0 1 2 4 8 16 32 ; do
+  ./.current/binary \
+    --benchmark_local_port=$PORT \
+    --benchmark_workers=$WORKERS \
+    --benchmark_handler_us=$HANDLER_US &
+  SERVER_PID=$!
+  while ! curl -s localhost:$PORT/perftest >/dev/null ; do sleep 0.1 ; done
+  echo -n "workers=$WORKERS,handler_us=$HANDLER_US : "
+  ./.current/benchmark --port=$PORT --threads=64 --seconds=2
+  kill $SERVER_PID
+  wait $SERVER_PID 2>/dev/null
+done
@@ -32,16 +32,27 @@ CURRENT_STRUCT(AddResult) {
   CURRENT_CONSTRUCTOR(AddResult)(int64_t sum = 0) : sum(sum) {}
 };
 
+// With `workers > 0`, requests are served from a pool of worker threads instead of from the listening thread.
+// A non-zero `handler_time` makes the `/add` handler sleep for that long, to emulate handlers that wait on I/O.
 class BenchmarkTestServer {
  public:
-  BenchmarkTestServer(int port, const std::string& route)
+  BenchmarkTestServer(int port,
+                      const std::string& route,
+                      size_t workers = 0u,
+                      size_t max_queue_depth = 1024u,
+                      std::chrono::microseconds handler_time = std::chrono::microseconds(0))
       : port_(port),
         scope_(HTTP(port).Register(route,
-                                   [](Request r) {
+                                   [handler_time](Request r) {
+                                     if (handler_time.count()) {
+                                       std::this_thread::sleep_for(handler_time);
+                                     }
                                      r(AddResult(current::FromString<int64_t>(r.url.query["a"]) +
                                                  current::FromString<int64_t>(r.url.query["b"])));
                                    }) +
-               HTTP(port).Register("/perftest", [](Request r) { r("perftest ok\n"); })) {}
+               HTTP(port).Register("/perftest", [](Request r) { r("perftest ok\n"); })) {
+    HTTP(port).UseWorkerPool(current::http::HTTPServerWorkerPoolParams(workers, max_queue_depth));
+  }
 
   void Join() { HTTP(port_).Join(); }
 
@@ -28,6 +28,9 @@ SOFTWARE.
 #include "../../../3rdparty/gtest/gtest-main-with-dflags.h"
 
 DEFINE_int32(benchmark_test_local_port, PickPortForUnitTest(), "The local port to spawn test server on.");
+DEFINE_int32(benchmark_test_local_port_worker_pool,
+             PickPortForUnitTest(),
+             "The local port to spawn test server with a worker pool on.");
 
 TEST(BenchmarkTest, OneAndOne) {
   BenchmarkTestServer server(FLAGS_benchmark_test_local_port, "/add");
@@ -42,3 +45,11 @@ TEST(BenchmarkTest, TenAndTen) {
   EXPECT_EQ(200, static_cast<int>(response.code));
   EXPECT_EQ(20, ParseJSON<AddResult>(response.body).sum);
 }
+
+TEST(BenchmarkTest, WorkerPool) {
+  BenchmarkTestServer server(FLAGS_benchmark_test_local_port_worker_pool, "/add", 4u);
+  const auto response =
+      HTTP(GET(Printf("http://localhost:%d/add?a=100&b=100", FLAGS_benchmark_test_local_port_worker_pool)));
+  EXPECT_EQ(200, static_cast<int>(response.code));
+  EXPECT_EQ(200, ParseJSON<AddResult>(response.body).sum);
+}
@@ -17,6 +17,9 @@ DEFINE_uint16(subs_range, 25, "For batch test, iterate from zero to this number
 DEFINE_string(json, ".current/result.json", "The name of the file to write the benchmark result as JSON.");
 DEFINE_string(png, ".current/result.png", "The name of the file to write the benchmark resuls as PNG.");
 
+DEFINE_bool(cold_start, false, "Set to measure the cold start time of the storage, with and without a snapshot.");
+DEFINE_string(snapshots, ".current/snapshot", "The path prefix of the storage snapshot files for `--cold_start`.");
+
 inline void GenerateTestData(const std::string& file, uint32_t size) {
   current::FileSystem::RmFile(file, current::FileSystem::RmFileParameters::Silent);
   storage_t storage(file);
@@ -233,10 +236,53 @@ inline void PerformReplayBenchmark(const std::string& file,
   }
 }
 
+inline void PerformColdStartBenchmark(const std::string& file, const std::string& snapshots_path) {
+  using current::storage::persister::StorageSnapshots;
+  using current::storage::persister::impl::ListStorageSnapshots;
+
+  for (const auto& snapshot : ListStorageSnapshots(snapshots_path)) {
+    current::FileSystem::RmFile(snapshot.second);
+  }
+
+  size_t storage_size = 0u;
+  const auto get_size = [&storage_size](ImmutableFields<storage_t> fields) { storage_size = fields.entries.Size(); };
+
+  {
+    const auto begin = current::time::Now();
+    storage_t storage(file);
+    const auto end = current::time::Now();
+    storage.ReadOnlyTransaction(get_size).Go();
+    std::cout << "* Cold start, full replay: " << (end - begin).count() / 1000 << " ms, " << storage_size
+              << " entries." << std::endl;
+  }
+
+  {
+    const auto begin = current::time::Now();
+    {
+      storage_t storage(StorageSnapshots(snapshots_path, 0u, 1u), file);
+      storage.Persister().TakeSnapshot();
+    }
+    const auto end = current::time::Now();
+    std::cout << "* Taking the snapshot: " << (end - begin).count() / 1000 << " ms, including the full replay."
+              << std::endl;
+  }
+
+  {
+    const auto begin = current::time::Now();
+    storage_t storage(StorageSnapshots(snapshots_path, 0u, 1u), file);
+    const auto end = current::time::Now();
+    storage.ReadOnlyTransaction(get_size).Go();
+    std::cout << "* Cold start, from the snapshot: " << (end - begin).count() / 1000 << " ms, " << storage_size
+              << " entries." << std::endl;
+  }
+}
+
 int main(int argc, char** argv) {
   ParseDFlags(&argc, &argv);
   if (FLAGS_gen) {
     GenerateTestData(FLAGS_file, FLAGS_gen);
+  } else if (FLAGS_cold_start) {
+    PerformColdStartBenchmark(FLAGS_file, FLAGS_snapshots);
   } else {
     Report report;
     if (FLAGS_subs) {
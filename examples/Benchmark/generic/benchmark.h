@@ -34,6 +34,13 @@ SOFTWARE.
 
 #include "../../../Bricks/util/singleton.h"
 
+// The number of heap allocations made by the current thread, for the scenarios to report allocations per query.
+// Counted by the `operator new` replaced in `run.cc`, and stays zero elsewhere.
+inline size_t& ThreadHeapAllocations() {
+  static thread_local size_t allocations = 0u;
+  return allocations;
+}
+
 struct Scenario {
   virtual ~Scenario() = default;
 
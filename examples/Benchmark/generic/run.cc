@@ -22,17 +22,35 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 *******************************************************************************/
 
+#include <cstdlib>
+#include <new>
+
 #include "../../../current.h"
 
 #include "scenario_golden_1k_qps.h"
 #include "scenario_json.h"
+#include "scenario_variant.h"
+#include "scenario_replay.h"
 #include "scenario_simple_http.h"
 #include "scenario_storage.h"
 #include "scenario_nginx_client.h"
 #include "scenario_replication.h"
+#include "scenario_memory_persister.h"
+#include "scenario_follower.h"
 
 using namespace current;
 
+// Counts the heap allocations per thread, see `ThreadHeapAllocations()`.
+void* operator new(size_t size) {
+  ++ThreadHeapAllocations();
+  if (void* result = std::malloc(size ? size : 1u)) {
+    return result;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
 DEFINE_string(scenario, "", "Benchmarking scenario to run. Leave empty for synopsis.");
 
 DEFINE_double(seconds, 2.5, "Run the load test for this many seconds.");
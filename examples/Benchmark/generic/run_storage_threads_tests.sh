@@ -0,0 +1,23 @@
+#!/bin/bash
+
+# Runs storage read-mostly performance tests against the number of threads,
+# comparing the default `Synchronous` transaction policy with `SynchronousWithSharedReads`.
+
+if [ ! -f .current/run ] ; then
+  echo "Building '.current/run' to run the tests. You may want to check the compilation flags."
+  make .current/run
+fi
+
+for SCENARIO in storage storage_shared_reads ; do
+  for STORAGE_TRANSACTION in get mixed ; do
+    for THREADS in 1 2 4 8 16 32 ; do
+      echo -n "$SCENARIO,$STORAGE_TRANSACTION,threads=$THREADS : "
+      ./.current/run \
+        --scenario=$SCENARIO \
+        --storage_transaction=$STORAGE_TRANSACTION \
+        --storage_initial_size=50000 \
+        --threads=$THREADS \
+        --seconds=2
+    done
+  done
+done
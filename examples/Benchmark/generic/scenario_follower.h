@@ -0,0 +1,95 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef BENCHMARK_SCENARIO_FOLLOWER_H
+#define BENCHMARK_SCENARIO_FOLLOWER_H
+
+#include "../../../port.h"
+
+#include <thread>
+
+#include "../../../Sherlock/replicator.h"
+#include "../../../Sherlock/sherlock.h"
+#include "../../../TypeSystem/struct.h"
+
+#include "benchmark.h"
+
+#include "../../../Bricks/dflags/dflags.h"
+#include "../../../Bricks/file/file.h"
+
+#ifndef CURRENT_MAKE_CHECK_MODE
+DEFINE_uint32(follower_entries, 10000, "The number of entries the follower applies per query.");
+DEFINE_uint32(follower_batch, 1000, "The maximum number of entries passed to the follower at once, 1 for per-entry.");
+DEFINE_bool(follower_fdatasync, false, "Set to `fdatasync()` each batch the follower writes into its file.");
+#else
+DECLARE_uint32(follower_entries);
+DECLARE_uint32(follower_batch);
+DECLARE_bool(follower_fdatasync);
+#endif
+
+CURRENT_STRUCT(FollowerBenchmarkEntry) {
+  CURRENT_FIELD(key, std::string);
+  CURRENT_FIELD(value, uint64_t, 0u);
+};
+
+// Each query replicates the whole in-memory stream into a new file-persisted stream via `StreamReplicator`,
+// the way a follower applies the entries of its leader.
+SCENARIO(stream_follower, "Replicate `--follower_entries` entries into a file-persisted follower stream.") {
+  using source_t = current::sherlock::Stream<FollowerBenchmarkEntry>;
+  using follower_t = current::sherlock::Stream<FollowerBenchmarkEntry, current::persistence::File>;
+
+  source_t source;
+
+  stream_follower() {
+    for (uint32_t i = 0u; i < FLAGS_follower_entries; ++i) {
+      FollowerBenchmarkEntry entry;
+      entry.key = "key" + current::ToString(i);
+      entry.value = i;
+      source.Publish(std::move(entry), std::chrono::microseconds(i + 1u));
+    }
+  }
+
+  void RunOneQuery() override {
+    const std::string filename = current::FileSystem::GenTmpFileName();
+    const auto file_remover = current::FileSystem::ScopedRmFile(filename);
+    follower_t follower(filename,
+                        current::persistence::FilePersisterGroupCommit(
+                            FLAGS_follower_batch,
+                            std::chrono::microseconds(0),
+                            FLAGS_follower_fdatasync ? current::persistence::FilePersisterDurability::FDataSync
+                                                     : current::persistence::FilePersisterDurability::Flush));
+    current::sherlock::StreamReplicator<follower_t> replicator(follower);
+    replicator.SetBatching(current::ss::SubscriberBatching(FLAGS_follower_batch));
+    {
+      const auto scope = source.Subscribe(replicator);
+      while (follower.Persister().Size() < FLAGS_follower_entries) {
+        std::this_thread::yield();
+      }
+    }
+  }
+};
+
+REGISTER_SCENARIO(stream_follower);
+
+#endif  // BENCHMARK_SCENARIO_FOLLOWER_H
@@ -30,6 +30,7 @@ SOFTWARE.
 #include "../../../TypeSystem/struct.h"
 #include "../../../TypeSystem/variant.h"
 #include "../../../TypeSystem/Serialization/json.h"
+#include "../../../TypeSystem/Serialization/binary.h"
 
 #include "benchmark.h"
 
@@ -37,8 +38,10 @@ SOFTWARE.
 
 #ifndef CURRENT_MAKE_CHECK_MODE
 DEFINE_string(json, "gen", "JSON action to take in the performance test, gen/parse/both.");
+DEFINE_string(binary, "gen", "Binary action to take in the performance test, gen/parse/both.");
 #else
 DECLARE_string(json);
+DECLARE_string(binary);
 #endif
 
 CURRENT_STRUCT(InnerLevelA) {
@@ -195,4 +198,34 @@ SCENARIO(json, "JSON performance test.") {
 
 REGISTER_SCENARIO(json);
 
+// Same as `json`, but using the binary format, on the very same object.
+SCENARIO(binary, "Binary serialization performance test.") {
+  const TopLevel test_object;
+  const std::string test_object_binary;
+  constexpr static size_t test_object_binary_golden_length = 7169;
+  std::function<void()> f;
+
+  binary() : test_object(), test_object_binary(Binary(test_object)) {
+    if (test_object_binary.length() != test_object_binary_golden_length) {
+      std::cerr << "Actual binary length: " << test_object_binary.length() << ", expected "
+                << test_object_binary_golden_length << std::endl;
+      CURRENT_ASSERT(false);
+    }
+    if (FLAGS_binary == "gen") {
+      f = [this]() { Binary(test_object); };
+    } else if (FLAGS_binary == "parse") {
+      f = [this]() { ParseBinary<TopLevel>(test_object_binary); };
+    } else if (FLAGS_binary == "both") {
+      f = [this]() { ParseBinary<TopLevel>(Binary(test_object)); };
+    } else {
+      std::cerr << "The `--binary` flag must be 'gen', 'parse', or 'both'." << std::endl;
+      CURRENT_ASSERT(false);
+    }
+  }
+
+  void RunOneQuery() override { f(); }
+};
+
+REGISTER_SCENARIO(binary);
+
 #endif  // BENCHMARK_SCENARIO_JSON_H
@@ -0,0 +1,99 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef BENCHMARK_SCENARIO_MEMORY_PERSISTER_H
+#define BENCHMARK_SCENARIO_MEMORY_PERSISTER_H
+
+#include "../../../port.h"
+
+#include <atomic>
+#include <thread>
+
+#include "../../../Blocks/Persistence/memory.h"
+#include "../../../TypeSystem/struct.h"
+
+#include "benchmark.h"
+
+#include "../../../Bricks/dflags/dflags.h"
+
+#ifndef CURRENT_MAKE_CHECK_MODE
+DEFINE_uint32(memory_readers_entries, 1000, "The number of most recent entries each query iterates over.");
+DEFINE_uint32(memory_readers_publish_batch, 1000, "The number of entries the publisher adds between 1ms pauses.");
+#else
+DECLARE_uint32(memory_readers_entries);
+DECLARE_uint32(memory_readers_publish_batch);
+#endif
+
+CURRENT_STRUCT(MemoryPersisterBenchmarkEntry) { CURRENT_FIELD(value, uint64_t, 0u); };
+
+// Each query iterates over the most recent entries of an in-memory stream, while a single thread keeps publishing
+// into it. The `--threads` flag sets the number of concurrent readers.
+SCENARIO(memory_readers, "Read the last `--memory_readers_entries` of a `MemoryPersister` as it is published to.") {
+  using persister_t = current::persistence::Memory<MemoryPersisterBenchmarkEntry>;
+
+  std::mutex mutex;
+  persister_t persister;
+  std::atomic_bool stop;
+  std::atomic_size_t sink;
+  std::thread publisher;
+
+  memory_readers()
+      : persister(mutex, current::ss::StreamNamespaceName("memory_readers", "entry")),
+        stop(false),
+        sink(0u),
+        publisher([this]() {
+          uint64_t value = 0u;
+          while (!stop) {
+            for (uint32_t i = 0u; i < FLAGS_memory_readers_publish_batch; ++i) {
+              MemoryPersisterBenchmarkEntry entry;
+              entry.value = ++value;
+              persister.Publish(std::move(entry));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          }
+        }) {
+    while (persister.Size() < FLAGS_memory_readers_entries) {
+      std::this_thread::yield();
+    }
+  }
+
+  ~memory_readers() {
+    stop = true;
+    publisher.join();
+  }
+
+  void RunOneQuery() override {
+    const uint64_t size = persister.Size();
+    uint64_t total = 0u;
+    for (const auto& e : persister.Iterate(size - FLAGS_memory_readers_entries, size)) {
+      total += e.entry.value;
+    }
+    CURRENT_ASSERT(total);
+    sink += static_cast<size_t>(total);
+  }
+};
+
+REGISTER_SCENARIO(memory_readers);
+
+#endif  // BENCHMARK_SCENARIO_MEMORY_PERSISTER_H
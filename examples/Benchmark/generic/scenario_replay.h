@@ -0,0 +1,106 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef BENCHMARK_SCENARIO_REPLAY_H
+#define BENCHMARK_SCENARIO_REPLAY_H
+
+#include "../../../port.h"
+
+#include <atomic>
+
+#include "../../../Blocks/Persistence/file.h"
+#include "../../../TypeSystem/struct.h"
+#include "../../../TypeSystem/variant.h"
+
+#include "benchmark.h"
+
+#include "../../../Bricks/dflags/dflags.h"
+#include "../../../Bricks/file/file.h"
+
+#ifndef CURRENT_MAKE_CHECK_MODE
+DEFINE_uint32(replay_entries, 10000, "The number of entries in the file to replay.");
+DEFINE_string(replay_file, ".current/replay.json", "The file to create and then to replay.");
+#else
+DECLARE_uint32(replay_entries);
+DECLARE_string(replay_file);
+#endif
+
+CURRENT_STRUCT(ReplayBenchmarkKeyValue) {
+  CURRENT_FIELD(key, std::string);
+  CURRENT_FIELD(value, uint64_t, 0u);
+};
+
+CURRENT_STRUCT(ReplayBenchmarkDeletedKey) { CURRENT_FIELD(key, std::string); };
+
+CURRENT_STRUCT(ReplayBenchmarkTransaction) {
+  CURRENT_FIELD(meta, (std::map<std::string, std::string>));
+  CURRENT_FIELD(mutations, (std::vector<Variant<ReplayBenchmarkKeyValue, ReplayBenchmarkDeletedKey>>));
+  CURRENT_FIELD(comment, Optional<std::string>);
+};
+
+// Each query replays the whole file, parsing every entry, the way a stream or a storage does at startup.
+SCENARIO(replay, "Replay a file of `--replay_entries` JSON entries via the `FilePersister`.") {
+  using persister_t = current::persistence::File<ReplayBenchmarkTransaction>;
+
+  const current::ss::StreamNamespaceName namespace_name = current::ss::StreamNamespaceName("replay", "transaction");
+  std::atomic_size_t sink;
+
+  replay() : sink(0u) {
+    current::FileSystem::RmFile(FLAGS_replay_file, current::FileSystem::RmFileParameters::Silent);
+    std::mutex mutex;
+    persister_t persister(mutex, namespace_name, FLAGS_replay_file);
+    for (uint32_t i = 0u; i < FLAGS_replay_entries; ++i) {
+      ReplayBenchmarkTransaction transaction;
+      transaction.meta["who"] = "benchmark";
+      for (uint32_t j = 0u; j < 5u; ++j) {
+        ReplayBenchmarkKeyValue key_value;
+        key_value.key = "key" + current::ToString(i * 5u + j);
+        key_value.value = i * j;
+        transaction.mutations.push_back(key_value);
+      }
+      ReplayBenchmarkDeletedKey deleted_key;
+      deleted_key.key = "key" + current::ToString(i);
+      transaction.mutations.push_back(deleted_key);
+      if (i % 2u) {
+        transaction.comment = "odd";
+      }
+      persister.Publish(transaction, std::chrono::microseconds(i + 1u));
+    }
+  }
+
+  void RunOneQuery() override {
+    std::mutex mutex;
+    persister_t persister(mutex, namespace_name, FLAGS_replay_file);
+    size_t total = 0u;
+    for (const auto& e : persister.Iterate()) {
+      total += e.entry.mutations.size();
+    }
+    CURRENT_ASSERT(total == FLAGS_replay_entries * 6u);
+    sink += total;
+  }
+};
+
+REGISTER_SCENARIO(replay);
+
+#endif  // BENCHMARK_SCENARIO_REPLAY_H
@@ -40,11 +40,21 @@ DEFINE_string(simple_http_local_route, "/perftest", "Local route for `current_ht
 DEFINE_string(simple_http_test_body,
               "+current -nginx\n",
               "Golden HTTP body to return for the `current_http_server` scenario.");
+DEFINE_uint16(simple_http_keep_alive_port, 9750, "Local port for `current_http_keep_alive` to use.");
+DEFINE_uint32(simple_http_keep_alive_workers,
+              16u,
+              "The number of server worker threads for `current_http_keep_alive`, should be at least `--threads`.");
+DEFINE_bool(simple_http_client_pool,
+            true,
+            "Set to false to disable the client-side connection pool for `current_http_keep_alive`.");
 #else
 DECLARE_uint16(simple_http_local_port);
 DECLARE_uint16(simple_http_local_top_port);
 DECLARE_string(simple_http_local_route);
 DECLARE_string(simple_http_test_body);
+DECLARE_uint16(simple_http_keep_alive_port);
+DECLARE_uint32(simple_http_keep_alive_workers);
+DECLARE_bool(simple_http_client_pool);
 #endif
 
 SCENARIO(current_http_server, "Use Current's HTTP stack for simple HTTP client-server handshake.") {
@@ -68,4 +78,24 @@ SCENARIO(current_http_server, "Use Current's HTTP stack for simple HTTP client-s
 
 REGISTER_SCENARIO(current_http_server);
 
+SCENARIO(current_http_keep_alive, "Use Current's HTTP stack with persistent connections on both ends.") {
+  std::string url;
+  HTTPRoutesScope scope;
+
+  current_http_keep_alive() {
+    auto& server = HTTP(FLAGS_simple_http_keep_alive_port);
+    server.UseWorkerPool(current::http::HTTPServerWorkerPoolParams(FLAGS_simple_http_keep_alive_workers));
+    server.UseKeepAlive(current::net::HTTPKeepAliveParams(static_cast<size_t>(-1), std::chrono::milliseconds(5000)));
+    scope += server.Register(FLAGS_simple_http_local_route, [](Request r) { r(FLAGS_simple_http_test_body); });
+    url = "localhost:" + current::strings::ToString(FLAGS_simple_http_keep_alive_port) + FLAGS_simple_http_local_route;
+    if (!FLAGS_simple_http_client_pool) {
+      current::http::HTTPClientConnections().SetParams(current::http::HTTPClientConnectionPoolParams(0u));
+    }
+  }
+
+  void RunOneQuery() override { CURRENT_ASSERT(HTTP(GET(url)).body == FLAGS_simple_http_test_body); }
+};
+
+REGISTER_SCENARIO(current_http_keep_alive);
+
 #endif  // BENCHMARK_SCENARIO_SIMPLE_HTTP_H
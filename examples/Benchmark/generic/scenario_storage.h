@@ -27,6 +27,8 @@ SOFTWARE.
 
 #include "../../../port.h"
 
+#include <atomic>
+
 #include "benchmark.h"
 
 #include "../../../Bricks/util/random.h"
@@ -39,10 +41,14 @@ SOFTWARE.
 DEFINE_uint32(storage_initial_size, 10000, "The number of records initially in the storage.");
 DEFINE_string(storage_transaction, "empty", "The transaction to run in the inner loop of the load test.");
 DEFINE_bool(storage_test_string, false, "Set to `true` to test 'get' and 'put' with string, not int, keys.");
+DEFINE_uint32(storage_mixed_put_percentage, 10, "The percentage of 'put'-s among 'get'-s for the 'mixed' test.");
+DEFINE_uint32(storage_bulk_size, 1000, "The number of 'put'-s per transaction for the 'bulk' test.");
 #else
 DECLARE_uint32(storage_initial_size);
 DECLARE_string(storage_transaction);
 DECLARE_bool(storage_test_string);
+DECLARE_uint32(storage_mixed_put_percentage);
+DECLARE_uint32(storage_bulk_size);
 #endif
 
 CURRENT_STRUCT(UInt32KeyValuePair) {
@@ -73,17 +79,20 @@ struct NonSerializablePairOfTwoSizeT {
   NonSerializablePairOfTwoSizeT(size_t first, size_t second) : first(first), second(second) {}
 };
 
-SCENARIO(storage, "Storage transactions test.") {
-  using storage_t = KeyValueDB<SherlockInMemoryStreamPersister>;
+template <template <typename> class TRANSACTION_POLICY>
+struct StorageScenarioImpl {
+  using storage_t = KeyValueDB<SherlockInMemoryStreamPersister, TRANSACTION_POLICY>;
   storage_t db;
   size_t actual_size_uint32;
   size_t actual_size_string;
   std::function<void()> f;
+  std::atomic_size_t bulk_mutations{0u};
+  std::atomic_size_t bulk_allocations{0u};
 
   static uint32_t RandomUInt32() { return current::random::RandomIntegral<uint32_t>(1000000, 999999); }
   static std::string RandomString() { return current::ToString(RandomUInt32()); }
 
-  storage() {
+  StorageScenarioImpl() {
     const bool testing_string = FLAGS_storage_test_string;
 
     std::map<std::string, std::function<void()>> tests = {
@@ -117,7 +126,30 @@ SCENARIO(storage, "Storage transactions test.") {
                fields.hashmap_string.Add(StringKeyValuePair(RandomString(), RandomUInt32()));
              }
            }).Wait();
+         }},
+        // Overwrites the same `--storage_bulk_size` keys in each transaction, so that the allocations counted are
+        // those of the transaction itself, not of the growing hashmap.
+        {{"bulk"},
+         [this]() {
+           const size_t allocations_before = ThreadHeapAllocations();
+           db.ReadWriteTransaction([](MutableFields<storage_t> fields) {
+             for (uint32_t i = 0; i < FLAGS_storage_bulk_size; ++i) {
+               fields.hashmap_uint32.Add(UInt32KeyValuePair(i, RandomUInt32()));
+             }
+           }).Wait();
+           bulk_allocations += ThreadHeapAllocations() - allocations_before;
+           bulk_mutations += FLAGS_storage_bulk_size;
          }}};
+    // The read-mostly workload: `--storage_mixed_put_percentage` of 'put'-s, and 'get'-s for the rest.
+    const auto get = tests["get"];
+    const auto put = tests["put"];
+    tests["mixed"] = [get, put]() {
+      if (current::random::RandomIntegral<uint32_t>(0, 99) < FLAGS_storage_mixed_put_percentage) {
+        put();
+      } else {
+        get();
+      }
+    };
     const auto cit = tests.find(FLAGS_storage_transaction);
 
     if (cit != tests.end()) {
@@ -152,9 +184,28 @@ SCENARIO(storage, "Storage transactions test.") {
     }
   }
 
-  void RunOneQuery() override { f(); }
+  ~StorageScenarioImpl() {
+    if (bulk_mutations) {
+      std::cerr << "Transactions of " << FLAGS_storage_bulk_size << " mutations, "
+                << 1.0 * bulk_allocations / bulk_mutations << " allocations per mutation." << std::endl;
+    }
+  }
+
+  void RunOneQuery() { f(); }
+};
+
+SCENARIO(storage, "Storage transactions test.") {
+  StorageScenarioImpl<current::storage::transaction_policy::Synchronous> impl;
+  void RunOneQuery() override { impl.RunOneQuery(); }
 };
 
 REGISTER_SCENARIO(storage);
 
+SCENARIO(storage_shared_reads, "Storage transactions test, with read-only transactions running concurrently.") {
+  StorageScenarioImpl<current::storage::transaction_policy::SynchronousWithSharedReads> impl;
+  void RunOneQuery() override { impl.RunOneQuery(); }
+};
+
+REGISTER_SCENARIO(storage_shared_reads);
+
 #endif  // BENCHMARK_SCENARIO_STORAGE_H
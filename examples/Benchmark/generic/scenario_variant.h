@@ -0,0 +1,150 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef BENCHMARK_SCENARIO_VARIANT_H
+#define BENCHMARK_SCENARIO_VARIANT_H
+
+#include "../../../port.h"
+
+#include <atomic>
+
+#include "../../../TypeSystem/struct.h"
+#include "../../../TypeSystem/variant.h"
+
+#include "benchmark.h"
+
+#include "../../../Bricks/dflags/dflags.h"
+
+#ifndef CURRENT_MAKE_CHECK_MODE
+DEFINE_string(variant, "dispatch", "Variant operation to benchmark, construct/copy/move/dispatch/value.");
+#else
+DECLARE_string(variant);
+#endif
+
+CURRENT_STRUCT(VariantBenchmarkCounter) {
+  CURRENT_FIELD(value, uint64_t, 0u);
+  CURRENT_CONSTRUCTOR(VariantBenchmarkCounter)(uint64_t value = 0u) : value(value) {}
+};
+
+CURRENT_STRUCT(VariantBenchmarkPoint) {
+  CURRENT_FIELD(x, double, 0.0);
+  CURRENT_FIELD(y, double, 0.0);
+  CURRENT_CONSTRUCTOR(VariantBenchmarkPoint)(double x = 0.0, double y = 0.0) : x(x), y(y) {}
+};
+
+CURRENT_STRUCT(VariantBenchmarkName) { CURRENT_FIELD(name, std::string, "name"); };
+
+// Each query runs a batch of `variant_batch_size` operations, as a single one is too cheap to time on its own.
+SCENARIO(variant, "Variant construct/copy/move/dispatch/value test, 1000 operations per query.") {
+  using variant_t = Variant<VariantBenchmarkCounter, VariantBenchmarkPoint, VariantBenchmarkName>;
+  constexpr static size_t variant_batch_size = 1000u;
+
+  std::atomic_size_t sink;
+  std::function<size_t()> f;
+
+  struct Visitor {
+    size_t result = 0u;
+    void operator()(const VariantBenchmarkCounter& counter) { result += counter.value; }
+    void operator()(const VariantBenchmarkPoint& point) { result += static_cast<size_t>(point.x + point.y); }
+    void operator()(const VariantBenchmarkName& name) { result += name.name.length(); }
+  };
+
+  static variant_t Alternative(size_t i) {
+    if (i % 3 == 0) {
+      return VariantBenchmarkCounter(i);
+    } else if (i % 3 == 1) {
+      return VariantBenchmarkPoint(1.0, 2.0);
+    } else {
+      return VariantBenchmarkName();
+    }
+  }
+
+  variant() : sink(0u) {
+    if (FLAGS_variant == "construct") {
+      f = []() {
+        size_t result = 0u;
+        for (size_t i = 0; i < variant_batch_size; ++i) {
+          const variant_t v(VariantBenchmarkPoint(1.0, static_cast<double>(i)));
+          result += static_cast<size_t>(Value<VariantBenchmarkPoint>(v).y);
+        }
+        return result;
+      };
+    } else if (FLAGS_variant == "copy") {
+      f = []() {
+        const variant_t source(VariantBenchmarkPoint(1.0, 2.0));
+        size_t result = 0u;
+        for (size_t i = 0; i < variant_batch_size; ++i) {
+          const variant_t v(source);
+          result += static_cast<size_t>(Value<VariantBenchmarkPoint>(v).y);
+        }
+        return result;
+      };
+    } else if (FLAGS_variant == "move") {
+      f = []() {
+        variant_t a(VariantBenchmarkPoint(1.0, 2.0));
+        size_t result = 0u;
+        for (size_t i = 0; i < variant_batch_size; ++i) {
+          variant_t b(std::move(a));
+          // Observe the moved value, for the moves to not be optimized away.
+          Value<VariantBenchmarkPoint>(b).y = static_cast<double>(i);
+          a = std::move(b);
+          result += static_cast<size_t>(Value<VariantBenchmarkPoint>(a).y);
+        }
+        return result;
+      };
+    } else if (FLAGS_variant == "dispatch") {
+      f = []() {
+        std::vector<variant_t> alternatives;
+        for (size_t i = 0; i < 3u; ++i) {
+          alternatives.push_back(Alternative(i));
+        }
+        Visitor visitor;
+        for (size_t i = 0; i < variant_batch_size; ++i) {
+          alternatives[i % 3].Call(visitor);
+        }
+        return visitor.result;
+      };
+    } else if (FLAGS_variant == "value") {
+      f = []() {
+        const variant_t v(VariantBenchmarkPoint(1.0, 2.0));
+        size_t result = 0u;
+        for (size_t i = 0; i < variant_batch_size; ++i) {
+          if (Exists<VariantBenchmarkPoint>(v)) {
+            result += static_cast<size_t>(Value<VariantBenchmarkPoint>(v).y);
+          }
+        }
+        return result;
+      };
+    } else {
+      std::cerr << "The `--variant` flag must be 'construct', 'copy', 'move', 'dispatch', or 'value'." << std::endl;
+      CURRENT_ASSERT(false);
+    }
+  }
+
+  void RunOneQuery() override { sink += f(); }
+};
+
+REGISTER_SCENARIO(variant);
+
+#endif  // BENCHMARK_SCENARIO_VARIANT_H
@@ -0,0 +1,119 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// Measures the throughput of `persistence::File` publishing, in entries per second, for the regular mode
+// and for a range of group commit settings. Each setting is run with `--threads` concurrent publishers.
+
+#include "../../../Blocks/Persistence/file.h"
+#include "../../../Bricks/dflags/dflags.h"
+#include "../../../Bricks/file/file.h"
+#include "../../../Bricks/strings/split.h"
+
+#include "entry.h"
+
+DEFINE_uint32(threads, 8, "The number of concurrent publishers.");
+DEFINE_uint32(entries_per_thread, 25000, "The number of entries each publisher publishes.");
+DEFINE_uint32(entry_length, 100, "The length of the string member of each entry.");
+DEFINE_string(batch_sizes, "1,10,100,1000", "Comma-separated list of group commit max batch sizes to test.");
+DEFINE_string(delays_us, "0,100,1000", "Comma-separated list of group commit max delays, in microseconds, to test.");
+DEFINE_bool(fdatasync, true, "Also test the `FDataSync` durability level, besides `Flush`.");
+DEFINE_bool(held, true, "Also test the publishers that hold the publish mutex while publishing, as the streams do.");
+DEFINE_string(tmpdir, ".current", "The temporary directory to save the file-persisted stream into.");
+
+using persister_t = current::persistence::File<benchmark::replication::Entry>;
+
+// With `MLS` of `AlreadyLocked`, each publisher locks the publish mutex for each `Publish()`, as the streams do.
+template <current::locks::MutexLockStatus MLS, typename... ARGS>
+double EntriesPerSecond(ARGS&&... args) {
+  const std::string filename = current::FileSystem::JoinPath(FLAGS_tmpdir, "group_commit_benchmark");
+  current::FileSystem::RmFile(filename, current::FileSystem::RmFileParameters::Silent);
+  const auto file_remover = current::FileSystem::ScopedRmFile(filename);
+
+  std::mutex mutex;
+  persister_t persister(
+      mutex, current::ss::StreamNamespaceName("Benchmark", "Entry"), filename, std::forward<ARGS>(args)...);
+  const benchmark::replication::Entry entry(std::string(FLAGS_entry_length, '.'));
+
+  const auto begin = current::time::Now();
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < FLAGS_threads; ++t) {
+    threads.emplace_back([&mutex, &persister, &entry]() {
+      for (uint32_t i = 0; i < FLAGS_entries_per_thread; ++i) {
+        if (MLS == current::locks::MutexLockStatus::AlreadyLocked) {
+          std::lock_guard<std::mutex> lock(mutex);
+          persister.template Publish<MLS>(entry);
+        } else {
+          persister.Publish(entry);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const auto end = current::time::Now();
+
+  CURRENT_ASSERT(persister.Size() == static_cast<uint64_t>(FLAGS_threads) * FLAGS_entries_per_thread);
+  return 1e6 * persister.Size() / (end - begin).count();
+}
+
+int main(int argc, char** argv) {
+  ParseDFlags(&argc, &argv);
+  current::FileSystem::MkDir(FLAGS_tmpdir, current::FileSystem::MkDirParameters::Silent);
+
+  printf("Publishers: %d, entries per publisher: %d, entry length: %d.\n",
+         FLAGS_threads,
+         FLAGS_entries_per_thread,
+         FLAGS_entry_length);
+  using MLS = current::locks::MutexLockStatus;
+  printf("%-48s %15.0lf entries/sec\n", "Regular, flush per entry", EntriesPerSecond<MLS::NeedToLock>());
+
+  std::vector<current::persistence::FilePersisterDurability> durabilities{
+      current::persistence::FilePersisterDurability::Flush};
+  if (FLAGS_fdatasync) {
+    durabilities.push_back(current::persistence::FilePersisterDurability::FDataSync);
+  }
+  for (const auto durability : durabilities) {
+    for (const auto& batch_size : current::strings::Split(FLAGS_batch_sizes, ',')) {
+      for (const auto& delay : current::strings::Split(FLAGS_delays_us, ',')) {
+        const auto setting = current::persistence::FilePersisterGroupCommit(
+            current::FromString<size_t>(batch_size),
+            std::chrono::microseconds(current::FromString<int64_t>(delay)),
+            durability);
+        const auto description =
+            current::strings::Printf("Group, %s, batch %s, delay %sus",
+                                     durability == current::persistence::FilePersisterDurability::Flush ? "flush"
+                                                                                                         : "fdatasync",
+                                     batch_size.c_str(),
+                                     delay.c_str());
+        printf("%-48s %15.0lf entries/sec\n", description.c_str(), EntriesPerSecond<MLS::NeedToLock>(setting));
+        if (FLAGS_held) {
+          printf("%-48s %15.0lf entries/sec\n",
+                 (description + ", held").c_str(),
+                 EntriesPerSecond<MLS::AlreadyLocked>(setting));
+        }
+      }
+    }
+  }
+}
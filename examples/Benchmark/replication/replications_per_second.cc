@@ -23,6 +23,7 @@ SOFTWARE.
 *******************************************************************************/
 
 #include "../../../Bricks/dflags/dflags.h"
+#include "../../../Bricks/strings/split.h"
 
 #include "../../../Sherlock/sherlock.h"
 #include "../../../Sherlock/replicator.h"
@@ -36,6 +37,8 @@ DEFINE_uint32(iterations, 10, "The number of iterations to run.");
 
 DEFINE_string(tmpdir, ".current", "The temporary directory to save file-persisted streams into.");
 
+DEFINE_string(formats, "json,binary", "Comma-separated list of the wire formats to replicate in, `json` or `binary`.");
+
 CURRENT_STRUCT(Event) {
   CURRENT_FIELD(x, int32_t, 0);
   CURRENT_CONSTRUCTOR(Event)(int32_t x = 0) : x(x) {}
@@ -57,7 +60,7 @@ void InitializeStream(std::unique_ptr<current::sherlock::Stream<Event, current::
 }
 
 template <template <typename> class PERSISTER>
-double RunIteration() {
+double RunIteration(current::sherlock::RemoteStreamFormat format) {
   using stream_t = current::sherlock::Stream<Event, PERSISTER>;
 
   // N streams.
@@ -77,7 +80,7 @@ double RunIteration() {
   std::vector<std::unique_ptr<current::sherlock::SubscribableRemoteStream<Event>>> remote_subscribers(FLAGS_n);
   for (uint32_t i = 0; i < FLAGS_n; ++i) {
     remote_subscribers[i] = std::make_unique<current::sherlock::SubscribableRemoteStream<Event>>(
-        Printf("http://localhost:%d/stream", static_cast<uint16_t>(FLAGS_base_port + i)), "Event", "Sherlock");
+        Printf("http://localhost:%d/stream", static_cast<uint16_t>(FLAGS_base_port + i)), "Event", "Sherlock", format);
   }
 
   // (N - 1) replicators, where index zero, "replicate into the source", is left uninitialized.
@@ -109,11 +112,11 @@ double RunIteration() {
 }
 
 template <template <typename> class PERSISTER>
-void Run() {
+void Run(current::sherlock::RemoteStreamFormat format) {
   double sum = 0.0;
   double sum_squares = 0.0;
   for (uint32_t i = 0; i < FLAGS_iterations; ++i) {
-    const double value = RunIteration<PERSISTER>();
+    const double value = RunIteration<PERSISTER>(format);
     printf("Iteration %d/%d, %lf replications per second.\n", i + 1, FLAGS_iterations, value);
     sum += value;
     sum_squares += value * value;
@@ -129,8 +132,19 @@ int main(int argc, char** argv) {
 #ifndef NDEBUG
   printf("DEBUG\n");
 #endif
-  printf("Memory\n");
-  Run<current::persistence::Memory>();
-  printf("File\n");
-  Run<current::persistence::File>();
+  for (const auto& format_name : current::strings::Split(FLAGS_formats, ',')) {
+    current::sherlock::RemoteStreamFormat format;
+    if (format_name == "json") {
+      format = current::sherlock::RemoteStreamFormat::JSON;
+    } else if (format_name == "binary") {
+      format = current::sherlock::RemoteStreamFormat::Binary;
+    } else {
+      printf("The `--formats` should only contain `json` and `binary`.\n");
+      return -1;
+    }
+    printf("Memory, %s\n", format_name.c_str());
+    Run<current::persistence::Memory>(format);
+    printf("File, %s\n", format_name.c_str());
+    Run<current::persistence::File>(format);
+  }
 }